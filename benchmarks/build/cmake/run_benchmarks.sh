@@ -0,0 +1,6 @@
+#!/bin/bash
+set -e
+
+DIR=$(cd $(dirname ${BASH_SOURCE[0]}) && pwd)
+
+${DIR}/acons_benchmarks "$@"
@@ -0,0 +1,194 @@
+#ifndef ACONS_BENCHMARK_HARNESS_HPP
+#define ACONS_BENCHMARK_HARNESS_HPP
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+namespace acons_benchmarks {
+
+// Keeps the compiler from discarding a computed value
+template <typename T>
+void do_not_optimize(const T& value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const T* sink;
+    sink = &value;
+#endif
+}
+
+struct options
+{
+    size_t min_bytes;
+    size_t max_bytes;
+    double min_time;       // seconds per repetition
+    size_t repetitions;
+    std::string filter;
+    bool json;
+
+    options()
+        : min_bytes(1024), max_bytes(size_t(256) << 20), min_time(0.05), repetitions(5), json(false)
+    {
+    }
+
+    static void usage(const char* program)
+    {
+        std::cerr << "usage: " << program
+                  << " [--min-bytes=N] [--max-bytes=N] [--min-time=SECONDS]"
+                     " [--repetitions=N] [--filter=SUBSTRING] [--format=csv|json]\n";
+    }
+
+    bool parse(int argc, char** argv)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const char* arg = argv[i];
+            if (std::strncmp(arg, "--min-bytes=", 12) == 0)
+            {
+                min_bytes = std::strtoull(arg + 12, nullptr, 10);
+            }
+            else if (std::strncmp(arg, "--max-bytes=", 12) == 0)
+            {
+                max_bytes = std::strtoull(arg + 12, nullptr, 10);
+            }
+            else if (std::strncmp(arg, "--min-time=", 11) == 0)
+            {
+                min_time = std::strtod(arg + 11, nullptr);
+            }
+            else if (std::strncmp(arg, "--repetitions=", 14) == 0)
+            {
+                repetitions = (std::max)(size_t(1), size_t(std::strtoull(arg + 14, nullptr, 10)));
+            }
+            else if (std::strncmp(arg, "--filter=", 9) == 0)
+            {
+                filter = arg + 9;
+            }
+            else if (std::strcmp(arg, "--format=json") == 0)
+            {
+                json = true;
+            }
+            else if (std::strcmp(arg, "--format=csv") == 0)
+            {
+                json = false;
+            }
+            else
+            {
+                usage(argv[0]);
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+// Times a benchmark body and writes one record per (library, operation, size).
+// Each repetition runs the body until min_time has elapsed, and the fastest
+// repetition is reported.
+
+class runner
+{
+    options options_;
+    std::ostream& os_;
+    bool first_;
+public:
+    typedef std::chrono::steady_clock clock_type;
+
+    runner(const options& opts, std::ostream& os)
+        : options_(opts), os_(os), first_(true)
+    {
+        if (options_.json)
+        {
+            os_ << "[\n";
+        }
+        else
+        {
+            os_ << "library,operation,elements,bytes,iterations,ns_per_op,ns_per_element\n";
+        }
+    }
+
+    ~runner()
+    {
+        if (options_.json)
+        {
+            os_ << "\n]\n";
+        }
+    }
+
+    const options& get_options() const
+    {
+        return options_;
+    }
+
+    bool selected(const std::string& library, const std::string& operation) const
+    {
+        if (options_.filter.empty())
+        {
+            return true;
+        }
+        return (library + "/" + operation).find(options_.filter) != std::string::npos;
+    }
+
+    template <typename F>
+    void run(const std::string& library, const std::string& operation, size_t elements, size_t bytes, F f)
+    {
+        if (!selected(library, operation))
+        {
+            return;
+        }
+
+        double best = -1.0;
+        size_t best_iterations = 0;
+        for (size_t r = 0; r < options_.repetitions; ++r)
+        {
+            size_t iterations = 0;
+            auto start = clock_type::now();
+            double elapsed = 0.0;
+            do
+            {
+                f();
+                ++iterations;
+                elapsed = std::chrono::duration<double>(clock_type::now() - start).count();
+            }
+            while (elapsed < options_.min_time);
+
+            double per_op = elapsed*1e9/iterations;
+            if (best < 0 || per_op < best)
+            {
+                best = per_op;
+                best_iterations = iterations;
+            }
+        }
+        write(library, operation, elements, bytes, best_iterations, best);
+    }
+private:
+    void write(const std::string& library, const std::string& operation,
+               size_t elements, size_t bytes, size_t iterations, double ns_per_op)
+    {
+        double ns_per_element = elements ? ns_per_op/elements : 0.0;
+        if (options_.json)
+        {
+            os_ << (first_ ? "" : ",\n")
+                << "{\"library\":\"" << library << "\",\"operation\":\"" << operation
+                << "\",\"elements\":" << elements << ",\"bytes\":" << bytes
+                << ",\"iterations\":" << iterations << ",\"ns_per_op\":" << ns_per_op
+                << ",\"ns_per_element\":" << ns_per_element << "}";
+        }
+        else
+        {
+            os_ << library << "," << operation << "," << elements << "," << bytes << ","
+                << iterations << "," << ns_per_op << "," << ns_per_element << "\n";
+        }
+        os_.flush();
+        first_ = false;
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,430 @@
+// Benchmarks acons against boost::multi_array and hand written pointer loops.
+//
+// Square n x n arrays of doubles are swept from L1 resident sizes to far beyond
+// the last level cache. Results are written to stdout as CSV (default) or JSON.
+//
+// Growing an n x n array of zeros to n x (n+1) is measured two ways, since
+// ndarray::resize and multi_array::resize keep different elements.
+// construct_resize_flat keeps the first n*n elements in storage order and fills
+// the rest with zero, as ndarray::resize does. construct_resize_indexed keeps
+// element (i,j) and zeros the new column, as multi_array::resize does, which
+// value initializes the new buffer before copying. Every implementation that is
+// measured for an operation does the same work.
+
+#include <iostream>
+#include <acons/ndarray.hpp>
+#include <sstream>
+#include <memory>
+#include "benchmark_harness.hpp"
+
+#if defined(ACONS_BENCHMARK_BOOST)
+#include <boost/multi_array.hpp>
+#endif
+
+using namespace acons;
+using namespace acons_benchmarks;
+
+namespace {
+
+// print is far slower per element than the other operations, so it is only
+// measured up to this size
+const size_t max_print_bytes = size_t(8) << 20;
+
+void fill_sequence(double* p, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        p[i] = double(i % 1024);
+    }
+}
+
+void run_acons(runner& r, size_t n)
+{
+    const size_t elements = n*n;
+    const size_t bytes = elements*sizeof(double);
+
+    ndarray<double,2> a(n,n,0.0);
+    fill_sequence(a.data(), a.size());
+    ndarray<double,2> b(a);
+    ndarray<double,1> flat(elements,0.0);
+    fill_sequence(flat.data(), flat.size());
+
+    r.run("acons", "construct", elements, bytes, [&]()
+    {
+        ndarray<double,2> c(n,n,0.0);
+        do_not_optimize(c.data());
+    });
+
+    r.run("acons", "access", elements, bytes, [&]()
+    {
+        double sum = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            for (size_t j = 0; j < n; ++j)
+            {
+                sum += a(i,j);
+            }
+        }
+        do_not_optimize(sum);
+    });
+
+    r.run("acons", "slice", elements/4, bytes, [&]()
+    {
+        const_ndarray_view<double,2> v(a, {slice(0,n,2),slice(0,n,2)});
+        double sum = 0;
+        for (size_t i = 0; i < v.shape(0); ++i)
+        {
+            for (size_t j = 0; j < v.shape(1); ++j)
+            {
+                sum += v(i,j);
+            }
+        }
+        do_not_optimize(sum);
+    });
+
+    r.run("acons", "iterator_one", elements, bytes, [&]()
+    {
+        const ndarray<double,1>& cflat = flat;
+        double sum = 0;
+        for (auto it = cflat.begin(); it != cflat.end(); ++it)
+        {
+            sum += *it;
+        }
+        do_not_optimize(sum);
+    });
+
+    r.run("acons", "iterator_n_minus_1", elements, bytes, [&]()
+    {
+        const ndarray<double,2>& ca = a;
+        double sum = 0;
+        for (const auto& row : ca)
+        {
+            for (double x : row)
+            {
+                sum += x;
+            }
+        }
+        do_not_optimize(sum);
+    });
+
+    if (bytes <= max_print_bytes)
+    {
+        r.run("acons", "print", elements, bytes, [&]()
+        {
+            std::ostringstream os;
+            os << a;
+            do_not_optimize(os.tellp());
+        });
+    }
+
+    r.run("acons", "equal", elements, bytes, [&]()
+    {
+        bool result = a == b;
+        do_not_optimize(result);
+    });
+
+    r.run("acons", "construct_resize_flat", elements, bytes, [&]()
+    {
+        ndarray<double,2> c(n,n,0.0);
+        c.resize(extents_t<2>{n,n+1});
+        do_not_optimize(c.data());
+    });
+
+    r.run("acons", "construct_resize_indexed", elements, bytes, [&]()
+    {
+        ndarray<double,2> c(n,n,0.0);
+        ndarray<double,2> d(n,n+1,0.0);
+        for (size_t i = 0; i < n; ++i)
+        {
+            std::copy(&c(i,0), &c(i,0) + n, &d(i,0));
+        }
+        do_not_optimize(d.data());
+    });
+
+    r.run("acons", "copy", elements, bytes, [&]()
+    {
+        ndarray<double,2> c(a);
+        do_not_optimize(c.data());
+    });
+}
+
+#if defined(ACONS_BENCHMARK_BOOST)
+
+void run_boost(runner& r, size_t n)
+{
+    typedef boost::multi_array<double,2> array_type;
+    typedef boost::multi_array<double,1> flat_type;
+    typedef boost::multi_array_types::index_range range;
+
+    const size_t elements = n*n;
+    const size_t bytes = elements*sizeof(double);
+
+    array_type a(boost::extents[n][n]);
+    fill_sequence(a.data(), a.num_elements());
+    array_type b(a);
+    flat_type flat(boost::extents[elements]);
+    fill_sequence(flat.data(), flat.num_elements());
+
+    r.run("boost", "construct", elements, bytes, [&]()
+    {
+        array_type c(boost::extents[n][n]);
+        do_not_optimize(c.data());
+    });
+
+    r.run("boost", "access", elements, bytes, [&]()
+    {
+        double sum = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            for (size_t j = 0; j < n; ++j)
+            {
+                sum += a[i][j];
+            }
+        }
+        do_not_optimize(sum);
+    });
+
+    r.run("boost", "slice", elements/4, bytes, [&]()
+    {
+        auto v = a[boost::indices[range(0,n,2)][range(0,n,2)]];
+        double sum = 0;
+        for (size_t i = 0; i < v.shape()[0]; ++i)
+        {
+            for (size_t j = 0; j < v.shape()[1]; ++j)
+            {
+                sum += v[i][j];
+            }
+        }
+        do_not_optimize(sum);
+    });
+
+    r.run("boost", "iterator_one", elements, bytes, [&]()
+    {
+        const flat_type& cflat = flat;
+        double sum = 0;
+        for (auto it = cflat.begin(); it != cflat.end(); ++it)
+        {
+            sum += *it;
+        }
+        do_not_optimize(sum);
+    });
+
+    r.run("boost", "iterator_n_minus_1", elements, bytes, [&]()
+    {
+        const array_type& ca = a;
+        double sum = 0;
+        for (auto row = ca.begin(); row != ca.end(); ++row)
+        {
+            for (auto it = row->begin(); it != row->end(); ++it)
+            {
+                sum += *it;
+            }
+        }
+        do_not_optimize(sum);
+    });
+
+    if (bytes <= max_print_bytes)
+    {
+        // boost::multi_array has no stream output, print in the same format as acons
+        r.run("boost", "print", elements, bytes, [&]()
+        {
+            std::ostringstream os;
+            os << '[';
+            for (size_t i = 0; i < n; ++i)
+            {
+                os << (i ? ",[" : "[");
+                for (size_t j = 0; j < n; ++j)
+                {
+                    if (j)
+                    {
+                        os << ',';
+                    }
+                    os << a[i][j];
+                }
+                os << ']';
+            }
+            os << ']';
+            do_not_optimize(os.tellp());
+        });
+    }
+
+    r.run("boost", "equal", elements, bytes, [&]()
+    {
+        bool result = a == b;
+        do_not_optimize(result);
+    });
+
+    // multi_array::resize keeps elements by index, there is no flat variant
+    r.run("boost", "construct_resize_indexed", elements, bytes, [&]()
+    {
+        array_type c(boost::extents[n][n]);
+        c.resize(boost::extents[n][n+1]);
+        do_not_optimize(c.data());
+    });
+
+    r.run("boost", "copy", elements, bytes, [&]()
+    {
+        array_type c(a);
+        do_not_optimize(c.data());
+    });
+}
+
+#endif
+
+void run_raw(runner& r, size_t n)
+{
+    const size_t elements = n*n;
+    const size_t bytes = elements*sizeof(double);
+
+    std::unique_ptr<double[]> a(new double[elements]);
+    fill_sequence(a.get(), elements);
+    std::unique_ptr<double[]> b(new double[elements]);
+    std::copy(a.get(), a.get() + elements, b.get());
+
+    r.run("raw", "construct", elements, bytes, [&]()
+    {
+        std::unique_ptr<double[]> c(new double[elements]);
+        std::fill(c.get(), c.get() + elements, 0.0);
+        do_not_optimize(c.get());
+    });
+
+    r.run("raw", "access", elements, bytes, [&]()
+    {
+        const double* p = a.get();
+        double sum = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            for (size_t j = 0; j < n; ++j)
+            {
+                sum += p[i*n + j];
+            }
+        }
+        do_not_optimize(sum);
+    });
+
+    r.run("raw", "slice", elements/4, bytes, [&]()
+    {
+        const double* p = a.get();
+        double sum = 0;
+        for (size_t i = 0; i < n; i += 2)
+        {
+            for (size_t j = 0; j < n; j += 2)
+            {
+                sum += p[i*n + j];
+            }
+        }
+        do_not_optimize(sum);
+    });
+
+    r.run("raw", "iterator_one", elements, bytes, [&]()
+    {
+        const double* p = a.get();
+        double sum = 0;
+        for (const double* it = p; it != p + elements; ++it)
+        {
+            sum += *it;
+        }
+        do_not_optimize(sum);
+    });
+
+    r.run("raw", "iterator_n_minus_1", elements, bytes, [&]()
+    {
+        const double* p = a.get();
+        double sum = 0;
+        for (const double* row = p; row != p + elements; row += n)
+        {
+            for (const double* it = row; it != row + n; ++it)
+            {
+                sum += *it;
+            }
+        }
+        do_not_optimize(sum);
+    });
+
+    if (bytes <= max_print_bytes)
+    {
+        r.run("raw", "print", elements, bytes, [&]()
+        {
+            std::ostringstream os;
+            const double* p = a.get();
+            os << '[';
+            for (size_t i = 0; i < n; ++i)
+            {
+                os << (i ? ",[" : "[");
+                for (size_t j = 0; j < n; ++j)
+                {
+                    if (j)
+                    {
+                        os << ',';
+                    }
+                    os << p[i*n + j];
+                }
+                os << ']';
+            }
+            os << ']';
+            do_not_optimize(os.tellp());
+        });
+    }
+
+    r.run("raw", "equal", elements, bytes, [&]()
+    {
+        bool result = std::equal(a.get(), a.get() + elements, b.get());
+        do_not_optimize(result);
+    });
+
+    r.run("raw", "construct_resize_flat", elements, bytes, [&]()
+    {
+        std::unique_ptr<double[]> c(new double[elements]);
+        std::fill(c.get(), c.get() + elements, 0.0);
+        std::unique_ptr<double[]> d(new double[n*(n+1)]);
+        std::copy(c.get(), c.get() + elements, d.get());
+        std::fill(d.get() + elements, d.get() + n*(n+1), 0.0);
+        do_not_optimize(d.get());
+    });
+
+    r.run("raw", "construct_resize_indexed", elements, bytes, [&]()
+    {
+        std::unique_ptr<double[]> c(new double[elements]);
+        std::fill(c.get(), c.get() + elements, 0.0);
+        std::unique_ptr<double[]> d(new double[n*(n+1)]);
+        std::fill(d.get(), d.get() + n*(n+1), 0.0);
+        for (size_t i = 0; i < n; ++i)
+        {
+            std::copy(c.get() + i*n, c.get() + (i+1)*n, d.get() + i*(n+1));
+        }
+        do_not_optimize(d.get());
+    });
+
+    r.run("raw", "copy", elements, bytes, [&]()
+    {
+        std::unique_ptr<double[]> c(new double[elements]);
+        std::copy(a.get(), a.get() + elements, c.get());
+        do_not_optimize(c.get());
+    });
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    options opts;
+    if (!opts.parse(argc, argv))
+    {
+        return 1;
+    }
+
+    runner r(opts, std::cout);
+    for (size_t n = 16; n*n*sizeof(double) <= opts.max_bytes; n *= 2)
+    {
+        if (n*n*sizeof(double) < opts.min_bytes)
+        {
+            continue;
+        }
+        run_acons(r, n);
+#if defined(ACONS_BENCHMARK_BOOST)
+        run_boost(r, n);
+#endif
+        run_raw(r, n);
+    }
+    return 0;
+}
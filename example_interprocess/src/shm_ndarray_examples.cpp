@@ -0,0 +1,48 @@
+#include <cstdlib> //std::system
+#include <iostream>
+#include <acons/ndarray.hpp>
+#include <acons/shm_ndarray.hpp>
+
+using namespace acons;
+
+typedef shm_ndarray<double,2> ndarray_shm;
+
+int main(int argc, char *argv[])
+{
+    if(argc == 1) //Parent process
+    {  
+       //Remove the segment on construction and destruction
+       struct shm_remove
+       {
+          shm_remove() { ndarray_shm::remove("/MySharedArray"); }
+          ~shm_remove(){ ndarray_shm::remove("/MySharedArray"); }
+       } 
+       remover;
+
+       // Create a 2 x 2 array in a new segment
+       ndarray_shm a = ndarray_shm::create("/MySharedArray", extents_t<2>{2,2}, 0.0);
+
+       a(0,0) = 0;
+       a(0,1) = 1;
+       a(1,0) = 2;
+       a(1,1) = 3;
+
+       std::cout << "Parent process:\n";
+       const_ndarray_view<double,2> v = static_cast<const ndarray_shm&>(a).get_view();
+       std::cout << v << std::endl;
+
+       //Launch child process
+       std::string s(argv[0]); s += " child ";
+       if(0 != std::system(s.c_str()))
+          return 1;
+    }
+    else
+    {
+       // Attach to the segment, the header is checked against double, 2, row_major, zero_based
+       const_shm_ndarray<double,2> a = const_shm_ndarray<double,2>::open("/MySharedArray");
+
+       const_ndarray_view<double,2> v = a.get_view();
+       std::cout << "\nChild process:\n";
+       std::cout << v << "\n";
+    }
+}
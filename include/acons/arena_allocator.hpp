@@ -0,0 +1,304 @@
+#ifndef ACONS_ARENA_ALLOCATOR_HPP
+#define ACONS_ARENA_ALLOCATOR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+#include <stdexcept>
+#include <cassert>
+
+namespace acons {
+
+// monotonic_arena
+//
+// Hands out memory by bumping a pointer through a list of blocks. Individual
+// deallocations are no-ops, memory is reclaimed all at once by release() or
+// rewind(). Blocks are kept after a release, so a workload that repeats the same
+// allocations reaches a steady state with no calls to the system allocator.
+// Not thread safe.
+
+class monotonic_arena
+{
+public:
+    // Position in the arena, used to rewind to an earlier state
+    struct marker
+    {
+        size_t block;
+        size_t used;
+    };
+private:
+    struct block_type
+    {
+        char* data;
+        size_t size;
+        bool owned;
+    };
+
+    std::vector<block_type> blocks_;
+    size_t current_;
+    size_t used_;
+    size_t next_block_size_;
+public:
+    static constexpr size_t default_block_size = 64*1024;
+
+    explicit monotonic_arena(size_t initial_block_size = default_block_size)
+        : current_(0), used_(0), next_block_size_(initial_block_size ? initial_block_size : default_block_size)
+    {
+    }
+
+    // Uses a caller supplied buffer as the first block, further blocks come from operator new
+    monotonic_arena(void* buffer, size_t size)
+        : current_(0), used_(0), next_block_size_(size ? 2*size : default_block_size)
+    {
+        if (buffer != nullptr && size > 0)
+        {
+            blocks_.push_back(block_type{static_cast<char*>(buffer), size, false});
+        }
+    }
+
+    monotonic_arena(const monotonic_arena&) = delete;
+    monotonic_arena& operator=(const monotonic_arena&) = delete;
+
+    ~monotonic_arena()
+    {
+        for (auto& b : blocks_)
+        {
+            if (b.owned)
+            {
+                ::operator delete(b.data);
+            }
+        }
+    }
+
+    void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t))
+    {
+        assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+        while (current_ < blocks_.size())
+        {
+            void* p = bump(blocks_[current_], bytes, alignment);
+            if (p != nullptr)
+            {
+                return p;
+            }
+            ++current_;
+            used_ = 0;
+        }
+
+        size_t size = next_block_size_;
+        while (size < bytes + alignment)
+        {
+            size *= 2;
+        }
+        char* data = static_cast<char*>(::operator new(size));
+        blocks_.push_back(block_type{data, size, true});
+        next_block_size_ = 2*size;
+        current_ = blocks_.size() - 1;
+        used_ = 0;
+        return bump(blocks_[current_], bytes, alignment);
+    }
+
+    void deallocate(void*, size_t) noexcept
+    {
+    }
+
+    marker mark() const noexcept
+    {
+        return marker{current_, used_};
+    }
+
+    // Makes everything allocated since m available again, keeping the blocks
+    void rewind(const marker& m) noexcept
+    {
+        assert(m.block < current_ || (m.block == current_ && m.used <= used_));
+        current_ = m.block;
+        used_ = m.used;
+    }
+
+    // Makes all memory available again, keeping the blocks
+    void release() noexcept
+    {
+        current_ = 0;
+        used_ = 0;
+    }
+
+    size_t num_blocks() const noexcept
+    {
+        return blocks_.size();
+    }
+
+    size_t capacity() const noexcept
+    {
+        size_t n = 0;
+        for (const auto& b : blocks_)
+        {
+            n += b.size;
+        }
+        return n;
+    }
+private:
+    void* bump(const block_type& b, size_t bytes, size_t alignment)
+    {
+        std::uintptr_t base = reinterpret_cast<std::uintptr_t>(b.data);
+        std::uintptr_t p = (base + used_ + alignment - 1) & ~std::uintptr_t(alignment - 1);
+        size_t offset = static_cast<size_t>(p - base);
+        if (offset > b.size || b.size - offset < bytes)
+        {
+            return nullptr;
+        }
+        used_ = offset + bytes;
+        return b.data + offset;
+    }
+};
+
+// arena_allocator
+//
+// Allocator that draws from a monotonic_arena. Copies refer to the same arena,
+// and compare equal when they do.
+
+template <typename T>
+class arena_allocator
+{
+    template <typename U> friend class arena_allocator;
+
+    monotonic_arena* arena_;
+public:
+    typedef T value_type;
+    typedef std::true_type propagate_on_container_copy_assignment;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    template <typename U>
+    struct rebind
+    {
+        typedef arena_allocator<U> other;
+    };
+
+    arena_allocator(monotonic_arena& arena) noexcept
+        : arena_(std::addressof(arena))
+    {
+    }
+
+    template <typename U>
+    arena_allocator(const arena_allocator<U>& other) noexcept
+        : arena_(other.arena_)
+    {
+    }
+
+    T* allocate(size_t n)
+    {
+        if (n > size_t(-1)/sizeof(T))
+        {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(arena_->allocate(n*sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* p, size_t n) noexcept
+    {
+        arena_->deallocate(p, n*sizeof(T));
+    }
+
+    monotonic_arena& arena() const noexcept
+    {
+        return *arena_;
+    }
+
+    template <typename U>
+    friend bool operator==(const arena_allocator& lhs, const arena_allocator<U>& rhs) noexcept
+    {
+        return std::addressof(lhs.arena()) == std::addressof(rhs.arena());
+    }
+
+    template <typename U>
+    friend bool operator!=(const arena_allocator& lhs, const arena_allocator<U>& rhs) noexcept
+    {
+        return !(lhs == rhs);
+    }
+};
+
+// scratch_allocator
+//
+// Stateless allocator that draws from an arena owned by the calling thread. Memory
+// is reclaimed when the innermost enclosing scratch_scope on that thread ends, so
+// arrays using it must not outlive that scope. Memory allocated outside of any scope
+// is reclaimed when the thread exits.
+
+namespace detail {
+
+inline monotonic_arena& scratch_arena()
+{
+    static thread_local monotonic_arena arena;
+    return arena;
+}
+
+}
+
+class scratch_scope
+{
+    monotonic_arena::marker marker_;
+public:
+    scratch_scope() noexcept
+        : marker_(detail::scratch_arena().mark())
+    {
+    }
+
+    scratch_scope(const scratch_scope&) = delete;
+    scratch_scope& operator=(const scratch_scope&) = delete;
+
+    ~scratch_scope()
+    {
+        detail::scratch_arena().rewind(marker_);
+    }
+};
+
+template <typename T>
+class scratch_allocator
+{
+public:
+    typedef T value_type;
+    typedef std::true_type is_always_equal;
+
+    template <typename U>
+    struct rebind
+    {
+        typedef scratch_allocator<U> other;
+    };
+
+    scratch_allocator() = default;
+
+    template <typename U>
+    scratch_allocator(const scratch_allocator<U>&) noexcept
+    {
+    }
+
+    T* allocate(size_t n)
+    {
+        if (n > size_t(-1)/sizeof(T))
+        {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(detail::scratch_arena().allocate(n*sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T*, size_t) noexcept
+    {
+    }
+
+    template <typename U>
+    friend bool operator==(const scratch_allocator&, const scratch_allocator<U>&) noexcept
+    {
+        return true;
+    }
+
+    template <typename U>
+    friend bool operator!=(const scratch_allocator&, const scratch_allocator<U>&) noexcept
+    {
+        return false;
+    }
+};
+
+}
+
+#endif
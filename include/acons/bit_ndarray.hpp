@@ -0,0 +1,835 @@
+#ifndef ACONS_BIT_NDARRAY_HPP
+#define ACONS_BIT_NDARRAY_HPP
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <array>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include <acons/ndarray.hpp>
+
+namespace acons {
+
+namespace detail {
+
+inline size_t popcount64(uint64_t w)
+{
+#if defined(__GNUC__)
+    return static_cast<size_t>(__builtin_popcountll(w));
+#else
+    w = w - ((w >> 1) & 0x5555555555555555ull);
+    w = (w & 0x3333333333333333ull) + ((w >> 2) & 0x3333333333333333ull);
+    w = (w + (w >> 4)) & 0x0f0f0f0f0f0f0f0full;
+    return static_cast<size_t>((w*0x0101010101010101ull) >> 56);
+#endif
+}
+
+// The bits of the last word of a row of n bits that belong to the row
+inline uint64_t last_word_mask(size_t n)
+{
+    return n % 64 == 0 ? ~uint64_t(0) : (uint64_t(1) << (n % 64)) - 1;
+}
+
+// Spreads the eight bits of b into bytes of zero or one: multiplying copies the bits into
+// every byte, the and keeps bit i in byte i, and adding 0x7f carries it into the top bit of
+// its byte
+inline uint64_t spread_byte(uint64_t b)
+{
+    return ((((b*0x0101010101010101ull) & 0x8040201008040201ull) + 0x7f7f7f7f7f7f7f7full) >> 7)
+           & 0x0101010101010101ull;
+}
+
+// Gathers eight bytes of zero or one into the bits of a byte: multiplying moves byte k to
+// bit 56 + k, with no two partial products meeting
+inline uint64_t gather_bytes(uint64_t x)
+{
+    return (x*0x0102040810204080ull) >> 56;
+}
+
+// Written out so that the compiler merges them into single loads and stores
+inline uint64_t load_bytes(const unsigned char* p)
+{
+    return uint64_t(p[0]) | uint64_t(p[1]) << 8 | uint64_t(p[2]) << 16 | uint64_t(p[3]) << 24 |
+           uint64_t(p[4]) << 32 | uint64_t(p[5]) << 40 | uint64_t(p[6]) << 48 | uint64_t(p[7]) << 56;
+}
+
+inline void store_bytes(uint64_t x, unsigned char* p)
+{
+    p[0] = static_cast<unsigned char>(x);
+    p[1] = static_cast<unsigned char>(x >> 8);
+    p[2] = static_cast<unsigned char>(x >> 16);
+    p[3] = static_cast<unsigned char>(x >> 24);
+    p[4] = static_cast<unsigned char>(x >> 32);
+    p[5] = static_cast<unsigned char>(x >> 40);
+    p[6] = static_cast<unsigned char>(x >> 48);
+    p[7] = static_cast<unsigned char>(x >> 56);
+}
+
+// Spreads n bits, rounded up to a multiple of eight, into bytes of zero or one
+inline void unpack_bits(const uint64_t* words, size_t n, unsigned char* bytes)
+{
+    for (size_t j = 0; j < n; j += 8)
+    {
+        store_bytes(spread_byte((words[j/64] >> (j % 64)) & 0xff), bytes + j);
+    }
+}
+
+// Gathers n bytes of zero or one into bits, a word at a time. Bytes past the last multiple
+// of eight may be any nonzero value for true.
+inline void pack_bytes(const unsigned char* bytes, size_t n, uint64_t* words)
+{
+    size_t j = 0;
+    for (; j + 64 <= n; j += 64)
+    {
+        uint64_t w = 0;
+        for (size_t k = 0; k < 8; ++k)
+        {
+            w |= gather_bytes(load_bytes(bytes + j + 8*k)) << (8*k);
+        }
+        words[j/64] = w;
+    }
+    uint64_t w = 0;
+    for (; j + 8 <= n; j += 8)
+    {
+        w |= gather_bytes(load_bytes(bytes + j)) << (j % 64);
+    }
+    for (; j < n; ++j)
+    {
+        w |= uint64_t(bytes[j] != 0) << (j % 64);
+    }
+    if (n % 64 != 0)
+    {
+        words[n/64] = w;
+    }
+}
+
+template <typename T>
+struct is_bit_array : std::false_type
+{
+};
+
+template <size_t N>
+indices_t<N> dense_word_strides(const extents_t<N>& shape)
+{
+    indices_t<N> strides;
+    size_t stride = (shape[N-1] + 63)/64;
+    strides[N-1] = 1;
+    for (size_t i = N - 1; i-- > 0; )
+    {
+        strides[i] = stride;
+        stride *= shape[i];
+    }
+    return strides;
+}
+
+// Narrows a source layout by slices of every dimension but the last, which must be whole
+template <size_t N, typename Base, typename Source>
+size_t slice_bit_layout(const Source& a, const std::array<slice,N>& slices,
+                        extents_t<N>& shape, indices_t<N>& word_strides)
+{
+    const size_t n = a.shape(N-1);
+    if (slices[N-1].start(Base::origin()) != Base::origin() || slices[N-1].stop(Base::origin(), n) != Base::origin() + n ||
+        slices[N-1].step() != 1)
+    {
+        throw std::invalid_argument("bit array views cannot slice the last dimension");
+    }
+    size_t offset = 0;
+    for (size_t i = 0; i < N; ++i)
+    {
+        shape[i] = slices[i].length(Base::origin(), a.shape(i));
+        word_strides[i] = a.word_strides()[i];
+        if (i + 1 < N)
+        {
+            offset += Base::rebase_to_zero(slices[i].start(Base::origin()))*word_strides[i];
+            word_strides[i] *= slices[i].step();
+        }
+    }
+    return offset;
+}
+
+// Drops the leading dimensions of a source layout at the given indices
+template <size_t N, typename Base, typename Source, size_t K>
+size_t first_dim_bit_layout(const Source& a, const indices_t<K>& first_dim,
+                            extents_t<N>& shape, indices_t<N>& word_strides)
+{
+    size_t offset = 0;
+    for (size_t i = 0; i < K; ++i)
+    {
+        assert(Base::rebase_to_zero(first_dim[i]) < a.shape(i));
+        offset += Base::rebase_to_zero(first_dim[i])*a.word_strides()[i];
+    }
+    for (size_t i = 0; i < N; ++i)
+    {
+        shape[i] = a.shape(K+i);
+        word_strides[i] = a.word_strides()[K+i];
+    }
+    return offset;
+}
+
+}
+
+// bit_reference
+//
+// Proxy for one bit of a bit_ndarray or bit_ndarray_view.
+
+class bit_reference
+{
+    uint64_t* word_;
+    uint64_t mask_;
+public:
+    bit_reference(uint64_t* word, size_t bit)
+        : word_(word), mask_(uint64_t(1) << bit)
+    {
+    }
+
+    bit_reference(const bit_reference& other) = default;
+
+    operator bool() const
+    {
+        return (*word_ & mask_) != 0;
+    }
+
+    bit_reference& operator=(bool value)
+    {
+        *word_ = (*word_ & ~mask_) | ((uint64_t(0) - uint64_t(value ? 1 : 0)) & mask_);
+        return *this;
+    }
+
+    bit_reference& operator=(const bit_reference& other)
+    {
+        return *this = static_cast<bool>(other);
+    }
+
+    void flip()
+    {
+        *word_ ^= mask_;
+    }
+};
+
+// Layout shared by bit arrays and views. Elements are bits in index order along the last
+// dimension, and each row along it starts on a new 64 bit word, so the rows can be
+// addressed, sliced and combined a word at a time. word_strides()[i] is the distance in
+// words between rows one apart in dimension i < N-1.
+template <size_t N, typename Base, typename WordPtr>
+class bit_ndarray_base
+{
+protected:
+    WordPtr data_;
+    extents_t<N> shape_;
+    indices_t<N> word_strides_;
+    size_t words_per_row_;
+    size_t rows_;
+
+    bit_ndarray_base()
+        : data_(nullptr), words_per_row_(0), rows_(0)
+    {
+    }
+
+    void set_layout(WordPtr data, const extents_t<N>& shape, const indices_t<N>& word_strides)
+    {
+        data_ = data;
+        shape_ = shape;
+        word_strides_ = word_strides;
+        words_per_row_ = (shape[N-1] + 63)/64;
+        rows_ = 1;
+        for (size_t i = 0; i + 1 < N; ++i)
+        {
+            rows_ *= shape[i];
+        }
+    }
+
+    template <typename... Indices>
+    size_t word_offset(size_t& bit, Indices... indices) const
+    {
+        const size_t index[N] = {static_cast<size_t>(indices)...};
+        return word_offset(bit, index);
+    }
+
+    size_t word_offset(size_t& bit, const size_t* index) const
+    {
+        size_t offset = 0;
+        for (size_t i = 0; i + 1 < N; ++i)
+        {
+            assert(Base::rebase_to_zero(index[i]) < shape_[i]);
+            offset += Base::rebase_to_zero(index[i])*word_strides_[i];
+        }
+        size_t j = Base::rebase_to_zero(index[N-1]);
+        assert(j < shape_[N-1]);
+        bit = j % 64;
+        return offset + j/64;
+    }
+public:
+    static const size_t ndim = N;
+    typedef bool element_type;
+    typedef row_major order_type;
+    typedef Base base_type;
+
+    const extents_t<N>& shape() const
+    {
+        return shape_;
+    }
+
+    size_t shape(size_t i) const
+    {
+        return shape_[i];
+    }
+
+    size_t size() const
+    {
+        return rows_*shape_[N-1];
+    }
+
+    size_t rows() const
+    {
+        return rows_;
+    }
+
+    size_t words_per_row() const
+    {
+        return words_per_row_;
+    }
+
+    const indices_t<N>& word_strides() const
+    {
+        return word_strides_;
+    }
+
+    WordPtr words() const
+    {
+        return data_;
+    }
+
+    // True if the rows follow one another with no gaps, as in an unsliced bit_ndarray
+    bool contiguous() const
+    {
+        size_t expected = words_per_row_;
+        for (size_t i = N - 1; i-- > 0; )
+        {
+            if (shape_[i] != 1 && word_strides_[i] != expected)
+            {
+                return false;
+            }
+            expected *= shape_[i];
+        }
+        return true;
+    }
+
+    // Row r of the first N-1 dimensions, counted in index order
+    WordPtr row_words(size_t r) const
+    {
+        size_t offset = 0;
+        for (size_t i = N - 1; i-- > 0; )
+        {
+            offset += (r % shape_[i])*word_strides_[i];
+            r /= shape_[i];
+        }
+        return data_ + offset;
+    }
+
+    template <typename... Indices>
+    typename std::enable_if<sizeof...(Indices) == N, bool>::type
+    operator()(Indices... indices) const
+    {
+        size_t bit;
+        size_t offset = word_offset(bit, indices...);
+        return ((data_[offset] >> bit) & 1) != 0;
+    }
+
+    bool operator()(const indices_t<N>& indices) const
+    {
+        size_t bit;
+        size_t offset = word_offset(bit, &indices[0]);
+        return ((data_[offset] >> bit) & 1) != 0;
+    }
+
+    size_t count() const
+    {
+        size_t n = 0;
+        for_each_row([&](const uint64_t* w)
+        {
+            for (size_t k = 0; k < words_per_row_; ++k)
+            {
+                n += detail::popcount64(w[k]);
+            }
+        });
+        return n;
+    }
+
+    // Writes the elements into an ndarray or view of bool, or of any type bool converts to,
+    // of the same shape
+    template <typename Mask>
+    void unpack(Mask&& mask) const
+    {
+        typedef typename std::decay<Mask>::type mask_type;
+        static_assert(mask_type::ndim == N, "mask must have the rank of the bit array");
+        if (!std::equal(shape_.begin(), shape_.end(), mask.shape().begin()))
+        {
+            throw std::invalid_argument("mask and bit array shapes differ");
+        }
+        typedef typename std::remove_reference<decltype(*mask.data())>::type mask_element;
+        auto out = mask.data();
+        const size_t step = mask.strides()[N-1];
+        const size_t n = shape_[N-1];
+        std::vector<unsigned char> bytes(words_per_row_*64);
+        size_t r = 0;
+        for_each_row([&](const uint64_t* w)
+        {
+            size_t offset = 0;
+            size_t p = r++;
+            for (size_t i = N - 1; i-- > 0; )
+            {
+                offset += (p % shape_[i])*mask.strides()[i];
+                p /= shape_[i];
+            }
+            if (std::is_same<mask_element,bool>::value && step == 1)
+            {
+                // Whole bytes go straight into the mask
+                unsigned char* dst = reinterpret_cast<unsigned char*>(out + offset);
+                const size_t whole = n - n % 8;
+                detail::unpack_bits(w, whole, dst);
+                for (size_t j = whole; j < n; ++j)
+                {
+                    dst[j] = static_cast<unsigned char>((w[j/64] >> (j % 64)) & 1);
+                }
+                return;
+            }
+            detail::unpack_bits(w, n, bytes.data());
+            for (size_t j = 0; j < n; ++j)
+            {
+                out[offset + j*step] = bytes[j] != 0;
+            }
+        });
+    }
+
+    ndarray<bool,N,row_major,Base> to_mask() const
+    {
+        ndarray<bool,N,row_major,Base> mask(shape_);
+        unpack(mask);
+        return mask;
+    }
+
+protected:
+    // Calls f(words) for each row in index order, stepping through the rows without
+    // recomputing their offsets
+    template <typename F>
+    void for_each_row(F f) const
+    {
+        if (rows_ == 0)
+        {
+            return;
+        }
+        if (contiguous())
+        {
+            for (size_t r = 0; r < rows_; ++r)
+            {
+                f(data_ + r*words_per_row_);
+            }
+            return;
+        }
+        size_t index[N] = {};
+        WordPtr w = data_;
+        for (size_t r = 0; r < rows_; ++r)
+        {
+            f(w);
+            for (size_t i = N - 1; i-- > 0; )
+            {
+                w += word_strides_[i];
+                if (++index[i] < shape_[i])
+                {
+                    break;
+                }
+                w -= shape_[i]*word_strides_[i];
+                index[i] = 0;
+            }
+        }
+    }
+};
+
+// Adds the element and word level operations that write
+template <size_t N, typename Base>
+class mutable_bit_ndarray_base : public bit_ndarray_base<N,Base,uint64_t*>
+{
+    typedef bit_ndarray_base<N,Base,uint64_t*> super_type;
+protected:
+    using super_type::data_;
+    using super_type::shape_;
+    using super_type::words_per_row_;
+
+    template <typename Source, typename Op>
+    void combine(const Source& other, Op op)
+    {
+        static_assert(Source::ndim == N, "bit arrays must have the same rank");
+        if (!std::equal(shape_.begin(), shape_.end(), other.shape().begin()))
+        {
+            throw std::invalid_argument("bit array shapes differ");
+        }
+        const size_t wpr = words_per_row_;
+        if (this->contiguous() && other.contiguous())
+        {
+            const uint64_t* src = other.words();
+            const size_t n = this->rows()*wpr;
+            for (size_t k = 0; k < n; ++k)
+            {
+                data_[k] = op(data_[k], src[k]);
+            }
+            return;
+        }
+        size_t r = 0;
+        this->for_each_row([&](uint64_t* w)
+        {
+            const uint64_t* src = other.row_words(r++);
+            for (size_t k = 0; k < wpr; ++k)
+            {
+                w[k] = op(w[k], src[k]);
+            }
+        });
+    }
+public:
+    using super_type::operator();
+
+    template <typename... Indices>
+    typename std::enable_if<sizeof...(Indices) == N, bit_reference>::type
+    operator()(Indices... indices)
+    {
+        size_t bit;
+        size_t offset = this->word_offset(bit, indices...);
+        return bit_reference(data_ + offset, bit);
+    }
+
+    bit_reference operator()(const indices_t<N>& indices)
+    {
+        size_t bit;
+        size_t offset = this->word_offset(bit, &indices[0]);
+        return bit_reference(data_ + offset, bit);
+    }
+
+    void fill(bool value)
+    {
+        const size_t wpr = words_per_row_;
+        const uint64_t last = value ? detail::last_word_mask(shape_[N-1]) : 0;
+        const uint64_t word = value ? ~uint64_t(0) : 0;
+        this->for_each_row([&](uint64_t* w)
+        {
+            if (wpr > 0)
+            {
+                std::fill(w, w + wpr - 1, word);
+                w[wpr-1] = last;
+            }
+        });
+    }
+
+    // Copies the elements of another bit array or view of the same shape
+    template <typename Source>
+    void assign(const Source& other)
+    {
+        combine(other, [](uint64_t, uint64_t b) {return b;});
+    }
+
+    // Packs the elements of an ndarray or view of bool, or of any type converting to bool,
+    // of the same shape
+    template <typename Mask>
+    void pack(const Mask& mask)
+    {
+        static_assert(Mask::ndim == N, "mask must have the rank of the bit array");
+        if (!std::equal(shape_.begin(), shape_.end(), mask.shape().begin()))
+        {
+            throw std::invalid_argument("mask and bit array shapes differ");
+        }
+        typedef typename std::remove_cv<typename std::remove_reference<decltype(*mask.data())>::type>::type mask_element;
+        auto in = mask.data();
+        const size_t step = mask.strides()[N-1];
+        const size_t n = shape_[N-1];
+        const size_t wpr = words_per_row_;
+        size_t r = 0;
+        this->for_each_row([&](uint64_t* w)
+        {
+            size_t offset = 0;
+            size_t p = r++;
+            for (size_t i = N - 1; i-- > 0; )
+            {
+                offset += (p % shape_[i])*mask.strides()[i];
+                p /= shape_[i];
+            }
+            std::fill(w, w + wpr, uint64_t(0));
+            if (std::is_same<mask_element,bool>::value && step == 1)
+            {
+                detail::pack_bytes(reinterpret_cast<const unsigned char*>(in + offset), n, w);
+                return;
+            }
+            for (size_t j = 0; j < n; ++j)
+            {
+                w[j/64] |= uint64_t(in[offset + j*step] ? 1 : 0) << (j % 64);
+            }
+        });
+    }
+
+    template <typename Source>
+    mutable_bit_ndarray_base& operator&=(const Source& other)
+    {
+        combine(other, [](uint64_t a, uint64_t b) {return a & b;});
+        return *this;
+    }
+
+    template <typename Source>
+    mutable_bit_ndarray_base& operator|=(const Source& other)
+    {
+        combine(other, [](uint64_t a, uint64_t b) {return a | b;});
+        return *this;
+    }
+
+    template <typename Source>
+    mutable_bit_ndarray_base& operator^=(const Source& other)
+    {
+        combine(other, [](uint64_t a, uint64_t b) {return a ^ b;});
+        return *this;
+    }
+
+    // Inverts every element, leaving the bits past the end of each row zero
+    void flip()
+    {
+        const size_t wpr = words_per_row_;
+        const uint64_t last = detail::last_word_mask(shape_[N-1]);
+        this->for_each_row([&](uint64_t* w)
+        {
+            for (size_t k = 0; k < wpr; ++k)
+            {
+                w[k] = ~w[k];
+            }
+            if (wpr > 0)
+            {
+                w[wpr-1] &= last;
+            }
+        });
+    }
+};
+
+// bit_ndarray
+//
+// An N-dimensional array of bits, an eighth of the memory of an ndarray<bool,N>. Elements
+// are read through operator(), and written through the bit_reference proxy it returns
+// for a non-const array. Whole arrays and views are filled, copied, combined with
+// &=, |= and ^=, flipped and counted a 64 bit word at a time.
+
+template <size_t N, typename Base = zero_based, typename Allocator = std::allocator<uint64_t>>
+class bit_ndarray : public mutable_bit_ndarray_base<N,Base>
+{
+    typedef mutable_bit_ndarray_base<N,Base> super_type;
+    std::vector<uint64_t,Allocator> storage_;
+public:
+    typedef Allocator allocator_type;
+
+    explicit bit_ndarray(const extents_t<N>& shape, bool value = false, const Allocator& alloc = Allocator())
+        : storage_(alloc)
+    {
+        indices_t<N> strides = detail::dense_word_strides(shape);
+        size_t words = (shape[N-1] + 63)/64;
+        for (size_t i = 0; i + 1 < N; ++i)
+        {
+            words *= shape[i];
+        }
+        storage_.assign(words, 0);
+        this->set_layout(storage_.data(), shape, strides);
+        if (value)
+        {
+            this->fill(true);
+        }
+    }
+
+    // Packs an ndarray or view of bool, or of any type converting to bool
+    template <typename Mask>
+    explicit bit_ndarray(const Mask& mask, typename std::enable_if<Mask::ndim == N && !detail::is_bit_array<Mask>::value>::type* = 0)
+        : bit_ndarray(mask.shape())
+    {
+        this->pack(mask);
+    }
+
+    // Copies a bit view
+    template <typename Source>
+    explicit bit_ndarray(const Source& other, typename std::enable_if<Source::ndim == N && detail::is_bit_array<Source>::value>::type* = 0)
+        : bit_ndarray(other.shape())
+    {
+        this->assign(other);
+    }
+
+    bit_ndarray(const bit_ndarray& other)
+        : storage_(other.storage_)
+    {
+        this->set_layout(storage_.data(), other.shape(), other.word_strides());
+    }
+
+    bit_ndarray(bit_ndarray&& other) noexcept
+        : storage_(std::move(other.storage_))
+    {
+        this->set_layout(storage_.data(), other.shape(), other.word_strides());
+        other.set_layout(nullptr, extents_t<N>(), indices_t<N>());
+    }
+
+    bit_ndarray& operator=(const bit_ndarray& other)
+    {
+        if (this != &other)
+        {
+            storage_ = other.storage_;
+            this->set_layout(storage_.data(), other.shape(), other.word_strides());
+        }
+        return *this;
+    }
+
+    bit_ndarray& operator=(bit_ndarray&& other) noexcept
+    {
+        if (this != &other)
+        {
+            storage_ = std::move(other.storage_);
+            this->set_layout(storage_.data(), other.shape(), other.word_strides());
+            other.set_layout(nullptr, extents_t<N>(), indices_t<N>());
+        }
+        return *this;
+    }
+
+    const uint64_t* words() const
+    {
+        return this->data_;
+    }
+
+    uint64_t* words()
+    {
+        return this->data_;
+    }
+
+    const uint64_t* row_words(size_t r) const
+    {
+        return this->data_ + r*this->words_per_row_;
+    }
+
+    uint64_t* row_words(size_t r)
+    {
+        return this->data_ + r*this->words_per_row_;
+    }
+};
+
+// bit_ndarray_view, const_bit_ndarray_view
+//
+// Views of a bit_ndarray or of another bit view, either sliced along any dimension but the
+// last, or with leading dimensions fixed at the given indices.
+
+template <size_t N, typename Base = zero_based>
+class bit_ndarray_view : public mutable_bit_ndarray_base<N,Base>
+{
+public:
+    template <typename Source>
+    explicit bit_ndarray_view(Source& a, typename std::enable_if<Source::ndim == N>::type* = 0)
+    {
+        this->set_layout(a.words(), a.shape(), a.word_strides());
+    }
+
+    template <typename Source>
+    bit_ndarray_view(Source& a, const std::array<slice,N>& slices, typename std::enable_if<Source::ndim == N>::type* = 0)
+    {
+        extents_t<N> shape;
+        indices_t<N> strides;
+        size_t offset = detail::slice_bit_layout<N,Base>(a, slices, shape, strides);
+        this->set_layout(a.words() + offset, shape, strides);
+    }
+
+    template <typename Source>
+    bit_ndarray_view(Source& a, const indices_t<Source::ndim - N>& first_dim, typename std::enable_if<(Source::ndim > N)>::type* = 0)
+    {
+        extents_t<N> shape;
+        indices_t<N> strides;
+        size_t offset = detail::first_dim_bit_layout<N,Base>(a, first_dim, shape, strides);
+        this->set_layout(a.words() + offset, shape, strides);
+    }
+
+    bit_ndarray_view(const bit_ndarray_view& other) = default;
+
+    // Assignment copies elements, as with ndarray_view
+    bit_ndarray_view& operator=(const bit_ndarray_view& other)
+    {
+        this->assign(other);
+        return *this;
+    }
+};
+
+template <size_t N, typename Base = zero_based>
+class const_bit_ndarray_view : public bit_ndarray_base<N,Base,const uint64_t*>
+{
+public:
+    template <typename Source>
+    explicit const_bit_ndarray_view(const Source& a, typename std::enable_if<Source::ndim == N>::type* = 0)
+    {
+        this->set_layout(a.words(), a.shape(), a.word_strides());
+    }
+
+    template <typename Source>
+    const_bit_ndarray_view(const Source& a, const std::array<slice,N>& slices, typename std::enable_if<Source::ndim == N>::type* = 0)
+    {
+        extents_t<N> shape;
+        indices_t<N> strides;
+        size_t offset = detail::slice_bit_layout<N,Base>(a, slices, shape, strides);
+        this->set_layout(a.words() + offset, shape, strides);
+    }
+
+    template <typename Source>
+    const_bit_ndarray_view(const Source& a, const indices_t<Source::ndim - N>& first_dim, typename std::enable_if<(Source::ndim > N)>::type* = 0)
+    {
+        extents_t<N> shape;
+        indices_t<N> strides;
+        size_t offset = detail::first_dim_bit_layout<N,Base>(a, first_dim, shape, strides);
+        this->set_layout(a.words() + offset, shape, strides);
+    }
+
+    const_bit_ndarray_view& operator=(const const_bit_ndarray_view&) = delete;
+};
+
+namespace detail {
+
+template <size_t N, typename Base, typename Allocator>
+struct is_bit_array<bit_ndarray<N,Base,Allocator>> : std::true_type
+{
+};
+
+template <size_t N, typename Base>
+struct is_bit_array<bit_ndarray_view<N,Base>> : std::true_type
+{
+};
+
+template <size_t N, typename Base>
+struct is_bit_array<const_bit_ndarray_view<N,Base>> : std::true_type
+{
+};
+
+}
+
+// Two bit arrays or views are equal if they have the same shape and elements
+template <typename A, typename B>
+typename std::enable_if<detail::is_bit_array<A>::value && detail::is_bit_array<B>::value, bool>::type
+operator==(const A& a, const B& b)
+{
+    if (A::ndim != B::ndim || !std::equal(a.shape().begin(), a.shape().end(), b.shape().begin()))
+    {
+        return false;
+    }
+    const size_t wpr = a.words_per_row();
+    for (size_t r = 0; r < a.rows(); ++r)
+    {
+        if (!std::equal(a.row_words(r), a.row_words(r) + wpr, b.row_words(r)))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename A, typename B>
+typename std::enable_if<detail::is_bit_array<A>::value && detail::is_bit_array<B>::value, bool>::type
+operator!=(const A& a, const B& b)
+{
+    return !(a == b);
+}
+
+}
+
+#endif
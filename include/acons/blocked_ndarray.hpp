@@ -0,0 +1,237 @@
+#ifndef ACONS_BLOCKED_NDARRAY_HPP
+#define ACONS_BLOCKED_NDARRAY_HPP
+
+#include <memory>
+#include <stdexcept>
+#include <acons/ndarray.hpp>
+
+namespace acons {
+
+// blocked_ndarray
+//
+// A 2-dimensional array stored as BR x BC tiles. The tiles are laid out in row major 
+// tile order, and each tile is stored contiguously in row major order, so neighbourhood 
+// access along either dimension stays within a few cache lines and pages. 
+// A tiled layout cannot be described by a single stride per dimension, so rather than 
+// an Order policy it is kept as 4-dimensional row major storage 
+// (tile row, tile column, row in tile, column in tile). Edge tiles are padded.
+
+template <typename T, size_t BR, size_t BC, typename Base = zero_based, typename Allocator = std::allocator<T>>
+class blocked_ndarray
+{
+    static_assert(BR > 0 && BC > 0, "block extents must be positive");
+public:
+    typedef ndarray<T,4,row_major,zero_based,Allocator> storage_type;
+    typedef T element_type;
+    typedef Allocator allocator_type;
+    typedef Base base_type;
+    static constexpr size_t ndim = 2;
+    static constexpr size_t block_rows = BR;
+    static constexpr size_t block_cols = BC;
+
+    template <size_t M> using view = ndarray_view<T,M,row_major,Base>;
+    template <size_t M> using const_view = const_ndarray_view<T,M,row_major,Base>;
+private:
+    storage_type tiles_;
+    extents_t<2> shape_;
+public:
+    blocked_ndarray()
+    {
+        shape_.fill(0);
+    }
+
+    blocked_ndarray(size_t rows, size_t cols, const T& val = T())
+        : tiles_(extents_t<4>{tile_count(rows,BR),tile_count(cols,BC),BR,BC}, val), 
+          shape_{rows,cols}
+    {
+    }
+
+    blocked_ndarray(std::allocator_arg_t, const Allocator& alloc, size_t rows, size_t cols, const T& val = T())
+        : tiles_(std::allocator_arg, alloc, extents_t<4>{tile_count(rows,BR),tile_count(cols,BC),BR,BC}, val), 
+          shape_{rows,cols}
+    {
+    }
+
+    template <typename Order, typename TPtr>
+    explicit blocked_ndarray(const ndarray_view_base<T,2,Order,Base,TPtr>& v)
+        : tiles_(extents_t<4>{tile_count(v.shape(0),BR),tile_count(v.shape(1),BC),BR,BC}, T()), 
+          shape_(v.shape())
+    {
+        for (size_t i = 0; i < shape_[0]; ++i)
+        {
+            for (size_t j = 0; j < shape_[1]; ++j)
+            {
+                element(i,j) = v(Base::origin()+i, Base::origin()+j);
+            }
+        }
+    }
+
+    template <typename Order, typename OtherAllocator>
+    explicit blocked_ndarray(const ndarray<T,2,Order,Base,OtherAllocator>& a)
+        : blocked_ndarray(const_ndarray_view<T,2,Order,Base>(a))
+    {
+    }
+
+    blocked_ndarray(const blocked_ndarray&) = default;
+    blocked_ndarray(blocked_ndarray&&) = default;
+    blocked_ndarray& operator=(const blocked_ndarray&) = default;
+    blocked_ndarray& operator=(blocked_ndarray&&) = default;
+
+    allocator_type get_allocator() const
+    {
+        return tiles_.get_allocator();
+    }
+
+    bool empty() const noexcept
+    {
+        return size() == 0;
+    }
+
+    size_t size() const noexcept
+    {
+        return shape_[0]*shape_[1];
+    }
+
+    const extents_t<2>& shape() const {return shape_;}
+
+    size_t shape(size_t i) const
+    {
+        assert(i < shape_.size());
+        return shape_[i];
+    }
+
+    // Number of tiles along each dimension
+    extents_t<2> tiles_shape() const
+    {
+        return extents_t<2>{tiles_.shape(0),tiles_.shape(1)};
+    }
+
+    const storage_type& storage() const
+    {
+        return tiles_;
+    }
+
+    T* data()
+    {
+        return tiles_.data();
+    }
+
+    const T* data() const
+    {
+        return tiles_.data();
+    }
+
+    T& operator()(size_t i, size_t j)
+    {
+        return element(Base::rebase_to_zero(i), Base::rebase_to_zero(j));
+    }
+
+    const T& operator()(size_t i, size_t j) const
+    {
+        return element(Base::rebase_to_zero(i), Base::rebase_to_zero(j));
+    }
+
+    T& operator()(const indices_t<2>& indices)
+    {
+        return (*this)(indices[0], indices[1]);
+    }
+
+    const T& operator()(const indices_t<2>& indices) const
+    {
+        return (*this)(indices[0], indices[1]);
+    }
+
+    // The (padded) BR x BC tile at tile row ti and tile column tj
+    view<2> tile(size_t ti, size_t tj)
+    {
+        assert(ti < tiles_.shape(0) && tj < tiles_.shape(1));
+        return view<2>(tiles_.data() + tile_offset(ti,tj), extents_t<2>{BR,BC});
+    }
+
+    const_view<2> tile(size_t ti, size_t tj) const
+    {
+        assert(ti < tiles_.shape(0) && tj < tiles_.shape(1));
+        return const_view<2>(tiles_.data() + tile_offset(ti,tj), extents_t<2>{BR,BC});
+    }
+
+    template <typename Order = row_major, typename OtherAllocator = std::allocator<T>>
+    ndarray<T,2,Order,Base,OtherAllocator> to_ndarray() const
+    {
+        ndarray<T,2,Order,Base,OtherAllocator> a(shape_);
+        for (size_t ti = 0; ti < tiles_.shape(0); ++ti)
+        {
+            for (size_t tj = 0; tj < tiles_.shape(1); ++tj)
+            {
+                const T* p = tiles_.data() + tile_offset(ti,tj);
+                size_t rows = (std::min)(BR, shape_[0] - ti*BR);
+                size_t cols = (std::min)(BC, shape_[1] - tj*BC);
+                for (size_t ii = 0; ii < rows; ++ii)
+                {
+                    for (size_t jj = 0; jj < cols; ++jj)
+                    {
+                        a(Base::origin() + ti*BR + ii, Base::origin() + tj*BC + jj) = p[ii*BC + jj];
+                    }
+                }
+            }
+        }
+        return a;
+    }
+
+    void swap(blocked_ndarray& other) noexcept
+    {
+        tiles_.swap(other.tiles_);
+        std::swap(shape_, other.shape_);
+    }
+private:
+    static size_t tile_count(size_t n, size_t block)
+    {
+        return n/block + (n % block != 0);
+    }
+
+    size_t tile_offset(size_t ti, size_t tj) const
+    {
+        return (ti*tiles_.shape(1) + tj)*(BR*BC);
+    }
+
+    T& element(size_t i, size_t j)
+    {
+        assert(i < shape_[0] && j < shape_[1]);
+        return tiles_.data()[tile_offset(i/BR, j/BC) + (i % BR)*BC + (j % BC)];
+    }
+
+    const T& element(size_t i, size_t j) const
+    {
+        assert(i < shape_[0] && j < shape_[1]);
+        return tiles_.data()[tile_offset(i/BR, j/BC) + (i % BR)*BC + (j % BC)];
+    }
+};
+
+template <typename T, size_t BR, size_t BC, typename Base, typename Allocator>
+bool operator==(const blocked_ndarray<T,BR,BC,Base,Allocator>& lhs, const blocked_ndarray<T,BR,BC,Base,Allocator>& rhs)
+{
+    if (lhs.shape(0) != rhs.shape(0) || lhs.shape(1) != rhs.shape(1))
+    {
+        return false;
+    }
+    for (size_t i = 0; i < lhs.shape(0); ++i)
+    {
+        for (size_t j = 0; j < lhs.shape(1); ++j)
+        {
+            if (lhs(Base::origin()+i,Base::origin()+j) != rhs(Base::origin()+i,Base::origin()+j))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+template <typename T, size_t BR, size_t BC, typename Base, typename Allocator>
+bool operator!=(const blocked_ndarray<T,BR,BC,Base,Allocator>& lhs, const blocked_ndarray<T,BR,BC,Base,Allocator>& rhs)
+{
+    return !(lhs == rhs);
+}
+
+}
+
+#endif
@@ -0,0 +1,455 @@
+#ifndef ACONS_BUFFER_POOL_HPP
+#define ACONS_BUFFER_POOL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+
+namespace acons {
+
+struct buffer_pool_options
+{
+    // Bytes of free buffers the pool retains, buffers returned beyond this are freed
+    size_t high_water_bytes;
+    // Free buffers of each size and alignment kept by each thread without locking
+    size_t thread_cache_buffers;
+
+    buffer_pool_options()
+        : high_water_bytes(size_t(256) << 20), thread_cache_buffers(4)
+    {
+    }
+
+    buffer_pool_options(size_t high_water, size_t thread_cache)
+        : high_water_bytes(high_water), thread_cache_buffers(thread_cache)
+    {
+    }
+};
+
+struct buffer_pool_stats
+{
+    size_t system_allocations;
+    size_t system_deallocations;
+    size_t pool_hits;
+    size_t retained_bytes;
+};
+
+namespace detail {
+
+// Over-aligned allocation on top of operator new, the original pointer is stored
+// just before the returned one
+inline void* aligned_allocate(size_t bytes, size_t alignment)
+{
+    if (alignment <= alignof(std::max_align_t))
+    {
+        return ::operator new(bytes);
+    }
+    void* raw = ::operator new(bytes + alignment + sizeof(void*));
+    std::uintptr_t p = (reinterpret_cast<std::uintptr_t>(raw) + sizeof(void*) + alignment - 1) & ~std::uintptr_t(alignment - 1);
+    reinterpret_cast<void**>(p)[-1] = raw;
+    return reinterpret_cast<void*>(p);
+}
+
+inline void aligned_deallocate(void* p, size_t alignment) noexcept
+{
+    if (alignment <= alignof(std::max_align_t))
+    {
+        ::operator delete(p);
+    }
+    else
+    {
+        ::operator delete(static_cast<void**>(p)[-1]);
+    }
+}
+
+struct buffer_key
+{
+    size_t bytes;
+    size_t alignment;
+
+    friend bool operator==(const buffer_key& lhs, const buffer_key& rhs)
+    {
+        return lhs.bytes == rhs.bytes && lhs.alignment == rhs.alignment;
+    }
+};
+
+struct buffer_key_hash
+{
+    size_t operator()(const buffer_key& key) const
+    {
+        return std::hash<size_t>()(key.bytes) ^ (std::hash<size_t>()(key.alignment) << 1);
+    }
+};
+
+// Shared between a pool and the thread caches holding its buffers, so that buffers
+// cached by a thread can be returned or freed safely after the pool is gone
+struct buffer_pool_state
+{
+    std::mutex mutex;
+    std::unordered_map<buffer_key,std::vector<void*>,buffer_key_hash> free_lists;
+    buffer_pool_options options;
+    size_t retained_bytes;
+    std::atomic<bool> closed;
+    std::atomic<size_t> system_allocations;
+    std::atomic<size_t> system_deallocations;
+    std::atomic<size_t> pool_hits;
+
+    buffer_pool_state(const buffer_pool_options& opts)
+        : options(opts), retained_bytes(0), closed(false),
+          system_allocations(0), system_deallocations(0), pool_hits(0)
+    {
+    }
+
+    void* system_allocate(const buffer_key& key)
+    {
+        void* p = aligned_allocate(key.bytes, key.alignment);
+        system_allocations.fetch_add(1, std::memory_order_relaxed);
+        return p;
+    }
+
+    void system_deallocate(void* p, const buffer_key& key) noexcept
+    {
+        aligned_deallocate(p, key.alignment);
+        system_deallocations.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void* take(const buffer_key& key)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = free_lists.find(key);
+        if (it == free_lists.end() || it->second.empty())
+        {
+            return nullptr;
+        }
+        void* p = it->second.back();
+        it->second.pop_back();
+        retained_bytes -= key.bytes;
+        return p;
+    }
+
+    void give(void* p, const buffer_key& key) noexcept
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!closed.load(std::memory_order_relaxed) && retained_bytes + key.bytes <= options.high_water_bytes)
+            {
+                try
+                {
+                    free_lists[key].push_back(p);
+                    retained_bytes += key.bytes;
+                    return;
+                }
+                catch (...)
+                {
+                }
+            }
+        }
+        system_deallocate(p, key);
+    }
+
+    void trim() noexcept
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& entry : free_lists)
+        {
+            for (void* p : entry.second)
+            {
+                system_deallocate(p, entry.first);
+            }
+        }
+        free_lists.clear();
+        retained_bytes = 0;
+    }
+};
+
+class buffer_thread_cache
+{
+    struct entry
+    {
+        buffer_pool_state* state;
+        buffer_key key;
+        void* p;
+    };
+
+    // Holds the states of pools this thread caches buffers for, states of destroyed
+    // pools are dropped on the next put
+    std::vector<std::shared_ptr<buffer_pool_state>> states_;
+    std::vector<entry> entries_;
+
+    // Trivially destructible, so it can be read after the cache itself is destroyed
+    static bool& destroyed() noexcept
+    {
+        static thread_local bool flag = false;
+        return flag;
+    }
+public:
+    ~buffer_thread_cache()
+    {
+        destroyed() = true;
+        for (auto& e : entries_)
+        {
+            e.state->give(e.p, e.key);
+        }
+    }
+
+    // Returns nullptr once this thread's cache has been destroyed, for example when
+    // static objects are destroyed after the main thread's thread locals
+    static buffer_thread_cache* instance() noexcept
+    {
+        if (destroyed())
+        {
+            return nullptr;
+        }
+        static thread_local buffer_thread_cache cache;
+        return &cache;
+    }
+
+    void* take(buffer_pool_state* state, const buffer_key& key)
+    {
+        for (size_t i = entries_.size(); i-- > 0; )
+        {
+            if (entries_[i].state == state && entries_[i].key == key)
+            {
+                void* p = entries_[i].p;
+                entries_.erase(entries_.begin() + i);
+                return p;
+            }
+        }
+        return nullptr;
+    }
+
+    bool put(const std::shared_ptr<buffer_pool_state>& state, const buffer_key& key, void* p) noexcept
+    {
+        prune();
+        size_t count = std::count_if(entries_.begin(), entries_.end(),
+                                     [&](const entry& e){return e.state == state.get() && e.key == key;});
+        if (count >= state->options.thread_cache_buffers)
+        {
+            return false;
+        }
+        try
+        {
+            if (std::find(states_.begin(), states_.end(), state) == states_.end())
+            {
+                states_.push_back(state);
+            }
+            entries_.push_back(entry{state.get(), key, p});
+        }
+        catch (...)
+        {
+            return false;
+        }
+        return true;
+    }
+
+    // Returns this thread's cached buffers for a pool to it and forgets the pool
+    void flush(buffer_pool_state* state) noexcept
+    {
+        auto it = std::stable_partition(entries_.begin(), entries_.end(),
+                                        [&](const entry& e){return e.state != state;});
+        for (auto p = it; p != entries_.end(); ++p)
+        {
+            state->give(p->p, p->key);
+        }
+        entries_.erase(it, entries_.end());
+        states_.erase(std::remove_if(states_.begin(), states_.end(),
+                                     [&](const std::shared_ptr<buffer_pool_state>& s){return s.get() == state;}),
+                      states_.end());
+    }
+
+    size_t pool_count() const noexcept
+    {
+        return states_.size();
+    }
+private:
+    // Frees buffers cached for pools that have since been destroyed
+    void prune() noexcept
+    {
+        for (size_t i = states_.size(); i-- > 0; )
+        {
+            if (states_[i]->closed.load(std::memory_order_acquire))
+            {
+                std::shared_ptr<buffer_pool_state> state = states_[i];
+                flush(state.get());
+            }
+        }
+    }
+};
+
+}
+
+// buffer_pool
+//
+// Recycles buffers keyed by byte size and alignment. Freed buffers go first to a
+// small per thread cache, then to a shared free list up to a high water limit, and
+// only beyond that back to the system allocator. A loop that allocates and frees
+// buffers of the same sizes makes no system allocator calls after its first pass.
+
+class buffer_pool
+{
+    std::shared_ptr<detail::buffer_pool_state> state_;
+public:
+    explicit buffer_pool(const buffer_pool_options& options = buffer_pool_options())
+        : state_(std::make_shared<detail::buffer_pool_state>(options))
+    {
+    }
+
+    buffer_pool(const buffer_pool&) = delete;
+    buffer_pool& operator=(const buffer_pool&) = delete;
+
+    ~buffer_pool()
+    {
+        detail::buffer_thread_cache* cache = detail::buffer_thread_cache::instance();
+        if (cache != nullptr)
+        {
+            cache->flush(state_.get());
+        }
+        {
+            std::lock_guard<std::mutex> lock(state_->mutex);
+            state_->closed.store(true, std::memory_order_release);
+        }
+        state_->trim();
+    }
+
+    // Process wide pool, never destroyed so that it can be used from static objects
+    static buffer_pool& global()
+    {
+        static buffer_pool* pool = new buffer_pool();
+        return *pool;
+    }
+
+    void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t))
+    {
+        detail::buffer_key key{bytes, alignment};
+        detail::buffer_thread_cache* cache = detail::buffer_thread_cache::instance();
+        void* p = cache != nullptr ? cache->take(state_.get(), key) : nullptr;
+        if (p == nullptr)
+        {
+            p = state_->take(key);
+        }
+        if (p != nullptr)
+        {
+            state_->pool_hits.fetch_add(1, std::memory_order_relaxed);
+            return p;
+        }
+        return state_->system_allocate(key);
+    }
+
+    void deallocate(void* p, size_t bytes, size_t alignment = alignof(std::max_align_t)) noexcept
+    {
+        if (p == nullptr)
+        {
+            return;
+        }
+        detail::buffer_key key{bytes, alignment};
+        detail::buffer_thread_cache* cache = detail::buffer_thread_cache::instance();
+        if (cache == nullptr || !cache->put(state_, key, p))
+        {
+            state_->give(p, key);
+        }
+    }
+
+    // Frees the shared free lists, buffers in thread caches are not affected
+    void trim() noexcept
+    {
+        state_->trim();
+    }
+
+    buffer_pool_options options() const
+    {
+        return state_->options;
+    }
+
+    buffer_pool_stats stats() const
+    {
+        buffer_pool_stats s;
+        s.system_allocations = state_->system_allocations.load(std::memory_order_relaxed);
+        s.system_deallocations = state_->system_deallocations.load(std::memory_order_relaxed);
+        s.pool_hits = state_->pool_hits.load(std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(state_->mutex);
+            s.retained_bytes = state_->retained_bytes;
+        }
+        return s;
+    }
+};
+
+// pooled_allocator
+//
+// Allocator that draws from a buffer_pool, by default the global pool.
+
+template <typename T>
+class pooled_allocator
+{
+    template <typename U> friend class pooled_allocator;
+
+    buffer_pool* pool_;
+public:
+    typedef T value_type;
+    typedef std::true_type propagate_on_container_copy_assignment;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    template <typename U>
+    struct rebind
+    {
+        typedef pooled_allocator<U> other;
+    };
+
+    // Uses the global pool, which is allocated on first use and may throw std::bad_alloc
+    pooled_allocator()
+        : pool_(std::addressof(buffer_pool::global()))
+    {
+    }
+
+    pooled_allocator(buffer_pool& pool) noexcept
+        : pool_(std::addressof(pool))
+    {
+    }
+
+    template <typename U>
+    pooled_allocator(const pooled_allocator<U>& other) noexcept
+        : pool_(other.pool_)
+    {
+    }
+
+    T* allocate(size_t n)
+    {
+        if (n > size_t(-1)/sizeof(T))
+        {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(pool_->allocate(n*sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* p, size_t n) noexcept
+    {
+        pool_->deallocate(p, n*sizeof(T), alignof(T));
+    }
+
+    buffer_pool& pool() const noexcept
+    {
+        return *pool_;
+    }
+
+    template <typename U>
+    friend bool operator==(const pooled_allocator& lhs, const pooled_allocator<U>& rhs) noexcept
+    {
+        return std::addressof(lhs.pool()) == std::addressof(rhs.pool());
+    }
+
+    template <typename U>
+    friend bool operator!=(const pooled_allocator& lhs, const pooled_allocator<U>& rhs) noexcept
+    {
+        return !(lhs == rhs);
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,359 @@
+#ifndef ACONS_CHUNKED_NDARRAY_HPP
+#define ACONS_CHUNKED_NDARRAY_HPP
+
+#include <memory>
+#include <vector>
+#include <stdexcept>
+#include <acons/ndarray.hpp>
+
+namespace acons {
+
+// chunked_ndarray
+//
+// An N-dimensional array whose index space is split into chunks of a fixed shape, each
+// chunk a separately allocated ndarray. Chunks are allocated on first write, until then
+// every element of the chunk reads as the fill value. Chunks on the upper edges of the
+// array are allocated with the full chunk shape, but views of them are trimmed to the
+// array shape.
+
+template <typename T, size_t N, typename Order = row_major, typename Base = zero_based, typename Allocator = std::allocator<T>>
+class chunked_ndarray
+{
+public:
+    typedef T element_type;
+    typedef Order order_type;
+    typedef Base base_type;
+    typedef Allocator allocator_type;
+    typedef ndarray<T,N,Order,Base,Allocator> chunk_type;
+    static constexpr size_t ndim = N;
+
+    template <size_t M> using view = ndarray_view<T,M,Order,Base>;
+    template <size_t M> using const_view = const_ndarray_view<T,M,Order,Base>;
+private:
+    Allocator allocator_;
+    extents_t<N> shape_;
+    extents_t<N> chunk_shape_;
+    extents_t<N> chunks_shape_;
+    indices_t<N> chunk_strides_;
+    T fill_value_;
+    size_t allocated_;
+    std::vector<std::unique_ptr<chunk_type>> chunks_;
+public:
+    chunked_ndarray(const extents_t<N>& shape, const extents_t<N>& chunk_shape,
+                    const T& fill_value = T(), const Allocator& alloc = Allocator())
+        : allocator_(alloc), shape_(shape), chunk_shape_(chunk_shape), fill_value_(fill_value), allocated_(0)
+    {
+        for (size_t i = 0; i < N; ++i)
+        {
+            if (chunk_shape_[i] == 0)
+            {
+                throw std::invalid_argument("chunk extents must be positive");
+            }
+            chunks_shape_[i] = shape_[i]/chunk_shape_[i] + (shape_[i] % chunk_shape_[i] != 0);
+        }
+        size_t count = 0;
+        row_major::calculate_strides(chunks_shape_, chunk_strides_, count);
+        chunks_.resize(count);
+    }
+
+    chunked_ndarray(const chunked_ndarray& other)
+        : allocator_(other.allocator_), shape_(other.shape_), chunk_shape_(other.chunk_shape_),
+          chunks_shape_(other.chunks_shape_), chunk_strides_(other.chunk_strides_),
+          fill_value_(other.fill_value_), allocated_(other.allocated_), chunks_(other.chunks_.size())
+    {
+        for (size_t k = 0; k < chunks_.size(); ++k)
+        {
+            if (other.chunks_[k])
+            {
+                chunks_[k].reset(new chunk_type(std::allocator_arg, allocator_, *other.chunks_[k]));
+            }
+        }
+    }
+
+    // Leaves other empty, with no chunks and zero extents
+    chunked_ndarray(chunked_ndarray&& other)
+        : allocator_(other.allocator_), shape_(other.shape_), chunk_shape_(other.chunk_shape_),
+          chunks_shape_(other.chunks_shape_), chunk_strides_(other.chunk_strides_),
+          fill_value_(other.fill_value_), allocated_(other.allocated_), chunks_(std::move(other.chunks_))
+    {
+        other.shape_.fill(0);
+        other.chunks_shape_.fill(0);
+        other.chunk_strides_.fill(0);
+        other.allocated_ = 0;
+        other.chunks_.clear();
+    }
+
+    chunked_ndarray& operator=(const chunked_ndarray& other)
+    {
+        if (&other != this)
+        {
+            chunked_ndarray temp(other);
+            swap(temp);
+        }
+        return *this;
+    }
+
+    chunked_ndarray& operator=(chunked_ndarray&& other)
+    {
+        if (&other != this)
+        {
+            chunked_ndarray temp(std::move(other));
+            swap(temp);
+        }
+        return *this;
+    }
+
+    allocator_type get_allocator() const
+    {
+        return allocator_;
+    }
+
+    const extents_t<N>& shape() const {return shape_;}
+
+    size_t shape(size_t i) const
+    {
+        assert(i < N);
+        return shape_[i];
+    }
+
+    size_t size() const
+    {
+        return std::accumulate(shape_.begin(), shape_.end(), size_t(1), std::multiplies<size_t>());
+    }
+
+    const extents_t<N>& chunk_shape() const {return chunk_shape_;}
+
+    // Number of chunks along each dimension
+    const extents_t<N>& chunks_shape() const {return chunks_shape_;}
+
+    size_t num_chunks() const noexcept
+    {
+        return chunks_.size();
+    }
+
+    size_t allocated_chunks() const noexcept
+    {
+        return allocated_;
+    }
+
+    const T& fill_value() const
+    {
+        return fill_value_;
+    }
+
+    bool is_allocated(const indices_t<N>& chunk_index) const
+    {
+        return static_cast<bool>(chunks_[chunk_position(chunk_index)]);
+    }
+
+    // Reads do not allocate
+    template <typename... Indices>
+    const T& operator()(size_t index, Indices... indices) const
+    {
+        return (*this)(indices_t<N>(index, indices...));
+    }
+
+    const T& operator()(const indices_t<N>& indices) const
+    {
+        indices_t<N> within;
+        const chunk_type* c = chunks_[locate(indices, within)].get();
+        return c ? (*c)(within) : fill_value_;
+    }
+
+    // Writes allocate the chunk if it is not yet allocated
+    template <typename... Indices>
+    T& operator()(size_t index, Indices... indices)
+    {
+        return (*this)(indices_t<N>(index, indices...));
+    }
+
+    T& operator()(const indices_t<N>& indices)
+    {
+        indices_t<N> within;
+        return acquire(locate(indices, within))(within);
+    }
+
+    // View of the elements of a chunk, allocating it if needed
+    view<N> chunk(const indices_t<N>& chunk_index)
+    {
+        size_t k = chunk_position(chunk_index);
+        return view<N>(acquire(k), chunk_slices(chunk_index));
+    }
+
+    // View of the elements of an allocated chunk, throws std::out_of_range if it is not allocated
+    const_view<N> chunk(const indices_t<N>& chunk_index) const
+    {
+        size_t k = chunk_position(chunk_index);
+        if (!chunks_[k])
+        {
+            throw std::out_of_range("chunk not allocated");
+        }
+        return const_view<N>(*chunks_[k], chunk_slices(chunk_index));
+    }
+
+    // Frees a chunk, its elements read as the fill value again
+    void release_chunk(const indices_t<N>& chunk_index)
+    {
+        size_t k = chunk_position(chunk_index);
+        if (chunks_[k])
+        {
+            chunks_[k].reset();
+            --allocated_;
+        }
+    }
+
+    // Calls f(chunk_index, view) for each allocated chunk, in row major chunk order
+    template <typename F>
+    void for_each_chunk(F f)
+    {
+        for_each_allocated([&](const indices_t<N>& ci, size_t k)
+        {
+            view<N> v(*chunks_[k], chunk_slices(ci));
+            f(ci, v);
+        });
+    }
+
+    template <typename F>
+    void for_each_chunk(F f) const
+    {
+        for_each_allocated([&](const indices_t<N>& ci, size_t k)
+        {
+            const_view<N> v(*chunks_[k], chunk_slices(ci));
+            f(ci, v);
+        });
+    }
+
+    // Index of the first element of a chunk
+    indices_t<N> chunk_origin(const indices_t<N>& chunk_index) const
+    {
+        indices_t<N> origin;
+        for (size_t i = 0; i < N; ++i)
+        {
+            origin[i] = Base::origin() + chunk_index[i]*chunk_shape_[i];
+        }
+        return origin;
+    }
+
+    template <typename OtherOrder = Order, typename OtherAllocator = std::allocator<T>>
+    ndarray<T,N,OtherOrder,Base,OtherAllocator> to_ndarray() const
+    {
+        ndarray<T,N,OtherOrder,Base,OtherAllocator> a(shape_, fill_value_);
+        for_each_chunk([&](const indices_t<N>& ci, const const_view<N>& v)
+        {
+            indices_t<N> origin = chunk_origin(ci);
+            indices_t<N> local;
+            local.fill(0);
+            copy_chunk(a, v, origin, local, 0);
+        });
+        return a;
+    }
+
+    void swap(chunked_ndarray& other) noexcept
+    {
+        using std::swap;
+        swap(allocator_, other.allocator_);
+        swap(shape_, other.shape_);
+        swap(chunk_shape_, other.chunk_shape_);
+        swap(chunks_shape_, other.chunks_shape_);
+        swap(chunk_strides_, other.chunk_strides_);
+        swap(fill_value_, other.fill_value_);
+        swap(allocated_, other.allocated_);
+        chunks_.swap(other.chunks_);
+    }
+private:
+    size_t chunk_position(const indices_t<N>& chunk_index) const
+    {
+        size_t k = 0;
+        for (size_t i = 0; i < N; ++i)
+        {
+            assert(chunk_index[i] < chunks_shape_[i]);
+            k += chunk_index[i]*chunk_strides_[i];
+        }
+        return k;
+    }
+
+    size_t locate(const indices_t<N>& indices, indices_t<N>& within) const
+    {
+        size_t k = 0;
+        for (size_t i = 0; i < N; ++i)
+        {
+            size_t index = Base::rebase_to_zero(indices[i]);
+            assert(index < shape_[i]);
+            k += (index/chunk_shape_[i])*chunk_strides_[i];
+            within[i] = Base::origin() + index % chunk_shape_[i];
+        }
+        return k;
+    }
+
+    chunk_type& acquire(size_t k)
+    {
+        if (!chunks_[k])
+        {
+            chunks_[k].reset(new chunk_type(std::allocator_arg, allocator_, chunk_shape_, fill_value_));
+            ++allocated_;
+        }
+        return *chunks_[k];
+    }
+
+    std::array<slice,N> chunk_slices(const indices_t<N>& chunk_index) const
+    {
+        std::array<slice,N> slices;
+        for (size_t i = 0; i < N; ++i)
+        {
+            size_t len = (std::min)(chunk_shape_[i], shape_[i] - chunk_index[i]*chunk_shape_[i]);
+            slices[i] = slice(Base::origin(), Base::origin() + len);
+        }
+        return slices;
+    }
+
+    template <typename F>
+    void for_each_allocated(F f) const
+    {
+        indices_t<N> ci;
+        ci.fill(0);
+        for (size_t k = 0; k < chunks_.size(); ++k)
+        {
+            if (chunks_[k])
+            {
+                f(ci, k);
+            }
+            for (size_t i = N; i-- > 0; )
+            {
+                if (++ci[i] < chunks_shape_[i])
+                {
+                    break;
+                }
+                ci[i] = 0;
+            }
+        }
+    }
+
+    template <typename Array>
+    static void copy_chunk(Array& a, const const_view<N>& v,
+                           const indices_t<N>& origin, indices_t<N>& local, size_t dim)
+    {
+        for (size_t j = 0; j < v.shape(dim); ++j)
+        {
+            local[dim] = j;
+            if (dim+1 < N)
+            {
+                copy_chunk(a, v, origin, local, dim+1);
+            }
+            else
+            {
+                indices_t<N> src;
+                indices_t<N> dst;
+                for (size_t i = 0; i < N; ++i)
+                {
+                    src[i] = Base::origin() + local[i];
+                    dst[i] = origin[i] + local[i];
+                }
+                a(dst) = v(src);
+            }
+        }
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,527 @@
+#ifndef ACONS_CONVOLVE_HPP
+#define ACONS_CONVOLVE_HPP
+
+#include <cstddef>
+#include <vector>
+#include <array>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include <acons/ndarray.hpp>
+#include <acons/parallel.hpp>
+#include <acons/linalg.hpp>
+
+namespace acons {
+
+enum class convolve_mode
+{
+    valid,  // only positions where the kernel lies entirely inside the input
+    same,   // the extent of the input, centered on the full output
+    full    // every position where the kernel overlaps the input
+};
+
+// Extents of the output of convolve or correlate. Throws std::invalid_argument if a
+// kernel extent is zero, or in valid mode exceeds the input extent.
+template <size_t N>
+extents_t<N> convolve_shape(const extents_t<N>& input, const extents_t<N>& kernel, convolve_mode mode)
+{
+    extents_t<N> shape;
+    for (size_t i = 0; i < N; ++i)
+    {
+        if (kernel[i] == 0)
+        {
+            throw std::invalid_argument("kernel extent must be positive");
+        }
+        switch (mode)
+        {
+            case convolve_mode::valid:
+                if (kernel[i] > input[i])
+                {
+                    throw std::invalid_argument("kernel is larger than the input in valid mode");
+                }
+                shape[i] = input[i] - kernel[i] + 1;
+                break;
+            case convolve_mode::same:
+                shape[i] = input[i];
+                break;
+            case convolve_mode::full:
+                shape[i] = input[i] + kernel[i] - 1;
+                break;
+        }
+    }
+    return shape;
+}
+
+namespace detail {
+
+// Width of the output row segments that are computed, and spread across threads, as a unit
+const size_t conv_tile_width = 2048;
+
+// Filter banks with at least this many filters and kernel elements use im2col and matmul
+const size_t im2col_min_filters = 4;
+const size_t im2col_min_kernel_size = 9;
+
+// An operand of up to three dimensions, padded with leading dimensions of extent one
+template <typename TPtr>
+struct volume_ref
+{
+    TPtr data;
+    size_t shape[3];
+    size_t strides[3];
+};
+
+// Views dimensions [first, Array::ndim) of a
+template <typename TPtr, typename Array>
+volume_ref<TPtr> make_volume_ref(TPtr data, const Array& a, size_t first)
+{
+    const size_t lead = 3 - (Array::ndim - first);
+    volume_ref<TPtr> v;
+    v.data = data;
+    for (size_t i = 0; i < 3; ++i)
+    {
+        v.shape[i] = i < lead ? 1 : a.shape(first + i - lead);
+        v.strides[i] = i < lead ? 0 : a.strides()[first + i - lead];
+    }
+    return v;
+}
+
+// Kernel weights copied into a contiguous volume, reversed for convolution so that
+// every path computes a correlation
+template <typename T>
+struct conv_kernel
+{
+    std::vector<T> weights;
+    size_t shape[3];
+
+    size_t size() const
+    {
+        return shape[0]*shape[1]*shape[2];
+    }
+};
+
+template <typename T>
+conv_kernel<T> make_conv_kernel(const volume_ref<const T*>& k, bool flip)
+{
+    conv_kernel<T> kernel;
+    kernel.shape[0] = k.shape[0];
+    kernel.shape[1] = k.shape[1];
+    kernel.shape[2] = k.shape[2];
+    kernel.weights.reserve(kernel.size());
+    for (size_t z = 0; z < k.shape[0]; ++z)
+    {
+        for (size_t y = 0; y < k.shape[1]; ++y)
+        {
+            for (size_t x = 0; x < k.shape[2]; ++x)
+            {
+                size_t iz = flip ? k.shape[0] - 1 - z : z;
+                size_t iy = flip ? k.shape[1] - 1 - y : y;
+                size_t ix = flip ? k.shape[2] - 1 - x : x;
+                kernel.weights.push_back(k.data[iz*k.strides[0] + iy*k.strides[1] + ix*k.strides[2]]);
+            }
+        }
+    }
+    return kernel;
+}
+
+inline std::ptrdiff_t conv_padding(size_t k, convolve_mode mode)
+{
+    switch (mode)
+    {
+        case convolve_mode::same:
+            return static_cast<std::ptrdiff_t>(k/2);
+        case convolve_mode::full:
+            return static_cast<std::ptrdiff_t>(k - 1);
+        default:
+            return 0;
+    }
+}
+
+// Splits the output into segments of at most conv_tile_width along its last dimension
+// and calls f(z, y, x_first, x_last) for the segments [first, last)
+struct conv_tiling
+{
+    size_t rows;
+    size_t cols;
+    size_t tiles_per_row;
+
+    conv_tiling(const size_t* shape)
+        : rows(shape[0]*shape[1]), cols(shape[2]),
+          tiles_per_row((shape[2] + conv_tile_width - 1)/conv_tile_width)
+    {
+    }
+
+    size_t count() const
+    {
+        return rows*tiles_per_row;
+    }
+
+    template <typename F>
+    void for_each(size_t first, size_t last, size_t rows_per_plane, F f) const
+    {
+        for (size_t t = first; t < last; ++t)
+        {
+            size_t row = t / tiles_per_row;
+            size_t x0 = (t % tiles_per_row)*conv_tile_width;
+            f(row / rows_per_plane, row % rows_per_plane, x0, (std::min)(cols, x0 + conv_tile_width));
+        }
+    }
+};
+
+inline size_t conv_threads(size_t threads, size_t work)
+{
+    if (work < (size_t(1) << 16))
+    {
+        return 1;
+    }
+    return threads == 0 ? default_thread_count() : threads;
+}
+
+// Direct path: each kernel weight is multiplied into a contiguous segment of an input
+// row and added to an accumulator, a loop the compiler vectorizes
+template <typename T>
+void correlate_segment(const volume_ref<const T*>& in, const conv_kernel<T>& kernel,
+                       const std::ptrdiff_t* pad, size_t z, size_t y, size_t xa, size_t xb,
+                       T* acc)
+{
+    typedef std::ptrdiff_t diff_t;
+    const size_t width = xb - xa;
+    std::fill(acc, acc + width, T());
+    for (size_t kz = 0; kz < kernel.shape[0]; ++kz)
+    {
+        diff_t iz = static_cast<diff_t>(z + kz) - pad[0];
+        if (iz < 0 || iz >= static_cast<diff_t>(in.shape[0]))
+        {
+            continue;
+        }
+        for (size_t ky = 0; ky < kernel.shape[1]; ++ky)
+        {
+            diff_t iy = static_cast<diff_t>(y + ky) - pad[1];
+            if (iy < 0 || iy >= static_cast<diff_t>(in.shape[1]))
+            {
+                continue;
+            }
+            const T* row = in.data + iz*in.strides[0] + iy*in.strides[1];
+            const T* w = kernel.weights.data() + (kz*kernel.shape[1] + ky)*kernel.shape[2];
+            for (size_t kx = 0; kx < kernel.shape[2]; ++kx)
+            {
+                // Input position x + shift for output position x
+                diff_t shift = static_cast<diff_t>(kx) - pad[2];
+                diff_t x0 = (std::max)(static_cast<diff_t>(xa), -shift);
+                diff_t x1 = (std::min)(static_cast<diff_t>(xb), static_cast<diff_t>(in.shape[2]) - shift);
+                if (x0 >= x1)
+                {
+                    continue;
+                }
+                const T wk = w[kx];
+                T* a = acc + (x0 - static_cast<diff_t>(xa));
+                const size_t n = static_cast<size_t>(x1 - x0);
+                if (in.strides[2] == 1)
+                {
+                    const T* src = row + (x0 + shift);
+                    for (size_t i = 0; i < n; ++i)
+                    {
+                        a[i] += wk*src[i];
+                    }
+                }
+                else
+                {
+                    const T* src = row + (x0 + shift)*in.strides[2];
+                    for (size_t i = 0; i < n; ++i)
+                    {
+                        a[i] += wk*src[i*in.strides[2]];
+                    }
+                }
+            }
+        }
+    }
+}
+
+template <typename T>
+void correlate_direct(const volume_ref<const T*>& in, const conv_kernel<T>& kernel,
+                      const volume_ref<T*>& out, const std::ptrdiff_t* pad, size_t threads)
+{
+    conv_tiling tiling(out.shape);
+    threads = conv_threads(threads, out.shape[0]*out.shape[1]*out.shape[2]*kernel.size());
+    parallel_for(tiling.count(), [&](size_t first, size_t last)
+    {
+        std::vector<T> acc((std::min)(out.shape[2], conv_tile_width));
+        tiling.for_each(first, last, out.shape[1], [&](size_t z, size_t y, size_t xa, size_t xb)
+        {
+            correlate_segment(in, kernel, pad, z, y, xa, xb, acc.data());
+            T* dst = out.data + z*out.strides[0] + y*out.strides[1] + xa*out.strides[2];
+            for (size_t i = 0; i < xb - xa; ++i)
+            {
+                dst[i*out.strides[2]] = acc[i];
+            }
+        });
+    }, threads);
+}
+
+// im2col path for a bank of filters: a segment of an output row for every filter is the
+// product of the filter weights, filters x kernel elements, and the matrix of the input
+// elements under each kernel element, kernel elements x segment width
+template <typename T>
+void correlate_im2col(const volume_ref<const T*>& in, const std::vector<T>& weights, const size_t* kshape,
+                      size_t filters, const volume_ref<T*>& out, size_t filter_stride,
+                      const std::ptrdiff_t* pad, size_t threads)
+{
+    typedef std::ptrdiff_t diff_t;
+    const size_t kernel_size = kshape[0]*kshape[1]*kshape[2];
+    conv_tiling tiling(out.shape);
+    threads = conv_threads(threads, filters*out.shape[0]*out.shape[1]*out.shape[2]*kernel_size);
+    matrix_ref<const T*> a{weights.data(), filters, kernel_size, kernel_size, 1};
+
+    parallel_for(tiling.count(), [&](size_t first, size_t last)
+    {
+        std::vector<T> cols(kernel_size*(std::min)(out.shape[2], conv_tile_width));
+        tiling.for_each(first, last, out.shape[1], [&](size_t z, size_t y, size_t xa, size_t xb)
+        {
+            const size_t width = xb - xa;
+            T* col = cols.data();
+            for (size_t kz = 0; kz < kshape[0]; ++kz)
+            {
+                diff_t iz = static_cast<diff_t>(z + kz) - pad[0];
+                bool z_inside = iz >= 0 && iz < static_cast<diff_t>(in.shape[0]);
+                for (size_t ky = 0; ky < kshape[1]; ++ky)
+                {
+                    diff_t iy = static_cast<diff_t>(y + ky) - pad[1];
+                    bool inside = z_inside && iy >= 0 && iy < static_cast<diff_t>(in.shape[1]);
+                    const T* row = inside ? in.data + iz*in.strides[0] + iy*in.strides[1] : nullptr;
+                    for (size_t kx = 0; kx < kshape[2]; ++kx)
+                    {
+                        // Output positions [x0,x1) read inside the input, the rest are zero
+                        diff_t shift = static_cast<diff_t>(kx) - pad[2];
+                        diff_t x0 = (std::max)(static_cast<diff_t>(xa), -shift);
+                        diff_t x1 = (std::min)(static_cast<diff_t>(xb), static_cast<diff_t>(in.shape[2]) - shift);
+                        if (!inside || x0 >= x1)
+                        {
+                            std::fill(col, col + width, T());
+                        }
+                        else
+                        {
+                            size_t lo = static_cast<size_t>(x0) - xa;
+                            size_t hi = static_cast<size_t>(x1) - xa;
+                            std::fill(col, col + lo, T());
+                            const T* src = row + (x0 + shift)*in.strides[2];
+                            for (size_t i = 0; i < hi - lo; ++i)
+                            {
+                                col[lo + i] = src[i*in.strides[2]];
+                            }
+                            std::fill(col + hi, col + width, T());
+                        }
+                        col += width;
+                    }
+                }
+            }
+            matrix_ref<const T*> b{cols.data(), kernel_size, width, width, 1};
+            matrix_ref<T*> c{out.data + z*out.strides[0] + y*out.strides[1] + xa*out.strides[2],
+                             filters, width, filter_stride, out.strides[2]};
+            gemm(a, b, c, 1);
+        });
+    }, threads);
+}
+
+template <size_t N, typename In, typename K, typename Out>
+void check_convolve_shapes(const In& input, const K& kernel, const Out& output, size_t first, convolve_mode mode)
+{
+    static_assert(N >= 1 && N <= 3, "convolve supports one, two and three dimensional arrays");
+    static_assert(std::is_same<typename In::element_type, typename K::element_type>::value &&
+                  std::is_same<typename In::element_type, typename Out::element_type>::value,
+                  "convolve operands must have the same element type");
+    extents_t<N> kshape;
+    extents_t<N> oshape;
+    for (size_t i = 0; i < N; ++i)
+    {
+        kshape[i] = kernel.shape(first + i);
+        oshape[i] = output.shape(first + i);
+    }
+    extents_t<N> expected = convolve_shape(input.shape(), kshape, mode);
+    if (!std::equal(expected.begin(), expected.end(), oshape.begin()))
+    {
+        throw std::invalid_argument("convolve output has the wrong shape");
+    }
+}
+
+template <typename In, typename K, typename Out>
+void convolve_single(const In& input, const K& kernel, Out& output, convolve_mode mode, bool flip, size_t threads)
+{
+    typedef typename In::element_type T;
+    check_convolve_shapes<In::ndim>(input, kernel, output, 0, mode);
+    conv_kernel<T> k = make_conv_kernel(make_volume_ref(kernel.data(), kernel, 0), flip);
+    std::ptrdiff_t pad[3];
+    for (size_t i = 0; i < 3; ++i)
+    {
+        pad[i] = conv_padding(k.shape[i], mode);
+    }
+    correlate_direct(make_volume_ref(input.data(), input, 0), k, make_volume_ref(output.data(), output, 0), pad, threads);
+}
+
+template <typename In, typename K, typename Out>
+void convolve_bank(const In& input, const K& kernels, Out& output, convolve_mode mode, bool flip, size_t threads)
+{
+    typedef typename In::element_type T;
+    const size_t filters = kernels.shape(0);
+    if (output.shape(0) != filters)
+    {
+        throw std::invalid_argument("convolve output has the wrong number of filters");
+    }
+    check_convolve_shapes<In::ndim>(input, kernels, output, 1, mode);
+
+    volume_ref<const T*> in = make_volume_ref(input.data(), input, 0);
+    volume_ref<const T*> first = make_volume_ref(kernels.data(), kernels, 1);
+    std::ptrdiff_t pad[3];
+    for (size_t i = 0; i < 3; ++i)
+    {
+        pad[i] = conv_padding(first.shape[i], mode);
+    }
+
+    const size_t kernel_size = first.shape[0]*first.shape[1]*first.shape[2];
+    if (filters >= im2col_min_filters && kernel_size >= im2col_min_kernel_size)
+    {
+        std::vector<T> weights;
+        weights.reserve(filters*kernel_size);
+        for (size_t f = 0; f < filters; ++f)
+        {
+            volume_ref<const T*> kf = first;
+            kf.data = kernels.data() + f*kernels.strides()[0];
+            conv_kernel<T> k = make_conv_kernel(kf, flip);
+            weights.insert(weights.end(), k.weights.begin(), k.weights.end());
+        }
+        correlate_im2col(in, weights, first.shape, filters, make_volume_ref(output.data(), output, 1),
+                         output.strides()[0], pad, threads);
+    }
+    else
+    {
+        for (size_t f = 0; f < filters; ++f)
+        {
+            volume_ref<const T*> kf = first;
+            kf.data = kernels.data() + f*kernels.strides()[0];
+            volume_ref<T*> of = make_volume_ref(output.data() + f*output.strides()[0], output, 1);
+            correlate_direct(in, make_conv_kernel(kf, flip), of, pad, threads);
+        }
+    }
+}
+
+template <typename In, typename K, size_t N, typename Out>
+void convolve_separable(const In& input, const std::array<K,N>& kernels, Out& output, convolve_mode mode, bool flip, size_t threads)
+{
+    typedef typename In::element_type T;
+    static_assert(N == In::ndim, "one kernel is needed for each dimension");
+    static_assert(K::ndim == 1, "separable kernels must be one dimensional");
+
+    extents_t<N> kshape;
+    for (size_t i = 0; i < N; ++i)
+    {
+        kshape[i] = kernels[i].shape(0);
+    }
+    extents_t<N> expected = convolve_shape(input.shape(), kshape, mode);
+    if (!std::equal(expected.begin(), expected.end(), output.shape().begin()))
+    {
+        throw std::invalid_argument("convolve output has the wrong shape");
+    }
+
+    // One pass along each dimension, through contiguous temporaries
+    volume_ref<const T*> in = make_volume_ref(input.data(), input, 0);
+    volume_ref<T*> out = make_volume_ref(output.data(), output, 0);
+    std::vector<T> buffers[2];
+    for (size_t d = 0; d < N; ++d)
+    {
+        const size_t axis = 3 - N + d;
+        volume_ref<const T*> k1 = {kernels[d].data(), {1, 1, 1}, {0, 0, 0}};
+        k1.shape[axis] = kernels[d].shape(0);
+        k1.strides[axis] = kernels[d].strides()[0];
+        conv_kernel<T> k = make_conv_kernel(k1, flip);
+
+        std::ptrdiff_t pad[3] = {0, 0, 0};
+        pad[axis] = conv_padding(k.shape[axis], mode);
+
+        volume_ref<T*> next;
+        if (d + 1 == N)
+        {
+            next = out;
+        }
+        else
+        {
+            next.shape[0] = in.shape[0];
+            next.shape[1] = in.shape[1];
+            next.shape[2] = in.shape[2];
+            next.shape[axis] = out.shape[axis];
+            std::vector<T>& buffer = buffers[d % 2];
+            buffer.resize(next.shape[0]*next.shape[1]*next.shape[2]);
+            next.data = buffer.data();
+            next.strides[0] = next.shape[1]*next.shape[2];
+            next.strides[1] = next.shape[2];
+            next.strides[2] = 1;
+        }
+        correlate_direct(in, k, next, pad, threads);
+        in = volume_ref<const T*>{next.data, {next.shape[0], next.shape[1], next.shape[2]},
+                                  {next.strides[0], next.strides[1], next.strides[2]}};
+    }
+}
+
+}
+
+// convolve, correlate
+//
+// Convolution and correlation of one, two and three dimensional arrays. The input,
+// kernel and output may be ndarrays or views of either order with any strides, the
+// output must have the shape given by convolve_shape. Input elements outside the
+// array are taken as zero. The output is computed in row segments spread across threads.
+//
+// With a kernel of the same rank as the input, each segment accumulates one kernel
+// weight at a time into a contiguous buffer. With a bank of kernels, one more leading
+// dimension on the kernel and the output, larger banks are computed with im2col and
+// matmul.
+
+template <typename In, typename K, typename Out>
+typename std::enable_if<K::ndim == In::ndim && std::decay<Out>::type::ndim == In::ndim>::type
+convolve(const In& input, const K& kernel, Out&& output,
+         convolve_mode mode = convolve_mode::valid, size_t threads = 0)
+{
+    detail::convolve_single(input, kernel, output, mode, true, threads);
+}
+
+template <typename In, typename K, typename Out>
+typename std::enable_if<K::ndim == In::ndim && std::decay<Out>::type::ndim == In::ndim>::type
+correlate(const In& input, const K& kernel, Out&& output,
+          convolve_mode mode = convolve_mode::valid, size_t threads = 0)
+{
+    detail::convolve_single(input, kernel, output, mode, false, threads);
+}
+
+template <typename In, typename K, typename Out>
+typename std::enable_if<K::ndim == In::ndim + 1 && std::decay<Out>::type::ndim == In::ndim + 1>::type
+convolve(const In& input, const K& kernels, Out&& output,
+         convolve_mode mode = convolve_mode::valid, size_t threads = 0)
+{
+    detail::convolve_bank(input, kernels, output, mode, true, threads);
+}
+
+template <typename In, typename K, typename Out>
+typename std::enable_if<K::ndim == In::ndim + 1 && std::decay<Out>::type::ndim == In::ndim + 1>::type
+correlate(const In& input, const K& kernels, Out&& output,
+          convolve_mode mode = convolve_mode::valid, size_t threads = 0)
+{
+    detail::convolve_bank(input, kernels, output, mode, false, threads);
+}
+
+// Convolution with the outer product of one dimensional kernels, one for each dimension,
+// computed as one pass along each dimension
+template <typename In, typename K, size_t N, typename Out>
+void convolve_separable(const In& input, const std::array<K,N>& kernels, Out&& output,
+                        convolve_mode mode = convolve_mode::valid, size_t threads = 0)
+{
+    detail::convolve_separable(input, kernels, output, mode, true, threads);
+}
+
+template <typename In, typename K, size_t N, typename Out>
+void correlate_separable(const In& input, const std::array<K,N>& kernels, Out&& output,
+                         convolve_mode mode = convolve_mode::valid, size_t threads = 0)
+{
+    detail::convolve_separable(input, kernels, output, mode, false, threads);
+}
+
+}
+
+#endif
@@ -0,0 +1,694 @@
+#ifndef ACONS_DYN_NDARRAY_HPP
+#define ACONS_DYN_NDARRAY_HPP
+
+#include <memory>
+#include <vector>
+#include <stdexcept>
+#include <initializer_list>
+#include <acons/ndarray.hpp>
+
+#ifndef ACONS_DYN_INLINE_RANK
+#define ACONS_DYN_INLINE_RANK 8
+#endif
+
+namespace acons {
+
+namespace detail {
+
+// small_array holds up to Capacity elements inline, and larger sizes on the heap
+
+template <typename T, size_t Capacity>
+class small_array
+{
+    size_t size_;
+    T inline_[Capacity];
+    std::unique_ptr<T[]> heap_;
+public:
+    typedef T value_type;
+    typedef T* iterator;
+    typedef const T* const_iterator;
+
+    small_array()
+        : size_(0)
+    {
+    }
+
+    explicit small_array(size_t n, const T& val = T())
+        : size_(n)
+    {
+        if (n > Capacity)
+        {
+            heap_.reset(new T[n]);
+        }
+        std::fill(begin(), end(), val);
+    }
+
+    small_array(std::initializer_list<T> list)
+        : small_array(list.size())
+    {
+        std::copy(list.begin(), list.end(), begin());
+    }
+
+    template <size_t N>
+    small_array(const element_array<T,N>& a)
+        : small_array(N)
+    {
+        std::copy(a.begin(), a.end(), begin());
+    }
+
+    small_array(const small_array& other)
+        : small_array(other.size())
+    {
+        std::copy(other.begin(), other.end(), begin());
+    }
+
+    small_array(small_array&& other) noexcept
+        : size_(other.size_), heap_(std::move(other.heap_))
+    {
+        if (size_ <= Capacity)
+        {
+            std::copy(other.inline_, other.inline_ + size_, inline_);
+        }
+        other.size_ = 0;
+    }
+
+    small_array& operator=(const small_array& other)
+    {
+        if (&other != this)
+        {
+            small_array temp(other);
+            swap(temp);
+        }
+        return *this;
+    }
+
+    small_array& operator=(small_array&& other) noexcept
+    {
+        if (&other != this)
+        {
+            swap(other);
+        }
+        return *this;
+    }
+
+    void swap(small_array& other) noexcept
+    {
+        for (size_t i = 0; i < Capacity; ++i)
+        {
+            std::swap(inline_[i], other.inline_[i]);
+        }
+        std::swap(size_, other.size_);
+        heap_.swap(other.heap_);
+    }
+
+    size_t size() const noexcept
+    {
+        return size_;
+    }
+
+    T* data() noexcept
+    {
+        return size_ <= Capacity ? inline_ : heap_.get();
+    }
+
+    const T* data() const noexcept
+    {
+        return size_ <= Capacity ? inline_ : heap_.get();
+    }
+
+    T& operator[](size_t i)
+    {
+        assert(i < size_);
+        return data()[i];
+    }
+
+    const T& operator[](size_t i) const
+    {
+        assert(i < size_);
+        return data()[i];
+    }
+
+    iterator begin() {return data();}
+    iterator end() {return data() + size_;}
+    const_iterator begin() const {return data();}
+    const_iterator end() const {return data() + size_;}
+
+    friend bool operator==(const small_array& lhs, const small_array& rhs)
+    {
+        return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin());
+    }
+
+    friend bool operator!=(const small_array& lhs, const small_array& rhs)
+    {
+        return !(lhs == rhs);
+    }
+};
+
+} // namespace detail
+
+typedef detail::small_array<size_t,ACONS_DYN_INLINE_RANK> dyn_extents_t;
+typedef detail::small_array<size_t,ACONS_DYN_INLINE_RANK> dyn_indices_t;
+
+template <typename T, typename Order = row_major, typename Base = zero_based, typename Allocator = std::allocator<T>>
+class dyn_ndarray;
+
+template <typename T, typename Order, typename Base, typename TPtr>
+class dyn_ndarray_view_base;
+
+template <typename T, typename Order = row_major, typename Base = zero_based>
+class dyn_ndarray_view;
+
+template <typename T, typename Order = row_major, typename Base = zero_based>
+class const_dyn_ndarray_view;
+
+namespace detail {
+
+template <size_t N>
+void check_rank(size_t rank)
+{
+    if (rank != N)
+    {
+        throw std::invalid_argument("array rank does not match requested rank");
+    }
+}
+
+template <typename Base>
+size_t dyn_offset(const dyn_indices_t&, size_t)
+{
+    return 0;
+}
+
+template <typename Base, typename... Indices>
+size_t dyn_offset(const dyn_indices_t& strides, size_t pos, size_t index, Indices... indices)
+{
+    return Base::rebase_to_zero(index)*strides[pos] + dyn_offset<Base>(strides, pos+1, indices...);
+}
+
+template <typename Base>
+size_t dyn_offset(const dyn_indices_t& strides, const dyn_indices_t& indices)
+{
+    assert(indices.size() == strides.size());
+    size_t offset = 0;
+    for (size_t i = 0; i < indices.size(); ++i)
+    {
+        offset += Base::rebase_to_zero(indices[i])*strides[i];
+    }
+    return offset;
+}
+
+template <size_t N>
+size_t total_offset(const indices_t<N>& offsets)
+{
+    return std::accumulate(offsets.begin(), offsets.end(), size_t(0));
+}
+
+} // namespace detail
+
+// dyn_ndarray_view_base
+
+template <typename T, typename Order, typename Base, typename TPtr>
+class dyn_ndarray_view_base
+{
+public:
+    typedef Order order_type;
+    typedef Base base_type;
+    typedef T element_type;
+protected:
+    TPtr base_data_;
+    size_t base_size_;
+    size_t offset_;
+    dyn_extents_t shape_;
+    dyn_indices_t strides_;
+public:
+    dyn_ndarray_view_base()
+        : base_data_(nullptr), base_size_(0), offset_(0)
+    {
+    }
+
+    dyn_ndarray_view_base(TPtr data, size_t size, size_t offset,
+                          const dyn_extents_t& shape, const dyn_indices_t& strides)
+        : base_data_(data), base_size_(size), offset_(offset), shape_(shape), strides_(strides)
+    {
+        assert(shape_.size() == strides_.size());
+    }
+
+    dyn_ndarray_view_base(TPtr data, const dyn_extents_t& shape)
+        : base_data_(data), offset_(0), shape_(shape), strides_(shape.size())
+    {
+        Order::calculate_strides(shape_.data(), strides_.data(), shape_.size(), base_size_);
+    }
+
+    size_t rank() const noexcept
+    {
+        return shape_.size();
+    }
+
+    size_t size() const
+    {
+        return std::accumulate(shape_.begin(), shape_.end(), size_t(1), std::multiplies<size_t>());
+    }
+
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    size_t base_size() const noexcept
+    {
+        return base_size_;
+    }
+
+    size_t offset() const noexcept
+    {
+        return offset_;
+    }
+
+    const dyn_extents_t& shape() const {return shape_;}
+
+    const dyn_indices_t& strides() const {return strides_;}
+
+    size_t shape(size_t i) const
+    {
+        assert(i < shape_.size());
+        return shape_[i];
+    }
+
+    const T* base_data() const
+    {
+        return base_data_;
+    }
+
+    template <typename tptr=TPtr>
+    typename std::enable_if<!is_pointer_to_const<tptr>::value,T*>::type
+    base_data()
+    {
+        return base_data_;
+    }
+
+    const T* data() const
+    {
+        return base_data_ + offset_;
+    }
+
+    template <typename tptr=TPtr>
+    typename std::enable_if<!is_pointer_to_const<tptr>::value,T*>::type
+    data()
+    {
+        return base_data_ + offset_;
+    }
+
+    template <typename... Indices>
+    const T& operator()(size_t index, Indices... indices) const
+    {
+        assert(sizeof...(Indices)+1 == rank());
+        size_t off = offset_ + detail::dyn_offset<Base>(strides_, 0, index, indices...);
+        assert(off < base_size_);
+        return base_data_[off];
+    }
+
+    const T& operator()(const dyn_indices_t& indices) const
+    {
+        size_t off = offset_ + detail::dyn_offset<Base>(strides_, indices);
+        assert(off < base_size_);
+        return base_data_[off];
+    }
+
+    // Reinterprets the view with a static rank, throws std::invalid_argument if the rank differs
+    template <size_t N>
+    const_ndarray_view<T,N,Order,Base> as_static() const
+    {
+        detail::check_rank<N>(rank());
+        return const_ndarray_view<T,N,Order,Base>(base_data_, base_size_, static_shape<N>(), static_strides<N>(), static_offsets<N>());
+    }
+
+    template <size_t N, typename tptr=TPtr>
+    typename std::enable_if<!is_pointer_to_const<tptr>::value,ndarray_view<T,N,Order,Base>>::type
+    as_static()
+    {
+        detail::check_rank<N>(rank());
+        return ndarray_view<T,N,Order,Base>(base_data_, base_size_, static_shape<N>(), static_strides<N>(), static_offsets<N>());
+    }
+protected:
+    template <size_t N>
+    extents_t<N> static_shape() const
+    {
+        extents_t<N> shape;
+        std::copy(shape_.begin(), shape_.end(), shape.begin());
+        return shape;
+    }
+
+    template <size_t N>
+    indices_t<N> static_strides() const
+    {
+        indices_t<N> strides;
+        std::copy(strides_.begin(), strides_.end(), strides.begin());
+        return strides;
+    }
+
+    template <size_t N>
+    indices_t<N> static_offsets() const
+    {
+        indices_t<N> offsets;
+        offsets.fill(0);
+        Order::update_offsets(offset_, offsets);
+        return offsets;
+    }
+};
+
+template <typename T, typename Order, typename Base>
+class dyn_ndarray_view : public dyn_ndarray_view_base<T,Order,Base,T*>
+{
+    typedef dyn_ndarray_view_base<T,Order,Base,T*> super_type;
+public:
+    dyn_ndarray_view() = default;
+
+    dyn_ndarray_view(T* data, size_t size, size_t offset,
+                     const dyn_extents_t& shape, const dyn_indices_t& strides)
+        : super_type(data, size, offset, shape, strides)
+    {
+    }
+
+    dyn_ndarray_view(T* data, const dyn_extents_t& shape)
+        : super_type(data, shape)
+    {
+    }
+
+    template <typename Allocator>
+    dyn_ndarray_view(dyn_ndarray<T,Order,Base,Allocator>& a)
+        : super_type(a.data(), a.size(), 0, a.shape(), a.strides())
+    {
+    }
+
+    // Cheap conversions from static rank arrays and views
+
+    template <size_t N>
+    dyn_ndarray_view(ndarray_view<T,N,Order,Base>& v)
+        : super_type(v.base_data(), v.base_size(), detail::total_offset(v.offsets()), v.shape(), v.strides())
+    {
+    }
+
+    template <size_t N, typename Allocator>
+    dyn_ndarray_view(ndarray<T,N,Order,Base,Allocator>& a)
+        : super_type(a.data(), a.size(), 0, a.shape(), a.strides())
+    {
+    }
+
+    using super_type::operator();
+
+    template <typename... Indices>
+    T& operator()(size_t index, Indices... indices)
+    {
+        assert(sizeof...(Indices)+1 == this->rank());
+        size_t off = this->offset_ + detail::dyn_offset<Base>(this->strides_, 0, index, indices...);
+        assert(off < this->base_size_);
+        return this->base_data_[off];
+    }
+
+    T& operator()(const dyn_indices_t& indices)
+    {
+        size_t off = this->offset_ + detail::dyn_offset<Base>(this->strides_, indices);
+        assert(off < this->base_size_);
+        return this->base_data_[off];
+    }
+};
+
+template <typename T, typename Order, typename Base>
+class const_dyn_ndarray_view : public dyn_ndarray_view_base<T,Order,Base,const T*>
+{
+    typedef dyn_ndarray_view_base<T,Order,Base,const T*> super_type;
+public:
+    const_dyn_ndarray_view() = default;
+
+    const_dyn_ndarray_view(const T* data, size_t size, size_t offset,
+                           const dyn_extents_t& shape, const dyn_indices_t& strides)
+        : super_type(data, size, offset, shape, strides)
+    {
+    }
+
+    const_dyn_ndarray_view(const T* data, const dyn_extents_t& shape)
+        : super_type(data, shape)
+    {
+    }
+
+    template <typename OtherTPtr>
+    const_dyn_ndarray_view(const dyn_ndarray_view_base<T,Order,Base,OtherTPtr>& v)
+        : super_type(v.base_data(), v.base_size(), v.offset(), v.shape(), v.strides())
+    {
+    }
+
+    template <typename Allocator>
+    const_dyn_ndarray_view(const dyn_ndarray<T,Order,Base,Allocator>& a)
+        : super_type(a.data(), a.size(), 0, a.shape(), a.strides())
+    {
+    }
+
+    template <size_t N, typename OtherTPtr>
+    const_dyn_ndarray_view(const ndarray_view_base<T,N,Order,Base,OtherTPtr>& v)
+        : super_type(v.base_data(), v.base_size(), detail::total_offset(v.offsets()), v.shape(), v.strides())
+    {
+    }
+
+    template <size_t N, typename Allocator>
+    const_dyn_ndarray_view(const ndarray<T,N,Order,Base,Allocator>& a)
+        : super_type(a.data(), a.size(), 0, a.shape(), a.strides())
+    {
+    }
+};
+
+// dyn_ndarray
+
+template <typename T, typename Order, typename Base, typename Allocator>
+class dyn_ndarray
+{
+public:
+    typedef Allocator allocator_type;
+    typedef T element_type;
+    typedef Order order_type;
+    typedef Base base_type;
+    typedef dyn_ndarray_view<T,Order,Base> view;
+    typedef const_dyn_ndarray_view<T,Order,Base> const_view;
+private:
+    std::vector<T,Allocator> data_;
+    dyn_extents_t shape_;
+    dyn_indices_t strides_;
+public:
+    dyn_ndarray() = default;
+
+    explicit dyn_ndarray(const dyn_extents_t& shape, const T& val = T(), const Allocator& alloc = Allocator())
+        : data_(alloc), shape_(shape), strides_(shape.size())
+    {
+        size_t size = 0;
+        Order::calculate_strides(shape_.data(), strides_.data(), shape_.size(), size);
+        data_.assign(size, val);
+    }
+
+    template <typename OtherTPtr>
+    explicit dyn_ndarray(const dyn_ndarray_view_base<T,Order,Base,OtherTPtr>& v, const Allocator& alloc = Allocator())
+        : dyn_ndarray(v.shape(), T(), alloc)
+    {
+        copy_from(v.base_data(), v.offset(), v.strides());
+    }
+
+    template <size_t N, typename OtherAllocator>
+    explicit dyn_ndarray(const ndarray<T,N,Order,Base,OtherAllocator>& a, const Allocator& alloc = Allocator())
+        : data_(a.data(), a.data() + a.size(), alloc), shape_(a.shape()), strides_(a.strides())
+    {
+    }
+
+    template <size_t N, typename OtherTPtr>
+    explicit dyn_ndarray(const ndarray_view_base<T,N,Order,Base,OtherTPtr>& v, const Allocator& alloc = Allocator())
+        : dyn_ndarray(const_dyn_ndarray_view<T,Order,Base>(v), alloc)
+    {
+    }
+
+    dyn_ndarray(const dyn_ndarray&) = default;
+    dyn_ndarray(dyn_ndarray&&) = default;
+    dyn_ndarray& operator=(const dyn_ndarray&) = default;
+    dyn_ndarray& operator=(dyn_ndarray&&) = default;
+
+    allocator_type get_allocator() const
+    {
+        return data_.get_allocator();
+    }
+
+    size_t rank() const noexcept
+    {
+        return shape_.size();
+    }
+
+    size_t size() const noexcept
+    {
+        return data_.size();
+    }
+
+    bool empty() const noexcept
+    {
+        return data_.empty();
+    }
+
+    const dyn_extents_t& shape() const {return shape_;}
+
+    const dyn_indices_t& strides() const {return strides_;}
+
+    size_t shape(size_t i) const
+    {
+        assert(i < shape_.size());
+        return shape_[i];
+    }
+
+    T* data()
+    {
+        return data_.data();
+    }
+
+    const T* data() const
+    {
+        return data_.data();
+    }
+
+    template <typename... Indices>
+    T& operator()(size_t index, Indices... indices)
+    {
+        assert(sizeof...(Indices)+1 == rank());
+        size_t off = detail::dyn_offset<Base>(strides_, 0, index, indices...);
+        assert(off < size());
+        return data_[off];
+    }
+
+    template <typename... Indices>
+    const T& operator()(size_t index, Indices... indices) const
+    {
+        assert(sizeof...(Indices)+1 == rank());
+        size_t off = detail::dyn_offset<Base>(strides_, 0, index, indices...);
+        assert(off < size());
+        return data_[off];
+    }
+
+    T& operator()(const dyn_indices_t& indices)
+    {
+        size_t off = detail::dyn_offset<Base>(strides_, indices);
+        assert(off < size());
+        return data_[off];
+    }
+
+    const T& operator()(const dyn_indices_t& indices) const
+    {
+        size_t off = detail::dyn_offset<Base>(strides_, indices);
+        assert(off < size());
+        return data_[off];
+    }
+
+    // Zero copy static rank views, throw std::invalid_argument if the rank differs
+    template <size_t N>
+    ndarray_view<T,N,Order,Base> as_static()
+    {
+        return view(*this).template as_static<N>();
+    }
+
+    template <size_t N>
+    const_ndarray_view<T,N,Order,Base> as_static() const
+    {
+        return const_view(*this).template as_static<N>();
+    }
+
+    template <size_t N, typename OtherAllocator = std::allocator<T>>
+    ndarray<T,N,Order,Base,OtherAllocator> to_ndarray() const
+    {
+        return ndarray<T,N,Order,Base,OtherAllocator>(as_static<N>());
+    }
+
+    void swap(dyn_ndarray& other) noexcept
+    {
+        data_.swap(other.data_);
+        shape_.swap(other.shape_);
+        strides_.swap(other.strides_);
+    }
+private:
+    void copy_from(const T* base, size_t offset, const dyn_indices_t& strides)
+    {
+        if (data_.empty())
+        {
+            return;
+        }
+        dyn_indices_t index(rank(), 0);
+        for (size_t n = 0; n < data_.size(); ++n)
+        {
+            size_t src = offset;
+            size_t dst = 0;
+            for (size_t i = 0; i < rank(); ++i)
+            {
+                src += index[i]*strides[i];
+                dst += index[i]*strides_[i];
+            }
+            data_[dst] = base[src];
+            for (size_t i = rank(); i-- > 0; )
+            {
+                if (++index[i] < shape_[i])
+                {
+                    break;
+                }
+                index[i] = 0;
+            }
+        }
+    }
+};
+
+template <typename T, typename Order, typename Base, typename Allocator>
+bool operator==(const dyn_ndarray<T,Order,Base,Allocator>& lhs, const dyn_ndarray<T,Order,Base,Allocator>& rhs)
+{
+    return lhs.shape() == rhs.shape() && std::equal(lhs.data(), lhs.data() + lhs.size(), rhs.data());
+}
+
+template <typename T, typename Order, typename Base, typename Allocator>
+bool operator!=(const dyn_ndarray<T,Order,Base,Allocator>& lhs, const dyn_ndarray<T,Order,Base,Allocator>& rhs)
+{
+    return !(lhs == rhs);
+}
+
+// dispatch_rank
+//
+// Calls f with a static rank view of v for ranks 1 to MaxN, so hot loops can be
+// written once as rank generic kernels. Throws std::invalid_argument for other ranks.
+
+namespace detail {
+
+template <size_t N, size_t MaxN>
+struct rank_dispatcher
+{
+    template <typename View, typename F>
+    static auto apply(View& v, F&& f) -> decltype(f(v.template as_static<1>()))
+    {
+        if (v.rank() == N)
+        {
+            return f(v.template as_static<N>());
+        }
+        return rank_dispatcher<N+1,MaxN>::apply(v, std::forward<F>(f));
+    }
+};
+
+template <size_t MaxN>
+struct rank_dispatcher<MaxN,MaxN>
+{
+    template <typename View, typename F>
+    static auto apply(View& v, F&& f) -> decltype(f(v.template as_static<1>()))
+    {
+        if (v.rank() != MaxN)
+        {
+            throw std::invalid_argument("array rank not supported by dispatch");
+        }
+        return f(v.template as_static<MaxN>());
+    }
+};
+
+} // namespace detail
+
+template <size_t MaxN = 8, typename View, typename F>
+auto dispatch_rank(View&& v, F&& f) -> decltype(f(v.template as_static<1>()))
+{
+    static_assert(MaxN >= 1, "MaxN must be at least 1");
+    return detail::rank_dispatcher<1,MaxN>::apply(v, std::forward<F>(f));
+}
+
+}
+
+#endif
@@ -0,0 +1,653 @@
+#ifndef ACONS_FLOAT16_HPP
+#define ACONS_FLOAT16_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <limits>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <type_traits>
+#include <acons/ndarray.hpp>
+#include <acons/parallel.hpp>
+#if defined(__F16C__)
+#include <immintrin.h>
+#endif
+
+namespace acons {
+
+namespace detail {
+
+inline uint32_t float_bits(float f)
+{
+    uint32_t x;
+    std::memcpy(&x, &f, sizeof(x));
+    return x;
+}
+
+inline float bits_float(uint32_t x)
+{
+    float f;
+    std::memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
+// IEEE binary16 conversions, rounding to nearest even. Subnormal halves are produced and
+// read by adding and subtracting a float whose exponent lines their bits up with the
+// float mantissa, so the float unit does the rounding.
+inline uint16_t float_to_half_bits(float f)
+{
+    uint32_t x = float_bits(f);
+    const uint32_t sign = x & 0x80000000u;
+    x ^= sign;
+    uint32_t h;
+    if (x >= (127u + 16u) << 23)
+    {
+        // Too large for a half, infinity or NaN
+        h = x > 0x7f800000u ? 0x7e00u : 0x7c00u;
+    }
+    else if (x < 113u << 23)
+    {
+        const uint32_t magic = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+        h = float_bits(bits_float(x) + bits_float(magic)) - magic;
+    }
+    else
+    {
+        const uint32_t odd = (x >> 13) & 1u;
+        x += ((15u - 127u) << 23) + 0xfffu + odd;
+        h = x >> 13;
+    }
+    return static_cast<uint16_t>(h | (sign >> 16));
+}
+
+inline float half_bits_to_float(uint16_t h)
+{
+    const uint32_t exponent_mask = 0x7c00u << 13;
+    uint32_t x = (h & 0x7fffu) << 13;
+    const uint32_t exponent = x & exponent_mask;
+    x += (127u - 15u) << 23;
+    if (exponent == exponent_mask)
+    {
+        x += (128u - 16u) << 23;
+    }
+    else if (exponent == 0)
+    {
+        x += 1u << 23;
+        x = float_bits(bits_float(x) - bits_float(113u << 23));
+    }
+    return bits_float(x | (uint32_t(h & 0x8000u) << 16));
+}
+
+// bfloat16 is the upper half of a float, rounded to nearest even, with NaNs kept quiet
+inline uint16_t float_to_bfloat16_bits(float f)
+{
+    uint32_t x = float_bits(f);
+    if ((x & 0x7fffffffu) > 0x7f800000u)
+    {
+        return static_cast<uint16_t>((x >> 16) | 0x40u);
+    }
+    x += 0x7fffu + ((x >> 16) & 1u);
+    return static_cast<uint16_t>(x >> 16);
+}
+
+inline float bfloat16_bits_to_float(uint16_t b)
+{
+    return bits_float(uint32_t(b) << 16);
+}
+
+}
+
+// binary16_format, bfloat16_format
+//
+// The 16 bit encodings behind float16 and bfloat16: conversions from and to float, and the
+// constants for std::numeric_limits.
+
+struct binary16_format
+{
+    static uint16_t from_float(float f)
+    {
+#if defined(__F16C__)
+        return static_cast<uint16_t>(_cvtss_sh(f, _MM_FROUND_TO_NEAREST_INT));
+#else
+        return detail::float_to_half_bits(f);
+#endif
+    }
+
+    static float to_float(uint16_t h)
+    {
+#if defined(__F16C__)
+        return _cvtsh_ss(h);
+#else
+        return detail::half_bits_to_float(h);
+#endif
+    }
+
+    static constexpr int digits = 11;
+    static constexpr int digits10 = 3;
+    static constexpr int max_digits10 = 5;
+    static constexpr int min_exponent = -13;
+    static constexpr int min_exponent10 = -4;
+    static constexpr int max_exponent = 16;
+    static constexpr int max_exponent10 = 4;
+    static constexpr uint16_t min_bits = 0x0400;
+    static constexpr uint16_t max_bits = 0x7bff;
+    static constexpr uint16_t lowest_bits = 0xfbff;
+    static constexpr uint16_t epsilon_bits = 0x1400;
+    static constexpr uint16_t round_error_bits = 0x3800;
+    static constexpr uint16_t infinity_bits = 0x7c00;
+    static constexpr uint16_t quiet_nan_bits = 0x7e00;
+    static constexpr uint16_t signaling_nan_bits = 0x7d00;
+    static constexpr uint16_t denorm_min_bits = 0x0001;
+};
+
+struct bfloat16_format
+{
+    static uint16_t from_float(float f)
+    {
+        return detail::float_to_bfloat16_bits(f);
+    }
+
+    static float to_float(uint16_t b)
+    {
+        return detail::bfloat16_bits_to_float(b);
+    }
+
+    static constexpr int digits = 8;
+    static constexpr int digits10 = 2;
+    static constexpr int max_digits10 = 4;
+    static constexpr int min_exponent = -125;
+    static constexpr int min_exponent10 = -37;
+    static constexpr int max_exponent = 128;
+    static constexpr int max_exponent10 = 38;
+    static constexpr uint16_t min_bits = 0x0080;
+    static constexpr uint16_t max_bits = 0x7f7f;
+    static constexpr uint16_t lowest_bits = 0xff7f;
+    static constexpr uint16_t epsilon_bits = 0x3c00;
+    static constexpr uint16_t round_error_bits = 0x3f00;
+    static constexpr uint16_t infinity_bits = 0x7f80;
+    static constexpr uint16_t quiet_nan_bits = 0x7fc0;
+    static constexpr uint16_t signaling_nan_bits = 0x7fa0;
+    static constexpr uint16_t denorm_min_bits = 0x0001;
+};
+
+// basic_float16
+//
+// A 16 bit floating point element type. Values convert implicitly from arithmetic types and
+// explicitly to float, so that an expression mixing a basic_float16 with a literal has one
+// meaning. Arithmetic is done in float and rounded back. The default constructor leaves the
+// value uninitialized, like float, and value initialization gives zero.
+
+template <typename Format>
+class basic_float16
+{
+    uint16_t bits_;
+public:
+    typedef Format format_type;
+
+    basic_float16() = default;
+
+    template <typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+    basic_float16(T value)
+        : bits_(Format::from_float(static_cast<float>(value)))
+    {
+    }
+
+    // Between the two formats, through float
+    template <typename OtherFormat>
+    explicit basic_float16(basic_float16<OtherFormat> other)
+        : bits_(Format::from_float(static_cast<float>(other)))
+    {
+    }
+
+    static basic_float16 from_bits(uint16_t bits)
+    {
+        basic_float16 h;
+        h.bits_ = bits;
+        return h;
+    }
+
+    uint16_t bits() const
+    {
+        return bits_;
+    }
+
+    template <typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+    explicit operator T() const
+    {
+        return static_cast<T>(Format::to_float(bits_));
+    }
+
+    basic_float16& operator+=(basic_float16 other)
+    {
+        return *this = basic_float16(float(*this) + float(other));
+    }
+
+    basic_float16& operator-=(basic_float16 other)
+    {
+        return *this = basic_float16(float(*this) - float(other));
+    }
+
+    basic_float16& operator*=(basic_float16 other)
+    {
+        return *this = basic_float16(float(*this)*float(other));
+    }
+
+    basic_float16& operator/=(basic_float16 other)
+    {
+        return *this = basic_float16(float(*this)/float(other));
+    }
+
+    friend basic_float16 operator+(basic_float16 a, basic_float16 b)
+    {
+        return basic_float16(float(a) + float(b));
+    }
+
+    friend basic_float16 operator-(basic_float16 a, basic_float16 b)
+    {
+        return basic_float16(float(a) - float(b));
+    }
+
+    friend basic_float16 operator*(basic_float16 a, basic_float16 b)
+    {
+        return basic_float16(float(a)*float(b));
+    }
+
+    friend basic_float16 operator/(basic_float16 a, basic_float16 b)
+    {
+        return basic_float16(float(a)/float(b));
+    }
+
+    friend basic_float16 operator-(basic_float16 a)
+    {
+        return from_bits(static_cast<uint16_t>(a.bits_ ^ 0x8000u));
+    }
+
+    friend basic_float16 operator+(basic_float16 a)
+    {
+        return a;
+    }
+
+    friend bool operator==(basic_float16 a, basic_float16 b)
+    {
+        return float(a) == float(b);
+    }
+
+    friend bool operator!=(basic_float16 a, basic_float16 b)
+    {
+        return float(a) != float(b);
+    }
+
+    friend bool operator<(basic_float16 a, basic_float16 b)
+    {
+        return float(a) < float(b);
+    }
+
+    friend bool operator<=(basic_float16 a, basic_float16 b)
+    {
+        return float(a) <= float(b);
+    }
+
+    friend bool operator>(basic_float16 a, basic_float16 b)
+    {
+        return float(a) > float(b);
+    }
+
+    friend bool operator>=(basic_float16 a, basic_float16 b)
+    {
+        return float(a) >= float(b);
+    }
+
+    friend basic_float16 abs(basic_float16 a)
+    {
+        return from_bits(static_cast<uint16_t>(a.bits_ & 0x7fffu));
+    }
+
+    friend bool isnan(basic_float16 a)
+    {
+        return (a.bits_ & 0x7fffu) > Format::infinity_bits;
+    }
+
+    friend bool isinf(basic_float16 a)
+    {
+        return (a.bits_ & 0x7fffu) == Format::infinity_bits;
+    }
+
+    friend bool isfinite(basic_float16 a)
+    {
+        return (a.bits_ & Format::infinity_bits) != Format::infinity_bits;
+    }
+
+    template <typename CharT>
+    friend std::basic_ostream<CharT>& operator<<(std::basic_ostream<CharT>& os, basic_float16 a)
+    {
+        return os << float(a);
+    }
+
+    template <typename CharT>
+    friend std::basic_istream<CharT>& operator>>(std::basic_istream<CharT>& is, basic_float16& a)
+    {
+        float f;
+        if (is >> f)
+        {
+            a = basic_float16(f);
+        }
+        return is;
+    }
+};
+
+typedef basic_float16<binary16_format> float16;
+typedef basic_float16<bfloat16_format> bfloat16;
+
+namespace detail {
+
+template <typename T>
+struct is_float16 : std::false_type
+{
+};
+
+template <typename Format>
+struct is_float16<basic_float16<Format>> : std::true_type
+{
+};
+
+// Declared here so that linalg.hpp need not include this header. matmul packs 16 bit
+// operands as float and sums their products in float.
+template <typename T>
+struct gemm_compute;
+
+template <typename Format>
+struct gemm_compute<basic_float16<Format>>
+{
+    typedef float type;
+};
+
+#if defined(__GNUC__)
+typedef uint32_t half_vector_u32 __attribute__((vector_size(16)));
+typedef float half_vector_f32 __attribute__((vector_size(16)));
+
+// The binary16 conversions four at a time, with each case computed and one selected by
+// masks, as the compiler does not turn the branches of the scalar versions into selects
+inline void half_bits_to_float4(const float16* in, float* out)
+{
+    const half_vector_u32 h = {in[0].bits(), in[1].bits(), in[2].bits(), in[3].bits()};
+    const half_vector_u32 x = (h & 0x7fffu) << 13;
+    const half_vector_u32 exponent = x & (0x7c00u << 13);
+    const half_vector_u32 normal = x + ((127u - 15u) << 23);
+    const half_vector_u32 special = normal + ((128u - 16u) << 23);
+    const half_vector_u32 subnormal = (half_vector_u32)((half_vector_f32)(normal + (1u << 23)) - bits_float(113u << 23));
+    const half_vector_u32 is_special = (half_vector_u32)(exponent == (0x7c00u << 13));
+    const half_vector_u32 is_subnormal = (half_vector_u32)(exponent == 0u);
+    const half_vector_u32 y = (special & is_special) | (subnormal & is_subnormal) | (normal & ~(is_special | is_subnormal)) |
+                              (h & 0x8000u) << 16;
+    std::memcpy(out, &y, sizeof(y));
+}
+
+inline void float_to_half_bits4(const float* in, float16* out)
+{
+    const uint32_t magic = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+    half_vector_u32 x;
+    std::memcpy(&x, in, sizeof(x));
+    const half_vector_u32 sign = x & 0x80000000u;
+    x ^= sign;
+    const half_vector_u32 special = 0x7c00u | ((half_vector_u32)(x > 0x7f800000u) & 0x200u);
+    const half_vector_u32 subnormal = (half_vector_u32)((half_vector_f32)x + bits_float(magic)) - magic;
+    const half_vector_u32 normal = (x + (((15u - 127u) << 23) + 0xfffu) + ((x >> 13) & 1u)) >> 13;
+    const half_vector_u32 is_special = (half_vector_u32)(x >= ((127u + 16u) << 23));
+    const half_vector_u32 is_subnormal = (half_vector_u32)(x < (113u << 23));
+    const half_vector_u32 h = (special & is_special) | (subnormal & is_subnormal) | (normal & ~(is_special | is_subnormal)) |
+                              sign >> 16;
+    for (size_t k = 0; k < 4; ++k)
+    {
+        out[k] = float16::from_bits(static_cast<uint16_t>(h[k]));
+    }
+}
+#endif
+
+// Bulk conversions between float and 16 bit floats. With F16C, eight halves are converted
+// per instruction. Otherwise binary16 is converted four at a time with GCC vector types,
+// and bfloat16, which only needs shifts and masks, in loops the compiler vectorizes.
+inline void float16_to_float(const float16* in, float* out, size_t n)
+{
+    size_t i = 0;
+#if defined(__F16C__)
+    for (; i + 8 <= n; i += 8)
+    {
+        __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        _mm256_storeu_ps(out + i, _mm256_cvtph_ps(h));
+    }
+#elif defined(__GNUC__)
+    for (; i + 4 <= n; i += 4)
+    {
+        half_bits_to_float4(in + i, out + i);
+    }
+#endif
+    for (; i < n; ++i)
+    {
+        out[i] = half_bits_to_float(in[i].bits());
+    }
+}
+
+inline void float_to_float16(const float* in, float16* out, size_t n)
+{
+    size_t i = 0;
+#if defined(__F16C__)
+    for (; i + 8 <= n; i += 8)
+    {
+        __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), h);
+    }
+#elif defined(__GNUC__)
+    for (; i + 4 <= n; i += 4)
+    {
+        float_to_half_bits4(in + i, out + i);
+    }
+#endif
+    for (; i < n; ++i)
+    {
+        out[i] = float16::from_bits(float_to_half_bits(in[i]));
+    }
+}
+
+inline void float16_to_float(const bfloat16* in, float* out, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        out[i] = bfloat16_bits_to_float(in[i].bits());
+    }
+}
+
+inline void float_to_float16(const float* in, bfloat16* out, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        uint32_t x = float_bits(in[i]);
+        uint32_t rounded = (x + 0x7fffu + ((x >> 16) & 1u)) >> 16;
+        uint32_t is_nan = 0u - uint32_t((x & 0x7fffffffu) > 0x7f800000u);
+        out[i] = bfloat16::from_bits(static_cast<uint16_t>((rounded & ~is_nan) | (((x >> 16) | 0x40u) & is_nan)));
+    }
+}
+
+// Converts a row of n elements, in bulk where one side is float and both are unit stride
+template <typename T, typename U>
+void convert_row(const T* in, size_t in_step, U* out, size_t out_step, size_t n)
+{
+    for (size_t j = 0; j < n; ++j)
+    {
+        out[j*out_step] = static_cast<U>(in[j*in_step]);
+    }
+}
+
+template <typename Format>
+void convert_row(const basic_float16<Format>* in, size_t in_step, float* out, size_t out_step, size_t n)
+{
+    if (in_step == 1 && out_step == 1)
+    {
+        float16_to_float(in, out, n);
+        return;
+    }
+    for (size_t j = 0; j < n; ++j)
+    {
+        out[j*out_step] = static_cast<float>(in[j*in_step]);
+    }
+}
+
+template <typename Format>
+void convert_row(const float* in, size_t in_step, basic_float16<Format>* out, size_t out_step, size_t n)
+{
+    if (in_step == 1 && out_step == 1)
+    {
+        float_to_float16(in, out, n);
+        return;
+    }
+    for (size_t j = 0; j < n; ++j)
+    {
+        out[j*out_step] = basic_float16<Format>(in[j*in_step]);
+    }
+}
+
+// Arrays of at least this many elements are converted on several threads
+const size_t astype_min_parallel_size = size_t(1) << 16;
+
+// True if the elements of a fill its span with no gaps, in either storage order
+template <typename Array>
+bool is_dense(const Array& a)
+{
+    const size_t N = Array::ndim;
+    size_t row = 1;
+    size_t column = 1;
+    bool row_major_dense = true;
+    bool column_major_dense = true;
+    for (size_t i = 0; i < N; ++i)
+    {
+        size_t r = N - 1 - i;
+        row_major_dense = row_major_dense && (a.shape(r) == 1 || a.strides()[r] == row);
+        column_major_dense = column_major_dense && (a.shape(i) == 1 || a.strides()[i] == column);
+        row *= a.shape(r);
+        column *= a.shape(i);
+    }
+    return row_major_dense || column_major_dense;
+}
+
+template <typename In, typename Out>
+void astype(const In& a, Out& out, size_t threads)
+{
+    const size_t N = In::ndim;
+    const size_t size = a.size();
+    if (size == 0)
+    {
+        return;
+    }
+    threads = size < astype_min_parallel_size ? 1 : (threads == 0 ? default_thread_count() : threads);
+    auto in_data = a.data();
+    auto out_data = out.data();
+
+    // Dense arrays with the same strides are converted as one flat row
+    if (std::equal(a.strides().begin(), a.strides().end(), out.strides().begin()) && is_dense(a))
+    {
+        const size_t chunk = 4096;
+        parallel_for((size + chunk - 1)/chunk, [&](size_t first, size_t last)
+        {
+            for (size_t t = first; t < last; ++t)
+            {
+                size_t i = t*chunk;
+                convert_row(in_data + i, 1, out_data + i, 1, (std::min)(chunk, size - i));
+            }
+        }, threads);
+        return;
+    }
+
+    // Otherwise row by row along the last dimension, in index order
+    const size_t n = a.shape(N-1);
+    const size_t rows = size/n;
+    parallel_for(rows, [&](size_t first, size_t last)
+    {
+        for (size_t r = first; r < last; ++r)
+        {
+            size_t in_offset = 0;
+            size_t out_offset = 0;
+            size_t p = r;
+            for (size_t i = N - 1; i-- > 0; )
+            {
+                size_t k = p % a.shape(i);
+                in_offset += k*a.strides()[i];
+                out_offset += k*out.strides()[i];
+                p /= a.shape(i);
+            }
+            convert_row(in_data + in_offset, a.strides()[N-1], out_data + out_offset, out.strides()[N-1], n);
+        }
+    }, threads);
+}
+
+}
+
+// Returns a copy of a with elements of type U, in a new array with the order and base of a
+template <typename U, typename In>
+ndarray<U,In::ndim,typename In::order_type,typename In::base_type> astype(const In& a, size_t threads = 0)
+{
+    ndarray<U,In::ndim,typename In::order_type,typename In::base_type> out(a.shape());
+    detail::astype(a, out, threads);
+    return out;
+}
+
+// Converts the elements of a into out, an ndarray or view of the same shape
+template <typename In, typename Out>
+typename std::enable_if<(std::decay<Out>::type::ndim > 0)>::type
+astype(const In& a, Out&& out, size_t threads = 0)
+{
+    static_assert(In::ndim == std::decay<Out>::type::ndim, "astype operands must have the same rank");
+    if (!std::equal(a.shape().begin(), a.shape().end(), out.shape().begin()))
+    {
+        throw std::invalid_argument("astype shapes differ");
+    }
+    detail::astype(a, out, threads);
+}
+
+}
+
+namespace std {
+
+template <typename Format>
+class numeric_limits<acons::basic_float16<Format>>
+{
+    typedef acons::basic_float16<Format> value_type;
+public:
+    static constexpr bool is_specialized = true;
+    static constexpr bool is_signed = true;
+    static constexpr bool is_integer = false;
+    static constexpr bool is_exact = false;
+    static constexpr bool has_infinity = true;
+    static constexpr bool has_quiet_NaN = true;
+    static constexpr bool has_signaling_NaN = true;
+    static constexpr float_denorm_style has_denorm = denorm_present;
+    static constexpr bool has_denorm_loss = false;
+    static constexpr float_round_style round_style = round_to_nearest;
+    static constexpr bool is_iec559 = std::is_same<Format,acons::binary16_format>::value;
+    static constexpr bool is_bounded = true;
+    static constexpr bool is_modulo = false;
+    static constexpr int digits = Format::digits;
+    static constexpr int digits10 = Format::digits10;
+    static constexpr int max_digits10 = Format::max_digits10;
+    static constexpr int radix = 2;
+    static constexpr int min_exponent = Format::min_exponent;
+    static constexpr int min_exponent10 = Format::min_exponent10;
+    static constexpr int max_exponent = Format::max_exponent;
+    static constexpr int max_exponent10 = Format::max_exponent10;
+    static constexpr bool traps = false;
+    static constexpr bool tinyness_before = false;
+
+    static value_type min() {return value_type::from_bits(Format::min_bits);}
+    static value_type max() {return value_type::from_bits(Format::max_bits);}
+    static value_type lowest() {return value_type::from_bits(Format::lowest_bits);}
+    static value_type epsilon() {return value_type::from_bits(Format::epsilon_bits);}
+    static value_type round_error() {return value_type::from_bits(Format::round_error_bits);}
+    static value_type infinity() {return value_type::from_bits(Format::infinity_bits);}
+    static value_type quiet_NaN() {return value_type::from_bits(Format::quiet_nan_bits);}
+    static value_type signaling_NaN() {return value_type::from_bits(Format::signaling_nan_bits);}
+    static value_type denorm_min() {return value_type::from_bits(Format::denorm_min_bits);}
+};
+
+}
+
+#endif
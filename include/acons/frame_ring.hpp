@@ -0,0 +1,307 @@
+#ifndef ACONS_FRAME_RING_HPP
+#define ACONS_FRAME_RING_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <acons/ndarray.hpp>
+#include <acons/parallel.hpp>
+
+namespace acons {
+
+namespace detail {
+
+template <typename T, size_t N, typename Order, typename Base, typename Allocator>
+ndarray<T,N+1,Order,Base,Allocator> make_frame_storage(size_t capacity, const extents_t<N>& frame_shape,
+                                                       const Allocator& alloc)
+{
+    if (capacity == 0)
+    {
+        throw std::invalid_argument("frame ring capacity must be positive");
+    }
+    extents_t<N+1> shape;
+    shape[0] = capacity;
+    for (size_t i = 0; i < N; ++i)
+    {
+        shape[i+1] = frame_shape[i];
+    }
+    return ndarray<T,N+1,Order,Base,Allocator>(std::allocator_arg, alloc, shape);
+}
+
+}
+
+// spsc_frame_ring
+//
+// A lock-free ring of capacity preallocated frames of one shape, for one producer thread
+// and one consumer thread. The frames are the slices along the first dimension of an
+// ndarray<T,N+1>. The producer fills the next free frame in place through an ndarray_view
+// and publishes it, the consumer reads the oldest published frame through a
+// const_ndarray_view and releases it. Nothing is allocated after construction.
+
+template <typename T, size_t N, typename Order = row_major, typename Base = zero_based, typename Allocator = std::allocator<T>>
+class spsc_frame_ring
+{
+public:
+    typedef ndarray<T,N+1,Order,Base,Allocator> storage_type;
+    typedef ndarray_view<T,N,Order,Base> view_type;
+    typedef const_ndarray_view<T,N,Order,Base> const_view_type;
+private:
+    storage_type storage_;
+    size_t capacity_;
+    alignas(detail::cache_line_size) std::atomic<size_t> written_;
+    size_t read_cache_;     // producer's copy of read_
+    alignas(detail::cache_line_size) std::atomic<size_t> read_;
+    size_t written_cache_;  // consumer's copy of written_
+public:
+    spsc_frame_ring(size_t capacity, const extents_t<N>& frame_shape, const Allocator& alloc = Allocator())
+        : storage_(detail::make_frame_storage<T,N,Order,Base>(capacity, frame_shape, alloc)),
+          capacity_(capacity), written_(0), read_cache_(0), read_(0), written_cache_(0)
+    {
+    }
+
+    spsc_frame_ring(const spsc_frame_ring&) = delete;
+    spsc_frame_ring& operator=(const spsc_frame_ring&) = delete;
+
+    size_t capacity() const noexcept
+    {
+        return capacity_;
+    }
+
+    const storage_type& storage() const
+    {
+        return storage_;
+    }
+
+    // Number of published frames not yet released, exact only when both threads are idle
+    size_t size() const noexcept
+    {
+        return written_.load(std::memory_order_acquire) - read_.load(std::memory_order_acquire);
+    }
+
+    // Producer
+
+    // True if a frame is free for writing
+    bool write_available()
+    {
+        size_t w = written_.load(std::memory_order_relaxed);
+        if (w - read_cache_ == capacity_)
+        {
+            read_cache_ = read_.load(std::memory_order_acquire);
+        }
+        return w - read_cache_ < capacity_;
+    }
+
+    // View of the next free frame, requires write_available()
+    view_type write_frame()
+    {
+        assert(written_.load(std::memory_order_relaxed) - read_cache_ < capacity_);
+        return view_type(storage_, indices_t<1>{written_.load(std::memory_order_relaxed) % capacity_});
+    }
+
+    // Makes the frame returned by write_frame() visible to the consumer
+    void publish()
+    {
+        written_.store(written_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Calls fill(view_type&) on the next free frame and publishes it, returns false if the ring is full
+    template <typename F>
+    bool try_push(F fill)
+    {
+        if (!write_available())
+        {
+            return false;
+        }
+        view_type frame = write_frame();
+        fill(frame);
+        publish();
+        return true;
+    }
+
+    // Consumer
+
+    // True if a published frame is waiting
+    bool read_available()
+    {
+        size_t r = read_.load(std::memory_order_relaxed);
+        if (r == written_cache_)
+        {
+            written_cache_ = written_.load(std::memory_order_acquire);
+        }
+        return r != written_cache_;
+    }
+
+    // View of the oldest published frame, requires read_available()
+    const_view_type read_frame() const
+    {
+        assert(read_.load(std::memory_order_relaxed) != written_cache_);
+        return const_view_type(storage_, indices_t<1>{read_.load(std::memory_order_relaxed) % capacity_});
+    }
+
+    // Returns the frame returned by read_frame() to the producer
+    void release()
+    {
+        read_.store(read_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Calls consume(const const_view_type&) on the oldest published frame and releases it,
+    // returns false if the ring is empty
+    template <typename F>
+    bool try_pop(F consume)
+    {
+        if (!read_available())
+        {
+            return false;
+        }
+        const_view_type frame = read_frame();
+        consume(frame);
+        release();
+        return true;
+    }
+};
+
+// mpmc_frame_ring
+//
+// A bounded lock-free ring of preallocated frames for any number of producers and
+// consumers, using a sequence number per frame. A producer claims a free frame, fills it
+// and publishes it, a consumer claims the oldest published frame, reads it and releases it.
+// Frames are consumed in the order they were claimed by producers. A frame whose fill
+// throws is still published, marked empty, and consumers release it without reading it.
+// A frame whose consume throws is released.
+
+template <typename T, size_t N, typename Order = row_major, typename Base = zero_based, typename Allocator = std::allocator<T>>
+class mpmc_frame_ring
+{
+public:
+    typedef ndarray<T,N+1,Order,Base,Allocator> storage_type;
+    typedef ndarray_view<T,N,Order,Base> view_type;
+    typedef const_ndarray_view<T,N,Order,Base> const_view_type;
+private:
+    // Stores a frame's next sequence number when it goes out of scope, so that a claimed
+    // frame is published or released even if the callback throws
+    class sequence_guard
+    {
+        std::atomic<size_t>& sequence_;
+        size_t value_;
+    public:
+        sequence_guard(std::atomic<size_t>& sequence, size_t value)
+            : sequence_(sequence), value_(value)
+        {
+        }
+
+        sequence_guard(const sequence_guard&) = delete;
+        sequence_guard& operator=(const sequence_guard&) = delete;
+
+        ~sequence_guard()
+        {
+            sequence_.store(value_, std::memory_order_release);
+        }
+    };
+
+    storage_type storage_;
+    size_t capacity_;
+    std::unique_ptr<std::atomic<size_t>[]> sequences_;
+    // Written by the producer that claimed a frame before it is published
+    std::unique_ptr<bool[]> filled_;
+    alignas(detail::cache_line_size) std::atomic<size_t> write_pos_;
+    alignas(detail::cache_line_size) std::atomic<size_t> read_pos_;
+
+    // Claims the frame at position, which is ready when its sequence number is
+    // position + lag. Returns false if the frame at the current position is not ready.
+    bool claim(std::atomic<size_t>& position, size_t lag, size_t& pos)
+    {
+        pos = position.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            size_t seq = sequences_[pos % capacity_].load(std::memory_order_acquire);
+            std::intptr_t diff = std::intptr_t(seq - (pos + lag));
+            if (diff == 0)
+            {
+                if (position.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = position.load(std::memory_order_relaxed);
+            }
+        }
+    }
+public:
+    mpmc_frame_ring(size_t capacity, const extents_t<N>& frame_shape, const Allocator& alloc = Allocator())
+        : storage_(detail::make_frame_storage<T,N,Order,Base>(capacity, frame_shape, alloc)),
+          capacity_(capacity), sequences_(new std::atomic<size_t>[capacity]), filled_(new bool[capacity]()),
+          write_pos_(0), read_pos_(0)
+    {
+        for (size_t i = 0; i < capacity_; ++i)
+        {
+            sequences_[i].store(i, std::memory_order_relaxed);
+        }
+    }
+
+    mpmc_frame_ring(const mpmc_frame_ring&) = delete;
+    mpmc_frame_ring& operator=(const mpmc_frame_ring&) = delete;
+
+    size_t capacity() const noexcept
+    {
+        return capacity_;
+    }
+
+    const storage_type& storage() const
+    {
+        return storage_;
+    }
+
+    // Calls fill(view_type&) on a free frame and publishes it, returns false if the ring is full.
+    // If fill throws, the frame is published empty and the exception propagates.
+    template <typename F>
+    bool try_push(F fill)
+    {
+        size_t pos;
+        if (!claim(write_pos_, 0, pos))
+        {
+            return false;
+        }
+        size_t slot = pos % capacity_;
+        filled_[slot] = false;
+        sequence_guard publish(sequences_[slot], pos + 1);
+        view_type frame(storage_, indices_t<1>{slot});
+        fill(frame);
+        filled_[slot] = true;
+        return true;
+    }
+
+    // Calls consume(const const_view_type&) on the oldest published frame and releases it,
+    // returns false if no frame is ready. Empty frames are released without calling consume.
+    // If consume throws, the frame is released and the exception propagates.
+    template <typename F>
+    bool try_pop(F consume)
+    {
+        for (;;)
+        {
+            size_t pos;
+            if (!claim(read_pos_, 1, pos))
+            {
+                return false;
+            }
+            size_t slot = pos % capacity_;
+            sequence_guard release(sequences_[slot], pos + capacity_);
+            if (filled_[slot])
+            {
+                const_view_type frame(storage_, indices_t<1>{slot});
+                consume(frame);
+                return true;
+            }
+        }
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,313 @@
+#ifndef ACONS_HUGE_PAGE_ALLOCATOR_HPP
+#define ACONS_HUGE_PAGE_ALLOCATOR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <memory>
+#include <algorithm>
+#include <vector>
+#include <cstdio>
+#include <acons/parallel.hpp>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace acons {
+
+enum class page_policy
+{
+    standard,       // ordinary pages
+    transparent,    // transparent huge pages, madvise(MADV_HUGEPAGE) on a huge page aligned mapping
+    explicit_huge   // MAP_HUGETLB, falling back to transparent if no huge pages are reserved
+};
+
+enum class numa_policy
+{
+    local,          // pages are placed by the kernel's default policy
+    interleave,     // pages are interleaved round robin across the allowed nodes
+    first_touch     // fill touches the slabs of the slowest varying dimension from threads
+                    // pinned to the allocator's cpus, see parallel_for_pinned
+};
+
+namespace detail {
+
+// Size of a transparent huge page
+const size_t huge_page_size = size_t(2) << 20;
+
+inline size_t read_hugetlb_page_size()
+{
+    size_t size = huge_page_size;
+#if defined(__linux__)
+    std::FILE* f = std::fopen("/proc/meminfo", "r");
+    if (f != nullptr)
+    {
+        char line[256];
+        while (std::fgets(line, sizeof(line), f) != nullptr)
+        {
+            unsigned long kb = 0;
+            if (std::sscanf(line, "Hugepagesize: %lu kB", &kb) == 1 && kb > 0)
+            {
+                size = size_t(kb) << 10;
+                break;
+            }
+        }
+        std::fclose(f);
+    }
+#endif
+    return size;
+}
+
+inline size_t system_page_size()
+{
+#if defined(__linux__)
+    return size_t(sysconf(_SC_PAGESIZE));
+#else
+    return 4096;
+#endif
+}
+
+// Default size of the pages MAP_HUGETLB maps, which may be 1 GiB rather than 2 MiB
+inline size_t hugetlb_page_size()
+{
+    static const size_t size = read_hugetlb_page_size();
+    return size;
+}
+
+inline size_t round_up(size_t n, size_t m)
+{
+    return (n + m - 1)/m*m;
+}
+
+#if defined(__linux__)
+
+inline void* map_pages(size_t length, page_policy pages)
+{
+#if defined(MAP_HUGETLB)
+    if (pages == page_policy::explicit_huge)
+    {
+        void* p = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED)
+        {
+            return p;
+        }
+        pages = page_policy::transparent;
+    }
+#endif
+    if (pages == page_policy::standard)
+    {
+        void* p = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        return p == MAP_FAILED ? nullptr : p;
+    }
+
+    // Over map and trim so that the mapping starts on a huge page boundary
+    size_t padded = length + huge_page_size;
+    void* raw = mmap(nullptr, padded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED)
+    {
+        return nullptr;
+    }
+    std::uintptr_t start = reinterpret_cast<std::uintptr_t>(raw);
+    std::uintptr_t aligned = round_up(start, huge_page_size);
+    if (aligned > start)
+    {
+        munmap(raw, aligned - start);
+    }
+    size_t tail = (start + padded) - (aligned + length);
+    if (tail > 0)
+    {
+        munmap(reinterpret_cast<void*>(aligned + length), tail);
+    }
+    void* p = reinterpret_cast<void*>(aligned);
+#if defined(MADV_HUGEPAGE)
+    madvise(p, length, MADV_HUGEPAGE);
+#endif
+    return p;
+}
+
+// Best effort, the mapping keeps the default policy if the kernel has no NUMA support
+inline void interleave_pages(void* p, size_t length)
+{
+#if defined(SYS_mbind) && defined(SYS_get_mempolicy)
+    const int mpol_interleave = 3;
+    const unsigned long mpol_f_mems_allowed = 1 << 2;
+    const unsigned long max_node = 1024;
+    unsigned long mask[max_node/(8*sizeof(unsigned long))] = {0};
+    int mode = 0;
+    if (syscall(SYS_get_mempolicy, &mode, mask, max_node, nullptr, mpol_f_mems_allowed) == 0)
+    {
+        syscall(SYS_mbind, p, length, mpol_interleave, mask, max_node, 0);
+    }
+#else
+    (void)p;
+    (void)length;
+#endif
+}
+
+#endif
+
+}
+
+// huge_page_allocator
+//
+// Allocator for large arrays. Allocations of at least mmap_threshold bytes are mapped
+// directly with the requested page and NUMA policies, smaller ones use operator new.
+// Also provides fill, which ndarray uses to initialize new buffers. With
+// numa_policy::first_touch it writes the slabs with parallel_for_pinned over cpus(), so
+// each slab's pages are placed on the node of the cpu that touched them. Processing the
+// array with parallel_for_pinned over the same cpus keeps each slab on a local node. On
+// platforms other than Linux the policies are ignored.
+
+template <typename T>
+class huge_page_allocator
+{
+    template <typename U> friend class huge_page_allocator;
+
+    page_policy pages_;
+    numa_policy numa_;
+    size_t threads_;
+    std::shared_ptr<const std::vector<int>> cpus_;
+public:
+    typedef T value_type;
+    typedef std::true_type propagate_on_container_copy_assignment;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    static constexpr size_t mmap_threshold = size_t(1) << 20;
+
+    template <typename U>
+    struct rebind
+    {
+        typedef huge_page_allocator<U> other;
+    };
+
+    huge_page_allocator(page_policy pages = page_policy::transparent,
+                        numa_policy numa = numa_policy::local,
+                        size_t threads = 0) noexcept
+        : pages_(pages), numa_(numa), threads_(threads)
+    {
+    }
+
+    huge_page_allocator(page_policy pages, numa_policy numa, std::vector<int> cpus)
+        : pages_(pages), numa_(numa), threads_(cpus.size()), 
+          cpus_(std::make_shared<const std::vector<int>>(std::move(cpus)))
+    {
+    }
+
+    template <typename U>
+    huge_page_allocator(const huge_page_allocator<U>& other) noexcept
+        : pages_(other.pages_), numa_(other.numa_), threads_(other.threads_), cpus_(other.cpus_)
+    {
+    }
+
+    page_policy pages() const noexcept {return pages_;}
+    numa_policy numa() const noexcept {return numa_;}
+    size_t threads() const noexcept {return threads_;}
+
+    // The cpus the first touch fill runs on, those given to the constructor, or else
+    // threads() cpus spread over the ones the calling thread may run on
+    std::vector<int> cpus() const
+    {
+        return cpus_ ? *cpus_ : spread_cpus(threads_);
+    }
+
+    T* allocate(size_t n)
+    {
+        if (n > size_t(-1)/sizeof(T))
+        {
+            throw std::bad_alloc();
+        }
+        size_t bytes = n*sizeof(T);
+#if defined(__linux__)
+        if (bytes >= mmap_threshold)
+        {
+            size_t length = mapped_length(bytes);
+            void* p = detail::map_pages(length, pages_);
+            if (p == nullptr)
+            {
+                throw std::bad_alloc();
+            }
+            if (numa_ == numa_policy::interleave)
+            {
+                detail::interleave_pages(p, length);
+            }
+            return static_cast<T*>(p);
+        }
+#endif
+        return static_cast<T*>(::operator new(bytes));
+    }
+
+    void deallocate(T* p, size_t n) noexcept
+    {
+        if (p == nullptr)
+        {
+            return;
+        }
+        size_t bytes = n*sizeof(T);
+#if defined(__linux__)
+        if (bytes >= mmap_threshold)
+        {
+            munmap(p, mapped_length(bytes));
+            return;
+        }
+#endif
+        ::operator delete(p);
+    }
+
+    void fill(T* p, size_t n, size_t slab, const T& val) const
+    {
+        if (numa_ != numa_policy::first_touch || n*sizeof(T) < mmap_threshold || slab == 0)
+        {
+            std::fill(p, p+n, val);
+            return;
+        }
+        parallel_for_pinned(n/slab, [=](size_t first, size_t last)
+        {
+            std::fill(p + first*slab, p + last*slab, val);
+        }, cpus());
+        std::fill(p + (n/slab)*slab, p + n, val);
+    }
+
+    // True if other maps pages with the same page and NUMA policies and places them on
+    // the same cpus
+    template <typename U>
+    bool same_placement(const huge_page_allocator<U>& other) const noexcept
+    {
+        return pages_ == other.pages_ && numa_ == other.numa_ && threads_ == other.threads_ &&
+               (cpus_ == other.cpus_ || (cpus_ && other.cpus_ && *cpus_ == *other.cpus_));
+    }
+
+    template <typename U>
+    friend bool operator==(const huge_page_allocator& lhs, const huge_page_allocator<U>& rhs) noexcept
+    {
+        return lhs.same_placement(rhs);
+    }
+
+    template <typename U>
+    friend bool operator!=(const huge_page_allocator& lhs, const huge_page_allocator<U>& rhs) noexcept
+    {
+        return !(lhs == rhs);
+    }
+private:
+    // An explicit_huge allocation that falls back to transparent pages maps the same
+    // length, a multiple of the transparent huge page size
+    size_t mapped_length(size_t bytes) const
+    {
+        switch (pages_)
+        {
+            case page_policy::standard:
+                return detail::round_up(bytes, detail::system_page_size());
+            case page_policy::explicit_huge:
+                return detail::round_up(bytes, (std::max)(detail::hugetlb_page_size(), detail::huge_page_size));
+            default:
+                return detail::round_up(bytes, detail::huge_page_size);
+        }
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,477 @@
+#ifndef ACONS_INDEXING_HPP
+#define ACONS_INDEXING_HPP
+
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include <acons/ndarray.hpp>
+#include <acons/parallel.hpp>
+
+namespace acons {
+
+namespace detail {
+
+// Blocks ahead of the current one whose source rows are prefetched by take, and the most
+// bytes of each row prefetched
+const size_t take_prefetch_distance = 4;
+const size_t take_prefetch_bytes = 1024;
+
+// Elements moved below which take, put and scatter_add run on the calling thread
+const size_t take_min_parallel_size = size_t(1) << 14;
+
+inline void prefetch(const void* p)
+{
+#if defined(__GNUC__)
+    __builtin_prefetch(p);
+#else
+    (void)p;
+#endif
+}
+
+template <typename Idx, typename Enable = void>
+struct is_index_array : std::false_type
+{
+};
+
+template <typename Idx>
+struct is_index_array<Idx,decltype(void(Idx::ndim))> : std::true_type
+{
+};
+
+template <typename Idx>
+size_t index_count(const Idx& idx, std::true_type)
+{
+    static_assert(Idx::ndim == 1, "an index array must have rank 1");
+    return idx.shape(0);
+}
+
+template <typename Idx>
+size_t index_count(const Idx& idx, std::false_type)
+{
+    return idx.size();
+}
+
+template <typename Idx>
+auto index_at(const Idx& idx, size_t k, std::true_type) -> decltype(idx.data()[0])
+{
+    return idx.data()[k*idx.strides()[0]];
+}
+
+template <typename Idx>
+auto index_at(const Idx& idx, size_t k, std::false_type) -> decltype(idx[k])
+{
+    return idx[k];
+}
+
+// Zero based positions along an axis of the given extent, from indices counted from origin
+template <typename Idx>
+std::vector<size_t> index_positions(const Idx& idx, size_t extent, size_t origin)
+{
+    typedef is_index_array<Idx> tag;
+    const size_t m = index_count(idx, tag());
+    std::vector<size_t> positions(m);
+    for (size_t k = 0; k < m; ++k)
+    {
+        size_t pos = static_cast<size_t>(index_at(idx, k, tag())) - origin;
+        if (pos >= extent)
+        {
+            throw std::out_of_range("index out of range");
+        }
+        positions[k] = pos;
+    }
+    return positions;
+}
+
+// How take, put and scatter_add visit the block of elements sharing one position along
+// the axis. Dimensions with a larger stride than the axis in the reference array are
+// outer, looped over around the blocks. The rest make up the block, traversed in
+// decreasing stride order, the innermost dimensions merged into one row as far as both
+// arrays are contiguous across them. When the axis is outermost and the arrays are dense,
+// each block is one contiguous row.
+template <size_t N>
+struct take_plan
+{
+    size_t src_step;
+    size_t dst_step;
+    size_t outer_dims;
+    size_t outer_shape[N];
+    size_t src_outer[N];
+    size_t dst_outer[N];
+    size_t outer_count;
+    size_t inner_dims;
+    size_t inner_shape[N];
+    size_t src_inner[N];
+    size_t dst_inner[N];
+    size_t rows;
+    size_t row_length;
+    size_t src_row_step;
+    size_t dst_row_step;
+
+    take_plan(const extents_t<N>& shape, const indices_t<N>& src_strides, const indices_t<N>& dst_strides,
+              size_t axis, bool src_is_reference)
+        : src_step(src_strides[axis]), dst_step(dst_strides[axis]), outer_dims(0), outer_count(1),
+          inner_dims(0), rows(1), row_length(1), src_row_step(1), dst_row_step(1)
+    {
+        const indices_t<N>& ref = src_is_reference ? src_strides : dst_strides;
+        size_t inner[N];
+        for (size_t i = 0; i < N; ++i)
+        {
+            if (i == axis || shape[i] == 1)
+            {
+                continue;
+            }
+            if (ref[i] > ref[axis])
+            {
+                outer_shape[outer_dims] = shape[i];
+                src_outer[outer_dims] = src_strides[i];
+                dst_outer[outer_dims] = dst_strides[i];
+                outer_count *= shape[i];
+                ++outer_dims;
+            }
+            else
+            {
+                size_t j = inner_dims++;
+                while (j > 0 && ref[inner[j-1]] < ref[i])
+                {
+                    inner[j] = inner[j-1];
+                    --j;
+                }
+                inner[j] = i;
+            }
+        }
+        if (inner_dims > 0)
+        {
+            size_t last = inner[--inner_dims];
+            row_length = shape[last];
+            src_row_step = src_strides[last];
+            dst_row_step = dst_strides[last];
+            while (inner_dims > 0)
+            {
+                size_t d = inner[inner_dims-1];
+                if (src_strides[d] != src_row_step*row_length || dst_strides[d] != dst_row_step*row_length)
+                {
+                    break;
+                }
+                row_length *= shape[d];
+                --inner_dims;
+            }
+        }
+        for (size_t i = 0; i < inner_dims; ++i)
+        {
+            inner_shape[i] = shape[inner[i]];
+            src_inner[i] = src_strides[inner[i]];
+            dst_inner[i] = dst_strides[inner[i]];
+            rows *= inner_shape[i];
+        }
+    }
+
+    size_t block_size() const
+    {
+        return rows*row_length;
+    }
+
+    bool contiguous_rows() const
+    {
+        return inner_dims == 0 && src_row_step == 1;
+    }
+
+    void outer_offsets(size_t p, size_t& src_offset, size_t& dst_offset) const
+    {
+        src_offset = 0;
+        dst_offset = 0;
+        for (size_t i = outer_dims; i-- > 0; )
+        {
+            size_t index = p % outer_shape[i];
+            p /= outer_shape[i];
+            src_offset += index*src_outer[i];
+            dst_offset += index*dst_outer[i];
+        }
+    }
+};
+
+struct assign_op
+{
+    template <typename T, typename U>
+    void operator()(U& dst, const T& src) const
+    {
+        dst = src;
+    }
+};
+
+struct add_op
+{
+    template <typename T, typename U>
+    void operator()(U& dst, const T& src) const
+    {
+        dst += src;
+    }
+};
+
+template <typename T, typename U, typename Op>
+void apply_row(const T* src, size_t src_step, U* dst, size_t dst_step, size_t n, Op op)
+{
+    if (src_step == 1 && dst_step == 1)
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            op(dst[i], src[i]);
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            op(dst[i*dst_step], src[i*src_step]);
+        }
+    }
+}
+
+template <typename T>
+void apply_row(const T* src, size_t src_step, T* dst, size_t dst_step, size_t n, assign_op)
+{
+    if (src_step == 1 && dst_step == 1)
+    {
+        std::copy(src, src + n, dst);
+    }
+    else
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            dst[i*dst_step] = src[i*src_step];
+        }
+    }
+}
+
+template <size_t N, typename T, typename U, typename Op>
+void apply_block(const take_plan<N>& plan, const T* src, U* dst, Op op)
+{
+    if (plan.inner_dims == 0)
+    {
+        apply_row(src, plan.src_row_step, dst, plan.dst_row_step, plan.row_length, op);
+        return;
+    }
+    size_t index[N] = {};
+    for (size_t r = 0; r < plan.rows; ++r)
+    {
+        apply_row(src, plan.src_row_step, dst, plan.dst_row_step, plan.row_length, op);
+        for (size_t d = plan.inner_dims; d-- > 0; )
+        {
+            src += plan.src_inner[d];
+            dst += plan.dst_inner[d];
+            if (++index[d] < plan.inner_shape[d])
+            {
+                break;
+            }
+            src -= plan.inner_shape[d]*plan.src_inner[d];
+            dst -= plan.inner_shape[d]*plan.dst_inner[d];
+            index[d] = 0;
+        }
+    }
+}
+
+inline size_t take_threads(size_t threads, size_t size)
+{
+    if (size < take_min_parallel_size)
+    {
+        return 1;
+    }
+    return threads == 0 ? default_thread_count() : threads;
+}
+
+template <typename In, typename Out>
+void check_take_shape(const In& a, const Out& out, size_t axis, size_t m, const char* message)
+{
+    for (size_t i = 0; i < In::ndim; ++i)
+    {
+        if (out.shape(i) != (i == axis ? m : a.shape(i)))
+        {
+            throw std::invalid_argument(message);
+        }
+    }
+}
+
+template <typename In, typename Idx, typename Out>
+void take(const In& a, const Idx& idx, Out& out, size_t axis, size_t threads)
+{
+    typedef typename In::element_type T;
+    const size_t N = In::ndim;
+    static_assert(Out::ndim == N, "take output must have the rank of its input");
+    if (axis >= N)
+    {
+        throw std::out_of_range("axis out of range");
+    }
+    std::vector<size_t> positions = index_positions(idx, a.shape(axis), In::base_type::origin());
+    const size_t m = positions.size();
+    check_take_shape(a, out, axis, m, "take output has the wrong shape");
+
+    take_plan<N> plan(a.shape(), a.strides(), out.strides(), axis, true);
+    const T* src = a.data();
+    auto dst = out.data();
+    const size_t block_bytes = (std::min)(plan.row_length*sizeof(T), take_prefetch_bytes);
+    const bool prefetch_rows = plan.contiguous_rows();
+
+    parallel_for(plan.outer_count*m, [&](size_t first, size_t last)
+    {
+        size_t src_outer = 0;
+        size_t dst_outer = 0;
+        size_t current = plan.outer_count;
+        for (size_t t = first; t < last; ++t)
+        {
+            size_t p = t / m;
+            size_t k = t % m;
+            if (p != current)
+            {
+                plan.outer_offsets(p, src_outer, dst_outer);
+                current = p;
+            }
+            if (prefetch_rows && k + take_prefetch_distance < m)
+            {
+                const char* ahead = reinterpret_cast<const char*>(src + src_outer + positions[k + take_prefetch_distance]*plan.src_step);
+                for (size_t b = 0; b < block_bytes; b += cache_line_size)
+                {
+                    prefetch(ahead + b);
+                }
+            }
+            apply_block(plan, src + src_outer + positions[k]*plan.src_step, dst + dst_outer + k*plan.dst_step, assign_op());
+        }
+    }, take_threads(threads, plan.outer_count*m*plan.block_size()));
+}
+
+// Writes the blocks of values into a at positions along the axis, in index order, so
+// later duplicates win. Conflicts between threads are avoided by giving each thread the
+// destination positions in one range of the axis, so no two threads touch the same
+// element and the result does not depend on the thread count. The indices are bucketed
+// by range once, with a counting pass and a prefix sum, and each thread applies only the
+// indices in its bucket. The buckets are stable, so index order is kept within a range.
+template <typename Array, typename Idx, typename Values, typename Op>
+void scatter(Array& a, const Idx& idx, const Values& values, size_t axis, size_t threads, Op op, const char* message)
+{
+    typedef typename Values::element_type T;
+    const size_t N = Array::ndim;
+    static_assert(Values::ndim == N, "values must have the rank of the array");
+    if (axis >= N)
+    {
+        throw std::out_of_range("axis out of range");
+    }
+    const size_t extent = a.shape(axis);
+    std::vector<size_t> positions = index_positions(idx, extent, Array::base_type::origin());
+    const size_t m = positions.size();
+    check_take_shape(a, values, axis, m, message);
+
+    take_plan<N> plan(a.shape(), values.strides(), a.strides(), axis, false);
+    const T* src = values.data();
+    auto dst = a.data();
+
+    threads = take_threads(threads, plan.outer_count*m*plan.block_size());
+    size_t parts = 1;
+    if (threads > 1 && plan.outer_count < threads)
+    {
+        parts = (std::min)(extent, (threads*4 + plan.outer_count - 1)/plan.outer_count);
+    }
+
+    // Range j holds the positions from extent*j/parts up to extent*(j + 1)/parts, bucket j
+    // holds order[starts[j]] to order[starts[j + 1]]
+    std::vector<size_t> starts(parts + 1, 0);
+    std::vector<size_t> order(m);
+    if (parts == 1)
+    {
+        starts[1] = m;
+        for (size_t k = 0; k < m; ++k)
+        {
+            order[k] = k;
+        }
+    }
+    else
+    {
+        std::vector<size_t> bucket(m);
+        for (size_t k = 0; k < m; ++k)
+        {
+            bucket[k] = ((positions[k] + 1)*parts - 1)/extent;
+            ++starts[bucket[k] + 1];
+        }
+        for (size_t j = 0; j < parts; ++j)
+        {
+            starts[j + 1] += starts[j];
+        }
+        std::vector<size_t> next(starts.begin(), starts.end() - 1);
+        for (size_t k = 0; k < m; ++k)
+        {
+            order[next[bucket[k]]++] = k;
+        }
+    }
+
+    parallel_for(plan.outer_count*parts, [&](size_t first, size_t last)
+    {
+        for (size_t t = first; t < last; ++t)
+        {
+            size_t p = t / parts;
+            size_t part = t % parts;
+            size_t src_outer, dst_outer;
+            plan.outer_offsets(p, src_outer, dst_outer);
+            for (size_t i = starts[part]; i < starts[part + 1]; ++i)
+            {
+                size_t k = order[i];
+                apply_block(plan, src + src_outer + k*plan.src_step, dst + dst_outer + positions[k]*plan.dst_step, op);
+            }
+        }
+    }, threads);
+}
+
+}
+
+// take, put, scatter_add
+//
+// Selection by an index array along one axis, as in an embedding lookup. The block of a at
+// index idx[k] along axis corresponds to the block of the taken array or values at k.
+// Indices count from Base::origin() of a. idx is a rank one ndarray or view of integers,
+// or a container with size() and operator[] such as std::vector<size_t>.
+//
+// When the axis is outermost in memory and the blocks are contiguous, each block is a
+// contiguous row copy, and take prefetches the source rows a few indices ahead. Blocks are
+// spread across threads.
+
+// Returns the blocks of a at the positions in idx along axis
+template <typename In, typename Idx>
+ndarray<typename In::element_type,In::ndim,typename In::order_type,typename In::base_type>
+take(const In& a, const Idx& idx, size_t axis = 0, size_t threads = 0)
+{
+    if (axis >= In::ndim)
+    {
+        throw std::out_of_range("axis out of range");
+    }
+    extents_t<In::ndim> shape = a.shape();
+    shape[axis] = detail::index_count(idx, detail::is_index_array<Idx>());
+    ndarray<typename In::element_type,In::ndim,typename In::order_type,typename In::base_type> out(shape);
+    detail::take(a, idx, out, axis, threads);
+    return out;
+}
+
+// Writes the blocks of a at the positions in idx along axis into out
+template <typename In, typename Idx, typename Out>
+typename std::enable_if<!std::is_integral<typename std::decay<Out>::type>::value>::type
+take(const In& a, const Idx& idx, Out&& out, size_t axis = 0, size_t threads = 0)
+{
+    detail::take(a, idx, out, axis, threads);
+}
+
+// Assigns the blocks of values to a at the positions in idx along axis. Where an index
+// repeats, the last of its blocks is the one kept.
+template <typename Array, typename Idx, typename Values>
+void put(Array&& a, const Idx& idx, const Values& values, size_t axis = 0, size_t threads = 0)
+{
+    detail::scatter(a, idx, values, axis, threads, detail::assign_op(), "put values have the wrong shape");
+}
+
+// Adds the blocks of values to a at the positions in idx along axis. Where an index
+// repeats, every one of its blocks is added, in index order.
+template <typename Array, typename Idx, typename Values>
+void scatter_add(Array&& a, const Idx& idx, const Values& values, size_t axis = 0, size_t threads = 0)
+{
+    detail::scatter(a, idx, values, axis, threads, detail::add_op(), "scatter_add values have the wrong shape");
+}
+
+}
+
+#endif
@@ -0,0 +1,466 @@
+#ifndef ACONS_LINALG_HPP
+#define ACONS_LINALG_HPP
+
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include <acons/ndarray.hpp>
+#include <acons/parallel.hpp>
+
+namespace acons {
+
+namespace detail {
+
+// A strided 2-D operand, element (i,j) is at data[i*row_stride + j*col_stride]
+template <typename TPtr>
+struct matrix_ref
+{
+    TPtr data;
+    size_t rows;
+    size_t cols;
+    size_t row_stride;
+    size_t col_stride;
+};
+
+template <typename TPtr, typename Array>
+matrix_ref<TPtr> make_matrix_ref(TPtr data, const Array& a, size_t first_dim)
+{
+    return matrix_ref<TPtr>{data, a.shape(first_dim), a.shape(first_dim+1),
+                            a.strides()[first_dim], a.strides()[first_dim+1]};
+}
+
+// Width in bytes of the vectors the micro-kernel is written for
+#if defined(__AVX__)
+const size_t gemm_vector_bytes = 32;
+#else
+const size_t gemm_vector_bytes = 16;
+#endif
+
+// The type panels are packed in and products accumulated in. float16.hpp specializes
+// it so that 16 bit floats are widened to float when packed and rounded once when stored.
+template <typename T>
+struct gemm_compute
+{
+    typedef T type;
+};
+
+// Register and cache blocking. The micro-kernel keeps an mr x nr block of C in registers,
+// nr is two vectors of T. A kc x nr panel of B stays in L1 while it is multiplied by an
+// mc x kc block of A held in L2.
+template <typename T>
+struct gemm_blocking
+{
+    static constexpr size_t mr = 4;
+    static constexpr size_t nr = sizeof(T) <= gemm_vector_bytes ? 2*gemm_vector_bytes/sizeof(T) : 2;
+    static constexpr size_t kc = 256;
+    static constexpr size_t mc = 128;
+    static constexpr size_t nc = 512;
+    static_assert(mc % mr == 0 && nc % nr == 0, "cache blocks must be whole register blocks");
+};
+
+// Copies rows [i,i+m) and columns [k,k+kb) of a into panels of mr rows, each stored
+// column by column and padded with zeros to mr rows
+template <size_t MR, typename T, typename P>
+void pack_a(const matrix_ref<const T*>& a, size_t i, size_t m, size_t k, size_t kb, P* dst)
+{
+    for (size_t i0 = 0; i0 < m; i0 += MR)
+    {
+        size_t rows = (std::min)(MR, m - i0);
+        const T* src = a.data + (i + i0)*a.row_stride + k*a.col_stride;
+        for (size_t p = 0; p < kb; ++p)
+        {
+            const T* col = src + p*a.col_stride;
+            size_t r = 0;
+            for (; r < rows; ++r)
+            {
+                dst[r] = static_cast<P>(col[r*a.row_stride]);
+            }
+            for (; r < MR; ++r)
+            {
+                dst[r] = P();
+            }
+            dst += MR;
+        }
+    }
+}
+
+// Copies rows [k,k+kb) and columns [j,j+n) of b into panels of nr columns, each stored
+// row by row and padded with zeros to nr columns
+template <size_t NR, typename T, typename P>
+void pack_b(const matrix_ref<const T*>& b, size_t k, size_t kb, size_t j, size_t n, P* dst)
+{
+    for (size_t j0 = 0; j0 < n; j0 += NR)
+    {
+        size_t cols = (std::min)(NR, n - j0);
+        const T* src = b.data + k*b.row_stride + (j + j0)*b.col_stride;
+        for (size_t p = 0; p < kb; ++p)
+        {
+            const T* row = src + p*b.row_stride;
+            size_t c = 0;
+            if (b.col_stride == 1)
+            {
+                for (; c < cols; ++c)
+                {
+                    dst[c] = static_cast<P>(row[c]);
+                }
+            }
+            else
+            {
+                for (; c < cols; ++c)
+                {
+                    dst[c] = static_cast<P>(row[c*b.col_stride]);
+                }
+            }
+            for (; c < NR; ++c)
+            {
+                dst[c] = P();
+            }
+            dst += NR;
+        }
+    }
+}
+
+// Stores or adds the leading m x n part of an mr x nr block of products to c
+template <typename P, size_t MR, size_t NR, typename T>
+void gemm_store(const P (&acc)[MR][NR], T* c, size_t row_stride, size_t col_stride,
+                size_t m, size_t n, bool accumulate)
+{
+    if (m == MR && n == NR && col_stride == 1)
+    {
+        for (size_t i = 0; i < MR; ++i)
+        {
+            T* row = c + i*row_stride;
+            for (size_t j = 0; j < NR; ++j)
+            {
+                row[j] = static_cast<T>(accumulate ? static_cast<P>(row[j]) + acc[i][j] : acc[i][j]);
+            }
+        }
+        return;
+    }
+    for (size_t i = 0; i < m; ++i)
+    {
+        T* row = c + i*row_stride;
+        if (accumulate)
+        {
+            for (size_t j = 0; j < n; ++j)
+            {
+                row[j*col_stride] = static_cast<T>(static_cast<P>(row[j*col_stride]) + acc[i][j]);
+            }
+        }
+        else
+        {
+            for (size_t j = 0; j < n; ++j)
+            {
+                row[j*col_stride] = static_cast<T>(acc[i][j]);
+            }
+        }
+    }
+}
+
+// Vector types for the micro-kernel, where the compiler provides them
+template <typename T>
+struct gemm_vector
+{
+    static constexpr bool available = false;
+};
+
+#if defined(__GNUC__)
+template <>
+struct gemm_vector<float>
+{
+    static constexpr bool available = true;
+    typedef float type __attribute__((vector_size(gemm_vector_bytes)));
+};
+
+template <>
+struct gemm_vector<double>
+{
+    static constexpr bool available = true;
+    typedef double type __attribute__((vector_size(gemm_vector_bytes)));
+};
+#endif
+
+// Multiplies an mr x kb panel of A by a kb x nr panel of B, both packed as T, and stores
+// or adds the leading m x n part of the product to c
+template <typename T, size_t MR, size_t NR, bool Vector = gemm_vector<T>::available>
+struct gemm_micro_kernel
+{
+    template <typename U>
+    static void apply(size_t kb, const T* ap, const T* bp,
+                      U* c, size_t row_stride, size_t col_stride,
+                      size_t m, size_t n, bool accumulate)
+    {
+        T acc[MR][NR] = {};
+        for (size_t p = 0; p < kb; ++p)
+        {
+            for (size_t i = 0; i < MR; ++i)
+            {
+                const T x = ap[i];
+                for (size_t j = 0; j < NR; ++j)
+                {
+                    acc[i][j] += x*bp[j];
+                }
+            }
+            ap += MR;
+            bp += NR;
+        }
+        gemm_store(acc, c, row_stride, col_stride, m, n, accumulate);
+    }
+};
+
+// A 4 x 2 vector block held in eight named accumulators, so that it stays in registers
+// whatever the optimizer decides about unrolling
+template <typename T, size_t NR>
+struct gemm_micro_kernel<T,4,NR,true>
+{
+    typedef typename gemm_vector<T>::type vector_type;
+    static_assert(NR*sizeof(T) == 2*sizeof(vector_type), "nr must be two vectors");
+
+    template <typename U>
+    static void apply(size_t kb, const T* ap, const T* bp,
+                      U* c, size_t row_stride, size_t col_stride,
+                      size_t m, size_t n, bool accumulate)
+    {
+        vector_type c00 = {}, c01 = {}, c10 = {}, c11 = {}, c20 = {}, c21 = {}, c30 = {}, c31 = {};
+        for (size_t p = 0; p < kb; ++p)
+        {
+            vector_type b0, b1;
+            std::memcpy(&b0, bp, sizeof(vector_type));
+            std::memcpy(&b1, bp + NR/2, sizeof(vector_type));
+            T a0 = ap[0], a1 = ap[1], a2 = ap[2], a3 = ap[3];
+            c00 += a0*b0; c01 += a0*b1;
+            c10 += a1*b0; c11 += a1*b1;
+            c20 += a2*b0; c21 += a2*b1;
+            c30 += a3*b0; c31 += a3*b1;
+            ap += 4;
+            bp += NR;
+        }
+        vector_type acc[4][2] = {{c00, c01}, {c10, c11}, {c20, c21}, {c30, c31}};
+        T result[4][NR];
+        std::memcpy(result, acc, sizeof(result));
+        gemm_store(result, c, row_stride, col_stride, m, n, accumulate);
+    }
+};
+
+// c = a*b for the block of c with rows [i,i+m) and columns [j,j+n). a and b are
+// matrix_refs, or other operand types with pack_a and pack_b overloads that convert
+// their elements to P.
+template <typename ARef, typename BRef, typename T, typename P>
+void gemm_tile(const ARef& a, const BRef& b, const matrix_ref<T*>& c,
+               size_t i, size_t m, size_t j, size_t n,
+               std::vector<P>& a_pack, std::vector<P>& b_pack)
+{
+    const size_t mr = gemm_blocking<P>::mr;
+    const size_t nr = gemm_blocking<P>::nr;
+    const size_t kc = gemm_blocking<P>::kc;
+    const size_t k = a.cols;
+
+    for (size_t p = 0; p < k; p += kc)
+    {
+        size_t kb = (std::min)(kc, k - p);
+        pack_b<gemm_blocking<P>::nr>(b, p, kb, j, n, b_pack.data());
+        pack_a<gemm_blocking<P>::mr>(a, i, m, p, kb, a_pack.data());
+        for (size_t j0 = 0; j0 < n; j0 += nr)
+        {
+            const P* bp = b_pack.data() + j0*kb;
+            for (size_t i0 = 0; i0 < m; i0 += mr)
+            {
+                const P* ap = a_pack.data() + i0*kb;
+                T* cp = c.data + (i + i0)*c.row_stride + (j + j0)*c.col_stride;
+                gemm_micro_kernel<P,gemm_blocking<P>::mr,gemm_blocking<P>::nr>::apply(
+                    kb, ap, bp, cp, c.row_stride, c.col_stride,
+                    (std::min)(mr, m - i0), (std::min)(nr, n - j0), p != 0);
+            }
+        }
+    }
+}
+
+inline size_t round_up_to(size_t n, size_t m)
+{
+    return (n + m - 1)/m*m;
+}
+
+// c = a*b, splitting c into tiles of at most mc x nc that are computed in parallel,
+// each thread packing its own blocks of a and b
+template <typename ARef, typename BRef, typename T>
+void gemm(const ARef& a, const BRef& b, const matrix_ref<T*>& c, size_t threads)
+{
+    typedef typename gemm_compute<T>::type P;
+    const size_t mr = gemm_blocking<P>::mr;
+    const size_t nr = gemm_blocking<P>::nr;
+    const size_t kc = gemm_blocking<P>::kc;
+    const size_t m = c.rows;
+    const size_t n = c.cols;
+    const size_t k = a.cols;
+    if (m == 0 || n == 0)
+    {
+        return;
+    }
+    if (k == 0)
+    {
+        for (size_t i = 0; i < m; ++i)
+        {
+            for (size_t j = 0; j < n; ++j)
+            {
+                c.data[i*c.row_stride + j*c.col_stride] = T();
+            }
+        }
+        return;
+    }
+
+    if (threads == 0)
+    {
+        threads = default_thread_count();
+    }
+    if (m*n*k < 64*64*64)
+    {
+        threads = 1;
+    }
+
+    // Narrow the row blocks when there are too few tiles to keep the threads busy
+    size_t nc = (std::min)(size_t(gemm_blocking<P>::nc), round_up_to(n, nr));
+    size_t col_tiles = (n + nc - 1)/nc;
+    size_t row_tiles_wanted = (threads + col_tiles - 1)/col_tiles;
+    size_t mc = (std::min)(size_t(gemm_blocking<P>::mc), round_up_to((m + row_tiles_wanted - 1)/row_tiles_wanted, mr));
+    size_t row_tiles = (m + mc - 1)/mc;
+    size_t kb = (std::min)(kc, k);
+
+    parallel_for(row_tiles*col_tiles, [&](size_t first, size_t last)
+    {
+        std::vector<P> a_pack(mc*kb);
+        std::vector<P> b_pack(kb*nc);
+        for (size_t t = first; t < last; ++t)
+        {
+            size_t i = (t / col_tiles)*mc;
+            size_t j = (t % col_tiles)*nc;
+            gemm_tile(a, b, c, i, (std::min)(mc, m - i), j, (std::min)(nc, n - j), a_pack, b_pack);
+        }
+    }, threads);
+}
+
+// Dense operands expose data() and strides(), sparse matrices do not
+template <typename Array>
+struct is_strided_operand
+{
+private:
+    template <typename U>
+    static auto test(int) -> decltype(std::declval<const U&>().data(), std::declval<const U&>().strides(), std::true_type());
+    template <typename U>
+    static std::false_type test(...);
+public:
+    static constexpr bool value = decltype(test<Array>(0))::value;
+};
+
+template <typename A, typename B>
+struct are_strided_operands
+    : std::integral_constant<bool, is_strided_operand<A>::value && is_strided_operand<B>::value>
+{
+};
+
+template <typename A, typename B, typename C>
+void check_matmul_operands()
+{
+    static_assert(std::is_same<typename A::element_type, typename B::element_type>::value &&
+                  std::is_same<typename A::element_type, typename C::element_type>::value,
+                  "matmul operands must have the same element type");
+}
+
+}
+
+// matmul
+//
+// c = a*b for matrices, or for each pair of matrices along the first dimension of
+// three dimensional arrays. Operands may be ndarrays or views of either order with any
+// strides. Blocks of a and b are packed into contiguous panels, so strided operands cost
+// no more than contiguous ones apart from the packing. c must not overlap a or b.
+
+template <typename A, typename B, typename C>
+typename std::enable_if<detail::are_strided_operands<A,B>::value &&
+                        A::ndim == 2 && B::ndim == 2 && std::decay<C>::type::ndim == 2>::type
+matmul(const A& a, const B& b, C&& c, size_t threads = 0)
+{
+    detail::check_matmul_operands<A,B,typename std::decay<C>::type>();
+    if (a.shape(1) != b.shape(0) || c.shape(0) != a.shape(0) || c.shape(1) != b.shape(1))
+    {
+        throw std::invalid_argument("matmul shapes do not conform");
+    }
+    detail::gemm(detail::make_matrix_ref(a.data(), a, 0),
+                 detail::make_matrix_ref(b.data(), b, 0),
+                 detail::make_matrix_ref(c.data(), c, 0), threads);
+}
+
+// Batched, b may be a single matrix shared by every batch
+template <typename A, typename B, typename C>
+typename std::enable_if<detail::are_strided_operands<A,B>::value &&
+                        A::ndim == 3 && (B::ndim == 2 || B::ndim == 3) && std::decay<C>::type::ndim == 3>::type
+matmul(const A& a, const B& b, C&& c, size_t threads = 0)
+{
+    typedef typename A::element_type T;
+    detail::check_matmul_operands<A,B,typename std::decay<C>::type>();
+    const size_t bd = B::ndim - 2;
+    const size_t batches = a.shape(0);
+    if ((B::ndim == 3 && b.shape(0) != batches) || c.shape(0) != batches ||
+        a.shape(2) != b.shape(bd) || c.shape(1) != a.shape(1) || c.shape(2) != b.shape(bd+1))
+    {
+        throw std::invalid_argument("matmul shapes do not conform");
+    }
+    if (threads == 0)
+    {
+        threads = default_thread_count();
+    }
+
+    const T* a_data = a.data();
+    const T* b_data = b.data();
+    T* c_data = c.data();
+    const size_t a_stride = a.strides()[0];
+    const size_t b_stride = B::ndim == 3 ? b.strides()[0] : 0;
+    const size_t c_stride = c.strides()[0];
+    auto multiply = [&](size_t first, size_t last, size_t inner_threads)
+    {
+        for (size_t i = first; i < last; ++i)
+        {
+            detail::gemm(detail::make_matrix_ref(a_data + i*a_stride, a, 1),
+                         detail::make_matrix_ref(b_data + i*b_stride, b, bd),
+                         detail::make_matrix_ref(c_data + i*c_stride, c, 1), inner_threads);
+        }
+    };
+
+    // Parallel across batches when there are enough of them, otherwise within each product
+    if (batches >= threads)
+    {
+        detail::parallel_for(batches, [&](size_t first, size_t last) {multiply(first, last, 1);}, threads);
+    }
+    else
+    {
+        multiply(0, batches, threads);
+    }
+}
+
+// Returns a*b in a new array with the order and base of a
+template <typename A, typename B>
+typename std::enable_if<detail::are_strided_operands<A,B>::value && A::ndim == 2 && B::ndim == 2,
+                        ndarray<typename A::element_type,2,typename A::order_type,typename A::base_type>>::type
+matmul(const A& a, const B& b, size_t threads = 0)
+{
+    ndarray<typename A::element_type,2,typename A::order_type,typename A::base_type> c(a.shape(0), b.shape(1));
+    matmul(a, b, c, threads);
+    return c;
+}
+
+template <typename A, typename B>
+typename std::enable_if<detail::are_strided_operands<A,B>::value && A::ndim == 3 && (B::ndim == 2 || B::ndim == 3),
+                        ndarray<typename A::element_type,3,typename A::order_type,typename A::base_type>>::type
+matmul(const A& a, const B& b, size_t threads = 0)
+{
+    ndarray<typename A::element_type,3,typename A::order_type,typename A::base_type> c(a.shape(0), a.shape(1), b.shape(B::ndim-1));
+    matmul(a, b, c, threads);
+    return c;
+}
+
+}
+
+#endif
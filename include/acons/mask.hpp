@@ -0,0 +1,722 @@
+#ifndef ACONS_MASK_HPP
+#define ACONS_MASK_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include <acons/ndarray.hpp>
+#include <acons/parallel.hpp>
+#include <acons/bit_ndarray.hpp>
+
+namespace acons {
+
+// packed_mask
+//
+// A mask stored one bit per element, see bit_ndarray.
+
+template <size_t N>
+using packed_mask = bit_ndarray<N>;
+
+namespace detail {
+
+// Arrays and views have a rank, values of any element type do not
+template <typename T, typename Enable = void>
+struct is_mask_operand : std::false_type
+{
+};
+
+template <typename T>
+struct is_mask_operand<T,decltype(void(T::ndim))> : std::true_type
+{
+};
+
+// Any bit array or view, indexed by row
+template <typename Mask>
+struct is_packed_mask : is_bit_array<Mask>
+{
+};
+
+// Elementwise traversal of K array operands of one shape, in rows. In storage order the
+// dimensions are visited in decreasing stride order of the first operand, otherwise in
+// index order. Innermost dimensions are merged into one row as far as every operand is
+// contiguous across them, unless the row must be the last dimension, as it is for packed
+// masks.
+template <size_t N, size_t K>
+struct elementwise_plan
+{
+    size_t rows;
+    size_t row_length;
+    size_t row_step[K];
+    size_t outer_dims;
+    size_t outer_shape[N];
+    size_t outer_strides[N][K];
+    bool unit;
+
+    elementwise_plan(const extents_t<N>& shape, const std::array<indices_t<N>,K>& strides,
+                     bool storage_order, bool last_dim_rows)
+        : rows(1), row_length(1), outer_dims(0), unit(true)
+    {
+        size_t dims[N];
+        size_t count = 0;
+        for (size_t i = 0; i < N; ++i)
+        {
+            if (shape[i] == 1 && !(last_dim_rows && i == N-1))
+            {
+                continue;
+            }
+            size_t j = count++;
+            while (storage_order && j > 0 && strides[0][dims[j-1]] < strides[0][i])
+            {
+                dims[j] = dims[j-1];
+                --j;
+            }
+            dims[j] = i;
+        }
+        for (size_t k = 0; k < K; ++k)
+        {
+            row_step[k] = 1;
+        }
+        if (count > 0)
+        {
+            size_t last = dims[--count];
+            row_length = shape[last];
+            for (size_t k = 0; k < K; ++k)
+            {
+                row_step[k] = strides[k][last];
+            }
+            while (!last_dim_rows && count > 0 && mergeable(strides, dims[count-1]))
+            {
+                row_length *= shape[dims[--count]];
+            }
+        }
+        for (size_t i = 0; i < count; ++i)
+        {
+            outer_shape[i] = shape[dims[i]];
+            for (size_t k = 0; k < K; ++k)
+            {
+                outer_strides[i][k] = strides[k][dims[i]];
+            }
+            rows *= outer_shape[i];
+        }
+        outer_dims = count;
+        for (size_t k = 0; k < K; ++k)
+        {
+            unit = unit && row_step[k] == 1;
+        }
+    }
+
+    bool mergeable(const std::array<indices_t<N>,K>& strides, size_t d) const
+    {
+        for (size_t k = 0; k < K; ++k)
+        {
+            if (strides[k][d] != row_step[k]*row_length)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void offsets(size_t r, size_t (&offset)[K]) const
+    {
+        for (size_t k = 0; k < K; ++k)
+        {
+            offset[k] = 0;
+        }
+        for (size_t i = outer_dims; i-- > 0; )
+        {
+            size_t index = r % outer_shape[i];
+            r /= outer_shape[i];
+            for (size_t k = 0; k < K; ++k)
+            {
+                offset[k] += index*outer_strides[i][k];
+            }
+        }
+    }
+};
+
+// Row accessors. The row kernels are written once against these, and are instantiated
+// with unit_ref when every operand is contiguous along the row, which the compiler
+// vectorizes into blends.
+
+template <typename T>
+struct unit_ref
+{
+    T* p;
+    T& operator[](size_t i) const {return p[i];}
+};
+
+template <typename T>
+struct strided_ref
+{
+    T* p;
+    size_t step;
+    T& operator[](size_t i) const {return p[i*step];}
+};
+
+template <typename T>
+struct scalar_ref
+{
+    T value;
+    const T& operator[](size_t) const {return value;}
+};
+
+struct bit_ref
+{
+    const uint64_t* words;
+    bool operator[](size_t i) const {return ((words[i/64] >> (i % 64)) & 1) != 0;}
+};
+
+template <typename T>
+unit_ref<T> row_ref(T* p, size_t, std::true_type)
+{
+    return unit_ref<T>{p};
+}
+
+template <typename T>
+strided_ref<T> row_ref(T* p, size_t step, std::false_type)
+{
+    return strided_ref<T>{p, step};
+}
+
+// Both sides are read before the select, so it compiles to a blend rather than a branch
+template <typename Out, typename M, typename A, typename B>
+void where_row(Out out, M m, A a, B b, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        auto x = a[i];
+        auto y = b[i];
+        out[i] = m[i] ? x : y;
+    }
+}
+
+template <typename Out, typename M, typename A>
+void putmask_row(Out out, M m, A a, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        auto x = a[i];
+        auto y = out[i];
+        out[i] = m[i] ? x : y;
+    }
+}
+
+template <typename M>
+size_t count_row(M m, size_t n)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        count += m[i] ? 1 : 0;
+    }
+    return count;
+}
+
+inline size_t count_row(bit_ref m, size_t n)
+{
+    size_t count = 0;
+    for (size_t j = 0; j < n/64; ++j)
+    {
+        count += popcount64(m.words[j]);
+    }
+    if (n % 64 != 0)
+    {
+        count += popcount64(m.words[n/64] & ((uint64_t(1) << (n % 64)) - 1));
+    }
+    return count;
+}
+
+// Appends the selected elements of a row at out[pos], without branching on the mask: every
+// element is written at the current position, which only advances past selected ones. When
+// the row could run past the last selected position, writes from there on go to a sink.
+template <typename T, typename M, typename A>
+size_t compress_row(T* out, size_t pos, size_t total, M m, A a, size_t n)
+{
+    if (pos + n <= total)
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            out[pos] = a[i];
+            pos += m[i] ? 1 : 0;
+        }
+    }
+    else
+    {
+        T sink;
+        for (size_t i = 0; i < n; ++i)
+        {
+            T* dst = pos < total ? out + pos : &sink;
+            *dst = a[i];
+            pos += m[i] ? 1 : 0;
+        }
+    }
+    return pos;
+}
+
+// Rows of at least this many elements in all are processed per thread
+const size_t mask_min_parallel_size = size_t(1) << 15;
+
+inline size_t mask_threads(size_t threads, size_t size)
+{
+    if (size < mask_min_parallel_size)
+    {
+        return 1;
+    }
+    return threads == 0 ? default_thread_count() : threads;
+}
+
+template <typename A, typename B>
+void check_mask_shape(const A& a, const B& b)
+{
+    if (!std::equal(a.shape().begin(), a.shape().end(), b.shape().begin()))
+    {
+        throw std::invalid_argument("mask and array shapes differ");
+    }
+}
+
+// A byte mask takes part in the plan like the array operands. A packed mask is indexed by
+// row, so with one the plan visits whole rows along the last dimension in index order.
+template <typename Mask>
+typename std::enable_if<is_packed_mask<Mask>::value,indices_t<Mask::ndim>>::type
+mask_strides(const Mask&)
+{
+    const size_t N = Mask::ndim;
+    indices_t<N> strides;
+    std::fill(strides.begin(), strides.end(), size_t(0));
+    strides[N-1] = 1;
+    return strides;
+}
+
+template <typename Mask>
+typename std::enable_if<!is_packed_mask<Mask>::value,indices_t<Mask::ndim>>::type
+mask_strides(const Mask& mask)
+{
+    return mask.strides();
+}
+
+// Rows are split into segments of this many elements, a multiple of the packed mask word
+// size, so that a single long row can still be spread across threads
+const size_t mask_segment_length = 4096;
+
+template <size_t N, size_t K>
+struct mask_plan
+{
+    elementwise_plan<N,K+1> plan;
+    size_t segments;
+
+    template <typename Mask>
+    mask_plan(const Mask& mask, const std::array<indices_t<N>,K>& strides, bool storage_order)
+        : plan(mask.shape(), all_strides(mask, strides), storage_order && !is_packed_mask<Mask>::value,
+               is_packed_mask<Mask>::value),
+          segments((plan.row_length + mask_segment_length - 1)/mask_segment_length)
+    {
+    }
+
+    template <typename Mask>
+    static std::array<indices_t<N>,K+1> all_strides(const Mask& mask, const std::array<indices_t<N>,K>& strides)
+    {
+        // The first array operand leads, so that storage order follows it
+        std::array<indices_t<N>,K+1> all;
+        for (size_t k = 0; k < K; ++k)
+        {
+            all[k] = strides[k];
+        }
+        all[K] = mask_strides(mask);
+        return all;
+    }
+
+    size_t items() const
+    {
+        return plan.rows*segments;
+    }
+
+    size_t row_length() const
+    {
+        return plan.row_length;
+    }
+
+    size_t step(size_t k) const
+    {
+        return plan.row_step[k];
+    }
+};
+
+// bool masks are read as unsigned char, which holds the same zero or one but which the
+// compiler will vectorize loads of
+template <typename T>
+struct mask_element
+{
+    typedef T type;
+};
+
+template <>
+struct mask_element<bool>
+{
+    typedef unsigned char type;
+};
+
+template <typename T>
+unit_ref<const typename mask_element<T>::type> mask_ref(const T* m, size_t offset, size_t, std::true_type)
+{
+    typedef typename mask_element<T>::type M;
+    return unit_ref<const M>{reinterpret_cast<const M*>(m + offset)};
+}
+
+template <typename T>
+strided_ref<const typename mask_element<T>::type> mask_ref(const T* m, size_t offset, size_t step, std::false_type)
+{
+    typedef typename mask_element<T>::type M;
+    return strided_ref<const M>{reinterpret_cast<const M*>(m + offset), step};
+}
+
+// Calls f(offsets, m, n, unit) for the row segments [first,last), where offsets are those
+// of the K array operands, m is the mask accessor, n the segment length and unit whether
+// every array operand is contiguous along the row
+template <size_t N, size_t K, typename Mask, typename F>
+void for_each_mask_segment(const mask_plan<N,K>& mp, const Mask& mask, size_t first, size_t last, F f, std::false_type,
+                           bool = false)
+{
+    auto m = mask.data();
+    for (size_t t = first; t < last; ++t)
+    {
+        size_t r = t / mp.segments;
+        size_t j = (t % mp.segments)*mask_segment_length;
+        size_t n = (std::min)(mask_segment_length, mp.row_length() - j);
+        size_t offset[K+1];
+        mp.plan.offsets(r, offset);
+        for (size_t k = 0; k <= K; ++k)
+        {
+            offset[k] += j*mp.step(k);
+        }
+        if (mp.plan.unit)
+        {
+            f(offset, mask_ref(m, offset[K], 1, std::true_type()), n, std::true_type());
+        }
+        else
+        {
+            f(offset, mask_ref(m, offset[K], mp.step(K), std::false_type()), n, std::false_type());
+        }
+    }
+}
+
+// With a packed mask, each segment of mask bits is unpacked into bytes so that the same
+// vectorized row kernels apply, unless bits is set, when f gets a bit_ref to the words
+template <size_t N, size_t K, typename Mask, typename F>
+void for_each_mask_segment(const mask_plan<N,K>& mp, const Mask& mask, size_t first, size_t last, F f, std::true_type,
+                           bool bits = false)
+{
+    std::vector<unsigned char> bytes(bits ? 0 : mask_segment_length);
+    for (size_t t = first; t < last; ++t)
+    {
+        size_t r = t / mp.segments;
+        size_t j = (t % mp.segments)*mask_segment_length;
+        size_t n = (std::min)(mask_segment_length, mp.row_length() - j);
+        size_t offset[K+1];
+        mp.plan.offsets(r, offset);
+        for (size_t k = 0; k < K; ++k)
+        {
+            offset[k] += j*mp.step(k);
+        }
+        const uint64_t* words = mask.row_words(r) + j/64;
+        if (bits)
+        {
+            f(offset, bit_ref{words}, n, std::false_type());
+            continue;
+        }
+        unpack_bits(words, n, bytes.data());
+        if (mp.plan.unit)
+        {
+            f(offset, unit_ref<const unsigned char>{bytes.data()}, n, std::true_type());
+        }
+        else
+        {
+            f(offset, unit_ref<const unsigned char>{bytes.data()}, n, std::false_type());
+        }
+    }
+}
+
+template <size_t N, size_t K, typename Mask, typename F>
+void for_each_mask_segment(const mask_plan<N,K>& mp, const Mask& mask, size_t threads, F f)
+{
+    parallel_for(mp.items(), [&](size_t first, size_t last)
+    {
+        for_each_mask_segment(mp, mask, first, last, f, is_packed_mask<Mask>());
+    }, mask_threads(threads, mp.items()*mask_segment_length));
+}
+
+// Row segment kernels passed to for_each_mask_segment, which calls them with the mask
+// segment and unit stride tag types of each segment
+
+template <typename Plan, typename PO, typename PA, typename PB>
+struct where_segment
+{
+    const Plan& mp;
+    PO po;
+    PA pa;
+    PB pb;
+
+    template <typename M, typename Unit>
+    void operator()(const size_t* offset, M m, size_t n, Unit unit) const
+    {
+        where_row(row_ref(po + offset[0], mp.step(0), unit), m, row_ref(pa + offset[1], mp.step(1), unit),
+                  row_ref(pb + offset[2], mp.step(2), unit), n);
+    }
+};
+
+template <typename Plan, typename PO, typename PA, typename T>
+struct where_value_segment
+{
+    const Plan& mp;
+    PO po;
+    PA pa;
+    const T& value;
+
+    template <typename M, typename Unit>
+    void operator()(const size_t* offset, M m, size_t n, Unit unit) const
+    {
+        where_row(row_ref(po + offset[0], mp.step(0), unit), m, row_ref(pa + offset[1], mp.step(1), unit),
+                  scalar_ref<T>{value}, n);
+    }
+};
+
+template <typename Plan, typename PA, typename PV>
+struct putmask_segment
+{
+    const Plan& mp;
+    PA pa;
+    PV pv;
+
+    template <typename M, typename Unit>
+    void operator()(const size_t* offset, M m, size_t n, Unit unit) const
+    {
+        putmask_row(row_ref(pa + offset[0], mp.step(0), unit), m, row_ref(pv + offset[1], mp.step(1), unit), n);
+    }
+};
+
+template <typename Plan, typename PA, typename T>
+struct putmask_value_segment
+{
+    const Plan& mp;
+    PA pa;
+    const T& value;
+
+    template <typename M, typename Unit>
+    void operator()(const size_t* offset, M m, size_t n, Unit unit) const
+    {
+        putmask_row(row_ref(pa + offset[0], mp.step(0), unit), m, scalar_ref<T>{value}, n);
+    }
+};
+
+// Stores the count of each segment at counts[next++]
+struct count_segment
+{
+    std::vector<size_t>& counts;
+    size_t& next;
+
+    template <typename M, typename Unit>
+    void operator()(const size_t*, M m, size_t n, Unit) const
+    {
+        counts[next++] = count_row(m, n);
+    }
+};
+
+// Compresses segment t to out[starts[t],starts[t+1]) and advances t
+template <typename Plan, typename Out, typename PA>
+struct compress_segment
+{
+    const Plan& mp;
+    Out out;
+    PA pa;
+    const std::vector<size_t>& starts;
+    size_t& t;
+
+    template <typename M, typename Unit>
+    void operator()(const size_t* offset, M m, size_t n, Unit unit) const
+    {
+        compress_row(out, starts[t], starts[t+1], m, row_ref(pa + offset[0], mp.step(0), unit), n);
+        ++t;
+    }
+};
+
+template <typename Out, typename Mask, typename A, typename B>
+void where(Out& out, const Mask& mask, const A& a, const B& b, size_t threads)
+{
+    const size_t N = Out::ndim;
+    mask_plan<N,3> mp(mask, std::array<indices_t<N>,3>{{out.strides(), a.strides(), b.strides()}}, true);
+    auto po = out.data();
+    auto pa = a.data();
+    auto pb = b.data();
+    for_each_mask_segment(mp, mask, threads,
+                          where_segment<mask_plan<N,3>,decltype(po),decltype(pa),decltype(pb)>{mp, po, pa, pb});
+}
+
+template <typename Out, typename Mask, typename A, typename T>
+void where_value(Out& out, const Mask& mask, const A& a, const T& value, size_t threads)
+{
+    const size_t N = Out::ndim;
+    mask_plan<N,2> mp(mask, std::array<indices_t<N>,2>{{out.strides(), a.strides()}}, true);
+    auto po = out.data();
+    auto pa = a.data();
+    for_each_mask_segment(mp, mask, threads,
+                          where_value_segment<mask_plan<N,2>,decltype(po),decltype(pa),T>{mp, po, pa, value});
+}
+
+template <typename Array, typename Mask, typename Values>
+void putmask(Array& a, const Mask& mask, const Values& values, size_t threads)
+{
+    const size_t N = Array::ndim;
+    mask_plan<N,2> mp(mask, std::array<indices_t<N>,2>{{a.strides(), values.strides()}}, true);
+    auto pa = a.data();
+    auto pv = values.data();
+    for_each_mask_segment(mp, mask, threads,
+                          putmask_segment<mask_plan<N,2>,decltype(pa),decltype(pv)>{mp, pa, pv});
+}
+
+template <typename Array, typename Mask, typename T>
+void putmask_value(Array& a, const Mask& mask, const T& value, size_t threads)
+{
+    const size_t N = Array::ndim;
+    mask_plan<N,1> mp(mask, std::array<indices_t<N>,1>{{a.strides()}}, true);
+    auto pa = a.data();
+    for_each_mask_segment(mp, mask, threads,
+                          putmask_value_segment<mask_plan<N,1>,decltype(pa),T>{mp, pa, value});
+}
+
+// Selected elements per row segment, in index order
+template <size_t N, size_t K, typename Mask>
+std::vector<size_t> segment_counts(const mask_plan<N,K>& mp, const Mask& mask, size_t threads)
+{
+    std::vector<size_t> counts(mp.items());
+    parallel_for(mp.items(), [&](size_t first, size_t last)
+    {
+        size_t next = first;
+        for_each_mask_segment(mp, mask, first, last, count_segment{counts, next}, is_packed_mask<Mask>(), true);
+    }, mask_threads(threads, mp.items()*mask_segment_length));
+    return counts;
+}
+
+// Counts the selected elements of each row segment, then compresses the segments in
+// parallel, each starting at the total of those before it
+template <typename Array, typename Mask>
+ndarray<typename Array::element_type,1,row_major,typename Array::base_type>
+compress(const Array& a, const Mask& mask, size_t threads)
+{
+    const size_t N = Array::ndim;
+    mask_plan<N,1> mp(mask, std::array<indices_t<N>,1>{{a.strides()}}, false);
+    std::vector<size_t> starts = segment_counts(mp, mask, threads);
+    size_t total = 0;
+    for (size_t& s : starts)
+    {
+        size_t c = s;
+        s = total;
+        total += c;
+    }
+    starts.push_back(total);
+
+    ndarray<typename Array::element_type,1,row_major,typename Array::base_type> result(total);
+    auto out = result.data();
+    auto pa = a.data();
+    parallel_for(mp.items(), [&](size_t first, size_t last)
+    {
+        size_t t = first;
+        for_each_mask_segment(mp, mask, first, last,
+                              compress_segment<mask_plan<N,1>,decltype(out),decltype(pa)>{mp, out, pa, starts, t},
+                              is_packed_mask<Mask>());
+    }, mask_threads(threads, mp.items()*mask_segment_length));
+    return result;
+}
+
+}
+
+// where, putmask, compress, count_nonzero
+//
+// Masked operations on ndarrays and views, where the mask is an ndarray or view of bool, or
+// a packed_mask, of the same shape as the arrays. The element loops do not branch on the
+// mask: where and putmask read both candidates and select, which the compiler turns into
+// vector blends when every operand is contiguous along the innermost loop, and compress
+// writes every element and advances its output position by the mask value.
+//
+// where and putmask traverse the arrays in the storage order of the first array operand,
+// merging dimensions over which all operands are contiguous. compress and count_nonzero
+// traverse in index order. With a packed mask, rows along the last dimension are visited
+// in index order. Long rows are split into segments, and segments are spread across
+// threads.
+
+// Returns an array with the elements of a where mask is true and those of b elsewhere
+template <typename Mask, typename A, typename B>
+typename std::enable_if<detail::is_mask_operand<B>::value,
+                        ndarray<typename A::element_type,A::ndim,typename A::order_type,typename A::base_type>>::type
+where(const Mask& mask, const A& a, const B& b, size_t threads = 0)
+{
+    detail::check_mask_shape(mask, a);
+    detail::check_mask_shape(mask, b);
+    ndarray<typename A::element_type,A::ndim,typename A::order_type,typename A::base_type> out(a.shape());
+    detail::where(out, mask, a, b, threads);
+    return out;
+}
+
+// Returns an array with the elements of a where mask is true and value elsewhere
+template <typename Mask, typename A, typename T>
+typename std::enable_if<!detail::is_mask_operand<T>::value,
+                        ndarray<typename A::element_type,A::ndim,typename A::order_type,typename A::base_type>>::type
+where(const Mask& mask, const A& a, const T& value, size_t threads = 0)
+{
+    typedef typename A::element_type U;
+    detail::check_mask_shape(mask, a);
+    ndarray<U,A::ndim,typename A::order_type,typename A::base_type> out(a.shape());
+    detail::where_value(out, mask, a, static_cast<U>(value), threads);
+    return out;
+}
+
+// Assigns the elements of values to a where mask is true
+template <typename Array, typename Mask, typename Values>
+typename std::enable_if<detail::is_mask_operand<Values>::value>::type
+putmask(Array&& a, const Mask& mask, const Values& values, size_t threads = 0)
+{
+    detail::check_mask_shape(mask, a);
+    detail::check_mask_shape(mask, values);
+    detail::putmask(a, mask, values, threads);
+}
+
+// Assigns value to a where mask is true
+template <typename Array, typename Mask, typename T>
+typename std::enable_if<!detail::is_mask_operand<T>::value>::type
+putmask(Array&& a, const Mask& mask, const T& value, size_t threads = 0)
+{
+    typedef typename std::decay<Array>::type::element_type U;
+    detail::check_mask_shape(mask, a);
+    detail::putmask_value(a, mask, static_cast<U>(value), threads);
+}
+
+// Returns the number of true elements of mask
+template <typename Mask>
+size_t count_nonzero(const Mask& mask, size_t threads = 0)
+{
+    const size_t N = Mask::ndim;
+    detail::mask_plan<N,0> mp(mask, std::array<indices_t<N>,0>(), false);
+    std::vector<size_t> counts = detail::segment_counts(mp, mask, threads);
+    size_t total = 0;
+    for (size_t c : counts)
+    {
+        total += c;
+    }
+    return total;
+}
+
+// Returns the elements of a where mask is true, in index order
+template <typename Array, typename Mask>
+ndarray<typename Array::element_type,1,row_major,typename Array::base_type>
+compress(const Array& a, const Mask& mask, size_t threads = 0)
+{
+    detail::check_mask_shape(mask, a);
+    return detail::compress(a, mask, threads);
+}
+
+}
+
+#endif
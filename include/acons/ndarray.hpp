@@ -14,11 +14,18 @@
 #include <type_traits>
 #include <iterator>
 #include <numeric> // std::accumulate
+#include <ostream>
+#if defined(ACONS_INSTRUMENTATION)
+#include <atomic>
+#endif
   
 namespace acons {
 
 // Forward declarations
 
+struct row_major;
+struct zero_based;
+
 template <typename T, size_t M, typename Order = row_major, typename Base = zero_based, typename TPtr = const T*>
 class ndarray_view_base;
 
@@ -30,6 +37,9 @@ class const_ndarray_view;
 
 template <typename T, size_t M, typename Order = row_major, typename Base = zero_based>
 class ndarray_view;
+
+template <typename T, size_t N, typename Order, typename Base, typename TPtr>
+class window_iterator;
 namespace detail {
 
 
@@ -94,6 +104,11 @@ public:
         std::fill(elements_, elements_ + size(), value);
     }
 
+    void swap(element_array& other) noexcept
+    {
+        std::swap_ranges(elements_, elements_ + size(), other.elements_);
+    }
+
     element_array() = default;
 
     template <size_t n = N, typename... Args>
@@ -172,6 +187,10 @@ public:
     {
     }
 
+    void swap(element_array&) noexcept
+    {
+    }
+
     constexpr size_t size() const noexcept
     {
         return 0;
@@ -430,6 +449,20 @@ std::ostream& operator<<(std::ostream& os, const std::array<T,N>& a)
     return os;
 }
 
+template <typename T, size_t N>
+std::ostream& operator<<(std::ostream& os, const detail::element_array<T,N>& a)
+{
+    for (auto it = a.begin(); it != a.end(); ++it)
+    {
+        if (it != a.begin())
+        {
+            os << ",";
+        }
+        os << *it;
+    }
+    return os;
+}
+
 template<class Pointer> inline
 typename std::pointer_traits<Pointer>::element_type* to_plain_pointer(Pointer ptr)
 {       
@@ -480,6 +513,38 @@ public:
     }
 };
 
+namespace detail {
+
+// Allocators may provide fill(T* p, size_t n, size_t slab, const T& val) to initialize 
+// freshly allocated buffers themselves, for example to place pages by first touch. 
+// slab is the number of elements in one index of the slowest varying dimension.
+
+template <typename Allocator, typename T>
+struct has_allocator_fill
+{
+private:
+    template <typename A>
+    static auto test(int) -> decltype(std::declval<const A&>().fill(std::declval<T*>(), size_t(), size_t(), std::declval<const T&>()), std::true_type());
+    template <typename A>
+    static std::false_type test(...);
+public:
+    static constexpr bool value = decltype(test<Allocator>(0))::value;
+};
+
+template <typename Allocator, typename T>
+void allocator_fill(const Allocator& alloc, T* p, size_t n, size_t slab, const T& val, std::true_type)
+{
+    alloc.fill(p, n, slab, val);
+}
+
+template <typename Allocator, typename T>
+void allocator_fill(const Allocator&, T* p, size_t n, size_t, const T& val, std::false_type)
+{
+    std::fill(p, p+n, val);
+}
+
+} // namespace detail
+
 template <typename T>
 struct is_stateless
  : public std::integral_constant<bool,  
@@ -576,6 +641,16 @@ struct row_major
         }
     }
 
+    static void calculate_strides(const size_t* shape, size_t* strides, size_t n, size_t& size)
+    {
+        size = 1;
+        for (size_t i = 0; i < n; ++i)
+        {
+            strides[n-i-1] = size;
+            size *= shape[n-i-1];
+        }
+    }
+
     template <size_t N>
     static void update_offsets(size_t rel, indices_t<N>& offsets)
     {
@@ -610,6 +685,16 @@ struct column_major
         }
     }
 
+    static void calculate_strides(const size_t* shape, size_t* strides, size_t n, size_t& size)
+    {
+        size = 1;
+        for (size_t i = 0; i < n; ++i)
+        {
+            strides[i] = size;
+            size *= shape[i];
+        }
+    }
+
     template <size_t N>
     static void update_offsets(size_t rel, indices_t<N>& offsets)
     {
@@ -631,6 +716,186 @@ struct column_major
     }
 };
 
+// instrumentation
+//
+// Counts allocations, deep copies, moves and view constructions per element type. 
+// Compiled out unless ACONS_INSTRUMENTATION is defined, in which case the hooks 
+// are relaxed atomic increments. The stats API is always available and reports 
+// zeros when instrumentation is compiled out.
+
+struct ndarray_stats
+{
+    size_t allocations;
+    size_t deallocations;
+    size_t bytes_allocated;
+    size_t bytes_deallocated;
+    size_t deep_copies;
+    size_t bytes_copied;
+    size_t moves;
+    size_t view_constructions;
+
+    ndarray_stats()
+        : allocations(0), deallocations(0), bytes_allocated(0), bytes_deallocated(0),
+          deep_copies(0), bytes_copied(0), moves(0), view_constructions(0)
+    {
+    }
+
+    friend ndarray_stats operator-(const ndarray_stats& lhs, const ndarray_stats& rhs)
+    {
+        ndarray_stats result;
+        result.allocations = lhs.allocations - rhs.allocations;
+        result.deallocations = lhs.deallocations - rhs.deallocations;
+        result.bytes_allocated = lhs.bytes_allocated - rhs.bytes_allocated;
+        result.bytes_deallocated = lhs.bytes_deallocated - rhs.bytes_deallocated;
+        result.deep_copies = lhs.deep_copies - rhs.deep_copies;
+        result.bytes_copied = lhs.bytes_copied - rhs.bytes_copied;
+        result.moves = lhs.moves - rhs.moves;
+        result.view_constructions = lhs.view_constructions - rhs.view_constructions;
+        return result;
+    }
+};
+
+#if defined(ACONS_INSTRUMENTATION)
+
+namespace detail {
+
+template <typename T>
+struct instrumentation
+{
+    static std::atomic<size_t> allocations;
+    static std::atomic<size_t> deallocations;
+    static std::atomic<size_t> bytes_allocated;
+    static std::atomic<size_t> bytes_deallocated;
+    static std::atomic<size_t> deep_copies;
+    static std::atomic<size_t> bytes_copied;
+    static std::atomic<size_t> moves;
+    static std::atomic<size_t> view_constructions;
+
+    static void on_allocate(size_t n)
+    {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        bytes_allocated.fetch_add(n*sizeof(T), std::memory_order_relaxed);
+    }
+    static void on_deallocate(size_t n)
+    {
+        deallocations.fetch_add(1, std::memory_order_relaxed);
+        bytes_deallocated.fetch_add(n*sizeof(T), std::memory_order_relaxed);
+    }
+    static void on_deep_copy(size_t n)
+    {
+        deep_copies.fetch_add(1, std::memory_order_relaxed);
+        bytes_copied.fetch_add(n*sizeof(T), std::memory_order_relaxed);
+    }
+    static void on_move()
+    {
+        moves.fetch_add(1, std::memory_order_relaxed);
+    }
+    static void on_view()
+    {
+        view_constructions.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    static ndarray_stats stats()
+    {
+        ndarray_stats s;
+        s.allocations = allocations.load(std::memory_order_relaxed);
+        s.deallocations = deallocations.load(std::memory_order_relaxed);
+        s.bytes_allocated = bytes_allocated.load(std::memory_order_relaxed);
+        s.bytes_deallocated = bytes_deallocated.load(std::memory_order_relaxed);
+        s.deep_copies = deep_copies.load(std::memory_order_relaxed);
+        s.bytes_copied = bytes_copied.load(std::memory_order_relaxed);
+        s.moves = moves.load(std::memory_order_relaxed);
+        s.view_constructions = view_constructions.load(std::memory_order_relaxed);
+        return s;
+    }
+
+    static void reset()
+    {
+        allocations = 0;
+        deallocations = 0;
+        bytes_allocated = 0;
+        bytes_deallocated = 0;
+        deep_copies = 0;
+        bytes_copied = 0;
+        moves = 0;
+        view_constructions = 0;
+    }
+};
+
+template <typename T> std::atomic<size_t> instrumentation<T>::allocations(0);
+template <typename T> std::atomic<size_t> instrumentation<T>::deallocations(0);
+template <typename T> std::atomic<size_t> instrumentation<T>::bytes_allocated(0);
+template <typename T> std::atomic<size_t> instrumentation<T>::bytes_deallocated(0);
+template <typename T> std::atomic<size_t> instrumentation<T>::deep_copies(0);
+template <typename T> std::atomic<size_t> instrumentation<T>::bytes_copied(0);
+template <typename T> std::atomic<size_t> instrumentation<T>::moves(0);
+template <typename T> std::atomic<size_t> instrumentation<T>::view_constructions(0);
+
+} // namespace detail
+
+constexpr bool instrumentation_enabled() {return true;}
+
+#else
+
+namespace detail {
+
+template <typename T>
+struct instrumentation
+{
+    static void on_allocate(size_t) {}
+    static void on_deallocate(size_t) {}
+    static void on_deep_copy(size_t) {}
+    static void on_move() {}
+    static void on_view() {}
+    static ndarray_stats stats() {return ndarray_stats();}
+    static void reset() {}
+};
+
+} // namespace detail
+
+constexpr bool instrumentation_enabled() {return false;}
+
+#endif
+
+// Totals for arrays and views with element type T since start up or the last reset
+template <typename T>
+ndarray_stats get_ndarray_stats()
+{
+    return detail::instrumentation<T>::stats();
+}
+
+template <typename T>
+void reset_ndarray_stats()
+{
+    detail::instrumentation<T>::reset();
+}
+
+// Records the activity for element type T between construction and a call to stats(), 
+// intended for tests. Counts are process wide, activity on other threads is included.
+template <typename T>
+class scoped_stats_recorder
+{
+    ndarray_stats start_;
+public:
+    scoped_stats_recorder()
+        : start_(get_ndarray_stats<T>())
+    {
+    }
+
+    scoped_stats_recorder(const scoped_stats_recorder&) = delete;
+    scoped_stats_recorder& operator=(const scoped_stats_recorder&) = delete;
+
+    ndarray_stats stats() const
+    {
+        return get_ndarray_stats<T>() - start_;
+    }
+
+    void restart()
+    {
+        start_ = get_ndarray_stats<T>();
+    }
+};
+
 // ndarray
 
 template <class T>
@@ -657,6 +922,14 @@ struct array_item
     {
     }
 
+    // Elements of class type, such as float16, from literals of types they convert from
+    template <typename U, typename = typename std::enable_if<!std::is_arithmetic<T>::value && std::is_arithmetic<U>::value &&
+                                                              std::is_convertible<U,T>::value>::type>
+    array_item(U val)
+        : is_array_(false), val_(val)
+    {
+    }
+
     array_item() 
         : is_array_(false)
     {
@@ -763,14 +1036,14 @@ public:
     using typename super_type::pointer;
 
     using element_type = T;
-    using value_type = std::conditional_t<N == 1, T, ndarray_view<T,N-1,Order,Base>>;
+    using value_type = typename std::conditional<N == 1, T, ndarray_view<T,N-1,Order,Base>>::type;
     //typedef T& reference;
     //typedef const T& const_reference;
     static constexpr size_t ndim = N;
     typedef typename std::conditional<N==1,iterator_one<T,T*>,iterator_n_minus_1<T,N,Order,Base,T*>>::type iterator;
     typedef typename std::conditional<N==1,iterator_one<T,const T*>,iterator_n_minus_1<T,N,Order,Base,const T*>>::type const_iterator;
     using reference = typename iterator::reference;
-    using const_reference = std::conditional_t<N == 1, const T&, ndarray_view_base<T,N-1,Order,Base,const T*>>;
+    using const_reference = typename std::conditional<N == 1, const T&, ndarray_view_base<T,N-1,Order,Base,const T*>>::type;
     typedef Order order_type;
     typedef Base base_type;
 
@@ -818,7 +1091,7 @@ public:
         Order::calculate_strides(shape_, strides_, num_elements_);
         capacity_ = num_elements_;
         data_ = create(capacity_, get_allocator());
-        std::fill(data_, data_+num_elements_, T());
+        fill_new(T());
     }
 
     ndarray(std::allocator_arg_t, const Allocator& alloc, const extents_t<N>& shape)
@@ -828,7 +1101,7 @@ public:
         Order::calculate_strides(shape_, strides_, num_elements_);
         capacity_ = num_elements_;
         data_ = create(capacity_, get_allocator());
-        std::fill(data_, data_+num_elements_, T());
+        fill_new(T());
     }
 
     ndarray(const extents_t<N>& shape, T val)
@@ -838,7 +1111,7 @@ public:
         Order::calculate_strides(shape_, strides_, num_elements_);
         capacity_ = num_elements_;
         data_ = create(capacity_, get_allocator());
-        std::fill(data_, data_+num_elements_,val);
+        fill_new(val);
     }
 
     ndarray(std::allocator_arg_t, const Allocator& alloc, const extents_t<N>& shape, T val)
@@ -849,7 +1122,7 @@ public:
 
         capacity_ = num_elements_;
         data_ = create(capacity_, get_allocator());
-        std::fill(data_, data_+num_elements_, val);
+        fill_new(val);
     }
 
     ndarray(std::initializer_list<array_item<T>> list) 
@@ -884,6 +1157,7 @@ public:
         capacity_ = num_elements_;
         data_ = create(capacity_, get_allocator());
 
+        detail::instrumentation<T>::on_deep_copy(other.num_elements_);
 #if defined(_MSC_VER)
         std::copy(other.data_, other.data_+other.num_elements_,stdext::make_checked_array_iterator(data_,num_elements_));
 #else 
@@ -898,6 +1172,7 @@ public:
         capacity_ = num_elements_;
         data_ = create(capacity_, get_allocator());
 
+        detail::instrumentation<T>::on_deep_copy(other.num_elements_);
 #if defined(_MSC_VER)
         std::copy(other.data_, other.data_+other.num_elements_,stdext::make_checked_array_iterator(data_,num_elements_));
 #else 
@@ -906,9 +1181,10 @@ public:
     }
 
     ndarray(ndarray&& other)
-        : super_type(other.get_allocator()), 
+        : super_type(std::allocator_arg, other.get_allocator()), 
           data_(other.data_), num_elements_(other.num_elements_), capacity_(other.capacity_), shape_(other.shape_), strides_(other.strides_)          
     {
+        detail::instrumentation<T>::on_move();
         other.data_ = nullptr;
         other.num_elements_ = 0;
         other.capacity_ = 0;
@@ -922,6 +1198,7 @@ public:
     {
         if (alloc == other.get_allocator())
         {
+            detail::instrumentation<T>::on_move();
             data_ = other.data_;
             other.data_ = nullptr;
             other.num_elements_ = 0;
@@ -933,6 +1210,7 @@ public:
         {
             capacity_ = num_elements_;
             data_ = create(capacity_, get_allocator());
+            detail::instrumentation<T>::on_deep_copy(other.num_elements_);
 #if defined(_MSC_VER)
             std::copy(other.data_, other.data_+other.num_elements_,stdext::make_checked_array_iterator(data_,num_elements_));
 #else 
@@ -950,6 +1228,7 @@ public:
         capacity_ = num_elements_;
         data_ = create(capacity_, get_allocator());
 
+        detail::instrumentation<T>::on_deep_copy(num_elements_);
 #if defined(_MSC_VER)
         std::copy(av.data(), av.data()+av.size(),stdext::make_checked_array_iterator(data_,num_elements_));
 #else 
@@ -966,6 +1245,7 @@ public:
         capacity_ = num_elements_;
         data_ = create(capacity_, get_allocator());
 
+        detail::instrumentation<T>::on_deep_copy(num_elements_);
 #if defined(_MSC_VER)
         std::copy(av.data(), av.data()+av.size(),stdext::make_checked_array_iterator(data_,num_elements_));
 #else 
@@ -975,18 +1255,18 @@ public:
 
     ~ndarray()
     {
-        get_allocator().deallocate(to_plain_pointer(data_), capacity_);
+        destroy(data_, capacity_);
     }
 
     template <size_t m = N>
-    typename std::enable_if<m == 1,const_iterator>::type
+    typename std::enable_if<m == 1,iterator>::type
     begin()
     {
         return iterator(this->data(),this->strides_[0],0);
     }
 
     template <size_t m = N>
-    typename std::enable_if<m == 1,const_iterator>::type
+    typename std::enable_if<m == 1,iterator>::type
     end() 
     {
         return iterator(this->data(),this->strides_[0],this->strides_[0]*this->shape_[0]);
@@ -1088,11 +1368,13 @@ public:
     {
         T* old_data = data();
         size_t old_size = size();
+        size_t old_capacity = capacity_;
 
         shape_ = shape;
         Order::calculate_strides(shape_, strides_, num_elements_);
 
-        if (num_elements_ > capacity_)
+        bool reallocated = num_elements_ > capacity_;
+        if (reallocated)
         {
             capacity_ = num_elements_;
             data_ = create(capacity_, get_allocator());
@@ -1100,19 +1382,23 @@ public:
 
         size_t len = (std::min)(old_size,num_elements_);
 
+        if (reallocated)
+        {
+            detail::instrumentation<T>::on_deep_copy(len);
 #if defined(_MSC_VER)
-        std::copy(old_data, old_data+len,stdext::make_checked_array_iterator(data_,num_elements_));
+            std::copy(old_data, old_data+len,stdext::make_checked_array_iterator(data_,num_elements_));
 #else 
-        std::copy(old_data, old_data+len,data_);
+            std::copy(old_data, old_data+len,data_);
 #endif
+        }
         if (len < num_elements_)
         {
             std::fill(data_ + len, data_+num_elements_, value);
         }
 
-        if (num_elements_ > old_size)
+        if (reallocated)
         {
-            get_allocator().deallocate(to_plain_pointer(old_data), old_size);
+            destroy(old_data, old_capacity);
         }
     }
 
@@ -1138,7 +1424,7 @@ public:
 
     ndarray& operator=(std::initializer_list<array_item<T>> list)
     {
-        get_allocator().deallocate(to_plain_pointer(data_),capacity_);
+        destroy(data_, capacity_);
         dim_from_initializer_list(list, 0);
 
         Order::calculate_strides(shape_, strides_, num_elements_);
@@ -1232,11 +1518,23 @@ private:
     {
         allocator_type alloc(allocator);
         pointer ptr = alloc.allocate(size);
+        detail::instrumentation<T>::on_allocate(size);
         return ptr;
     }
 
+    template <typename Ptr>
+    void destroy(Ptr ptr, size_t size)
+    {
+        if (ptr != nullptr)
+        {
+            detail::instrumentation<T>::on_deallocate(size);
+        }
+        get_allocator().deallocate(to_plain_pointer(ptr), size);
+    }
+
     void assign_move(ndarray<T,N,Order,Base,Allocator>&& other, std::true_type) noexcept
     {
+        detail::instrumentation<T>::on_move();
         swap(other);
     }
 
@@ -1244,13 +1542,14 @@ private:
     {
         if (size() != other.size())
         {
-            get_allocator().deallocate(to_plain_pointer(data_),capacity_);
+            destroy(data_, capacity_);
             num_elements_ = other.size();
             capacity_ = num_elements_;
             data_ = create(capacity_, get_allocator());
         }
         shape_ = other.shape();
         strides_ = other.strides();
+        detail::instrumentation<T>::on_deep_copy(other.num_elements_);
 #if defined(_MSC_VER)
         std::copy(other.data_, other.data_+other.num_elements_,stdext::make_checked_array_iterator(data_,num_elements_));
 #else 
@@ -1261,12 +1560,13 @@ private:
     void assign_copy(const ndarray<T,N,Order,Base,Allocator>& other, std::true_type)
     {
         this->allocator_ = other.get_allocator();
-        get_allocator().deallocate(to_plain_pointer(data_),capacity_);
+        destroy(data_, capacity_);
         num_elements_ = other.size();
         capacity_ = num_elements_;
         data_ = create(capacity_, get_allocator());
         shape_ = other.shape();
         strides_ = other.strides();
+        detail::instrumentation<T>::on_deep_copy(other.num_elements_);
 #if defined(_MSC_VER)
         std::copy(other.data_, other.data_+other.num_elements_,stdext::make_checked_array_iterator(data_,num_elements_));
 #else 
@@ -1278,13 +1578,14 @@ private:
     {
         if (size() != other.size())
         {
-            get_allocator().deallocate(to_plain_pointer(data_),capacity_);
+            destroy(data_, capacity_);
             num_elements_ = other.size();
             capacity_ = num_elements_;
             data_ = create(capacity_, get_allocator());
         }
         shape_ = other.shape();
         strides_ = other.strides();
+        detail::instrumentation<T>::on_deep_copy(other.num_elements_);
 #if defined(_MSC_VER)
         std::copy(other.data_, other.data_+other.num_elements_,stdext::make_checked_array_iterator(data_,num_elements_));
 #else 
@@ -1313,6 +1614,18 @@ private:
         // Undefined behavior
     }
 
+    // Initializes a newly allocated buffer, through the allocator if it provides fill
+    void fill_new(const T& val)
+    {
+        if (num_elements_ == 0)
+        {
+            return;
+        }
+        size_t slab = *std::max_element(strides_.begin(), strides_.end());
+        detail::allocator_fill(get_allocator(), to_plain_pointer(data_), num_elements_, slab, val,
+                               std::integral_constant<bool,detail::has_allocator_fill<Allocator,T>::value>());
+    }
+
     void init()
     {
         Order::calculate_strides(shape_, strides_, num_elements_);
@@ -1325,7 +1638,7 @@ private:
         Order::calculate_strides(shape_, strides_, num_elements_);
         capacity_ = num_elements_;
         data_ = create(capacity_, get_allocator());
-        std::fill(data_, data_+num_elements_,val);
+        fill_new(val);
     }
 
     void dim_from_initializer_list(const array_item<T>& init, size_t shape)
@@ -1482,16 +1795,19 @@ public:
     typedef Order order_type;
     typedef Base base_type;
     using element_type = T;
-    using value_type = std::conditional_t<M == 1, T, ndarray_view_base<T,M-1,Order,Base,TPtr>>;
+    using value_type = typename std::conditional<M == 1, T, ndarray_view_base<T,M-1,Order,Base,TPtr>>::type;
 
     typedef typename std::conditional<M==1,iterator_one<T,TPtr>,iterator_n_minus_1<T,M,Order,Base,TPtr>>::type iterator;
     typedef typename std::conditional<M==1,iterator_one<T,const T*>,iterator_n_minus_1<T,M,Order,Base,const T*>>::type const_iterator;
 
     using reference = typename iterator::reference;
-    using const_reference = std::conditional_t<M == 1, T, ndarray_view_base<T,M-1,Order,Base,const T*>>;
+    using const_reference = typename std::conditional<M == 1, T, ndarray_view_base<T,M-1,Order,Base,const T*>>::type;
 
     template <size_t K> using const_view = const_ndarray_view<T,K,Order,Base>;
 protected:
+    template <typename T2, size_t N2, typename Order2, typename Base2, typename TPtr2>
+    friend class window_iterator;
+
     TPtr base_data_;
     size_t base_size_;
     extents_t<M> shape_;
@@ -1684,6 +2000,7 @@ public:
     ndarray_view_base()
         : base_data_(nullptr), base_size_(0)
     {
+        detail::instrumentation<T>::on_view();
         shape_.fill(0);
         strides_.fill(0);
         offsets_.fill(0);
@@ -1692,12 +2009,14 @@ public:
     ndarray_view_base(TPtr data, size_t size, const extents_t<M>& shape, const indices_t<M>& strides)
         : base_data_(data), base_size_(size), shape_(shape), strides_(strides)          
     {
+        detail::instrumentation<T>::on_view();
         offsets_.fill(0);
     }
 
     ndarray_view_base(TPtr data, size_t size, const extents_t<M>& shape, const indices_t<M>& strides, const indices_t<M>& offsets)
         : base_data_(data), base_size_(size), shape_(shape), strides_(strides), offsets_(offsets)          
     {
+        detail::instrumentation<T>::on_view();
     }
 
     // data
@@ -1707,6 +2026,7 @@ public:
                        typename std::enable_if<std::is_convertible<OtherTPtr,TPtr>::value>::type* = 0) 
         : base_data_(data), shape_(shape)
     {
+        detail::instrumentation<T>::on_view();
         offsets_.fill(0);
         Order::calculate_strides(shape_, strides_, base_size_);
     }
@@ -1716,6 +2036,7 @@ public:
                        typename std::enable_if<std::is_convertible<OtherTPtr,TPtr>::value,size_t>::type i, Args... args) 
         : base_data_(data)
     {
+        detail::instrumentation<T>::on_view();
         offsets_.fill(0);
         init_helper<M>::init(shape_, *this, i, args ...);
 
@@ -1729,6 +2050,7 @@ public:
                       const indices_t<N-M>& first_dim)
         : base_data_(data), base_size_(size)
     {
+        detail::instrumentation<T>::on_view();
         size_t rel = get_offset<N,N-M,Base>(strides,first_dim);
 
         //std::cout << "offset: " << offset << "\n";
@@ -1749,6 +2071,7 @@ public:
                       const indices_t<N-M>& first_dim)
         : base_data_(data), base_size_(size)
     {
+        detail::instrumentation<T>::on_view();
         //std::cout << "ndarray_view_base strides: " << other.strides() << ", offsets: " << other.offsets() << ", first_dim: " << first_dim << ", data[0] " << base_data_[0] << ", size: " << size() << "\n";
 
         constexpr size_t K = N-M;
@@ -1773,6 +2096,7 @@ public:
                       const std::array<slice,M>& slices)
         : base_data_(data), base_size_(size)
     {
+        detail::instrumentation<T>::on_view();
         constexpr size_t K = N-M;
         size_t rel = get_offset<N,K,Base>(strides,first_dim);
 
@@ -1794,6 +2118,7 @@ public:
                       const std::array<slice,M>& slices)
         : base_data_(data), base_size_(size)
     {
+        detail::instrumentation<T>::on_view();
         constexpr size_t K = N-M;
         size_t rel = get_offset<N,K,Base>(strides, offsets ,first_dim);
 
@@ -1815,6 +2140,7 @@ public:
                       const indices_t<N-M>& last_dim)
         : base_data_(data), base_size_(size)
     {
+        detail::instrumentation<T>::on_view();
         constexpr size_t K = N-M;
 
         indices_t<N> indices;
@@ -1843,6 +2169,7 @@ public:
                       const std::array<slice,M>& slices, const indices_t<N-M>& last_dim)
         : base_data_(data), base_size_(size)
     {
+        detail::instrumentation<T>::on_view();
         constexpr size_t K = N-M;
 
         indices_t<N> indices;
@@ -2017,6 +2344,11 @@ public:
     {
     }
 
+    ndarray_view(T* data, size_t size, const extents_t<M>& shape, const indices_t<M>& strides, const indices_t<M>& offsets) 
+        : super_type(data, size, shape, strides, offsets)
+    {
+    }
+
     template <typename... Args>
     ndarray_view(T* data, size_t i, Args... args) 
         : super_type(data, i, args...)
@@ -2174,6 +2506,11 @@ public:
     {
     }
 
+    const_ndarray_view(const T* data, size_t size, const extents_t<M>& shape, const indices_t<M>& strides, const indices_t<M>& offsets) 
+        : super_type(data, size, shape, strides, offsets)
+    {
+    }
+
     template <typename... Args>
     const_ndarray_view(const T* data, size_t i, Args... args) 
         : super_type(data, i, args...)
@@ -2195,6 +2532,282 @@ public:
     }
 };
 
+// sliding windows
+
+namespace detail {
+
+template <size_t N>
+extents_t<N> window_counts(const extents_t<N>& shape, 
+                           const extents_t<N>& window_shape, 
+                           const indices_t<N>& steps)
+{
+    extents_t<N> counts;
+    for (size_t i = 0; i < N; ++i)
+    {
+        if (window_shape[i] == 0 || window_shape[i] > shape[i])
+        {
+            throw std::invalid_argument("window shape incompatible with array shape");
+        }
+        if (steps[i] == 0)
+        {
+            throw std::invalid_argument("window step must be positive");
+        }
+        counts[i] = (shape[i] - window_shape[i])/steps[i] + 1;
+    }
+    return counts;
+}
+
+template <size_t N>
+indices_t<N> unit_steps()
+{
+    indices_t<N> steps;
+    steps.fill(1);
+    return steps;
+}
+
+template <typename View, typename T, size_t N, typename Order, typename Base, typename TPtr, typename DataPtr>
+View make_window_view(const ndarray_view_base<T,N,Order,Base,TPtr>& v, DataPtr data,
+                      const extents_t<N>& window_shape, 
+                      const indices_t<N>& steps)
+{
+    extents_t<N> counts = window_counts(v.shape(), window_shape, steps);
+
+    extents_t<2*N> shape;
+    indices_t<2*N> strides;
+    indices_t<2*N> offsets;
+    for (size_t i = 0; i < N; ++i)
+    {
+        shape[i] = counts[i];
+        strides[i] = v.strides()[i]*steps[i];
+        offsets[i] = v.offsets()[i];
+
+        shape[N+i] = window_shape[i];
+        strides[N+i] = v.strides()[i];
+        offsets[N+i] = 0;
+    }
+    return View(data, v.base_size(), shape, strides, offsets);
+}
+
+} // namespace detail
+
+// The first N dimensions of a window view index the window position, the last N 
+// the element within the window. Windows overlap whenever a step is smaller than 
+// the window extent along that dimension.
+
+template <typename T, size_t N, typename Order, typename Base, typename Allocator>
+ndarray_view<T,2*N,Order,Base> sliding_window_view(ndarray<T,N,Order,Base,Allocator>& a,
+                                                   const extents_t<N>& window_shape,
+                                                   const indices_t<N>& steps = detail::unit_steps<N>())
+{
+    ndarray_view<T,N,Order,Base> v(a);
+    return detail::make_window_view<ndarray_view<T,2*N,Order,Base>>(v, v.base_data(), window_shape, steps);
+}
+
+template <typename T, size_t N, typename Order, typename Base>
+ndarray_view<T,2*N,Order,Base> sliding_window_view(ndarray_view<T,N,Order,Base>& v,
+                                                   const extents_t<N>& window_shape,
+                                                   const indices_t<N>& steps = detail::unit_steps<N>())
+{
+    return detail::make_window_view<ndarray_view<T,2*N,Order,Base>>(v, v.base_data(), window_shape, steps);
+}
+
+template <typename T, size_t N, typename Order, typename Base, typename Allocator>
+const_ndarray_view<T,2*N,Order,Base> sliding_window_view(const ndarray<T,N,Order,Base,Allocator>& a,
+                                                         const extents_t<N>& window_shape,
+                                                         const indices_t<N>& steps = detail::unit_steps<N>())
+{
+    const_ndarray_view<T,N,Order,Base> v(a);
+    return detail::make_window_view<const_ndarray_view<T,2*N,Order,Base>>(v, v.base_data(), window_shape, steps);
+}
+
+template <typename T, size_t N, typename Order, typename Base, typename TPtr>
+const_ndarray_view<T,2*N,Order,Base> sliding_window_view(const ndarray_view_base<T,N,Order,Base,TPtr>& v,
+                                                         const extents_t<N>& window_shape,
+                                                         const indices_t<N>& steps = detail::unit_steps<N>())
+{
+    return detail::make_window_view<const_ndarray_view<T,2*N,Order,Base>>(v, v.base_data(), window_shape, steps);
+}
+
+// window_iterator visits windows in index order, the last dimension varying fastest. 
+// Advancing only adjusts the offsets of the current window, shape and strides 
+// are set up once.
+
+template <typename T, size_t N, typename Order, typename Base, typename TPtr>
+class window_iterator
+{
+public:
+    typedef ndarray_view_base<T,N,Order,Base,TPtr> value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const value_type* pointer;
+    typedef const value_type& reference;
+    typedef std::input_iterator_tag iterator_category;
+private:
+    value_type v_;
+    extents_t<N> counts_;
+    indices_t<N> moves_;
+    indices_t<N> position_;
+    size_t index_;
+public:
+    window_iterator()
+        : index_(0)
+    {
+        counts_.fill(0);
+        moves_.fill(0);
+        position_.fill(0);
+    }
+
+    window_iterator(TPtr data, size_t size, 
+                    const extents_t<N>& window_shape, 
+                    const indices_t<N>& strides, 
+                    const indices_t<N>& offsets,
+                    const extents_t<N>& counts,
+                    const indices_t<N>& steps,
+                    size_t index = 0)
+        : v_(data, size, window_shape, strides, offsets), counts_(counts), index_(index)
+    {
+        for (size_t i = 0; i < N; ++i)
+        {
+            moves_[i] = strides[i]*steps[i];
+        }
+        position_.fill(0);
+    }
+
+    window_iterator(const window_iterator&) = default;
+    window_iterator(window_iterator&&) = default;
+    window_iterator& operator=(const window_iterator&) = default;
+    window_iterator& operator=(window_iterator&&) = default;
+
+    const indices_t<N>& position() const
+    {
+        return position_;
+    }
+
+    window_iterator& operator++()
+    {
+        ++index_;
+        for (size_t i = N; i-- > 0; )
+        {
+            if (++position_[i] < counts_[i])
+            {
+                Order::update_offsets(moves_[i], v_.offsets_);
+                return *this;
+            }
+            // rewind this dimension, unsigned wrap-around subtracts the distance travelled
+            Order::update_offsets(size_t(0) - (counts_[i]-1)*moves_[i], v_.offsets_);
+            position_[i] = 0;
+        }
+        return *this;
+    }
+
+    window_iterator operator++(int) // postfix increment
+    {
+        window_iterator temp(*this);
+        ++(*this);
+        return temp;
+    }
+
+    reference operator*() const
+    {
+        return v_;
+    }
+
+    pointer operator->() const
+    {
+        return &v_;
+    }
+
+    friend bool operator==(const window_iterator& it1, const window_iterator& it2)
+    {
+        return (it1.v_.base_data() == it2.v_.base_data()) && (it1.index_ == it2.index_);
+    }
+    friend bool operator!=(const window_iterator& it1, const window_iterator& it2)
+    {
+        return !(it1 == it2);
+    }
+};
+
+template <typename T, size_t N, typename Order, typename Base, typename TPtr>
+class window_range
+{
+public:
+    typedef window_iterator<T,N,Order,Base,TPtr> iterator;
+private:
+    TPtr data_;
+    size_t size_;
+    extents_t<N> window_shape_;
+    indices_t<N> strides_;
+    indices_t<N> offsets_;
+    extents_t<N> counts_;
+    indices_t<N> steps_;
+public:
+    window_range(TPtr data, size_t size, 
+                 const extents_t<N>& shape,
+                 const indices_t<N>& strides, 
+                 const indices_t<N>& offsets,
+                 const extents_t<N>& window_shape,
+                 const indices_t<N>& steps)
+        : data_(data), size_(size), window_shape_(window_shape), strides_(strides), offsets_(offsets),
+          counts_(detail::window_counts(shape, window_shape, steps)), steps_(steps)
+    {
+    }
+
+    const extents_t<N>& counts() const
+    {
+        return counts_;
+    }
+
+    size_t size() const
+    {
+        return std::accumulate(counts_.begin(), counts_.end(), size_t(1), std::multiplies<size_t>());
+    }
+
+    iterator begin() const
+    {
+        return iterator(data_, size_, window_shape_, strides_, offsets_, counts_, steps_);
+    }
+
+    iterator end() const
+    {
+        return iterator(data_, size_, window_shape_, strides_, offsets_, counts_, steps_, size());
+    }
+};
+
+template <typename T, size_t N, typename Order, typename Base, typename Allocator>
+window_range<T,N,Order,Base,T*> sliding_windows(ndarray<T,N,Order,Base,Allocator>& a,
+                                                const extents_t<N>& window_shape,
+                                                const indices_t<N>& steps = detail::unit_steps<N>())
+{
+    indices_t<N> offsets;
+    offsets.fill(0);
+    return window_range<T,N,Order,Base,T*>(a.data(), a.size(), a.shape(), a.strides(), offsets, window_shape, steps);
+}
+
+template <typename T, size_t N, typename Order, typename Base>
+window_range<T,N,Order,Base,T*> sliding_windows(ndarray_view<T,N,Order,Base>& v,
+                                                const extents_t<N>& window_shape,
+                                                const indices_t<N>& steps = detail::unit_steps<N>())
+{
+    return window_range<T,N,Order,Base,T*>(v.base_data(), v.base_size(), v.shape(), v.strides(), v.offsets(), window_shape, steps);
+}
+
+template <typename T, size_t N, typename Order, typename Base, typename Allocator>
+window_range<T,N,Order,Base,const T*> sliding_windows(const ndarray<T,N,Order,Base,Allocator>& a,
+                                                      const extents_t<N>& window_shape,
+                                                      const indices_t<N>& steps = detail::unit_steps<N>())
+{
+    indices_t<N> offsets;
+    offsets.fill(0);
+    return window_range<T,N,Order,Base,const T*>(a.data(), a.size(), a.shape(), a.strides(), offsets, window_shape, steps);
+}
+
+template <typename T, size_t N, typename Order, typename Base, typename TPtr>
+window_range<T,N,Order,Base,const T*> sliding_windows(const ndarray_view_base<T,N,Order,Base,TPtr>& v,
+                                                      const extents_t<N>& window_shape,
+                                                      const indices_t<N>& steps = detail::unit_steps<N>())
+{
+    return window_range<T,N,Order,Base,const T*>(v.base_data(), v.base_size(), v.shape(), v.strides(), v.offsets(), window_shape, steps);
+}
+
 template <typename T, size_t N, typename Order, typename Base, typename Allocator>
 bool operator==(const ndarray<T, N, Order, Base, Allocator>& lhs, const ndarray<T, N, Order, Base, Allocator>& rhs)
 {
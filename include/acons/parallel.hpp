@@ -0,0 +1,246 @@
+#ifndef ACONS_PARALLEL_HPP
+#define ACONS_PARALLEL_HPP
+
+#include <cstddef>
+#include <thread>
+#include <vector>
+#include <exception>
+#include <algorithm>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace acons {
+
+// Number of threads used when a thread count of zero is requested
+inline size_t default_thread_count()
+{
+    size_t n = std::thread::hardware_concurrency();
+    return n ? n : 1;
+}
+
+namespace detail {
+
+const size_t cache_line_size = 64;
+
+// Range [first,last) of part t when [0,n) is split into threads parts of whole grains
+inline void partition_range(size_t n, size_t grain, size_t threads, size_t t, size_t& first, size_t& last)
+{
+    size_t grains = n/grain + (n % grain != 0);
+    first = (std::min)(n, (grains*t/threads)*grain);
+    last = (std::min)(n, (grains*(t+1)/threads)*grain);
+}
+
+// Best effort, returns false if the calling thread could not be pinned to cpu
+inline bool pin_current_thread(int cpu)
+{
+#if defined(__linux__)
+    if (cpu < 0 || cpu >= CPU_SETSIZE)
+    {
+        return false;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+// Joins the threads it holds when destroyed, so that threads already started are joined
+// if starting another one throws
+class thread_joiner
+{
+    std::vector<std::thread>& threads_;
+public:
+    explicit thread_joiner(std::vector<std::thread>& threads)
+        : threads_(threads)
+    {
+    }
+
+    thread_joiner(const thread_joiner&) = delete;
+    thread_joiner& operator=(const thread_joiner&) = delete;
+
+    ~thread_joiner()
+    {
+        join();
+    }
+
+    void join()
+    {
+        for (auto& t : threads_)
+        {
+            if (t.joinable())
+            {
+                t.join();
+            }
+        }
+    }
+};
+
+// Splits [0,n) into at most threads contiguous ranges of whole grains and calls
+// f(first,last) for each on its own thread, the calling thread taking the first range.
+// The partition depends only on n, grain and threads, so two calls with the same
+// arguments split the work into the same ranges. The threads are started for each call
+// and are not pinned to cores. Rethrows the first exception thrown by f.
+template <typename F>
+void parallel_for(size_t n, F f, size_t threads = 0, size_t grain = 1)
+{
+    if (threads == 0)
+    {
+        threads = default_thread_count();
+    }
+    if (grain == 0)
+    {
+        grain = 1;
+    }
+    size_t grains = n/grain + (n % grain != 0);
+    threads = (std::min)(threads, grains);
+    if (threads <= 1)
+    {
+        if (n > 0)
+        {
+            f(size_t(0), n);
+        }
+        return;
+    }
+
+    auto range = [=](size_t t, size_t& first, size_t& last)
+    {
+        partition_range(n, grain, threads, t, first, last);
+    };
+
+    std::vector<std::exception_ptr> errors(threads);
+    std::vector<std::thread> workers;
+    thread_joiner joiner(workers);
+    workers.reserve(threads-1);
+    for (size_t t = 1; t < threads; ++t)
+    {
+        workers.emplace_back([&,t]()
+        {
+            size_t first, last;
+            range(t, first, last);
+            try
+            {
+                f(first, last);
+            }
+            catch (...)
+            {
+                errors[t] = std::current_exception();
+            }
+        });
+    }
+    size_t first, last;
+    range(0, first, last);
+    try
+    {
+        f(first, last);
+    }
+    catch (...)
+    {
+        errors[0] = std::current_exception();
+    }
+    joiner.join();
+    for (auto& e : errors)
+    {
+        if (e)
+        {
+            std::rethrow_exception(e);
+        }
+    }
+}
+
+}
+
+// Up to threads cpus the calling thread may run on, spread evenly over the allowed set,
+// all of them for a thread count of zero. Empty where affinity is not supported.
+inline std::vector<int> spread_cpus(size_t threads = 0)
+{
+    std::vector<int> allowed;
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0)
+    {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+        {
+            if (CPU_ISSET(cpu, &set))
+            {
+                allowed.push_back(cpu);
+            }
+        }
+    }
+#endif
+    if (threads == 0 || threads >= allowed.size())
+    {
+        return allowed;
+    }
+    std::vector<int> cpus(threads);
+    for (size_t t = 0; t < threads; ++t)
+    {
+        cpus[t] = allowed[t*allowed.size()/threads];
+    }
+    return cpus;
+}
+
+// Splits [0,n) like detail::parallel_for with one part per cpu, and calls f(first,last)
+// for part t on a new thread pinned to cpus[t]. Two calls with the same n, grain and
+// cpus run each range on the same cpu, so memory first touched by one call is local to
+// the threads of the other. Pinning is best effort, with an empty cpus the work runs
+// on the calling thread. Rethrows the first exception thrown by f.
+template <typename F>
+void parallel_for_pinned(size_t n, F f, const std::vector<int>& cpus, size_t grain = 1)
+{
+    if (grain == 0)
+    {
+        grain = 1;
+    }
+    size_t grains = n/grain + (n % grain != 0);
+    size_t threads = (std::min)(cpus.size(), grains);
+    if (threads == 0)
+    {
+        if (n > 0)
+        {
+            f(size_t(0), n);
+        }
+        return;
+    }
+
+    std::vector<std::exception_ptr> errors(threads);
+    std::vector<std::thread> workers;
+    detail::thread_joiner joiner(workers);
+    workers.reserve(threads);
+    for (size_t t = 0; t < threads; ++t)
+    {
+        workers.emplace_back([&,t]()
+        {
+            detail::pin_current_thread(cpus[t]);
+            size_t first, last;
+            detail::partition_range(n, grain, threads, t, first, last);
+            try
+            {
+                f(first, last);
+            }
+            catch (...)
+            {
+                errors[t] = std::current_exception();
+            }
+        });
+    }
+    joiner.join();
+    for (auto& e : errors)
+    {
+        if (e)
+        {
+            std::rethrow_exception(e);
+        }
+    }
+}
+
+}
+
+#endif
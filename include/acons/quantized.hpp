@@ -0,0 +1,910 @@
+#ifndef ACONS_QUANTIZED_HPP
+#define ACONS_QUANTIZED_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include <acons/ndarray.hpp>
+#include <acons/linalg.hpp>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace acons {
+
+namespace detail {
+
+// The real value of code q, computed the same way by every kernel so that the fused
+// paths agree with dequantize
+template <typename T>
+inline float dequantize_code(T q, float scale, int32_t zero_point)
+{
+    return scale*static_cast<float>(static_cast<int32_t>(q) - zero_point);
+}
+
+// v rounded to the nearest code of T, ties to even. Clamping first keeps v small enough
+// that adding 1.5*2^23 leaves no fraction bits in the mantissa, so the rounding is done
+// by the float unit and the loops that call this vectorize. NaN becomes the lowest code.
+template <typename T>
+inline T quantize_code(float v)
+{
+    const float lo = static_cast<float>((std::numeric_limits<T>::min)());
+    const float hi = static_cast<float>((std::numeric_limits<T>::max)());
+    const float magic = 12582912.0f;
+    v = v > lo ? v : lo;
+    v = v < hi ? v : hi;
+    return static_cast<T>(static_cast<int32_t>((v + magic) - magic));
+}
+
+// The dimension along which the codes of a dense array of this order are contiguous
+template <typename Order, size_t N>
+constexpr size_t dense_dimension()
+{
+    return std::is_same<Order,column_major>::value ? 0 : N - 1;
+}
+
+template <size_t N>
+size_t offset_of(const indices_t<N>& strides, const indices_t<N>& index)
+{
+    size_t offset = 0;
+    for (size_t i = 0; i < N; ++i)
+    {
+        offset += index[i]*strides[i];
+    }
+    return offset;
+}
+
+// Calls f(index) with the zero based index of the first element of each line along
+// dimension d, the other dimensions in index order
+template <size_t N, typename F>
+void for_each_line(const extents_t<N>& shape, size_t d, F f)
+{
+    size_t lines = 1;
+    for (size_t i = 0; i < N; ++i)
+    {
+        lines *= i == d ? 1 : shape[i];
+    }
+    if (shape[d] == 0)
+    {
+        return;
+    }
+    indices_t<N> index;
+    index.fill(0);
+    for (size_t l = 0; l < lines; ++l)
+    {
+        f(index);
+        for (size_t i = N; i-- > 0; )
+        {
+            if (i == d)
+            {
+                continue;
+            }
+            if (++index[i] < shape[i])
+            {
+                break;
+            }
+            index[i] = 0;
+        }
+    }
+}
+
+// The quantization parameters of a line are either one pair for the whole line, with
+// param_step 0, or one pair per element, with param_step 1.
+//
+// Lines of float with unit stride are processed 16 elements per step with SSE2 where the
+// compiler targets it. The block functions return the number of leading elements they
+// handled, and the scalar loops finish the rest.
+
+template <typename S>
+size_t range_blocks(const S*, size_t, float*, float*)
+{
+    return 0;
+}
+
+template <typename S, typename T>
+size_t quantize_blocks(const S*, T*, size_t, const float*, const float*, size_t)
+{
+    return 0;
+}
+
+template <typename T, typename U>
+size_t dequantize_blocks(const T*, U*, size_t, const float*, const int32_t*, size_t)
+{
+    return 0;
+}
+
+template <typename T>
+size_t sum_code_blocks(const T*, size_t, int64_t&)
+{
+    return 0;
+}
+
+#if defined(__SSE2__)
+inline size_t range_blocks(const float* in, size_t n, float* lo, float* hi)
+{
+    if (n < 16)
+    {
+        return 0;
+    }
+    __m128 l[4];
+    __m128 h[4];
+    for (size_t k = 0; k < 4; ++k)
+    {
+        l[k] = _mm_set1_ps(*lo);
+        h[k] = _mm_set1_ps(*hi);
+    }
+    size_t j = 0;
+    for (; j + 16 <= n; j += 16)
+    {
+        for (size_t k = 0; k < 4; ++k)
+        {
+            // The second operand is returned when either is NaN, so NaNs are skipped
+            __m128 v = _mm_loadu_ps(in + j + 4*k);
+            l[k] = _mm_min_ps(v, l[k]);
+            h[k] = _mm_max_ps(v, h[k]);
+        }
+    }
+    float lanes[4];
+    _mm_storeu_ps(lanes, _mm_min_ps(_mm_min_ps(l[0], l[1]), _mm_min_ps(l[2], l[3])));
+    *lo = (std::min)((std::min)(lanes[0], lanes[1]), (std::min)(lanes[2], lanes[3]));
+    _mm_storeu_ps(lanes, _mm_max_ps(_mm_max_ps(h[0], h[1]), _mm_max_ps(h[2], h[3])));
+    *hi = (std::max)((std::max)(lanes[0], lanes[1]), (std::max)(lanes[2], lanes[3]));
+    return j;
+}
+
+// Narrows four vectors of int32 codes already in range, the saturating packs doing no
+// further clamping
+inline __m128i pack_codes(const __m128i (&q)[4], int8_t*)
+{
+    return _mm_packs_epi16(_mm_packs_epi32(q[0], q[1]), _mm_packs_epi32(q[2], q[3]));
+}
+
+inline __m128i pack_codes(const __m128i (&q)[4], uint8_t*)
+{
+    return _mm_packus_epi16(_mm_packs_epi32(q[0], q[1]), _mm_packs_epi32(q[2], q[3]));
+}
+
+// Clamping before the conversion maps NaN to the lowest code, and the conversion rounds to
+// nearest even in the default rounding mode, as quantize_code does
+template <typename T>
+size_t quantize_blocks(const float* in, T* out, size_t n,
+                       const float* inv_scale, const float* zero_point, size_t param_step)
+{
+    const __m128 lo = _mm_set1_ps(static_cast<float>((std::numeric_limits<T>::min)()));
+    const __m128 hi = _mm_set1_ps(static_cast<float>((std::numeric_limits<T>::max)()));
+    __m128 s = _mm_set1_ps(*inv_scale);
+    __m128 z = _mm_set1_ps(*zero_point);
+    size_t j = 0;
+    for (; j + 16 <= n; j += 16)
+    {
+        __m128i q[4];
+        for (size_t k = 0; k < 4; ++k)
+        {
+            if (param_step != 0)
+            {
+                s = _mm_loadu_ps(inv_scale + j + 4*k);
+                z = _mm_loadu_ps(zero_point + j + 4*k);
+            }
+            __m128 v = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(in + j + 4*k), s), z);
+            q[k] = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(v, lo), hi));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + j), pack_codes(q, out));
+    }
+    return j;
+}
+
+// Widens 16 codes to four vectors of int32
+inline void widen_codes(__m128i x, int8_t*, __m128i (&q)[4])
+{
+    __m128i lo = _mm_srai_epi16(_mm_unpacklo_epi8(x, x), 8);
+    __m128i hi = _mm_srai_epi16(_mm_unpackhi_epi8(x, x), 8);
+    q[0] = _mm_srai_epi32(_mm_unpacklo_epi16(lo, lo), 16);
+    q[1] = _mm_srai_epi32(_mm_unpackhi_epi16(lo, lo), 16);
+    q[2] = _mm_srai_epi32(_mm_unpacklo_epi16(hi, hi), 16);
+    q[3] = _mm_srai_epi32(_mm_unpackhi_epi16(hi, hi), 16);
+}
+
+inline void widen_codes(__m128i x, uint8_t*, __m128i (&q)[4])
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i lo = _mm_unpacklo_epi8(x, zero);
+    __m128i hi = _mm_unpackhi_epi8(x, zero);
+    q[0] = _mm_unpacklo_epi16(lo, zero);
+    q[1] = _mm_unpackhi_epi16(lo, zero);
+    q[2] = _mm_unpacklo_epi16(hi, zero);
+    q[3] = _mm_unpackhi_epi16(hi, zero);
+}
+
+template <typename T>
+size_t dequantize_blocks(const T* in, float* out, size_t n,
+                         const float* scale, const int32_t* zero_point, size_t param_step)
+{
+    __m128 s = _mm_set1_ps(*scale);
+    __m128i z = _mm_set1_epi32(*zero_point);
+    size_t j = 0;
+    for (; j + 16 <= n; j += 16)
+    {
+        __m128i q[4];
+        widen_codes(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + j)), static_cast<T*>(nullptr), q);
+        for (size_t k = 0; k < 4; ++k)
+        {
+            if (param_step != 0)
+            {
+                s = _mm_loadu_ps(scale + j + 4*k);
+                z = _mm_loadu_si128(reinterpret_cast<const __m128i*>(zero_point + j + 4*k));
+            }
+            _mm_storeu_ps(out + j + 4*k, _mm_mul_ps(s, _mm_cvtepi32_ps(_mm_sub_epi32(q[k], z))));
+        }
+    }
+    return j;
+}
+
+// Sums of absolute differences from zero add 16 unsigned codes per instruction. Signed
+// codes are offset by 128 first.
+template <typename T>
+size_t sad_code_blocks(const T* p, size_t n, int64_t& sum)
+{
+    const __m128i offset = _mm_set1_epi8(std::is_signed<T>::value ? -128 : 0);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc = _mm_setzero_si128();
+    size_t j = 0;
+    for (; j + 16 <= n; j += 16)
+    {
+        __m128i x = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + j)), offset);
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(x, zero));
+    }
+    int64_t lanes[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), acc);
+    sum += lanes[0] + lanes[1] - (std::is_signed<T>::value ? 128*static_cast<int64_t>(j) : 0);
+    return j;
+}
+
+inline size_t sum_code_blocks(const int8_t* p, size_t n, int64_t& sum)
+{
+    return sad_code_blocks(p, n, sum);
+}
+
+inline size_t sum_code_blocks(const uint8_t* p, size_t n, int64_t& sum)
+{
+    return sad_code_blocks(p, n, sum);
+}
+#endif
+
+template <typename S>
+void line_range(const S* in, size_t in_step, size_t n, float* lo, float* hi, size_t param_step)
+{
+    if (param_step == 0)
+    {
+        size_t j = in_step == 1 ? range_blocks(in, n, lo, hi) : 0;
+        float l = *lo;
+        float h = *hi;
+        for (; j < n; ++j)
+        {
+            float v = static_cast<float>(in[j*in_step]);
+            l = v < l ? v : l;
+            h = v > h ? v : h;
+        }
+        *lo = l;
+        *hi = h;
+    }
+    else
+    {
+        for (size_t j = 0; j < n; ++j)
+        {
+            float v = static_cast<float>(in[j*in_step]);
+            lo[j] = v < lo[j] ? v : lo[j];
+            hi[j] = v > hi[j] ? v : hi[j];
+        }
+    }
+}
+
+template <typename S, typename T>
+void quantize_line(const S* in, size_t in_step, T* out, size_t n,
+                   const float* inv_scale, const float* zero_point, size_t param_step)
+{
+    size_t j = in_step == 1 ? quantize_blocks(in, out, n, inv_scale, zero_point, param_step) : 0;
+    if (param_step == 0)
+    {
+        const float s = *inv_scale;
+        const float z = *zero_point;
+        for (; j < n; ++j)
+        {
+            out[j] = quantize_code<T>(static_cast<float>(in[j*in_step])*s + z);
+        }
+    }
+    else
+    {
+        for (; j < n; ++j)
+        {
+            out[j] = quantize_code<T>(static_cast<float>(in[j*in_step])*inv_scale[j] + zero_point[j]);
+        }
+    }
+}
+
+template <typename T, typename U>
+void dequantize_line(const T* in, U* out, size_t out_step, size_t n,
+                     const float* scale, const int32_t* zero_point, size_t param_step)
+{
+    size_t j = out_step == 1 ? dequantize_blocks(in, out, n, scale, zero_point, param_step) : 0;
+    if (param_step == 0)
+    {
+        const float s = *scale;
+        const int32_t z = *zero_point;
+        for (; j < n; ++j)
+        {
+            out[j*out_step] = static_cast<U>(dequantize_code(in[j], s, z));
+        }
+    }
+    else
+    {
+        for (; j < n; ++j)
+        {
+            out[j*out_step] = static_cast<U>(dequantize_code(in[j], scale[j], zero_point[j]));
+        }
+    }
+}
+
+// The sum of n codes, the scalar part in 32 bit chunks
+template <typename T>
+int64_t sum_codes(const T* p, size_t n)
+{
+    int64_t sum = 0;
+    size_t i = sum_code_blocks(p, n, sum);
+    const size_t chunk = size_t(1) << 16;
+    for (; i < n; i += chunk)
+    {
+        const size_t m = (std::min)(chunk, n - i);
+        int32_t part = 0;
+        for (size_t j = 0; j < m; ++j)
+        {
+            part += p[i + j];
+        }
+        sum += part;
+    }
+    return sum;
+}
+
+// The scale and zero point that map [lo,hi], widened to include zero, onto the codes of T,
+// so that zero is represented exactly. The scale is at least the smallest normal float, so
+// that 1/scale is finite for ranges of denormals.
+template <typename T>
+void choose_quantization(float lo, float hi, float& scale, int32_t& zero_point)
+{
+    const float qmin = static_cast<float>((std::numeric_limits<T>::min)());
+    const float qmax = static_cast<float>((std::numeric_limits<T>::max)());
+    lo = (std::min)(lo, 0.0f);
+    hi = (std::max)(hi, 0.0f);
+    if (!(hi > lo) || !std::isfinite(hi - lo))
+    {
+        scale = 1.0f;
+        zero_point = 0;
+        return;
+    }
+    scale = (std::max)((hi - lo)/(qmax - qmin), (std::numeric_limits<float>::min)());
+    float z = std::nearbyint(qmin - lo/scale);
+    zero_point = static_cast<int32_t>((std::min)((std::max)(z, qmin), qmax));
+}
+
+}
+
+// quantized_ndarray
+//
+// An N-dimensional array of int8_t or uint8_t codes with affine quantization parameters.
+// Code q stands for the real value scale*(q - zero_point). There is one scale and zero
+// point for the whole array, or one for each index along a quantization axis, as for the
+// output channels of a weight matrix. The codes are held in a dense ndarray, a quarter of
+// the memory of the float array they approximate.
+
+template <typename T, size_t N, typename Order = row_major, typename Base = zero_based, typename Allocator = std::allocator<T>>
+class quantized_ndarray
+{
+    static_assert(std::is_same<T,int8_t>::value || std::is_same<T,uint8_t>::value,
+                  "quantized_ndarray codes must be int8_t or uint8_t");
+public:
+    typedef ndarray<T,N,Order,Base,Allocator> storage_type;
+    typedef T element_type;
+    typedef Order order_type;
+    typedef Base base_type;
+    typedef Allocator allocator_type;
+    static constexpr size_t ndim = N;
+    // The axis of an array with a single scale and zero point
+    static constexpr size_t no_axis = size_t(-1);
+private:
+    storage_type codes_;
+    size_t axis_;
+    std::vector<float> scales_;
+    std::vector<int32_t> zero_points_;
+public:
+    quantized_ndarray()
+        : axis_(no_axis), scales_(1, 1.0f), zero_points_(1, 0)
+    {
+    }
+
+    quantized_ndarray(const extents_t<N>& shape, float scale, int32_t zero_point)
+        : codes_(shape, T()), axis_(no_axis), scales_(1, scale), zero_points_(1, zero_point)
+    {
+        check_parameters();
+        fill_zero();
+    }
+
+    quantized_ndarray(std::allocator_arg_t, const Allocator& alloc,
+                      const extents_t<N>& shape, float scale, int32_t zero_point)
+        : codes_(std::allocator_arg, alloc, shape, T()), axis_(no_axis), scales_(1, scale), zero_points_(1, zero_point)
+    {
+        check_parameters();
+        fill_zero();
+    }
+
+    quantized_ndarray(const extents_t<N>& shape, size_t axis,
+                      std::vector<float> scales, std::vector<int32_t> zero_points)
+        : codes_(shape, T()), axis_(axis), scales_(std::move(scales)), zero_points_(std::move(zero_points))
+    {
+        check_parameters();
+        fill_zero();
+    }
+
+    quantized_ndarray(std::allocator_arg_t, const Allocator& alloc, const extents_t<N>& shape, size_t axis,
+                      std::vector<float> scales, std::vector<int32_t> zero_points)
+        : codes_(std::allocator_arg, alloc, shape, T()), axis_(axis),
+          scales_(std::move(scales)), zero_points_(std::move(zero_points))
+    {
+        check_parameters();
+        fill_zero();
+    }
+
+    quantized_ndarray(const quantized_ndarray&) = default;
+    quantized_ndarray(quantized_ndarray&&) = default;
+    quantized_ndarray& operator=(const quantized_ndarray&) = default;
+    quantized_ndarray& operator=(quantized_ndarray&&) = default;
+
+    allocator_type get_allocator() const
+    {
+        return codes_.get_allocator();
+    }
+
+    bool empty() const noexcept
+    {
+        return size() == 0;
+    }
+
+    size_t size() const noexcept
+    {
+        return codes_.size();
+    }
+
+    const extents_t<N>& shape() const {return codes_.shape();}
+
+    size_t shape(size_t i) const
+    {
+        assert(i < N);
+        return codes_.shape(i);
+    }
+
+    // The quantization axis, or no_axis
+    size_t axis() const
+    {
+        return axis_;
+    }
+
+    const std::vector<float>& scales() const
+    {
+        return scales_;
+    }
+
+    const std::vector<int32_t>& zero_points() const
+    {
+        return zero_points_;
+    }
+
+    // The scale and zero point of index g along the axis, or of the whole array when g is 0
+    float scale(size_t g = 0) const
+    {
+        assert(g < scales_.size());
+        return scales_[g];
+    }
+
+    int32_t zero_point(size_t g = 0) const
+    {
+        assert(g < zero_points_.size());
+        return zero_points_[g];
+    }
+
+    storage_type& codes()
+    {
+        return codes_;
+    }
+
+    const storage_type& codes() const
+    {
+        return codes_;
+    }
+
+    T* data()
+    {
+        return codes_.data();
+    }
+
+    const T* data() const
+    {
+        return codes_.data();
+    }
+
+    // The real value of an element
+    template <typename... Args>
+    float operator()(size_t i, Args... args) const
+    {
+        return (*this)(indices_t<N>{i, static_cast<size_t>(args)...});
+    }
+
+    float operator()(const indices_t<N>& indices) const
+    {
+        size_t g = axis_ == no_axis ? 0 : Base::rebase_to_zero(indices[axis_]);
+        return detail::dequantize_code(codes_(indices), scales_[g], zero_points_[g]);
+    }
+
+    void swap(quantized_ndarray& other) noexcept
+    {
+        codes_.swap(other.codes_);
+        std::swap(axis_, other.axis_);
+        scales_.swap(other.scales_);
+        zero_points_.swap(other.zero_points_);
+    }
+private:
+    void check_parameters() const
+    {
+        size_t groups = 1;
+        if (axis_ != no_axis)
+        {
+            if (axis_ >= N)
+            {
+                throw std::invalid_argument("quantization axis out of range");
+            }
+            groups = codes_.shape(axis_);
+        }
+        if (scales_.size() != groups || zero_points_.size() != groups)
+        {
+            throw std::invalid_argument("quantization parameters do not match the axis");
+        }
+        for (size_t g = 0; g < groups; ++g)
+        {
+            if (!(scales_[g] > 0) || !std::isfinite(scales_[g]))
+            {
+                throw std::invalid_argument("quantization scale must be positive and finite");
+            }
+            if (zero_points_[g] < (std::numeric_limits<T>::min)() || zero_points_[g] > (std::numeric_limits<T>::max)())
+            {
+                throw std::invalid_argument("quantization zero point out of range");
+            }
+        }
+    }
+
+    // Sets every element to the code of zero
+    void fill_zero()
+    {
+        const size_t d = detail::dense_dimension<Order,N>();
+        const size_t n = codes_.shape(d);
+        detail::for_each_line(codes_.shape(), d, [&](const indices_t<N>& index)
+        {
+            T* p = codes_.data() + detail::offset_of(codes_.strides(), index);
+            for (size_t j = 0; j < n; ++j)
+            {
+                size_t g = axis_ == no_axis ? 0 : (axis_ == d ? j : index[axis_]);
+                p[j] = static_cast<T>(zero_points_[g]);
+            }
+        });
+    }
+};
+
+template <typename T, size_t N, typename Order, typename Base, typename Allocator>
+constexpr size_t quantized_ndarray<T,N,Order,Base,Allocator>::no_axis;
+
+template <typename T, size_t N, typename Order, typename Base, typename Allocator>
+void swap(quantized_ndarray<T,N,Order,Base,Allocator>& a, quantized_ndarray<T,N,Order,Base,Allocator>& b) noexcept
+{
+    a.swap(b);
+}
+
+namespace detail {
+
+// Calls f(index, n, g, param_step) with the first index of each line of n elements along the
+// dimension the codes of a dense array of this order are contiguous in. The quantization
+// parameters of the line start at group g.
+template <typename Order, size_t N, typename F>
+void for_each_quantized_line(const extents_t<N>& shape, size_t axis, F f)
+{
+    const size_t d = dense_dimension<Order,N>();
+    const size_t n = shape[d];
+    for_each_line(shape, d, [&](const indices_t<N>& index)
+    {
+        f(index, n, axis == d || axis >= N ? 0 : index[axis], axis == d ? 1 : 0);
+    });
+}
+
+template <typename A, typename Q>
+void quantize(const A& a, Q& q)
+{
+    std::vector<float> inv_scales(q.scales().size());
+    std::vector<float> zero_points(q.scales().size());
+    for (size_t g = 0; g < inv_scales.size(); ++g)
+    {
+        inv_scales[g] = 1.0f/q.scale(g);
+        zero_points[g] = static_cast<float>(q.zero_point(g));
+    }
+    const size_t d = dense_dimension<typename Q::order_type,Q::ndim>();
+    for_each_quantized_line<typename Q::order_type>(q.shape(), q.axis(),
+        [&](const indices_t<Q::ndim>& index, size_t n, size_t g, size_t param_step)
+    {
+        quantize_line(a.data() + offset_of(a.strides(), index), a.strides()[d],
+                      q.data() + offset_of(q.codes().strides(), index), n,
+                      inv_scales.data() + g, zero_points.data() + g, param_step);
+    });
+}
+
+// Quantizes a with parameters chosen from the range of each group of elements
+template <typename T, typename Order, typename Base, typename A>
+quantized_ndarray<T,A::ndim,Order,Base> quantize(const A& a, size_t axis)
+{
+    const size_t N = A::ndim;
+    const size_t d = dense_dimension<Order,N>();
+    const size_t groups = axis >= N ? 1 : a.shape(axis);
+    std::vector<float> lo(groups, 0.0f);
+    std::vector<float> hi(groups, 0.0f);
+    for_each_quantized_line<Order>(a.shape(), axis, [&](const indices_t<N>& index, size_t n, size_t g, size_t param_step)
+    {
+        line_range(a.data() + offset_of(a.strides(), index), a.strides()[d], n, lo.data() + g, hi.data() + g, param_step);
+    });
+
+    std::vector<float> scales(groups);
+    std::vector<int32_t> zero_points(groups);
+    for (size_t g = 0; g < groups; ++g)
+    {
+        choose_quantization<T>(lo[g], hi[g], scales[g], zero_points[g]);
+    }
+    quantized_ndarray<T,N,Order,Base> q(a.shape(), axis, std::move(scales), std::move(zero_points));
+    quantize(a, q);
+    return q;
+}
+
+// A 2-D quantized operand of gemm. The parameters of element (i,j) are at
+// i*row_group_step + j*col_group_step.
+template <typename T>
+struct quantized_matrix_ref
+{
+    const T* data;
+    size_t rows;
+    size_t cols;
+    size_t row_stride;
+    size_t col_stride;
+    const float* scales;
+    const int32_t* zero_points;
+    size_t row_group_step;
+    size_t col_group_step;
+};
+
+// Dequantizes while packing, so only one block of each operand is ever held as float
+template <size_t MR, typename T, typename P>
+void pack_a(const quantized_matrix_ref<T>& a, size_t i, size_t m, size_t k, size_t kb, P* dst)
+{
+    for (size_t i0 = 0; i0 < m; i0 += MR)
+    {
+        size_t rows = (std::min)(MR, m - i0);
+        for (size_t p = 0; p < kb; ++p)
+        {
+            size_t r = 0;
+            for (; r < rows; ++r)
+            {
+                size_t row = i + i0 + r;
+                size_t col = k + p;
+                size_t g = row*a.row_group_step + col*a.col_group_step;
+                dst[r] = static_cast<P>(dequantize_code(a.data[row*a.row_stride + col*a.col_stride],
+                                                        a.scales[g], a.zero_points[g]));
+            }
+            for (; r < MR; ++r)
+            {
+                dst[r] = P();
+            }
+            dst += MR;
+        }
+    }
+}
+
+template <size_t NR, typename T, typename P>
+void pack_b(const quantized_matrix_ref<T>& b, size_t k, size_t kb, size_t j, size_t n, P* dst)
+{
+    for (size_t j0 = 0; j0 < n; j0 += NR)
+    {
+        size_t cols = (std::min)(NR, n - j0);
+        for (size_t p = 0; p < kb; ++p)
+        {
+            const size_t row = k + p;
+            const T* src = b.data + row*b.row_stride + (j + j0)*b.col_stride;
+            const size_t g0 = row*b.row_group_step + (j + j0)*b.col_group_step;
+            size_t c = 0;
+            for (; c < cols; ++c)
+            {
+                size_t g = g0 + c*b.col_group_step;
+                dst[c] = static_cast<P>(dequantize_code(src[c*b.col_stride], b.scales[g], b.zero_points[g]));
+            }
+            for (; c < NR; ++c)
+            {
+                dst[c] = P();
+            }
+            dst += NR;
+        }
+    }
+}
+
+template <typename A>
+matrix_ref<const float*> make_dequantize_operand(const A& a)
+{
+    static_assert(std::is_same<typename A::element_type,float>::value,
+                  "dequantize_matmul operands must be quantized arrays or arrays of float");
+    return make_matrix_ref(a.data(), a, 0);
+}
+
+template <typename T, typename Order, typename Base, typename Allocator>
+quantized_matrix_ref<T> make_dequantize_operand(const quantized_ndarray<T,2,Order,Base,Allocator>& q)
+{
+    return quantized_matrix_ref<T>{q.data(), q.shape(0), q.shape(1), q.codes().strides()[0], q.codes().strides()[1],
+                                   q.scales().data(), q.zero_points().data(),
+                                   q.axis() == 0 ? size_t(1) : size_t(0), q.axis() == 1 ? size_t(1) : size_t(0)};
+}
+
+}
+
+// quantize
+//
+// Quantizes an ndarray or view of float, or of any type that converts to float, of any
+// order and strides. Values are divided by the scale, rounded to the nearest code, ties
+// to even, and clamped to the range of T.
+
+// One scale and zero point, chosen from the range of a widened to include zero
+template <typename T, typename A>
+quantized_ndarray<T,A::ndim,typename A::order_type,typename A::base_type> quantize(const A& a)
+{
+    return detail::quantize<T,typename A::order_type,typename A::base_type>(a, size_t(-1));
+}
+
+// One scale and zero point per index along axis, each chosen from the range of its slice
+template <typename T, typename A>
+quantized_ndarray<T,A::ndim,typename A::order_type,typename A::base_type> quantize(const A& a, size_t axis)
+{
+    if (axis >= A::ndim)
+    {
+        throw std::invalid_argument("quantization axis out of range");
+    }
+    return detail::quantize<T,typename A::order_type,typename A::base_type>(a, axis);
+}
+
+// With the scales and zero points already held by q
+template <typename A, typename T, size_t N, typename Order, typename Base, typename Allocator>
+void quantize(const A& a, quantized_ndarray<T,N,Order,Base,Allocator>& q)
+{
+    static_assert(A::ndim == N, "quantize operands must have the same rank");
+    if (!std::equal(a.shape().begin(), a.shape().end(), q.shape().begin()))
+    {
+        throw std::invalid_argument("quantize shapes differ");
+    }
+    detail::quantize(a, q);
+}
+
+// dequantize
+//
+// Converts the codes of q to real values, into a new array of float or into an ndarray or
+// view of the same shape.
+
+template <typename T, size_t N, typename Order, typename Base, typename Allocator, typename Out>
+typename std::enable_if<(std::decay<Out>::type::ndim > 0)>::type
+dequantize(const quantized_ndarray<T,N,Order,Base,Allocator>& q, Out&& out)
+{
+    static_assert(std::decay<Out>::type::ndim == N, "dequantize operands must have the same rank");
+    if (!std::equal(q.shape().begin(), q.shape().end(), out.shape().begin()))
+    {
+        throw std::invalid_argument("dequantize shapes differ");
+    }
+    const size_t d = detail::dense_dimension<Order,N>();
+    detail::for_each_quantized_line<Order>(q.shape(), q.axis(), [&](const indices_t<N>& index, size_t n, size_t g, size_t param_step)
+    {
+        detail::dequantize_line(q.data() + detail::offset_of(q.codes().strides(), index),
+                                out.data() + detail::offset_of(out.strides(), index), out.strides()[d], n,
+                                q.scales().data() + g, q.zero_points().data() + g, param_step);
+    });
+}
+
+template <typename T, size_t N, typename Order, typename Base, typename Allocator>
+ndarray<float,N,Order,Base> dequantize(const quantized_ndarray<T,N,Order,Base,Allocator>& q)
+{
+    ndarray<float,N,Order,Base> out(q.shape());
+    dequantize(q, out);
+    return out;
+}
+
+// dequantize_sum
+//
+// The sum of the real values of q, computed from integer sums of the codes of each group
+// of elements that share a scale and zero point, without converting the elements.
+
+template <typename T, size_t N, typename Order, typename Base, typename Allocator>
+double dequantize_sum(const quantized_ndarray<T,N,Order,Base,Allocator>& q)
+{
+    const size_t groups = q.scales().size();
+    if (q.size() == 0)
+    {
+        return 0;
+    }
+    std::vector<int64_t> sums(groups, 0);
+    if (q.axis() == q.no_axis)
+    {
+        sums[0] = detail::sum_codes(q.data(), q.size());
+    }
+    else
+    {
+        detail::for_each_quantized_line<Order>(q.shape(), q.axis(), [&](const indices_t<N>& index, size_t n, size_t g, size_t param_step)
+        {
+            const T* p = q.data() + detail::offset_of(q.codes().strides(), index);
+            if (param_step == 0)
+            {
+                sums[g] += detail::sum_codes(p, n);
+            }
+            else
+            {
+                for (size_t j = 0; j < n; ++j)
+                {
+                    sums[j] += p[j];
+                }
+            }
+        });
+    }
+
+    const double count = static_cast<double>(q.size()/groups);
+    double sum = 0;
+    for (size_t g = 0; g < groups; ++g)
+    {
+        sum += static_cast<double>(q.scale(g))*(static_cast<double>(sums[g]) - count*q.zero_point(g));
+    }
+    return sum;
+}
+
+// dequantize_matmul
+//
+// c = a*b in float, where either or both of a and b are 2-D quantized arrays and the others
+// are ndarrays or views of float. Blocks of a and b are dequantized into the float panels
+// matmul packs them into, so the dequantized operands are never held in full. c must not
+// overlap a or b.
+
+template <typename A, typename B, typename C>
+typename std::enable_if<A::ndim == 2 && B::ndim == 2 && std::decay<C>::type::ndim == 2>::type
+dequantize_matmul(const A& a, const B& b, C&& c, size_t threads = 0)
+{
+    static_assert(std::is_same<typename std::decay<C>::type::element_type,float>::value,
+                  "dequantize_matmul result must be an array of float");
+    if (a.shape(1) != b.shape(0) || c.shape(0) != a.shape(0) || c.shape(1) != b.shape(1))
+    {
+        throw std::invalid_argument("matmul shapes do not conform");
+    }
+    detail::gemm(detail::make_dequantize_operand(a),
+                 detail::make_dequantize_operand(b),
+                 detail::make_matrix_ref(c.data(), c, 0), threads);
+}
+
+// Returns a*b in a new array of float with the order and base of a
+template <typename A, typename B>
+typename std::enable_if<A::ndim == 2 && B::ndim == 2,
+                        ndarray<float,2,typename A::order_type,typename A::base_type>>::type
+dequantize_matmul(const A& a, const B& b, size_t threads = 0)
+{
+    ndarray<float,2,typename A::order_type,typename A::base_type> c(a.shape(0), b.shape(1));
+    dequantize_matmul(a, b, c, threads);
+    return c;
+}
+
+}
+
+#endif
@@ -0,0 +1,191 @@
+#ifndef ACONS_RCU_NDARRAY_HPP
+#define ACONS_RCU_NDARRAY_HPP
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stdexcept>
+#include <acons/ndarray.hpp>
+#include <acons/parallel.hpp>
+
+namespace acons {
+
+// rcu_ndarray
+//
+// An ndarray kept in two or three buffers, for data that is read by many threads and
+// rebuilt in the background. Readers take a read_guard, which pins the current buffer
+// and views it, and never lock or wait for the writer. Reads are lock-free, not
+// wait-free: read() retries when a publish lands while it pins a buffer, so a reader
+// can be delayed by a steady stream of publishes, though some thread always progresses.
+// A writer fills a buffer that no reader holds and publishes it with an atomic store.
+// Later readers see the new buffer while earlier guards keep viewing the old one, which
+// is not reused until they are released. With three buffers a writer rarely waits, with
+// two it waits for the readers of the previous version to finish. Writers yield while
+// they wait, so a guard that is held for a long time blocks every writer.
+
+template <typename T, size_t N, typename Order = row_major, typename Base = zero_based, typename Allocator = std::allocator<T>>
+class rcu_ndarray
+{
+public:
+    typedef ndarray<T,N,Order,Base,Allocator> array_type;
+    typedef const_ndarray_view<T,N,Order,Base> const_view_type;
+private:
+    // Padded so that each count is on its own cache line
+    struct reader_count
+    {
+        std::atomic<size_t> value;
+        char padding[detail::cache_line_size - sizeof(std::atomic<size_t>)];
+    };
+
+    std::vector<std::unique_ptr<array_type>> buffers_;
+    std::unique_ptr<reader_count[]> readers_;
+    std::unique_ptr<size_t[]> versions_;
+    alignas(detail::cache_line_size) std::atomic<size_t> current_;
+    std::mutex writer_mutex_;
+public:
+    // Pins one published version for as long as the guard lives
+    class read_guard
+    {
+        friend class rcu_ndarray;
+
+        const rcu_ndarray* owner_;
+        size_t index_;
+        size_t version_;
+
+        read_guard(const rcu_ndarray* owner, size_t index, size_t version)
+            : owner_(owner), index_(index), version_(version)
+        {
+        }
+    public:
+        read_guard(const read_guard&) = delete;
+        read_guard& operator=(const read_guard&) = delete;
+
+        read_guard(read_guard&& other) noexcept
+            : owner_(other.owner_), index_(other.index_), version_(other.version_)
+        {
+            other.owner_ = nullptr;
+        }
+
+        ~read_guard()
+        {
+            if (owner_ != nullptr)
+            {
+                owner_->readers_[index_].value.fetch_sub(1, std::memory_order_release);
+            }
+        }
+
+        const array_type& get() const
+        {
+            return *owner_->buffers_[index_];
+        }
+
+        const_view_type view() const
+        {
+            return const_view_type(get());
+        }
+
+        // Number of publishes before this version
+        size_t version() const noexcept
+        {
+            return version_;
+        }
+    };
+
+    rcu_ndarray(const extents_t<N>& shape, const T& val = T(), size_t buffers = 2,
+                const Allocator& alloc = Allocator())
+        : readers_(new reader_count[buffers]), versions_(new size_t[buffers]), current_(0)
+    {
+        if (buffers != 2 && buffers != 3)
+        {
+            throw std::invalid_argument("rcu_ndarray needs two or three buffers");
+        }
+        for (size_t i = 0; i < buffers; ++i)
+        {
+            buffers_.emplace_back(new array_type(std::allocator_arg, alloc, shape, val));
+            readers_[i].value.store(0, std::memory_order_relaxed);
+            versions_[i] = 0;
+        }
+    }
+
+    rcu_ndarray(const rcu_ndarray&) = delete;
+    rcu_ndarray& operator=(const rcu_ndarray&) = delete;
+
+    size_t num_buffers() const noexcept
+    {
+        return buffers_.size();
+    }
+
+    // Readers
+
+    // Pins the current buffer. Retries only if a publish lands between loading the
+    // current index and pinning it, so it is lock-free but not wait-free.
+    read_guard read() const
+    {
+        for (;;)
+        {
+            size_t index = current_.load(std::memory_order_seq_cst);
+            readers_[index].value.fetch_add(1, std::memory_order_seq_cst);
+            if (current_.load(std::memory_order_seq_cst) == index)
+            {
+                return read_guard(this, index, versions_[index]);
+            }
+            readers_[index].value.fetch_sub(1, std::memory_order_release);
+        }
+    }
+
+    // Writers, serialized with each other
+
+    // Calls f(array_type&) on a free buffer, which holds an older version or is of an
+    // earlier shape, then publishes it. f may resize the array.
+    template <typename F>
+    void update(F f)
+    {
+        std::lock_guard<std::mutex> lock(writer_mutex_);
+        size_t index = acquire_back_buffer();
+        f(*buffers_[index]);
+        publish(index);
+    }
+
+    // Like update, but the buffer is first assigned the current version
+    template <typename F>
+    void modify(F f)
+    {
+        std::lock_guard<std::mutex> lock(writer_mutex_);
+        size_t index = acquire_back_buffer();
+        *buffers_[index] = *buffers_[current_.load(std::memory_order_relaxed)];
+        f(*buffers_[index]);
+        publish(index);
+    }
+private:
+    // Waits until a buffer other than the current one has no readers. This spins with
+    // yield, blocking the writer (and, through writer_mutex_, later writers) for as long
+    // as readers hold every back buffer.
+    size_t acquire_back_buffer()
+    {
+        size_t current = current_.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            for (size_t i = 1; i < buffers_.size(); ++i)
+            {
+                size_t index = (current + i) % buffers_.size();
+                if (readers_[index].value.load(std::memory_order_seq_cst) == 0)
+                {
+                    return index;
+                }
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    void publish(size_t index)
+    {
+        versions_[index] = versions_[current_.load(std::memory_order_relaxed)] + 1;
+        current_.store(index, std::memory_order_seq_cst);
+    }
+};
+
+}
+
+#endif
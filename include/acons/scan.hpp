@@ -0,0 +1,423 @@
+#ifndef ACONS_SCAN_HPP
+#define ACONS_SCAN_HPP
+
+#include <cstddef>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include <acons/ndarray.hpp>
+#include <acons/parallel.hpp>
+
+namespace acons {
+
+// scan_identity
+//
+// The value an exclusive scan with Op starts from. Specialize it to use other
+// operations with scan, or pass the initial value to exclusive_scan.
+
+template <typename Op>
+struct scan_identity
+{
+};
+
+template <typename T>
+struct scan_identity<std::plus<T>>
+{
+    static T value() {return T(0);}
+};
+
+template <typename T>
+struct scan_identity<std::multiplies<T>>
+{
+    static T value() {return T(1);}
+};
+
+namespace detail {
+
+template <typename Op, typename Enable = void>
+struct has_scan_identity : std::false_type
+{
+};
+
+template <typename Op>
+struct has_scan_identity<Op,decltype(void(scan_identity<Op>::value()))> : std::true_type
+{
+};
+
+template <typename Op, typename U, bool Defined = has_scan_identity<Op>::value>
+struct scan_initial
+{
+    static U value()
+    {
+        return static_cast<U>(scan_identity<Op>::value());
+    }
+};
+
+template <typename Op, typename U>
+struct scan_initial<Op,U,false>
+{
+    static U value()
+    {
+        return U();
+    }
+};
+
+// Lanes vectorized together, and elements per lane scanned by one thread before the
+// two pass block scan is used
+const size_t scan_strip_width = 1024;
+const size_t scan_block_min_length = size_t(1) << 15;
+
+// The scan axis, the dimension the lanes are vectorized across, which is the other
+// dimension with the smallest input stride, and the remaining outer dimensions
+template <size_t N>
+struct scan_layout
+{
+    size_t length;
+    size_t in_step;
+    size_t out_step;
+    size_t width;
+    size_t in_inner;
+    size_t out_inner;
+    size_t outer_dims;
+    size_t outer_shape[N];
+    size_t in_outer[N];
+    size_t out_outer[N];
+    size_t outer_count;
+
+    template <typename In, typename Out>
+    scan_layout(const In& input, const Out& output, size_t axis)
+        : length(input.shape(axis)), in_step(input.strides()[axis]), out_step(output.strides()[axis]),
+          width(1), in_inner(0), out_inner(0), outer_dims(0), outer_count(1)
+    {
+        size_t inner = N;
+        for (size_t i = 0; i < N; ++i)
+        {
+            if (i != axis && input.shape(i) > 1 && (inner == N || input.strides()[i] < input.strides()[inner]))
+            {
+                inner = i;
+            }
+        }
+        if (inner != N)
+        {
+            width = input.shape(inner);
+            in_inner = input.strides()[inner];
+            out_inner = output.strides()[inner];
+        }
+        for (size_t i = 0; i < N; ++i)
+        {
+            if (i != axis && i != inner)
+            {
+                outer_shape[outer_dims] = input.shape(i);
+                in_outer[outer_dims] = input.strides()[i];
+                out_outer[outer_dims] = output.strides()[i];
+                outer_count *= input.shape(i);
+                ++outer_dims;
+            }
+        }
+    }
+
+    // True if consecutive elements along the axis are closer than consecutive lanes
+    bool axis_innermost() const
+    {
+        return width == 1 || in_step < in_inner;
+    }
+
+    void outer_offsets(size_t p, size_t& in_offset, size_t& out_offset) const
+    {
+        in_offset = 0;
+        out_offset = 0;
+        for (size_t i = outer_dims; i-- > 0; )
+        {
+            size_t index = p % outer_shape[i];
+            p /= outer_shape[i];
+            in_offset += index*in_outer[i];
+            out_offset += index*out_outer[i];
+        }
+    }
+};
+
+// Scans n elements of one lane, starting from carry if has_carry, and returns the
+// last running value. Without a carry an exclusive scan starts from initial.
+template <typename T, typename U, typename Op>
+U scan_lane(const T* in, size_t in_step, U* out, size_t out_step, size_t n,
+            Op op, bool inclusive, const U& initial, U carry, bool has_carry)
+{
+    U running = carry;
+    size_t i = 0;
+    if (!has_carry && n > 0)
+    {
+        running = inclusive ? static_cast<U>(in[0]) : op(initial, static_cast<U>(in[0]));
+        out[0] = inclusive ? running : initial;
+        i = 1;
+    }
+    for (; i < n; ++i)
+    {
+        U next = op(running, static_cast<U>(in[i*in_step]));
+        out[i*out_step] = inclusive ? next : running;
+        running = next;
+    }
+    return running;
+}
+
+template <typename T, typename U, typename Op>
+U reduce_lane(const T* in, size_t in_step, size_t n, Op op)
+{
+    U total = static_cast<U>(in[0]);
+    for (size_t i = 1; i < n; ++i)
+    {
+        total = op(total, static_cast<U>(in[i*in_step]));
+    }
+    return total;
+}
+
+// Two pass block scan of one long lane: each thread reduces a block, the block totals
+// are scanned, then each thread scans its block starting from the total before it
+template <typename T, typename U, typename Op>
+void block_scan_lane(const T* in, size_t in_step, U* out, size_t out_step, size_t n,
+                     Op op, bool inclusive, const U& initial, size_t threads)
+{
+    size_t blocks = (std::min)(threads, n);
+    size_t block = (n + blocks - 1)/blocks;
+    blocks = (n + block - 1)/block;
+    std::vector<U> totals(blocks);
+    parallel_for(blocks, [&](size_t first, size_t last)
+    {
+        for (size_t b = first; b < last; ++b)
+        {
+            size_t i = b*block;
+            totals[b] = reduce_lane<T,U>(in + i*in_step, in_step, (std::min)(block, n - i), op);
+        }
+    }, threads);
+    if (!inclusive)
+    {
+        totals[0] = op(initial, totals[0]);
+    }
+    for (size_t b = 1; b < blocks; ++b)
+    {
+        totals[b] = op(totals[b-1], totals[b]);
+    }
+    parallel_for(blocks, [&](size_t first, size_t last)
+    {
+        for (size_t b = first; b < last; ++b)
+        {
+            size_t i = b*block;
+            scan_lane(in + i*in_step, in_step, out + i*out_step, out_step, (std::min)(block, n - i),
+                      op, inclusive, initial, b > 0 ? totals[b-1] : U(), b > 0);
+        }
+    }, threads);
+}
+
+// Scans a strip of adjacent lanes together, one step along the axis at a time, so the
+// inner loop runs across lanes and vectorizes
+template <size_t N, typename T, typename U, typename Op>
+void scan_strip(const scan_layout<N>& layout, const T* in, U* out, size_t w, Op op, bool inclusive,
+                const U& initial, U* running)
+{
+    const size_t si = layout.in_inner;
+    const size_t so = layout.out_inner;
+    if (inclusive)
+    {
+        for (size_t j = 0; j < w; ++j)
+        {
+            running[j] = static_cast<U>(in[j*si]);
+            out[j*so] = running[j];
+        }
+    }
+    else
+    {
+        for (size_t j = 0; j < w; ++j)
+        {
+            running[j] = op(initial, static_cast<U>(in[j*si]));
+            out[j*so] = initial;
+        }
+    }
+    for (size_t k = 1; k < layout.length; ++k)
+    {
+        const T* src = in + k*layout.in_step;
+        U* dst = out + k*layout.out_step;
+        if (inclusive && si == 1 && so == 1)
+        {
+            for (size_t j = 0; j < w; ++j)
+            {
+                running[j] = op(running[j], static_cast<U>(src[j]));
+                dst[j] = running[j];
+            }
+        }
+        else
+        {
+            for (size_t j = 0; j < w; ++j)
+            {
+                U next = op(running[j], static_cast<U>(src[j*si]));
+                dst[j*so] = inclusive ? next : running[j];
+                running[j] = next;
+            }
+        }
+    }
+}
+
+template <typename In, typename Out, typename Op>
+void scan(const In& input, Out& output, size_t axis, Op op, bool inclusive,
+          const typename Out::element_type& initial, size_t threads)
+{
+    typedef typename In::element_type T;
+    typedef typename Out::element_type U;
+    const size_t N = In::ndim;
+    static_assert(Out::ndim == N, "scan input and output must have the same rank");
+    if (axis >= N)
+    {
+        throw std::out_of_range("scan axis out of range");
+    }
+    if (!std::equal(input.shape().begin(), input.shape().end(), output.shape().begin()))
+    {
+        throw std::invalid_argument("scan output has the wrong shape");
+    }
+    if (input.size() == 0)
+    {
+        return;
+    }
+    if (threads == 0)
+    {
+        threads = default_thread_count();
+    }
+    if (input.size() < scan_block_min_length)
+    {
+        threads = 1;
+    }
+
+    scan_layout<N> layout(input, output, axis);
+    const T* in = input.data();
+    U* out = output.data();
+
+    if (!layout.axis_innermost())
+    {
+        const size_t strips = (layout.width + scan_strip_width - 1)/scan_strip_width;
+        parallel_for(layout.outer_count*strips, [&](size_t first, size_t last)
+        {
+            std::vector<U> running((std::min)(layout.width, scan_strip_width));
+            for (size_t t = first; t < last; ++t)
+            {
+                size_t in_offset, out_offset;
+                layout.outer_offsets(t / strips, in_offset, out_offset);
+                size_t j = (t % strips)*scan_strip_width;
+                scan_strip(layout, in + in_offset + j*layout.in_inner, out + out_offset + j*layout.out_inner,
+                           (std::min)(scan_strip_width, layout.width - j), op, inclusive, initial, running.data());
+            }
+        }, threads);
+        return;
+    }
+
+    const size_t lanes = layout.width*layout.outer_count;
+    if (lanes < threads && layout.length >= scan_block_min_length)
+    {
+        for (size_t l = 0; l < lanes; ++l)
+        {
+            size_t in_offset, out_offset;
+            layout.outer_offsets(l / layout.width, in_offset, out_offset);
+            size_t j = l % layout.width;
+            block_scan_lane(in + in_offset + j*layout.in_inner, layout.in_step,
+                            out + out_offset + j*layout.out_inner, layout.out_step,
+                            layout.length, op, inclusive, initial, threads);
+        }
+        return;
+    }
+    parallel_for(lanes, [&](size_t first, size_t last)
+    {
+        for (size_t l = first; l < last; ++l)
+        {
+            size_t in_offset, out_offset;
+            layout.outer_offsets(l / layout.width, in_offset, out_offset);
+            size_t j = l % layout.width;
+            scan_lane(in + in_offset + j*layout.in_inner, layout.in_step,
+                      out + out_offset + j*layout.out_inner, layout.out_step,
+                      layout.length, op, inclusive, initial, U(), false);
+        }
+    }, threads);
+}
+
+}
+
+// scan, inclusive_scan, exclusive_scan
+//
+// Cumulative op along one axis of an ndarray or view, written into an output of the same
+// shape that may be the input itself but must not otherwise overlap it. Element i of a
+// lane is op applied to elements 0 to i if inclusive, or 0 to i-1 if exclusive, where
+// an exclusive scan starts from an initial value. op must be associative. The output
+// element type may be wider than the input's, elements are converted before op is
+// applied.
+//
+// scan takes the initial value from scan_identity<Op>, and does not compile for an op
+// without one. inclusive_scan takes any op, and exclusive_scan takes the initial value.
+//
+// When the axis is not the one with the smallest stride, adjacent lanes are scanned
+// together, one step along the axis at a time, in strips spread across threads.
+// Otherwise lanes are spread across threads, and a lane too long for one thread when
+// there are fewer lanes than threads is scanned with a two pass block scan.
+
+template <typename In, typename Out, typename Op = std::plus<typename std::decay<Out>::type::element_type>>
+void scan(const In& input, Out&& output, size_t axis, Op op = Op(), bool inclusive = true, size_t threads = 0)
+{
+    typedef typename std::decay<Out>::type::element_type U;
+    static_assert(detail::has_scan_identity<Op>::value,
+                  "scan needs a scan_identity for Op, use inclusive_scan or exclusive_scan");
+    detail::scan(input, output, axis, op, inclusive, detail::scan_initial<Op,U>::value(), threads);
+}
+
+template <typename In, typename Out, typename Op>
+void inclusive_scan(const In& input, Out&& output, size_t axis, Op op, size_t threads = 0)
+{
+    typedef typename std::decay<Out>::type::element_type U;
+    detail::scan(input, output, axis, op, true, U(), threads);
+}
+
+template <typename In, typename Out, typename Op = std::plus<typename std::decay<Out>::type::element_type>>
+void exclusive_scan(const In& input, Out&& output, size_t axis,
+                    const typename std::decay<Out>::type::element_type& initial,
+                    Op op = Op(), size_t threads = 0)
+{
+    detail::scan(input, output, axis, op, false, initial, threads);
+}
+
+// Returns the inclusive cumulative sum along axis
+template <typename In>
+ndarray<typename In::element_type,In::ndim,typename In::order_type,typename In::base_type>
+cumsum(const In& input, size_t axis, size_t threads = 0)
+{
+    typedef typename In::element_type T;
+    ndarray<T,In::ndim,typename In::order_type,typename In::base_type> output(input.shape());
+    detail::scan(input, output, axis, std::plus<T>(), true, T(), threads);
+    return output;
+}
+
+// Returns the inclusive cumulative product along axis
+template <typename In>
+ndarray<typename In::element_type,In::ndim,typename In::order_type,typename In::base_type>
+cumprod(const In& input, size_t axis, size_t threads = 0)
+{
+    typedef typename In::element_type T;
+    ndarray<T,In::ndim,typename In::order_type,typename In::base_type> output(input.shape());
+    detail::scan(input, output, axis, std::multiplies<T>(), true, T(), threads);
+    return output;
+}
+
+// integral_image
+//
+// Summed area table: each output element is the sum of the input elements at or before it
+// in every dimension, computed as an inclusive sum scan along each axis in turn. Use a
+// wider output element type to avoid overflow, for example uint32_t for uint8_t images.
+
+template <typename In, typename Out>
+void integral_image(const In& input, Out&& output, size_t threads = 0)
+{
+    typedef typename std::decay<Out>::type::element_type U;
+    detail::scan(input, output, 0, std::plus<U>(), true, U(), threads);
+    for (size_t axis = 1; axis < In::ndim; ++axis)
+    {
+        detail::scan(output, output, axis, std::plus<U>(), true, U(), threads);
+    }
+}
+
+}
+
+#endif
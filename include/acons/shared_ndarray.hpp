@@ -0,0 +1,484 @@
+#ifndef ACONS_SHARED_NDARRAY_HPP
+#define ACONS_SHARED_NDARRAY_HPP
+
+#include <memory>
+#include <atomic>
+#include <utility>
+#include <acons/ndarray.hpp>
+
+namespace acons {
+
+template <typename T, size_t M, typename Order = row_major, typename Base = zero_based>
+class const_shared_view;
+
+// shared_ndarray
+//
+// An N-dimensional array with copy-on-write storage. Copies share one reference counted
+// ndarray, and a copy detaches, deep copying the elements, on its first mutable access:
+// the non-const data(), operator(), begin(), end() and get(). Const access, including
+// cdata(), cbegin(), cend() and cget() on a non-const object, never copies.
+// Since a reference or pointer returned by mutable access stays usable, an object that has
+// handed one out is marked unshareable, and later copies of it take their own storage.
+// seal() makes it shareable again once the caller has finished writing through them.
+// A moved-from object is empty. As with std::shared_ptr, distinct objects may be used from
+// different threads even when they share storage, one object may not.
+
+template <typename T, size_t N, typename Order = row_major, typename Base = zero_based, typename Allocator = std::allocator<T>>
+class shared_ndarray
+{
+public:
+    typedef ndarray<T,N,Order,Base,Allocator> array_type;
+    typedef T element_type;
+    typedef Order order_type;
+    typedef Base base_type;
+    typedef Allocator allocator_type;
+    typedef typename array_type::iterator iterator;
+    typedef typename array_type::const_iterator const_iterator;
+    static constexpr size_t ndim = N;
+
+    template <size_t M> using view = ndarray_view<T,M,Order,Base>;
+    template <size_t M> using const_view = const_ndarray_view<T,M,Order,Base>;
+private:
+    std::shared_ptr<array_type> storage_;
+    // Set by mutable access, the storage may be written through references handed out
+    bool unshareable_;
+public:
+    shared_ndarray()
+        : storage_(std::make_shared<array_type>()), unshareable_(false)
+    {
+    }
+
+    template <typename... Args>
+    explicit shared_ndarray(size_t i, Args... args)
+        : storage_(std::make_shared<array_type>(i, args...)), unshareable_(false)
+    {
+    }
+
+    explicit shared_ndarray(const extents_t<N>& shape)
+        : storage_(std::make_shared<array_type>(shape)), unshareable_(false)
+    {
+    }
+
+    shared_ndarray(const extents_t<N>& shape, const T& val)
+        : storage_(std::make_shared<array_type>(shape, val)), unshareable_(false)
+    {
+    }
+
+    shared_ndarray(const array_type& a)
+        : storage_(std::make_shared<array_type>(a)), unshareable_(false)
+    {
+    }
+
+    // Takes over the buffer of a, no elements are copied
+    shared_ndarray(array_type&& a)
+        : storage_(std::make_shared<array_type>(std::move(a))), unshareable_(false)
+    {
+    }
+
+    // Shares the storage of other, or copies it if other is unshareable
+    shared_ndarray(const shared_ndarray& other)
+        : storage_(other.unshareable_ ? std::make_shared<array_type>(*other.storage_) : other.storage_),
+          unshareable_(false)
+    {
+    }
+
+    // Leaves other empty, as if default constructed
+    shared_ndarray(shared_ndarray&& other)
+        : storage_(std::make_shared<array_type>()), unshareable_(false)
+    {
+        swap(other);
+    }
+
+    shared_ndarray& operator=(const shared_ndarray& other)
+    {
+        if (this != &other)
+        {
+            shared_ndarray temp(other);
+            swap(temp);
+        }
+        return *this;
+    }
+
+    shared_ndarray& operator=(shared_ndarray&& other)
+    {
+        if (this != &other)
+        {
+            shared_ndarray temp(std::move(other));
+            swap(temp);
+        }
+        return *this;
+    }
+
+    // capacity
+
+    size_t size() const noexcept
+    {
+        return storage_->size();
+    }
+
+    const extents_t<N>& shape() const {return storage_->shape();}
+
+    size_t shape(size_t i) const
+    {
+        assert(i < N);
+        return storage_->shape()[i];
+    }
+
+    const indices_t<N>& strides() const {return storage_->strides();}
+
+    // sharing
+
+    // True if no other shared_ndarray or const_shared_view refers to the storage
+    bool unique() const noexcept
+    {
+        return storage_.use_count() == 1;
+    }
+
+    long use_count() const noexcept
+    {
+        return storage_.use_count();
+    }
+
+    // Gives this object its own copy of the storage if it is shared
+    void detach()
+    {
+        if (storage_.use_count() > 1)
+        {
+            storage_ = std::make_shared<array_type>(*storage_);
+        }
+        else
+        {
+            // The count is read relaxed, order it after the release by the last other
+            // owner before the elements are written in place
+            std::atomic_thread_fence(std::memory_order_acquire);
+        }
+    }
+
+    // True once mutable access has handed out a reference, copies then deep copy
+    bool unshareable() const noexcept
+    {
+        return unshareable_;
+    }
+
+    // Makes this object shareable again, so that copies and share() no longer copy the
+    // elements. References, pointers and iterators obtained from earlier mutable access
+    // are invalidated, since writing through them would reach the copies.
+    void seal() noexcept
+    {
+        unshareable_ = false;
+    }
+
+    // element access
+
+    const array_type& get() const
+    {
+        return *storage_;
+    }
+
+    const array_type& cget() const
+    {
+        return *storage_;
+    }
+
+    array_type& get()
+    {
+        return mutable_storage();
+    }
+
+    const T* data() const
+    {
+        return storage_->data();
+    }
+
+    T* data()
+    {
+        return mutable_storage().data();
+    }
+
+    const T* cdata() const
+    {
+        return storage_->data();
+    }
+
+    template <typename... Indices>
+    const T& operator()(size_t index, Indices... indices) const
+    {
+        return (*storage_)(index, indices...);
+    }
+
+    template <typename... Indices>
+    T& operator()(size_t index, Indices... indices)
+    {
+        return mutable_storage()(index, indices...);
+    }
+
+    const T& operator()(const indices_t<N>& indices) const
+    {
+        return (*storage_)(indices);
+    }
+
+    T& operator()(const indices_t<N>& indices)
+    {
+        return mutable_storage()(indices);
+    }
+
+    // iterators
+
+    const_iterator begin() const
+    {
+        const array_type& a = *storage_;
+        return a.begin();
+    }
+
+    const_iterator end() const
+    {
+        const array_type& a = *storage_;
+        return a.end();
+    }
+
+    iterator begin()
+    {
+        return mutable_storage().begin();
+    }
+
+    iterator end()
+    {
+        return mutable_storage().end();
+    }
+
+    const_iterator cbegin() const
+    {
+        return begin();
+    }
+
+    const_iterator cend() const
+    {
+        return end();
+    }
+
+    // views
+
+    // Non-owning view, valid while this object is neither modified nor destroyed
+    const_view<N> cview() const
+    {
+        return const_view<N>(*storage_);
+    }
+
+    operator const_view<N>() const
+    {
+        return cview();
+    }
+
+    // Owning view that keeps the current elements alive, later writes to this object
+    // detach from them. An unshareable object's elements are copied into the view.
+    const_shared_view<T,N,Order,Base> share() const;
+
+    void swap(shared_ndarray& other) noexcept
+    {
+        storage_.swap(other.storage_);
+        std::swap(unshareable_, other.unshareable_);
+    }
+
+    friend bool operator==(const shared_ndarray& lhs, const shared_ndarray& rhs)
+    {
+        return lhs.storage_ == rhs.storage_ || *lhs.storage_ == *rhs.storage_;
+    }
+
+    friend bool operator!=(const shared_ndarray& lhs, const shared_ndarray& rhs)
+    {
+        return !(lhs == rhs);
+    }
+
+    template <typename CharT>
+    friend std::basic_ostream<CharT>& operator<<(std::basic_ostream<CharT>& os, const shared_ndarray& a)
+    {
+        const_view<N> v(a.cview());
+        os << v;
+        return os;
+    }
+private:
+    // An unshareable object's storage is never shared, copies and share() take their own,
+    // so only the first mutable access after construction or seal() checks the count
+    array_type& mutable_storage()
+    {
+        if (!unshareable_)
+        {
+            detach();
+            unshareable_ = true;
+        }
+        return *storage_;
+    }
+};
+
+// shared_view, const_shared_view
+//
+// Views that hold a shared reference to the storage they view, so they stay valid after
+// every other owner has gone. They are constructed from a std::shared_ptr to an ndarray,
+// or from another shared view, with the same slice and reduction arguments as
+// ndarray_view and const_ndarray_view, and can be passed wherever those are expected.
+
+template <typename T, size_t M, typename Order = row_major, typename Base = zero_based>
+class shared_view : public ndarray_view<T,M,Order,Base>
+{
+    typedef ndarray_view<T,M,Order,Base> super_type;
+
+    std::shared_ptr<void> owner_;
+public:
+    template <size_t N, typename Allocator, typename... Args>
+    shared_view(const std::shared_ptr<ndarray<T,N,Order,Base,Allocator>>& owner, Args&&... args)
+        : super_type(*owner, std::forward<Args>(args)...), owner_(owner)
+    {
+    }
+
+    // Overloads that accept braced slice lists
+    template <typename Allocator>
+    shared_view(const std::shared_ptr<ndarray<T,M,Order,Base,Allocator>>& owner, const std::array<slice,M>& slices)
+        : super_type(*owner, slices), owner_(owner)
+    {
+    }
+
+    template <size_t N, typename... Args>
+    shared_view(shared_view<T,N,Order,Base>& parent, Args&&... args)
+        : super_type(static_cast<ndarray_view<T,N,Order,Base>&>(parent), std::forward<Args>(args)...),
+          owner_(parent.owner())
+    {
+    }
+
+    shared_view(shared_view& parent, const std::array<slice,M>& slices)
+        : super_type(static_cast<ndarray_view<T,M,Order,Base>&>(parent), slices),
+          owner_(parent.owner())
+    {
+    }
+
+    // Copies share the owner and the elements, as with the const copy a lambda captures
+    shared_view(const shared_view& other)
+        : super_type(const_cast<T*>(other.base_data()), other.base_size(), other.shape(), other.strides(), other.offsets()),
+          owner_(other.owner_)
+    {
+    }
+
+    shared_view(shared_view&& other)
+        : super_type(std::move(other)), owner_(std::move(other.owner_))
+    {
+    }
+
+    shared_view& operator=(const shared_view& other)
+    {
+        shared_view temp(other);
+        swap(temp);
+        return *this;
+    }
+
+    shared_view& operator=(shared_view&& other)
+    {
+        swap(other);
+        return *this;
+    }
+
+    const std::shared_ptr<void>& owner() const noexcept
+    {
+        return owner_;
+    }
+
+    void swap(shared_view& other) noexcept
+    {
+        super_type::swap(other);
+        owner_.swap(other.owner_);
+    }
+};
+
+template <typename T, size_t M, typename Order, typename Base>
+class const_shared_view : public const_ndarray_view<T,M,Order,Base>
+{
+    typedef const_ndarray_view<T,M,Order,Base> super_type;
+
+    std::shared_ptr<const void> owner_;
+public:
+    template <typename Array, typename... Args>
+    const_shared_view(const std::shared_ptr<Array>& owner, Args&&... args)
+        : super_type(static_cast<const Array&>(*owner), std::forward<Args>(args)...), owner_(owner)
+    {
+    }
+
+    template <typename Array>
+    const_shared_view(const std::shared_ptr<Array>& owner, const std::array<slice,M>& slices)
+        : super_type(static_cast<const Array&>(*owner), slices), owner_(owner)
+    {
+    }
+
+    const_shared_view(const const_shared_view& parent, const std::array<slice,M>& slices)
+        : super_type(static_cast<const ndarray_view_base<T,M,Order,Base,const T*>&>(parent), slices),
+          owner_(parent.owner())
+    {
+    }
+
+    template <size_t N, typename... Args>
+    const_shared_view(const const_shared_view<T,N,Order,Base>& parent, Args&&... args)
+        : super_type(static_cast<const ndarray_view_base<T,N,Order,Base,const T*>&>(parent), std::forward<Args>(args)...),
+          owner_(parent.owner())
+    {
+    }
+
+    template <size_t N, typename... Args>
+    const_shared_view(const shared_view<T,N,Order,Base>& parent, Args&&... args)
+        : super_type(static_cast<const ndarray_view_base<T,N,Order,Base,T*>&>(parent), std::forward<Args>(args)...),
+          owner_(parent.owner())
+    {
+    }
+
+    const_shared_view(const const_shared_view& other)
+        : super_type(other.base_data(), other.base_size(), other.shape(), other.strides(), other.offsets()),
+          owner_(other.owner_)
+    {
+    }
+
+    const_shared_view(const_shared_view&& other)
+        : super_type(std::move(other)), owner_(std::move(other.owner_))
+    {
+    }
+
+    const_shared_view& operator=(const const_shared_view& other)
+    {
+        const_shared_view temp(other);
+        swap(temp);
+        return *this;
+    }
+
+    const_shared_view& operator=(const_shared_view&& other)
+    {
+        swap(other);
+        return *this;
+    }
+
+    const std::shared_ptr<const void>& owner() const noexcept
+    {
+        return owner_;
+    }
+
+    void swap(const_shared_view& other) noexcept
+    {
+        super_type::swap(other);
+        owner_.swap(other.owner_);
+    }
+};
+
+template <typename T, size_t N, typename Order, typename Base, typename Allocator>
+const_shared_view<T,N,Order,Base> shared_ndarray<T,N,Order,Base,Allocator>::share() const
+{
+    if (unshareable_)
+    {
+        return const_shared_view<T,N,Order,Base>(std::shared_ptr<const array_type>(std::make_shared<array_type>(*storage_)));
+    }
+    return const_shared_view<T,N,Order,Base>(std::shared_ptr<const array_type>(storage_));
+}
+
+// Moves an array into shared storage and returns an owning view of all of it
+template <typename T, size_t N, typename Order, typename Base, typename Allocator>
+shared_view<T,N,Order,Base> make_shared_view(ndarray<T,N,Order,Base,Allocator>&& a)
+{
+    return shared_view<T,N,Order,Base>(std::make_shared<ndarray<T,N,Order,Base,Allocator>>(std::move(a)));
+}
+
+}
+
+#endif
@@ -0,0 +1,502 @@
+#ifndef ACONS_SHM_NDARRAY_HPP
+#define ACONS_SHM_NDARRAY_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <limits>
+#include <atomic>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+#include <new>
+#include <acons/ndarray.hpp>
+
+// POSIX shared memory, the header declares nothing on other platforms
+#if defined(__unix__) || defined(__APPLE__)
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace acons {
+
+// Element type codes stored in a shared memory header
+
+enum class shm_dtype : uint32_t
+{
+    opaque = 0,
+    int8, uint8, int16, uint16, int32, uint32, int64, uint64,
+    float32, float64, boolean
+};
+
+template <typename T, typename Enable = void>
+struct shm_dtype_of
+{
+    static constexpr shm_dtype value = shm_dtype::opaque;
+};
+
+template <typename T>
+struct shm_dtype_of<T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T,bool>::value>::type>
+{
+    static constexpr shm_dtype value =
+        sizeof(T) == 1 ? (std::is_signed<T>::value ? shm_dtype::int8 : shm_dtype::uint8) :
+        sizeof(T) == 2 ? (std::is_signed<T>::value ? shm_dtype::int16 : shm_dtype::uint16) :
+        sizeof(T) == 4 ? (std::is_signed<T>::value ? shm_dtype::int32 : shm_dtype::uint32) :
+        sizeof(T) == 8 ? (std::is_signed<T>::value ? shm_dtype::int64 : shm_dtype::uint64) :
+        shm_dtype::opaque;
+};
+
+template <>
+struct shm_dtype_of<float>
+{
+    static constexpr shm_dtype value = shm_dtype::float32;
+};
+
+template <>
+struct shm_dtype_of<double>
+{
+    static constexpr shm_dtype value = shm_dtype::float64;
+};
+
+template <>
+struct shm_dtype_of<bool>
+{
+    static constexpr shm_dtype value = shm_dtype::boolean;
+};
+
+// shm_header
+//
+// Fixed layout header at the start of a segment. Elements follow at data_offset, which
+// is a multiple of shm_data_alignment. The creator writes magic last, so a reader that
+// sees a valid magic sees a complete header.
+
+const size_t shm_max_rank = 16;
+const size_t shm_data_alignment = 64;
+const uint64_t shm_magic = 0x59524e4e534e4f43ULL; // "CONSNNRY" little endian
+const uint32_t shm_version = 1;
+
+struct shm_header
+{
+    std::atomic<uint64_t> magic;
+    uint32_t version;
+    uint32_t dtype;
+    uint32_t element_size;
+    uint32_t ndim;
+    uint32_t order;         // 0 row major, 1 column major
+    uint32_t base;          // index origin
+    uint64_t data_offset;
+    uint64_t size;          // number of elements
+    uint64_t shape[shm_max_rank];
+    uint64_t strides[shm_max_rank];
+};
+
+namespace detail {
+
+template <typename Order>
+struct shm_order_code;
+
+template <>
+struct shm_order_code<row_major>
+{
+    static constexpr uint32_t value = 0;
+};
+
+template <>
+struct shm_order_code<column_major>
+{
+    static constexpr uint32_t value = 1;
+};
+
+inline size_t shm_data_offset()
+{
+    return (sizeof(shm_header) + shm_data_alignment - 1)/shm_data_alignment*shm_data_alignment;
+}
+
+// Owns a mapping of a named POSIX shared memory object
+class shm_mapping
+{
+    void* addr_;
+    size_t length_;
+public:
+    shm_mapping()
+        : addr_(nullptr), length_(0)
+    {
+    }
+
+    shm_mapping(const std::string& name, size_t length, bool create, bool writable)
+        : addr_(nullptr), length_(0)
+    {
+        int flags = create ? (O_RDWR | O_CREAT | O_EXCL) : (writable ? O_RDWR : O_RDONLY);
+        int fd = shm_open(name.c_str(), flags, 0600);
+        if (fd == -1)
+        {
+            throw std::system_error(errno, std::generic_category(), "shm_open " + name);
+        }
+        if (create)
+        {
+            if (ftruncate(fd, static_cast<off_t>(length)) == -1)
+            {
+                int error = errno;
+                close(fd);
+                shm_unlink(name.c_str());
+                throw std::system_error(error, std::generic_category(), "ftruncate " + name);
+            }
+        }
+        else
+        {
+            struct stat st;
+            if (fstat(fd, &st) == -1)
+            {
+                int error = errno;
+                close(fd);
+                throw std::system_error(error, std::generic_category(), "fstat " + name);
+            }
+            length = static_cast<size_t>(st.st_size);
+        }
+        if (length < sizeof(shm_header))
+        {
+            close(fd);
+            throw std::invalid_argument("shared memory segment " + name + " is too small");
+        }
+        void* addr = mmap(nullptr, length, writable ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, fd, 0);
+        int error = errno;
+        close(fd);
+        if (addr == MAP_FAILED)
+        {
+            if (create)
+            {
+                shm_unlink(name.c_str());
+            }
+            throw std::system_error(error, std::generic_category(), "mmap " + name);
+        }
+        addr_ = addr;
+        length_ = length;
+    }
+
+    shm_mapping(const shm_mapping&) = delete;
+    shm_mapping& operator=(const shm_mapping&) = delete;
+
+    shm_mapping(shm_mapping&& other) noexcept
+        : addr_(other.addr_), length_(other.length_)
+    {
+        other.addr_ = nullptr;
+        other.length_ = 0;
+    }
+
+    shm_mapping& operator=(shm_mapping&& other) noexcept
+    {
+        std::swap(addr_, other.addr_);
+        std::swap(length_, other.length_);
+        return *this;
+    }
+
+    ~shm_mapping()
+    {
+        if (addr_ != nullptr)
+        {
+            munmap(addr_, length_);
+        }
+    }
+
+    void* address() const noexcept {return addr_;}
+    size_t length() const noexcept {return length_;}
+};
+
+}
+
+namespace detail {
+
+// The mapping, shape and elements of a segment, shared by shm_ndarray and const_shm_ndarray
+template <typename T, size_t N, typename Order, typename Base>
+class shm_array_base
+{
+    static_assert(N <= shm_max_rank, "rank exceeds shm_max_rank");
+    static_assert(std::is_trivially_copyable<T>::value, "shared memory elements must be trivially copyable");
+public:
+    typedef T element_type;
+    typedef Order order_type;
+    typedef Base base_type;
+    static constexpr size_t ndim = N;
+
+    template <size_t M> using const_view = const_ndarray_view<T,M,Order,Base>;
+protected:
+    std::string name_;
+    shm_mapping mapping_;
+    extents_t<N> shape_;
+    indices_t<N> strides_;
+    size_t size_;
+    T* data_;
+
+    shm_array_base(const std::string& name, shm_mapping&& mapping)
+        : name_(name), mapping_(std::move(mapping)), size_(0), data_(nullptr)
+    {
+    }
+
+    // Creates and maps a new segment and initializes its header and elements
+    void create_segment(const extents_t<N>& shape, const T& val)
+    {
+        indices_t<N> strides;
+        size_t size = 0;
+        Order::calculate_strides(shape, strides, size);
+
+        size_t offset = shm_data_offset();
+        mapping_ = shm_mapping(name_, offset + size*sizeof(T), true, true);
+
+        char* base = static_cast<char*>(mapping_.address());
+        // The segment is zero filled, magic stays zero until the header is complete
+        shm_header* h = new (base) shm_header();
+        h->version = shm_version;
+        h->dtype = static_cast<uint32_t>(shm_dtype_of<T>::value);
+        h->element_size = static_cast<uint32_t>(sizeof(T));
+        h->ndim = static_cast<uint32_t>(N);
+        h->order = shm_order_code<Order>::value;
+        h->base = static_cast<uint32_t>(Base::origin());
+        h->data_offset = offset;
+        h->size = size;
+        for (size_t i = 0; i < N; ++i)
+        {
+            h->shape[i] = shape[i];
+            h->strides[i] = strides[i];
+        }
+
+        shape_ = shape;
+        strides_ = strides;
+        size_ = size;
+        data_ = reinterpret_cast<T*>(base + offset);
+        std::fill(data_, data_ + size, val);
+
+        h->magic.store(shm_magic, std::memory_order_release);
+    }
+
+    // Maps an existing segment and checks its header
+    void open_segment(bool writable)
+    {
+        mapping_ = shm_mapping(name_, 0, false, writable);
+        const std::string& name = name_;
+
+        const char* base = static_cast<const char*>(mapping_.address());
+        // Constructed by the creating process, std::atomic<uint64_t> is address free
+        const shm_header* h = reinterpret_cast<const shm_header*>(base);
+        if (h->magic.load(std::memory_order_acquire) != shm_magic)
+        {
+            throw std::invalid_argument(name + " is not an acons shared memory array");
+        }
+        if (h->version != shm_version)
+        {
+            throw std::invalid_argument(name + " has an unsupported header version");
+        }
+        if (h->dtype != static_cast<uint32_t>(shm_dtype_of<T>::value) || h->element_size != sizeof(T))
+        {
+            throw std::invalid_argument(name + " has a different element type");
+        }
+        if (h->ndim != N)
+        {
+            throw std::invalid_argument(name + " has a different rank");
+        }
+        if (h->order != shm_order_code<Order>::value || h->base != Base::origin())
+        {
+            throw std::invalid_argument(name + " has a different order or base");
+        }
+        // Fields checked against each other are read once, another process may write them
+        const uint64_t data_offset = h->data_offset;
+        const uint64_t element_count = h->size;
+        if (data_offset % shm_data_alignment != 0 ||
+            data_offset > mapping_.length() ||
+            (mapping_.length() - data_offset)/sizeof(T) < element_count)
+        {
+            throw std::invalid_argument(name + " is truncated");
+        }
+        uint64_t size = 1;
+        for (size_t i = 0; i < N; ++i)
+        {
+            const uint64_t extent = h->shape[i];
+            if (extent != 0 && size > (std::numeric_limits<uint64_t>::max)()/extent)
+            {
+                throw std::invalid_argument(name + " has an inconsistent shape");
+            }
+            shape_[i] = static_cast<size_t>(extent);
+            size *= extent;
+        }
+        if (size != element_count)
+        {
+            throw std::invalid_argument(name + " has an inconsistent shape");
+        }
+        // Strides are recomputed rather than trusted, so every index within the shape
+        // stays within the elements checked above
+        Order::calculate_strides(shape_, strides_, size_);
+        for (size_t i = 0; i < N; ++i)
+        {
+            if (h->strides[i] != strides_[i])
+            {
+                throw std::invalid_argument(name + " has inconsistent strides");
+            }
+        }
+        data_ = reinterpret_cast<T*>(const_cast<char*>(base) + data_offset);
+    }
+public:
+    shm_array_base(shm_array_base&&) = default;
+    shm_array_base& operator=(shm_array_base&&) = default;
+
+    // Removes the name, existing mappings remain valid
+    static bool remove(const std::string& name) noexcept
+    {
+        return shm_unlink(name.c_str()) == 0;
+    }
+
+    const std::string& name() const {return name_;}
+
+    size_t size() const noexcept {return size_;}
+
+    const extents_t<N>& shape() const {return shape_;}
+
+    size_t shape(size_t i) const
+    {
+        assert(i < N);
+        return shape_[i];
+    }
+
+    const indices_t<N>& strides() const {return strides_;}
+
+    const shm_header& header() const
+    {
+        return *static_cast<const shm_header*>(mapping_.address());
+    }
+
+    const T* data() const
+    {
+        return data_;
+    }
+
+    template <typename... Indices>
+    const T& operator()(size_t index, Indices... indices) const
+    {
+        size_t off = get_offset<N, Base, 0>(strides_, index, indices...);
+        assert(off < size());
+        return data_[off];
+    }
+
+    const T& operator()(const indices_t<N>& indices) const
+    {
+        size_t off = get_offset<N, N, Base>(strides_, indices);
+        assert(off < size());
+        return data_[off];
+    }
+
+    const_view<N> get_view() const
+    {
+        indices_t<N> offsets;
+        offsets.fill(0);
+        return const_view<N>(data_, size_, shape_, strides_, offsets);
+    }
+};
+
+}
+
+// shm_ndarray
+//
+// An N-dimensional array in a named POSIX shared memory segment. One process creates
+// the segment, others open it by name and view the same elements with no copies.
+// The header records the element type, rank, order, base, shape and strides, and
+// open() checks them against the template arguments. The segment persists until
+// remove() is called, mappings stay valid until their shm_ndarray is destroyed.
+// const_shm_ndarray opens a segment read only.
+
+template <typename T, size_t N, typename Order = row_major, typename Base = zero_based>
+class shm_ndarray : public detail::shm_array_base<T,N,Order,Base>
+{
+    typedef detail::shm_array_base<T,N,Order,Base> super_type;
+
+    explicit shm_ndarray(const std::string& name)
+        : super_type(name, detail::shm_mapping())
+    {
+    }
+public:
+    template <size_t M> using view = ndarray_view<T,M,Order,Base>;
+
+    using super_type::data;
+    using super_type::operator();
+    using super_type::get_view;
+
+    shm_ndarray(shm_ndarray&&) = default;
+    shm_ndarray& operator=(shm_ndarray&&) = default;
+
+    // Creates a new segment, throws std::system_error if it already exists
+    static shm_ndarray create(const std::string& name, const extents_t<N>& shape, const T& val = T())
+    {
+        shm_ndarray a(name);
+        a.create_segment(shape, val);
+        return a;
+    }
+
+    // Opens an existing segment for reading and writing, throws std::system_error if it
+    // cannot be opened and std::invalid_argument if its header does not match T, N, Order
+    // and Base
+    static shm_ndarray open(const std::string& name)
+    {
+        shm_ndarray a(name);
+        a.open_segment(true);
+        return a;
+    }
+
+    T* data()
+    {
+        return this->data_;
+    }
+
+    template <typename... Indices>
+    T& operator()(size_t index, Indices... indices)
+    {
+        size_t off = get_offset<N, Base, 0>(this->strides_, index, indices...);
+        assert(off < this->size());
+        return this->data_[off];
+    }
+
+    T& operator()(const indices_t<N>& indices)
+    {
+        size_t off = get_offset<N, N, Base>(this->strides_, indices);
+        assert(off < this->size());
+        return this->data_[off];
+    }
+
+    view<N> get_view()
+    {
+        indices_t<N> offsets;
+        offsets.fill(0);
+        return view<N>(this->data_, this->size_, this->shape_, this->strides_, offsets);
+    }
+};
+
+// const_shm_ndarray
+//
+// A segment created by shm_ndarray, mapped without write permission. It has only const
+// accessors, so the type rules out writes to the read only mapping.
+
+template <typename T, size_t N, typename Order = row_major, typename Base = zero_based>
+class const_shm_ndarray : public detail::shm_array_base<T,N,Order,Base>
+{
+    typedef detail::shm_array_base<T,N,Order,Base> super_type;
+
+    explicit const_shm_ndarray(const std::string& name)
+        : super_type(name, detail::shm_mapping())
+    {
+    }
+public:
+    const_shm_ndarray(const_shm_ndarray&&) = default;
+    const_shm_ndarray& operator=(const_shm_ndarray&&) = default;
+
+    // Opens an existing segment read only, throws as shm_ndarray::open does
+    static const_shm_ndarray open(const std::string& name)
+    {
+        const_shm_ndarray a(name);
+        a.open_segment(false);
+        return a;
+    }
+};
+
+}
+
+#endif
+
+#endif
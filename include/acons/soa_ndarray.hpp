@@ -0,0 +1,478 @@
+#ifndef ACONS_SOA_NDARRAY_HPP
+#define ACONS_SOA_NDARRAY_HPP
+
+#include <cstddef>
+#include <cassert>
+#include <algorithm>
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <stdexcept>
+#include <type_traits>
+#include <acons/ndarray.hpp>
+
+namespace acons {
+
+// soa_field, soa_traits
+//
+// The fields of a record type stored by soa_ndarray are listed by specializing soa_traits
+// with a std::tuple of soa_field types, one per data member:
+//
+//     template <>
+//     struct soa_traits<Particle>
+//     {
+//         typedef std::tuple<ACONS_SOA_FIELD(Particle, x), ACONS_SOA_FIELD(Particle, y)> fields;
+//     };
+
+template <typename Record, typename T, T Record::*Member>
+struct soa_field
+{
+    typedef Record record_type;
+    typedef T value_type;
+
+    static constexpr T Record::*member()
+    {
+        return Member;
+    }
+
+    static T& get(Record& r)
+    {
+        return r.*Member;
+    }
+
+    static const T& get(const Record& r)
+    {
+        return r.*Member;
+    }
+};
+
+#define ACONS_SOA_FIELD(Record, member) ::acons::soa_field<Record,decltype(Record::member),&Record::member>
+
+template <typename Record>
+struct soa_traits;
+
+template <typename Record, size_t N, typename Order = row_major, typename Base = zero_based, typename Allocator = std::allocator<Record>>
+class soa_ndarray;
+
+namespace detail {
+
+// std::index_sequence is C++14
+
+template <size_t... I>
+struct index_sequence
+{
+};
+
+template <size_t N, size_t... I>
+struct make_index_sequence_impl : make_index_sequence_impl<N-1,N-1,I...>
+{
+};
+
+template <size_t... I>
+struct make_index_sequence_impl<0,I...>
+{
+    typedef index_sequence<I...> type;
+};
+
+template <size_t N>
+using make_index_sequence = typename make_index_sequence_impl<N>::type;
+
+template <typename Fields, typename Allocator, typename Indices>
+struct soa_buffers;
+
+template <typename Fields, typename Allocator, size_t... I>
+struct soa_buffers<Fields,Allocator,index_sequence<I...>>
+{
+    typedef std::tuple<ndarray<typename std::tuple_element<I,Fields>::type::value_type,1,row_major,zero_based,
+                               typename std::allocator_traits<Allocator>::template rebind_alloc<
+                                   typename std::tuple_element<I,Fields>::type::value_type>>...> type;
+};
+
+}
+
+// soa_reference
+//
+// A proxy for one record of a soa_ndarray. It converts to the record, gathering its fields,
+// and assigning a record scatters the fields to their arrays. Single fields are reached with
+// get<I>() or get(&Record::member) without touching the others.
+
+template <typename Array>
+class soa_reference
+{
+public:
+    typedef typename Array::element_type record_type;
+    template <size_t I> using field_type = typename Array::template field_type<I>;
+private:
+    Array* array_;
+    size_t offset_;
+public:
+    soa_reference(Array& array, size_t offset)
+        : array_(std::addressof(array)), offset_(offset)
+    {
+    }
+
+    soa_reference(const soa_reference&) = default;
+
+    operator record_type() const
+    {
+        record_type r = record_type();
+        gather(r, detail::make_index_sequence<Array::field_count>());
+        return r;
+    }
+
+    soa_reference& operator=(const record_type& r)
+    {
+        scatter(r, detail::make_index_sequence<Array::field_count>());
+        return *this;
+    }
+
+    soa_reference& operator=(const soa_reference& other)
+    {
+        return *this = static_cast<record_type>(other);
+    }
+
+    template <size_t I>
+    field_type<I>& get() const
+    {
+        return array_->template field_data<I>()[offset_];
+    }
+
+    template <typename U>
+    U& get(U record_type::*member) const
+    {
+        return array_->field_data(member)[offset_];
+    }
+private:
+    template <size_t... I>
+    void gather(record_type& r, detail::index_sequence<I...>) const
+    {
+        int expand[] = {0, (std::tuple_element<I,typename Array::fields_type>::type::get(r) = get<I>(), 0)...};
+        (void)expand;
+    }
+
+    template <size_t... I>
+    void scatter(const record_type& r, detail::index_sequence<I...>)
+    {
+        int expand[] = {0, (get<I>() = std::tuple_element<I,typename Array::fields_type>::type::get(r), 0)...};
+        (void)expand;
+    }
+};
+
+// soa_ndarray
+//
+// An N-dimensional array of records stored field by field. Each field listed in
+// soa_traits<Record> has its own contiguous buffer, and all of them share one shape and
+// one set of strides. field<I>() and field(&Record::member) return an ndarray_view of a
+// single field, indexed like the array, so loops over one field read only that field's
+// memory and can be vectorized. operator() returns a soa_reference for code that works
+// with whole records.
+
+template <typename Record, size_t N, typename Order, typename Base, typename Allocator>
+class soa_ndarray
+{
+public:
+    typedef typename soa_traits<Record>::fields fields_type;
+    static constexpr size_t field_count = std::tuple_size<fields_type>::value;
+    template <size_t I> using field_type = typename std::tuple_element<I,fields_type>::type::value_type;
+
+    typedef Record element_type;
+    typedef Order order_type;
+    typedef Base base_type;
+    typedef Allocator allocator_type;
+    typedef soa_reference<soa_ndarray> reference;
+    static constexpr size_t ndim = N;
+
+    template <size_t M, typename T> using view = ndarray_view<T,M,Order,Base>;
+    template <size_t M, typename T> using const_view = const_ndarray_view<T,M,Order,Base>;
+private:
+    typedef typename detail::soa_buffers<fields_type,Allocator,detail::make_index_sequence<field_count>>::type buffers_type;
+
+    extents_t<N> shape_;
+    indices_t<N> strides_;
+    size_t size_;
+    buffers_type buffers_;
+public:
+    soa_ndarray()
+        : size_(0)
+    {
+        shape_.fill(0);
+        strides_.fill(0);
+    }
+
+    explicit soa_ndarray(const extents_t<N>& shape, const Record& value = Record(), const Allocator& alloc = Allocator())
+        : shape_(shape), size_(0)
+    {
+        Order::calculate_strides(shape_, strides_, size_);
+        allocate(alloc, detail::make_index_sequence<field_count>());
+        for (size_t k = 0; k < size_; ++k)
+        {
+            reference(*this, k) = value;
+        }
+    }
+
+    // Copies the records of an ndarray or view of Record, of any order and strides
+    template <typename Source>
+    explicit soa_ndarray(const Source& a,
+                         typename std::enable_if<std::is_same<typename std::remove_const<typename Source::element_type>::type,Record>::value>::type* = nullptr)
+        : shape_(a.shape()), size_(0)
+    {
+        Order::calculate_strides(shape_, strides_, size_);
+        allocate(Allocator(), detail::make_index_sequence<field_count>());
+        for_each_index([&](const indices_t<N>& index, size_t offset)
+        {
+            size_t source_offset = 0;
+            for (size_t i = 0; i < N; ++i)
+            {
+                source_offset += index[i]*a.strides()[i];
+            }
+            reference(*this, offset) = a.data()[source_offset];
+        });
+    }
+
+    soa_ndarray(const soa_ndarray&) = default;
+    soa_ndarray(soa_ndarray&&) = default;
+    soa_ndarray& operator=(const soa_ndarray&) = default;
+    soa_ndarray& operator=(soa_ndarray&&) = default;
+
+    allocator_type get_allocator() const
+    {
+        return allocator_type(std::get<0>(buffers_).get_allocator());
+    }
+
+    bool empty() const noexcept
+    {
+        return size_ == 0;
+    }
+
+    size_t size() const noexcept
+    {
+        return size_;
+    }
+
+    const extents_t<N>& shape() const {return shape_;}
+
+    size_t shape(size_t i) const
+    {
+        assert(i < N);
+        return shape_[i];
+    }
+
+    // The strides of every field array, in elements
+    const indices_t<N>& strides() const {return strides_;}
+
+    template <size_t I>
+    field_type<I>* field_data()
+    {
+        return std::get<I>(buffers_).data();
+    }
+
+    template <size_t I>
+    const field_type<I>* field_data() const
+    {
+        return std::get<I>(buffers_).data();
+    }
+
+    // Throws std::invalid_argument if member is not one of the fields
+    template <typename U>
+    U* field_data(U Record::*member)
+    {
+        return const_cast<U*>(static_cast<const soa_ndarray&>(*this).field_data(member));
+    }
+
+    template <typename U>
+    const U* field_data(U Record::*member) const
+    {
+        const U* p = find_field(member, std::integral_constant<size_t,0>());
+        if (p == nullptr)
+        {
+            throw std::invalid_argument("Not a field of the record type");
+        }
+        return p;
+    }
+
+    template <size_t I>
+    view<N,field_type<I>> field()
+    {
+        return view<N,field_type<I>>(field_data<I>(), shape_);
+    }
+
+    template <size_t I>
+    const_view<N,field_type<I>> field() const
+    {
+        return const_view<N,field_type<I>>(field_data<I>(), shape_);
+    }
+
+    template <typename U>
+    view<N,U> field(U Record::*member)
+    {
+        return view<N,U>(field_data(member), shape_);
+    }
+
+    template <typename U>
+    const_view<N,U> field(U Record::*member) const
+    {
+        return const_view<N,U>(field_data(member), shape_);
+    }
+
+    template <typename... Args>
+    reference operator()(size_t i, Args... args)
+    {
+        return reference(*this, offset(indices_t<N>{i, static_cast<size_t>(args)...}));
+    }
+
+    template <typename... Args>
+    Record operator()(size_t i, Args... args) const
+    {
+        return record(offset(indices_t<N>{i, static_cast<size_t>(args)...}));
+    }
+
+    reference operator()(const indices_t<N>& indices)
+    {
+        return reference(*this, offset(indices));
+    }
+
+    Record operator()(const indices_t<N>& indices) const
+    {
+        return record(offset(indices));
+    }
+
+    // Returns the records as an ndarray of Record
+    template <typename OtherOrder = Order, typename OtherAllocator = std::allocator<Record>>
+    ndarray<Record,N,OtherOrder,Base,OtherAllocator> to_ndarray() const
+    {
+        ndarray<Record,N,OtherOrder,Base,OtherAllocator> a(shape_);
+        for_each_index([&](const indices_t<N>& index, size_t offset)
+        {
+            size_t target_offset = 0;
+            for (size_t i = 0; i < N; ++i)
+            {
+                target_offset += index[i]*a.strides()[i];
+            }
+            a.data()[target_offset] = record(offset);
+        });
+        return a;
+    }
+
+    void swap(soa_ndarray& other) noexcept
+    {
+        std::swap(shape_, other.shape_);
+        std::swap(strides_, other.strides_);
+        std::swap(size_, other.size_);
+        buffers_.swap(other.buffers_);
+    }
+
+    friend bool operator==(const soa_ndarray& lhs, const soa_ndarray& rhs)
+    {
+        return std::equal(lhs.shape_.begin(), lhs.shape_.end(), rhs.shape_.begin()) &&
+               lhs.equal_fields(rhs, std::integral_constant<size_t,0>());
+    }
+
+    friend bool operator!=(const soa_ndarray& lhs, const soa_ndarray& rhs)
+    {
+        return !(lhs == rhs);
+    }
+private:
+    template <size_t... I>
+    void allocate(const Allocator& alloc, detail::index_sequence<I...>)
+    {
+        buffers_ = buffers_type(typename std::tuple_element<I,buffers_type>::type(
+            std::allocator_arg, typename std::tuple_element<I,buffers_type>::type::allocator_type(alloc),
+            extents_t<1>{size_})...);
+    }
+
+    size_t offset(const indices_t<N>& indices) const
+    {
+        size_t off = 0;
+        for (size_t i = 0; i < N; ++i)
+        {
+            assert(Base::rebase_to_zero(indices[i]) < shape_[i]);
+            off += Base::rebase_to_zero(indices[i])*strides_[i];
+        }
+        return off;
+    }
+
+    Record record(size_t offset) const
+    {
+        return reference(const_cast<soa_ndarray&>(*this), offset);
+    }
+
+    // Calls f(index, offset) for every zero based index, in index order
+    template <typename F>
+    void for_each_index(F f) const
+    {
+        if (size_ == 0)
+        {
+            return;
+        }
+        indices_t<N> index;
+        index.fill(0);
+        for (size_t k = 0; k < size_; ++k)
+        {
+            size_t off = 0;
+            for (size_t i = 0; i < N; ++i)
+            {
+                off += index[i]*strides_[i];
+            }
+            f(index, off);
+            for (size_t i = N; i-- > 0; )
+            {
+                if (++index[i] < shape_[i])
+                {
+                    break;
+                }
+                index[i] = 0;
+            }
+        }
+    }
+
+    template <typename U, size_t I>
+    const U* find_field(U Record::*member, std::integral_constant<size_t,I>) const
+    {
+        typedef typename std::tuple_element<I,fields_type>::type field;
+        const U* p = matching_field<I>(member, std::is_same<typename field::value_type,U>());
+        return p != nullptr ? p : find_field(member, std::integral_constant<size_t,I+1>());
+    }
+
+    template <typename U>
+    const U* find_field(U Record::*, std::integral_constant<size_t,field_count>) const
+    {
+        return nullptr;
+    }
+
+    template <size_t I, typename U>
+    const U* matching_field(U Record::*member, std::true_type) const
+    {
+        return std::tuple_element<I,fields_type>::type::member() == member ? field_data<I>() : nullptr;
+    }
+
+    template <size_t I, typename U>
+    const U* matching_field(U Record::*, std::false_type) const
+    {
+        return nullptr;
+    }
+
+    template <size_t I>
+    bool equal_fields(const soa_ndarray& other, std::integral_constant<size_t,I>) const
+    {
+        return std::equal(field_data<I>(), field_data<I>() + size_, other.field_data<I>()) &&
+               equal_fields(other, std::integral_constant<size_t,I+1>());
+    }
+
+    bool equal_fields(const soa_ndarray&, std::integral_constant<size_t,field_count>) const
+    {
+        return true;
+    }
+};
+
+template <typename Record, size_t N, typename Order, typename Base, typename Allocator>
+constexpr size_t soa_ndarray<Record,N,Order,Base,Allocator>::field_count;
+
+template <typename Record, size_t N, typename Order, typename Base, typename Allocator>
+void swap(soa_ndarray<Record,N,Order,Base,Allocator>& a, soa_ndarray<Record,N,Order,Base,Allocator>& b) noexcept
+{
+    a.swap(b);
+}
+
+}
+
+#endif
@@ -0,0 +1,609 @@
+#ifndef ACONS_SORT_HPP
+#define ACONS_SORT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <utility>
+#include <numeric>
+#include <functional>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include <acons/ndarray.hpp>
+#include <acons/parallel.hpp>
+
+namespace acons {
+
+namespace detail {
+
+// Lanes shorter than this are sorted with std::sort rather than radix sort
+const size_t radix_sort_min_length = 256;
+
+// Maps keys to unsigned integers with the same order, for radix sort. Signed integers
+// have the sign bit flipped, floating point values have the sign bit flipped if positive
+// and every bit flipped if negative.
+template <typename T, typename Enable = void>
+struct radix_traits
+{
+    static constexpr bool enabled = false;
+};
+
+template <typename T>
+struct radix_traits<T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T,bool>::value>::type>
+{
+    static constexpr bool enabled = true;
+    typedef typename std::make_unsigned<T>::type key_type;
+    static constexpr key_type flip = std::is_signed<T>::value ? key_type(key_type(1) << (8*sizeof(T) - 1)) : key_type(0);
+
+    static key_type to_key(T x)
+    {
+        return static_cast<key_type>(static_cast<key_type>(x) ^ flip);
+    }
+
+    static T from_key(key_type k)
+    {
+        return static_cast<T>(static_cast<key_type>(k ^ flip));
+    }
+};
+
+template <typename T, typename Key>
+struct radix_float_traits
+{
+    static constexpr bool enabled = true;
+    typedef Key key_type;
+    static constexpr key_type sign = key_type(1) << (8*sizeof(Key) - 1);
+
+    static key_type to_key(T x)
+    {
+        key_type bits;
+        std::memcpy(&bits, &x, sizeof(bits));
+        return (bits & sign) ? key_type(~bits) : key_type(bits | sign);
+    }
+
+    static T from_key(key_type k)
+    {
+        key_type bits = (k & sign) ? key_type(k & ~sign) : key_type(~k);
+        T x;
+        std::memcpy(&x, &bits, sizeof(x));
+        return x;
+    }
+};
+
+template <>
+struct radix_traits<float> : radix_float_traits<float,uint32_t>
+{
+};
+
+template <>
+struct radix_traits<double> : radix_float_traits<double,uint64_t>
+{
+};
+
+// Ascending order by radix key where there is one, a strict weak order for floating
+// point values that agrees with the radix sort, NaNs included
+template <typename T, bool Radix = radix_traits<T>::enabled>
+struct ascending_order
+{
+    bool operator()(const T& x, const T& y) const
+    {
+        return radix_traits<T>::to_key(x) < radix_traits<T>::to_key(y);
+    }
+};
+
+template <typename T>
+struct ascending_order<T,false>
+{
+    bool operator()(const T& x, const T& y) const
+    {
+        return x < y;
+    }
+};
+
+// LSD radix sort of keys, with an optional payload moved with them, one byte per pass.
+// Passes in which every key has the same byte are skipped. Stable.
+template <typename Key, typename Value>
+void radix_sort(Key* keys, Value* values, size_t n, std::vector<Key>& key_buffer, std::vector<Value>& value_buffer)
+{
+    const size_t passes = sizeof(Key);
+    size_t counts[passes][256];
+    std::memset(counts, 0, sizeof(counts));
+    for (size_t i = 0; i < n; ++i)
+    {
+        Key k = keys[i];
+        for (size_t p = 0; p < passes; ++p)
+        {
+            ++counts[p][(k >> (8*p)) & 0xff];
+        }
+    }
+
+    key_buffer.resize(n);
+    if (values != nullptr)
+    {
+        value_buffer.resize(n);
+    }
+    Key* src_keys = keys;
+    Key* dst_keys = key_buffer.data();
+    Value* src_values = values;
+    Value* dst_values = values != nullptr ? value_buffer.data() : nullptr;
+
+    for (size_t p = 0; p < passes; ++p)
+    {
+        size_t* count = counts[p];
+        if (count[(src_keys[0] >> (8*p)) & 0xff] == n)
+        {
+            continue;
+        }
+        size_t offset = 0;
+        for (size_t d = 0; d < 256; ++d)
+        {
+            size_t c = count[d];
+            count[d] = offset;
+            offset += c;
+        }
+        for (size_t i = 0; i < n; ++i)
+        {
+            size_t pos = count[(src_keys[i] >> (8*p)) & 0xff]++;
+            dst_keys[pos] = src_keys[i];
+            if (values != nullptr)
+            {
+                dst_values[pos] = src_values[i];
+            }
+        }
+        std::swap(src_keys, dst_keys);
+        std::swap(src_values, dst_values);
+    }
+    if (src_keys != keys)
+    {
+        std::copy(src_keys, src_keys + n, keys);
+        if (values != nullptr)
+        {
+            std::copy(src_values, src_values + n, values);
+        }
+    }
+}
+
+// The lanes along one axis, numbered in index order of the other dimensions
+template <size_t N>
+struct axis_lanes
+{
+    size_t axis;
+    size_t length;
+    size_t count;
+    size_t other_dims;
+    size_t other[N];
+    size_t other_shape[N];
+
+    template <typename Array>
+    axis_lanes(const Array& a, size_t axis)
+        : axis(axis), length(a.shape(axis)), count(1), other_dims(0)
+    {
+        for (size_t i = 0; i < N; ++i)
+        {
+            if (i != axis)
+            {
+                other[other_dims] = i;
+                other_shape[other_dims] = a.shape(i);
+                count *= a.shape(i);
+                ++other_dims;
+            }
+        }
+    }
+
+    // Offset of the first element of a lane in an array with the given strides
+    size_t offset(size_t lane, const indices_t<N>& strides) const
+    {
+        size_t off = 0;
+        for (size_t i = other_dims; i-- > 0; )
+        {
+            off += (lane % other_shape[i])*strides[other[i]];
+            lane /= other_shape[i];
+        }
+        return off;
+    }
+};
+
+inline void check_sort_axis(size_t axis, size_t ndim)
+{
+    if (axis >= ndim)
+    {
+        throw std::out_of_range("axis out of range");
+    }
+}
+
+inline size_t sort_threads(size_t threads, size_t size)
+{
+    if (size < (size_t(1) << 14))
+    {
+        return 1;
+    }
+    return threads == 0 ? default_thread_count() : threads;
+}
+
+template <typename T, typename Compare>
+void sort_lane(T* p, size_t stride, size_t n, Compare comp, std::vector<T>& buffer)
+{
+    if (stride == 1)
+    {
+        std::sort(p, p + n, comp);
+        return;
+    }
+    buffer.resize(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        buffer[i] = p[i*stride];
+    }
+    std::sort(buffer.begin(), buffer.end(), comp);
+    for (size_t i = 0; i < n; ++i)
+    {
+        p[i*stride] = buffer[i];
+    }
+}
+
+template <typename T>
+struct radix_sort_workspace
+{
+    typedef typename radix_traits<T>::key_type key_type;
+    std::vector<key_type> keys;
+    std::vector<key_type> key_buffer;
+    std::vector<size_t> indices;
+    std::vector<size_t> index_buffer;
+};
+
+template <typename T>
+void radix_sort_lane(T* p, size_t stride, size_t n, radix_sort_workspace<T>& w)
+{
+    typedef radix_traits<T> traits;
+    w.keys.resize(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        w.keys[i] = traits::to_key(p[i*stride]);
+    }
+    radix_sort<typename traits::key_type,size_t>(w.keys.data(), nullptr, n, w.key_buffer, w.index_buffer);
+    for (size_t i = 0; i < n; ++i)
+    {
+        p[i*stride] = traits::from_key(w.keys[i]);
+    }
+}
+
+template <typename Array, typename F>
+void for_each_lane(Array& a, size_t axis, size_t threads, F f)
+{
+    const size_t N = Array::ndim;
+    axis_lanes<N> lanes(a, axis);
+    parallel_for(lanes.count, [&](size_t first, size_t last)
+    {
+        f(lanes, first, last);
+    }, sort_threads(threads, a.size()));
+}
+
+template <typename Array, typename Compare>
+void sort_with(Array& a, size_t axis, Compare comp, size_t threads)
+{
+    typedef typename Array::element_type T;
+    auto data = a.data();
+    const size_t stride = a.strides()[axis];
+    for_each_lane(a, axis, threads, [&](const axis_lanes<Array::ndim>& lanes, size_t first, size_t last)
+    {
+        std::vector<T> buffer;
+        for (size_t l = first; l < last; ++l)
+        {
+            sort_lane(data + lanes.offset(l, a.strides()), stride, lanes.length, comp, buffer);
+        }
+    });
+}
+
+template <typename Array>
+void sort_ascending(Array& a, size_t axis, size_t threads, std::true_type)
+{
+    typedef typename Array::element_type T;
+    auto data = a.data();
+    const size_t stride = a.strides()[axis];
+    for_each_lane(a, axis, threads, [&](const axis_lanes<Array::ndim>& lanes, size_t first, size_t last)
+    {
+        radix_sort_workspace<T> w;
+        std::vector<T> buffer;
+        for (size_t l = first; l < last; ++l)
+        {
+            T* p = data + lanes.offset(l, a.strides());
+            if (lanes.length >= radix_sort_min_length)
+            {
+                radix_sort_lane(p, stride, lanes.length, w);
+            }
+            else
+            {
+                sort_lane(p, stride, lanes.length, ascending_order<T>(), buffer);
+            }
+        }
+    });
+}
+
+template <typename Array>
+void sort_ascending(Array& a, size_t axis, size_t threads, std::false_type)
+{
+    sort_with(a, axis, ascending_order<typename Array::element_type>(), threads);
+}
+
+// Positions along the lane in stable sorted order
+template <typename T>
+void argsort_lane(const T* p, size_t stride, size_t n, size_t* indices, radix_sort_workspace<T>& w, std::true_type)
+{
+    typedef radix_traits<T> traits;
+    w.keys.resize(n);
+    w.indices.resize(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        w.keys[i] = traits::to_key(p[i*stride]);
+        w.indices[i] = i;
+    }
+    if (n >= radix_sort_min_length)
+    {
+        radix_sort(w.keys.data(), w.indices.data(), n, w.key_buffer, w.index_buffer);
+    }
+    else
+    {
+        const auto& keys = w.keys;
+        std::stable_sort(w.indices.begin(), w.indices.end(), [&](size_t i, size_t j) {return keys[i] < keys[j];});
+    }
+    std::copy(w.indices.begin(), w.indices.end(), indices);
+}
+
+template <typename T, typename W>
+void argsort_lane(const T* p, size_t stride, size_t n, size_t* indices, W& w, std::false_type)
+{
+    w.indices.resize(n);
+    std::iota(w.indices.begin(), w.indices.end(), size_t(0));
+    std::stable_sort(w.indices.begin(), w.indices.end(), [&](size_t i, size_t j) {return p[i*stride] < p[j*stride];});
+    std::copy(w.indices.begin(), w.indices.end(), indices);
+}
+
+template <typename T>
+struct sort_workspace
+{
+    std::vector<size_t> indices;
+};
+
+template <typename T, bool Radix = radix_traits<T>::enabled>
+struct argsort_workspace
+{
+    typedef radix_sort_workspace<T> type;
+};
+
+template <typename T>
+struct argsort_workspace<T,false>
+{
+    typedef sort_workspace<T> type;
+};
+
+// Lanes at least this many times longer than k are searched with a heap
+const size_t topk_heap_ratio = 16;
+
+// Orders (value, index) pairs best first, ties going to the lower index
+template <typename T>
+struct topk_order
+{
+    bool largest;
+
+    bool value_better(const T& x, const T& y) const
+    {
+        return largest ? ascending_order<T>()(y, x) : ascending_order<T>()(x, y);
+    }
+
+    bool operator()(const std::pair<T,size_t>& x, const std::pair<T,size_t>& y) const
+    {
+        return value_better(x.first, y.first) || (!value_better(y.first, x.first) && x.second < y.second);
+    }
+};
+
+// The front of the heap is the worst of the k best so far. Later elements have higher
+// indices, so only strictly better values replace it.
+template <typename T>
+void topk_heap_lane(const T* p, size_t stride, size_t n, size_t k, const topk_order<T>& better,
+                    std::vector<std::pair<T,size_t>>& heap)
+{
+    heap.clear();
+    for (size_t i = 0; i < k; ++i)
+    {
+        heap.emplace_back(p[i*stride], i);
+    }
+    std::make_heap(heap.begin(), heap.end(), better);
+    for (size_t i = k; i < n; ++i)
+    {
+        const T& x = p[i*stride];
+        if (better.value_better(x, heap.front().first))
+        {
+            std::pop_heap(heap.begin(), heap.end(), better);
+            heap.back() = std::pair<T,size_t>(x, i);
+            std::push_heap(heap.begin(), heap.end(), better);
+        }
+    }
+    std::sort_heap(heap.begin(), heap.end(), better);
+}
+
+template <typename T>
+void topk_select_lane(const T* p, size_t stride, size_t n, size_t k, const topk_order<T>& better,
+                      std::vector<std::pair<T,size_t>>& lane)
+{
+    lane.clear();
+    for (size_t i = 0; i < n; ++i)
+    {
+        lane.emplace_back(p[i*stride], i);
+    }
+    if (k < n)
+    {
+        std::nth_element(lane.begin(), lane.begin() + (k - 1), lane.end(), better);
+    }
+    std::sort(lane.begin(), lane.begin() + k, better);
+}
+
+}
+
+// sort, argsort, partition, topk
+//
+// Sorting along one axis of an ndarray or view, each lane independently. Lanes are spread
+// across threads. Lanes with a stride of one are sorted in place, others are gathered
+// into a contiguous buffer and scattered back. Integer and floating point lanes of at
+// least 256 elements are radix sorted, one byte per pass, skipping passes in which
+// every key has the same byte. Floating point values are ordered by sign and magnitude,
+// so -0.0 sorts before 0.0 and NaNs sort to the end if positive or the start if negative.
+
+// Sorts each lane along axis in ascending order
+template <typename Array>
+void sort(Array&& a, size_t axis = std::decay<Array>::type::ndim - 1, size_t threads = 0)
+{
+    typedef typename std::decay<Array>::type::element_type T;
+    detail::check_sort_axis(axis, std::decay<Array>::type::ndim);
+    detail::sort_ascending(a, axis, threads, std::integral_constant<bool,detail::radix_traits<T>::enabled>());
+}
+
+// Sorts each lane along axis so that comp(later, earlier) is false
+template <typename Array, typename Compare>
+typename std::enable_if<!std::is_integral<Compare>::value>::type
+sort(Array&& a, size_t axis, Compare comp, size_t threads = 0)
+{
+    detail::check_sort_axis(axis, std::decay<Array>::type::ndim);
+    detail::sort_with(a, axis, comp, threads);
+}
+
+// Returns, for each lane along axis, the indices that would sort it, equal elements keeping
+// their order. Indices count from Base::origin().
+template <typename Array>
+ndarray<size_t,Array::ndim,typename Array::order_type,typename Array::base_type>
+argsort(const Array& a, size_t axis = Array::ndim - 1, size_t threads = 0)
+{
+    typedef typename Array::element_type T;
+    typedef typename Array::base_type Base;
+    const size_t N = Array::ndim;
+    detail::check_sort_axis(axis, N);
+    ndarray<size_t,N,typename Array::order_type,Base> result(a.shape());
+    const T* data = a.data();
+    const size_t stride = a.strides()[axis];
+    size_t* out = result.data();
+    const size_t out_stride = result.strides()[axis];
+
+    detail::for_each_lane(a, axis, threads, [&](const detail::axis_lanes<N>& lanes, size_t first, size_t last)
+    {
+        typename detail::argsort_workspace<T>::type w;
+        std::vector<size_t> indices(lanes.length);
+        for (size_t l = first; l < last; ++l)
+        {
+            detail::argsort_lane(data + lanes.offset(l, a.strides()), stride, lanes.length, indices.data(), w,
+                                 std::integral_constant<bool,detail::radix_traits<T>::enabled>());
+            size_t* dst = out + lanes.offset(l, result.strides());
+            for (size_t i = 0; i < lanes.length; ++i)
+            {
+                dst[i*out_stride] = indices[i] + Base::origin();
+            }
+        }
+    });
+    return result;
+}
+
+// Rearranges each lane along axis so that the element at position kth is the one that would
+// be there if the lane were sorted, with no greater element before it and no smaller after
+template <typename Array>
+void partition(Array&& a, size_t kth, size_t axis = std::decay<Array>::type::ndim - 1, size_t threads = 0)
+{
+    typedef typename std::decay<Array>::type::element_type T;
+    detail::check_sort_axis(axis, std::decay<Array>::type::ndim);
+    if (kth >= a.shape(axis))
+    {
+        throw std::out_of_range("partition position out of range");
+    }
+    auto data = a.data();
+    const size_t stride = a.strides()[axis];
+    detail::for_each_lane(a, axis, threads, [&](const detail::axis_lanes<std::decay<Array>::type::ndim>& lanes, size_t first, size_t last)
+    {
+        std::vector<T> buffer(stride == 1 ? 0 : lanes.length);
+        for (size_t l = first; l < last; ++l)
+        {
+            T* p = data + lanes.offset(l, a.strides());
+            if (stride == 1)
+            {
+                std::nth_element(p, p + kth, p + lanes.length, detail::ascending_order<T>());
+                continue;
+            }
+            for (size_t i = 0; i < lanes.length; ++i)
+            {
+                buffer[i] = p[i*stride];
+            }
+            std::nth_element(buffer.begin(), buffer.begin() + kth, buffer.end(), detail::ascending_order<T>());
+            for (size_t i = 0; i < lanes.length; ++i)
+            {
+                p[i*stride] = buffer[i];
+            }
+        }
+    });
+}
+
+template <typename T, size_t N, typename Order = row_major, typename Base = zero_based>
+struct topk_result
+{
+    ndarray<T,N,Order,Base> values;
+    ndarray<size_t,N,Order,Base> indices;
+};
+
+// Returns the k largest, or smallest, elements of each lane along axis, best first, and
+// their indices from Base::origin(). Ties go to the lower index. When k is small next to
+// the lane length, the lane is read in place through a heap of the k best so far, most
+// elements costing one comparison against the worst of them. Otherwise the lane is
+// gathered and selected in linear time, and only the k selected elements are sorted.
+template <typename Array>
+topk_result<typename Array::element_type,Array::ndim,typename Array::order_type,typename Array::base_type>
+topk(const Array& a, size_t k, size_t axis = Array::ndim - 1, bool largest = true, size_t threads = 0)
+{
+    typedef typename Array::element_type T;
+    typedef typename Array::base_type Base;
+    const size_t N = Array::ndim;
+    detail::check_sort_axis(axis, N);
+    if (k > a.shape(axis))
+    {
+        throw std::invalid_argument("topk k exceeds the axis extent");
+    }
+    extents_t<N> shape = a.shape();
+    shape[axis] = k;
+    topk_result<T,N,typename Array::order_type,Base> result{ndarray<T,N,typename Array::order_type,Base>(shape),
+                                                             ndarray<size_t,N,typename Array::order_type,Base>(shape)};
+    if (k == 0)
+    {
+        return result;
+    }
+    const T* data = a.data();
+    const size_t stride = a.strides()[axis];
+    T* values = result.values.data();
+    size_t* indices = result.indices.data();
+    const size_t values_stride = result.values.strides()[axis];
+    const size_t indices_stride = result.indices.strides()[axis];
+
+    detail::for_each_lane(a, axis, threads, [&](const detail::axis_lanes<N>& lanes, size_t first, size_t last)
+    {
+        const size_t n = lanes.length;
+        detail::topk_order<T> better{largest};
+        std::vector<std::pair<T,size_t>> best;
+        for (size_t l = first; l < last; ++l)
+        {
+            const T* p = data + lanes.offset(l, a.strides());
+            if (k*detail::topk_heap_ratio <= n)
+            {
+                detail::topk_heap_lane(p, stride, n, k, better, best);
+            }
+            else
+            {
+                detail::topk_select_lane(p, stride, n, k, better, best);
+            }
+            T* v = values + lanes.offset(l, result.values.strides());
+            size_t* x = indices + lanes.offset(l, result.indices.strides());
+            for (size_t i = 0; i < k; ++i)
+            {
+                v[i*values_stride] = best[i].first;
+                x[i*indices_stride] = best[i].second + Base::origin();
+            }
+        }
+    });
+    return result;
+}
+
+}
+
+#endif
@@ -0,0 +1,466 @@
+#ifndef ACONS_SPARSE_NDARRAY_HPP
+#define ACONS_SPARSE_NDARRAY_HPP
+
+#include <vector>
+#include <stdexcept>
+#include <acons/ndarray.hpp>
+
+namespace acons {
+
+namespace detail {
+
+template <typename T>
+typename std::enable_if<std::is_arithmetic<T>::value && std::is_signed<T>::value,T>::type
+magnitude(const T& val)
+{
+    return val < T() ? -val : val;
+}
+
+template <typename T>
+typename std::enable_if<!(std::is_arithmetic<T>::value && std::is_signed<T>::value),T>::type
+magnitude(const T& val)
+{
+    return val;
+}
+
+// An element is stored if its magnitude exceeds the threshold,
+// with the default threshold every non-zero element is stored
+template <typename T>
+bool is_stored(const T& val, const T& threshold)
+{
+    return magnitude(val) > threshold;
+}
+
+// Calls f(indices) for every index of shape, with the last index varying fastest
+template <size_t N, typename F>
+void for_each_index(const extents_t<N>& shape, F f)
+{
+    for (size_t i = 0; i < N; ++i)
+    {
+        if (shape[i] == 0)
+        {
+            return;
+        }
+    }
+    indices_t<N> indices;
+    indices.fill(0);
+    while (true)
+    {
+        f(indices);
+        size_t i = N;
+        while (i-- > 0)
+        {
+            if (++indices[i] < shape[i])
+            {
+                break;
+            }
+            indices[i] = 0;
+        }
+        if (i == size_t(-1))
+        {
+            return;
+        }
+    }
+}
+
+template <size_t N, typename Base>
+indices_t<N> rebase_from_zero(const indices_t<N>& indices)
+{
+    indices_t<N> result;
+    for (size_t i = 0; i < N; ++i)
+    {
+        result[i] = indices[i] + Base::origin();
+    }
+    return result;
+}
+
+} // namespace detail
+
+// coo_ndarray
+//
+// Coordinate format: a list of (indices, value) entries. Indices are stored zero based,
+// whatever the Base of the dense arrays it is converted from or to.
+
+template <typename T, size_t N>
+class coo_ndarray
+{
+public:
+    typedef T element_type;
+    static constexpr size_t ndim = N;
+private:
+    extents_t<N> shape_;
+    std::vector<indices_t<N>> indices_;
+    std::vector<T> values_;
+public:
+    coo_ndarray()
+    {
+        shape_.fill(0);
+    }
+
+    explicit coo_ndarray(const extents_t<N>& shape)
+        : shape_(shape)
+    {
+    }
+
+    template <typename Order, typename Base, typename TPtr>
+    explicit coo_ndarray(const ndarray_view_base<T,N,Order,Base,TPtr>& v, const T& threshold = T())
+        : shape_(v.shape())
+    {
+        detail::for_each_index(shape_, [&](const indices_t<N>& indices)
+        {
+            const T& val = v(detail::rebase_from_zero<N,Base>(indices));
+            if (detail::is_stored(val, threshold))
+            {
+                indices_.push_back(indices);
+                values_.push_back(val);
+            }
+        });
+    }
+
+    template <typename Order, typename Base, typename Allocator>
+    explicit coo_ndarray(const ndarray<T,N,Order,Base,Allocator>& a, const T& threshold = T())
+        : coo_ndarray(const_ndarray_view<T,N,Order,Base>(a), threshold)
+    {
+    }
+
+    const extents_t<N>& shape() const {return shape_;}
+
+    size_t shape(size_t i) const
+    {
+        assert(i < N);
+        return shape_[i];
+    }
+
+    // Number of stored elements
+    size_t nnz() const noexcept
+    {
+        return values_.size();
+    }
+
+    const std::vector<indices_t<N>>& indices() const {return indices_;}
+
+    const std::vector<T>& values() const {return values_;}
+
+    std::vector<T>& values() {return values_;}
+
+    void reserve(size_t n)
+    {
+        indices_.reserve(n);
+        values_.reserve(n);
+    }
+
+    void push_back(const indices_t<N>& indices, const T& val)
+    {
+        for (size_t i = 0; i < N; ++i)
+        {
+            if (indices[i] >= shape_[i])
+            {
+                throw std::out_of_range("index out of range");
+            }
+        }
+        indices_.push_back(indices);
+        values_.push_back(val);
+    }
+
+    // Sorts entries into row major index order
+    void sort()
+    {
+        std::vector<size_t> perm(nnz());
+        std::iota(perm.begin(), perm.end(), size_t(0));
+        std::sort(perm.begin(), perm.end(), [this](size_t a, size_t b)
+        {
+            return std::lexicographical_compare(indices_[a].begin(), indices_[a].end(),
+                                                indices_[b].begin(), indices_[b].end());
+        });
+        std::vector<indices_t<N>> indices;
+        std::vector<T> values;
+        indices.reserve(nnz());
+        values.reserve(nnz());
+        for (size_t k : perm)
+        {
+            indices.push_back(indices_[k]);
+            values.push_back(values_[k]);
+        }
+        indices_.swap(indices);
+        values_.swap(values);
+    }
+
+    // Calls f(indices, value) for each stored element
+    template <typename F>
+    void for_each_nonzero(F f) const
+    {
+        for (size_t k = 0; k < values_.size(); ++k)
+        {
+            f(indices_[k], values_[k]);
+        }
+    }
+
+    // Duplicate entries are summed
+    template <typename Order = row_major, typename Base = zero_based, typename Allocator = std::allocator<T>>
+    ndarray<T,N,Order,Base,Allocator> to_dense() const
+    {
+        ndarray<T,N,Order,Base,Allocator> a(shape_, T());
+        for (size_t k = 0; k < values_.size(); ++k)
+        {
+            a(detail::rebase_from_zero<N,Base>(indices_[k])) += values_[k];
+        }
+        return a;
+    }
+};
+
+template <typename T>
+using coo_matrix = coo_ndarray<T,2>;
+
+// csr_matrix
+//
+// Compressed sparse row format. The column indices and values of row i are stored in
+// positions row_ptr()[i] to row_ptr()[i+1] of col_indices() and values(), sorted by column.
+
+template <typename T>
+class csr_matrix
+{
+public:
+    typedef T element_type;
+    static constexpr size_t ndim = 2;
+private:
+    extents_t<2> shape_;
+    std::vector<size_t> row_ptr_;
+    std::vector<size_t> col_indices_;
+    std::vector<T> values_;
+public:
+    csr_matrix()
+        : row_ptr_(1, 0)
+    {
+        shape_.fill(0);
+    }
+
+    csr_matrix(size_t rows, size_t cols)
+        : shape_{rows,cols}, row_ptr_(rows+1, 0)
+    {
+    }
+
+    csr_matrix(const extents_t<2>& shape,
+               std::vector<size_t> row_ptr,
+               std::vector<size_t> col_indices,
+               std::vector<T> values)
+        : shape_(shape), row_ptr_(std::move(row_ptr)), col_indices_(std::move(col_indices)), values_(std::move(values))
+    {
+        if (row_ptr_.size() != shape_[0]+1 || col_indices_.size() != values_.size() || row_ptr_.back() != values_.size())
+        {
+            throw std::invalid_argument("inconsistent compressed sparse row arrays");
+        }
+    }
+
+    template <typename Order, typename Base, typename TPtr>
+    explicit csr_matrix(const ndarray_view_base<T,2,Order,Base,TPtr>& v, const T& threshold = T())
+        : shape_(v.shape()), row_ptr_(v.shape(0)+1, 0)
+    {
+        for (size_t i = 0; i < shape_[0]; ++i)
+        {
+            for (size_t j = 0; j < shape_[1]; ++j)
+            {
+                const T& val = v(Base::origin()+i, Base::origin()+j);
+                if (detail::is_stored(val, threshold))
+                {
+                    col_indices_.push_back(j);
+                    values_.push_back(val);
+                }
+            }
+            row_ptr_[i+1] = values_.size();
+        }
+    }
+
+    template <typename Order, typename Base, typename Allocator>
+    explicit csr_matrix(const ndarray<T,2,Order,Base,Allocator>& a, const T& threshold = T())
+        : csr_matrix(const_ndarray_view<T,2,Order,Base>(a), threshold)
+    {
+    }
+
+    // Duplicate entries are summed
+    explicit csr_matrix(const coo_matrix<T>& coo)
+        : shape_(coo.shape()), row_ptr_(coo.shape(0)+1, 0)
+    {
+        // counting sort by row, then order each row by column
+        for (const auto& indices : coo.indices())
+        {
+            ++row_ptr_[indices[0]+1];
+        }
+        std::partial_sum(row_ptr_.begin(), row_ptr_.end(), row_ptr_.begin());
+
+        std::vector<size_t> next(row_ptr_.begin(), row_ptr_.end()-1);
+        std::vector<std::pair<size_t,T>> entries(coo.nnz());
+        for (size_t k = 0; k < coo.nnz(); ++k)
+        {
+            entries[next[coo.indices()[k][0]]++] = std::make_pair(coo.indices()[k][1], coo.values()[k]);
+        }
+
+        std::vector<size_t> row_ptr(row_ptr_.size(), 0);
+        col_indices_.reserve(entries.size());
+        values_.reserve(entries.size());
+        for (size_t i = 0; i < shape_[0]; ++i)
+        {
+            auto first = entries.begin() + row_ptr_[i];
+            auto last = entries.begin() + row_ptr_[i+1];
+            std::sort(first, last, [](const std::pair<size_t,T>& a, const std::pair<size_t,T>& b){return a.first < b.first;});
+            for (auto it = first; it != last; ++it)
+            {
+                if (!col_indices_.empty() && values_.size() > row_ptr[i] && col_indices_.back() == it->first)
+                {
+                    values_.back() += it->second;
+                }
+                else
+                {
+                    col_indices_.push_back(it->first);
+                    values_.push_back(it->second);
+                }
+            }
+            row_ptr[i+1] = values_.size();
+        }
+        row_ptr_.swap(row_ptr);
+    }
+
+    const extents_t<2>& shape() const {return shape_;}
+
+    size_t shape(size_t i) const
+    {
+        assert(i < 2);
+        return shape_[i];
+    }
+
+    size_t nnz() const noexcept
+    {
+        return values_.size();
+    }
+
+    const std::vector<size_t>& row_ptr() const {return row_ptr_;}
+
+    const std::vector<size_t>& col_indices() const {return col_indices_;}
+
+    const std::vector<T>& values() const {return values_;}
+
+    std::vector<T>& values() {return values_;}
+
+    // Calls f(i, j, value) for each stored element, in row major order
+    template <typename F>
+    void for_each_nonzero(F f) const
+    {
+        for (size_t i = 0; i < shape_[0]; ++i)
+        {
+            for (size_t k = row_ptr_[i]; k < row_ptr_[i+1]; ++k)
+            {
+                f(i, col_indices_[k], values_[k]);
+            }
+        }
+    }
+
+    coo_matrix<T> to_coo() const
+    {
+        coo_matrix<T> coo(shape_);
+        coo.reserve(nnz());
+        for_each_nonzero([&](size_t i, size_t j, const T& val)
+        {
+            coo.push_back(indices_t<2>{i,j}, val);
+        });
+        return coo;
+    }
+
+    template <typename Order = row_major, typename Base = zero_based, typename Allocator = std::allocator<T>>
+    ndarray<T,2,Order,Base,Allocator> to_dense() const
+    {
+        ndarray<T,2,Order,Base,Allocator> a(shape_, T());
+        for_each_nonzero([&](size_t i, size_t j, const T& val)
+        {
+            a(Base::origin()+i, Base::origin()+j) = val;
+        });
+        return a;
+    }
+};
+
+// Sparse-dense products. c = a*b, where b and c are dense.
+
+template <typename T, typename Order, typename Base, typename TPtr>
+void matmul(const csr_matrix<T>& a,
+            const ndarray_view_base<T,2,Order,Base,TPtr>& b,
+            ndarray_view<T,2,Order,Base>& c)
+{
+    if (a.shape(1) != b.shape(0) || c.shape(0) != a.shape(0) || c.shape(1) != b.shape(1))
+    {
+        throw std::invalid_argument("matrix shapes do not conform");
+    }
+    const size_t n = c.shape(1);
+    if (n == 0)
+    {
+        return;
+    }
+    const size_t o = Base::origin();
+    const size_t bs = b.strides()[1];
+    const size_t cs = c.strides()[1];
+    const auto& row_ptr = a.row_ptr();
+    const auto& cols = a.col_indices();
+    const auto& vals = a.values();
+    for (size_t i = 0; i < a.shape(0); ++i)
+    {
+        T* crow = &c(o+i,o);
+        for (size_t j = 0; j < n; ++j)
+        {
+            crow[j*cs] = T();
+        }
+        for (size_t k = row_ptr[i]; k < row_ptr[i+1]; ++k)
+        {
+            const T aik = vals[k];
+            const T* brow = &b(o+cols[k],o);
+            for (size_t j = 0; j < n; ++j)
+            {
+                crow[j*cs] += aik * brow[j*bs];
+            }
+        }
+    }
+}
+
+template <typename T, typename Order, typename Base, typename Allocator>
+ndarray<T,2,Order,Base,Allocator> matmul(const csr_matrix<T>& a,
+                                         const ndarray<T,2,Order,Base,Allocator>& b)
+{
+    ndarray<T,2,Order,Base,Allocator> c(extents_t<2>{a.shape(0),b.shape(1)}, T());
+    ndarray_view<T,2,Order,Base> cv(c);
+    matmul(a, const_ndarray_view<T,2,Order,Base>(b), cv);
+    return c;
+}
+
+template <typename T, typename Order, typename Base, typename TPtr>
+void matmul(const csr_matrix<T>& a,
+            const ndarray_view_base<T,1,Order,Base,TPtr>& x,
+            ndarray_view<T,1,Order,Base>& y)
+{
+    if (a.shape(1) != x.shape(0) || y.shape(0) != a.shape(0))
+    {
+        throw std::invalid_argument("matrix shapes do not conform");
+    }
+    const size_t o = Base::origin();
+    const auto& row_ptr = a.row_ptr();
+    const auto& cols = a.col_indices();
+    const auto& vals = a.values();
+    for (size_t i = 0; i < a.shape(0); ++i)
+    {
+        T sum = T();
+        for (size_t k = row_ptr[i]; k < row_ptr[i+1]; ++k)
+        {
+            sum += vals[k] * x(o+cols[k]);
+        }
+        y(o+i) = sum;
+    }
+}
+
+template <typename T, typename Order, typename Base, typename Allocator>
+ndarray<T,1,Order,Base,Allocator> matmul(const csr_matrix<T>& a,
+                                         const ndarray<T,1,Order,Base,Allocator>& x)
+{
+    ndarray<T,1,Order,Base,Allocator> y(extents_t<1>{a.shape(0)}, T());
+    ndarray_view<T,1,Order,Base> yv(y);
+    matmul(a, const_ndarray_view<T,1,Order,Base>(x), yv);
+    return y;
+}
+
+}
+
+#endif
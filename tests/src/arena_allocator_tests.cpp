@@ -0,0 +1,107 @@
+#include <catch/catch.hpp>
+#include <iostream>
+#include "acons/ndarray.hpp"
+#include "acons/arena_allocator.hpp"
+
+using namespace acons;
+
+TEST_CASE("monotonic_arena tests")
+{
+    monotonic_arena arena(256);
+
+    SECTION("alignment")
+    {
+        void* p = arena.allocate(3, 1);
+        void* q = arena.allocate(8, 64);
+        CHECK(p != nullptr);
+        CHECK(reinterpret_cast<std::uintptr_t>(q) % 64 == 0);
+        CHECK(arena.num_blocks() == 1);
+    }
+    SECTION("growth")
+    {
+        arena.allocate(200);
+        arena.allocate(200);
+        CHECK(arena.num_blocks() == 2);
+        arena.allocate(4096);
+        CHECK(arena.num_blocks() == 3);
+    }
+    SECTION("release keeps blocks")
+    {
+        void* p = arena.allocate(200);
+        arena.allocate(200);
+        size_t capacity = arena.capacity();
+
+        arena.release();
+        CHECK(arena.allocate(200) == p);
+        arena.allocate(200);
+        CHECK(arena.capacity() == capacity);
+    }
+    SECTION("rewind")
+    {
+        arena.allocate(16);
+        monotonic_arena::marker m = arena.mark();
+        void* p = arena.allocate(16);
+        arena.allocate(1000);
+        arena.rewind(m);
+        CHECK(arena.allocate(16) == p);
+    }
+}
+
+TEST_CASE("monotonic_arena external buffer tests")
+{
+    alignas(std::max_align_t) char buffer[128];
+    monotonic_arena arena(buffer, sizeof(buffer));
+
+    void* p = arena.allocate(64);
+    CHECK(static_cast<char*>(p) == buffer);
+    void* q = arena.allocate(128);
+    CHECK((static_cast<char*>(q) < buffer || static_cast<char*>(q) >= buffer + sizeof(buffer)));
+    CHECK(arena.num_blocks() == 2);
+}
+
+TEST_CASE("arena_allocator ndarray tests")
+{
+    typedef arena_allocator<double> allocator_type;
+    typedef ndarray<double,2,row_major,zero_based,allocator_type> array_type;
+
+    monotonic_arena arena;
+    allocator_type alloc(arena);
+
+    array_type a(std::allocator_arg, alloc, 3, 4, 1.0);
+    CHECK(a.get_allocator() == alloc);
+    CHECK(a(2,3) == 1.0);
+
+    array_type b(a);
+    CHECK(b == a);
+    CHECK(b.data() != a.data());
+
+    monotonic_arena other_arena;
+    CHECK(allocator_type(other_arena) != alloc);
+    CHECK(arena_allocator<int>(alloc) == alloc);
+}
+
+TEST_CASE("scratch_allocator tests")
+{
+    typedef ndarray<float,2,row_major,zero_based,scratch_allocator<float>> array_type;
+
+    float* first = nullptr;
+    {
+        scratch_scope scope;
+        array_type a(10, 10, 2.0f);
+        first = a.data();
+        array_type b(a);
+        CHECK(b(9,9) == 2.0f);
+    }
+    {
+        scratch_scope scope;
+        array_type a(10, 10, 3.0f);
+        CHECK(a.data() == first);
+
+        {
+            scratch_scope inner;
+            array_type b(5, 5, 4.0f);
+            CHECK(b.data() != a.data());
+        }
+        CHECK(a(9,9) == 3.0f);
+    }
+}
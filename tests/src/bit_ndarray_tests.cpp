@@ -0,0 +1,206 @@
+#include <catch/catch.hpp>
+#include <iostream>
+#include "acons/ndarray.hpp"
+#include "acons/bit_ndarray.hpp"
+
+using namespace acons;
+
+namespace {
+
+template <typename Mask>
+void fill_mask(Mask& mask, size_t period)
+{
+    size_t i = 0;
+    for (auto p = mask.data(); p != mask.data() + mask.size(); ++p)
+    {
+        *p = (i*i + 1) % period == 0;
+        ++i;
+    }
+}
+
+template <typename Bits, typename Mask>
+bool same_elements(const Bits& bits, const Mask& mask)
+{
+    bool ok = bits.size() == mask.size();
+    for (size_t i = 0; ok && i < mask.shape(0); ++i)
+    {
+        for (size_t j = 0; ok && j < mask.shape(1); ++j)
+        {
+            for (size_t k = 0; ok && k < mask.shape(2); ++k)
+            {
+                ok = bits(i,j,k) == mask(i,j,k);
+            }
+        }
+    }
+    return ok;
+}
+
+}
+
+TEST_CASE("bit_ndarray element tests")
+{
+    bit_ndarray<2> a(extents_t<2>{3,70});
+    CHECK(a.size() == 210);
+    CHECK(a.rows() == 3);
+    CHECK(a.words_per_row() == 2);
+    CHECK(a.count() == 0);
+
+    a(1,65) = true;
+    a(2,0) = true;
+    CHECK(a(1,65));
+    CHECK_FALSE(a(1,64));
+    CHECK(a(indices_t<2>{2,0}));
+    CHECK(a.count() == 2);
+
+    a(0,3) = a(1,65);
+    a(1,65).flip();
+    CHECK(a(0,3));
+    CHECK_FALSE(a(1,65));
+
+    const bit_ndarray<2>& c = a;
+    CHECK(c(0,3));
+
+    bit_ndarray<1,one_based> b(extents_t<1>{5});
+    b(5) = true;
+    CHECK(b(5));
+    CHECK(b.words()[0] == 16);
+}
+
+TEST_CASE("bit_ndarray word operations tests")
+{
+    bit_ndarray<2> a(extents_t<2>{4,100}, true);
+    CHECK(a.count() == 400);
+    // Bits past the end of each row stay zero
+    CHECK(a.row_words(0)[1] == (uint64_t(1) << 36) - 1);
+
+    a.flip();
+    CHECK(a.count() == 0);
+    a.fill(true);
+    CHECK(a.count() == 400);
+
+    bit_ndarray<2> b(extents_t<2>{4,100});
+    b(0,0) = true;
+    b(3,99) = true;
+    b(2,50) = true;
+
+    bit_ndarray<2> c(a);
+    c &= b;
+    CHECK(c == b);
+    c |= a;
+    CHECK(c == a);
+    c ^= b;
+    CHECK(c.count() == 397);
+    CHECK_FALSE(c(3,99));
+    CHECK(c != a);
+
+    bit_ndarray<2> wrong(extents_t<2>{4,99});
+    CHECK_THROWS_AS(c &= wrong, std::invalid_argument);
+}
+
+TEST_CASE("bit_ndarray byte mask conversion tests")
+{
+    ndarray<bool,3> mask(3, 4, 77);
+    fill_mask(mask, 3);
+    bit_ndarray<3> bits(mask);
+    CHECK(same_elements(bits, mask));
+    CHECK(bits.to_mask() == mask);
+
+    // Strided and column major masks take the element by element path
+    ndarray<bool,3,column_major> cm(3, 4, 77);
+    fill_mask(cm, 5);
+    bit_ndarray<3> bits2(cm);
+    CHECK(same_elements(bits2, cm));
+    ndarray<bool,3,column_major> back(3, 4, 77);
+    bits2.unpack(back);
+    CHECK(back == cm);
+
+    ndarray<unsigned char,3> bytes(3, 4, 77, 0);
+    bytes(1,2,70) = 7;
+    bit_ndarray<3> bits3(bytes);
+    CHECK(bits3.count() == 1);
+    CHECK(bits3(1,2,70));
+
+    ndarray<bool,3> wrong(3, 4, 76);
+    CHECK_THROWS_AS(bits.unpack(wrong), std::invalid_argument);
+}
+
+TEST_CASE("bit_ndarray_view tests")
+{
+    ndarray<bool,3> mask(6, 5, 130);
+    fill_mask(mask, 4);
+    bit_ndarray<3> bits(mask);
+
+    SECTION("slices")
+    {
+        bit_ndarray_view<3> v(bits, {slice(1,6,2),slice(1,4),slice()});
+        CHECK(v.shape(0) == 3);
+        CHECK(v.shape(1) == 3);
+        CHECK_FALSE(v.contiguous());
+        const_ndarray_view<bool,3> mv(mask, {slice(1,6,2),slice(1,4),slice()});
+        CHECK(same_elements(v, mv));
+
+        size_t expected = 0;
+        for (size_t i = 1; i < 6; i += 2)
+        {
+            for (size_t j = 1; j < 4; ++j)
+            {
+                for (size_t k = 0; k < 130; ++k)
+                {
+                    expected += mask(i,j,k) ? 1 : 0;
+                }
+            }
+        }
+        CHECK(v.count() == expected);
+
+        // Writes through the view land in the array, and stay inside the slices
+        v.fill(false);
+        CHECK_FALSE(bits(3,2,7));
+        v(0,0,129) = true;
+        CHECK(bits(1,1,129));
+        v.fill(true);
+        size_t outside = 0;
+        for (size_t i = 0; i < 6; ++i)
+        {
+            for (size_t j = 0; j < 5; ++j)
+            {
+                for (size_t k = 0; k < 130; ++k)
+                {
+                    bool inside = i % 2 == 1 && j >= 1 && j < 4;
+                    outside += !inside && bits(i,j,k) != mask(i,j,k) ? 1 : 0;
+                }
+            }
+        }
+        CHECK(outside == 0);
+        CHECK(v.count() == 9*130);
+
+        CHECK_THROWS_AS((bit_ndarray_view<3>(bits, {slice(),slice(),slice(0,64)})), std::invalid_argument);
+    }
+
+    SECTION("first dimensions")
+    {
+        const_bit_ndarray_view<2> plane(bits, indices_t<1>{4});
+        const_bit_ndarray_view<1> row(bits, indices_t<2>{4,3});
+        bool ok = true;
+        for (size_t j = 0; j < 5; ++j)
+        {
+            for (size_t k = 0; k < 130; ++k)
+            {
+                ok = ok && plane(j,k) == mask(4,j,k);
+            }
+        }
+        for (size_t k = 0; k < 130; ++k)
+        {
+            ok = ok && row(k) == mask(4,3,k);
+        }
+        CHECK(ok);
+
+        // Copying between planes a word at a time
+        bit_ndarray_view<2> dst(bits, indices_t<1>{0});
+        dst = bit_ndarray_view<2>(bits, indices_t<1>{4});
+        CHECK(const_bit_ndarray_view<2>(bits, indices_t<1>{0}) == plane);
+
+        bit_ndarray<2> copy(plane);
+        CHECK(copy == plane);
+        CHECK(copy.contiguous());
+    }
+}
@@ -0,0 +1,71 @@
+#include <catch/catch.hpp>
+#include <iostream>
+#include "acons/blocked_ndarray.hpp"
+
+using namespace acons;
+
+TEST_CASE("blocked_ndarray element access tests")
+{
+    ndarray<double,2> a(5,7);
+    for (size_t i = 0; i < a.shape(0); ++i)
+    {
+        for (size_t j = 0; j < a.shape(1); ++j)
+        {
+            a(i,j) = double(i*10 + j);
+        }
+    }
+
+    blocked_ndarray<double,2,4> b(a);
+
+    REQUIRE(b.shape(0) == 5);
+    REQUIRE(b.shape(1) == 7);
+    CHECK(b.tiles_shape()[0] == 3);
+    CHECK(b.tiles_shape()[1] == 2);
+
+    for (size_t i = 0; i < a.shape(0); ++i)
+    {
+        for (size_t j = 0; j < a.shape(1); ++j)
+        {
+            CHECK(b(i,j) == a(i,j));
+        }
+    }
+
+    SECTION("tiles are contiguous")
+    {
+        auto t = b.tile(1,1);
+        REQUIRE(t.shape(0) == 2);
+        REQUIRE(t.shape(1) == 4);
+        CHECK(t(0,0) == 24);
+        CHECK(t(1,2) == 36);
+        CHECK(&t(1,0) == &t(0,0) + 4);
+    }
+
+    SECTION("round trip")
+    {
+        ndarray<double,2> c = b.to_ndarray();
+        CHECK(c == a);
+
+        ndarray<double,2,column_major> d = b.to_ndarray<column_major>();
+        CHECK(d(4,6) == 46);
+    }
+
+    SECTION("writes")
+    {
+        b(4,6) = -1;
+        CHECK(b.tile(2,1)(0,2) == -1);
+    }
+}
+
+TEST_CASE("one_based blocked_ndarray tests")
+{
+    blocked_ndarray<int,2,2,one_based> b(3,3,1);
+    b(3,3) = 9;
+    CHECK(b(1,1) == 1);
+    CHECK(b(3,3) == 9);
+    CHECK(b.tile(1,1)(1,1) == 9);
+
+    blocked_ndarray<int,2,2,one_based> c(b);
+    CHECK(c == b);
+    c(1,2) = 0;
+    CHECK(c != b);
+}
@@ -0,0 +1,115 @@
+#include <catch/catch.hpp>
+#include <iostream>
+#include <thread>
+#include "acons/ndarray.hpp"
+#include "acons/buffer_pool.hpp"
+
+using namespace acons;
+
+TEST_CASE("buffer_pool steady state tests")
+{
+    typedef ndarray<float,4,row_major,zero_based,pooled_allocator<float>> array_type;
+
+    buffer_pool pool;
+    pooled_allocator<float> alloc(pool);
+
+    for (size_t iteration = 0; iteration < 10; ++iteration)
+    {
+        array_type a(std::allocator_arg, alloc, 2, 3, 4, 5, 1.0f);
+        array_type b(a);
+        array_type c(std::allocator_arg, alloc, 1, 2, 3, 4, 0.0f);
+        CHECK(b(1,2,3,4) == 1.0f);
+    }
+    buffer_pool_stats s = pool.stats();
+    CHECK(s.system_allocations == 3);
+    CHECK(s.system_deallocations == 0);
+    CHECK(s.pool_hits == 27);
+}
+
+TEST_CASE("buffer_pool alignment tests")
+{
+    buffer_pool pool;
+    void* p = pool.allocate(100, 64);
+    CHECK(reinterpret_cast<std::uintptr_t>(p) % 64 == 0);
+    pool.deallocate(p, 100, 64);
+
+    // Same size, different alignment is a different key
+    void* q = pool.allocate(100, 8);
+    pool.deallocate(q, 100, 8);
+    CHECK(pool.stats().system_allocations == 2);
+
+    CHECK(pool.allocate(100, 64) == p);
+    pool.deallocate(p, 100, 64);
+}
+
+TEST_CASE("buffer_pool high water tests")
+{
+    buffer_pool pool(buffer_pool_options(1000, 0));
+
+    void* p = pool.allocate(600);
+    void* q = pool.allocate(600);
+    pool.deallocate(p, 600);
+    pool.deallocate(q, 600);
+
+    buffer_pool_stats s = pool.stats();
+    CHECK(s.retained_bytes == 600);
+    CHECK(s.system_deallocations == 1);
+
+    pool.trim();
+    s = pool.stats();
+    CHECK(s.retained_bytes == 0);
+    CHECK(s.system_deallocations == 2);
+}
+
+TEST_CASE("buffer_pool thread cache tests")
+{
+    buffer_pool pool(buffer_pool_options(1 << 20, 2));
+
+    std::thread t([&]()
+    {
+        void* p = pool.allocate(64);
+        void* q = pool.allocate(64);
+        void* r = pool.allocate(64);
+        pool.deallocate(p, 64);
+        pool.deallocate(q, 64);
+        pool.deallocate(r, 64);
+        // Two buffers stay in the thread cache until the thread exits
+        CHECK(pool.stats().retained_bytes == 64);
+    });
+    t.join();
+
+    CHECK(pool.stats().retained_bytes == 192);
+    CHECK(pool.stats().system_deallocations == 0);
+}
+
+TEST_CASE("buffer_pool thread cache releases destroyed pools tests")
+{
+    std::thread worker([]()
+    {
+        for (size_t i = 0; i < 10; ++i)
+        {
+            buffer_pool* pool = new buffer_pool();
+            pool->deallocate(pool->allocate(64), 64);
+            // Destroyed on another thread, so this thread's cache still holds a buffer
+            std::thread([pool](){delete pool;}).join();
+        }
+        buffer_pool pool;
+        pool.deallocate(pool.allocate(64), 64);
+        CHECK(detail::buffer_thread_cache::instance()->pool_count() == 1);
+    });
+    worker.join();
+}
+
+TEST_CASE("pooled_allocator tests")
+{
+    buffer_pool pool;
+    pooled_allocator<double> a(pool);
+    pooled_allocator<double> b;
+
+    CHECK(a != b);
+    CHECK(pooled_allocator<int>(a) == a);
+    CHECK(&b.pool() == &buffer_pool::global());
+
+    ndarray<double,2,row_major,zero_based,pooled_allocator<double>> x(3,3,1.0);
+    CHECK(x(2,2) == 1.0);
+}
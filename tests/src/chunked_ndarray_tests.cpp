@@ -0,0 +1,104 @@
+#include <catch/catch.hpp>
+#include <iostream>
+#include "acons/chunked_ndarray.hpp"
+
+using namespace acons;
+
+TEST_CASE("chunked_ndarray lazy allocation tests")
+{
+    chunked_ndarray<double,2> a(extents_t<2>{10,7}, extents_t<2>{4,4}, -1.0);
+
+    REQUIRE(a.chunks_shape()[0] == 3);
+    REQUIRE(a.chunks_shape()[1] == 2);
+    REQUIRE(a.num_chunks() == 6);
+    CHECK(a.allocated_chunks() == 0);
+
+    const auto& ca = a;
+    CHECK(ca(9,6) == -1.0);
+    CHECK(a.allocated_chunks() == 0);
+
+    a(9,6) = 3.0;
+    CHECK(a.allocated_chunks() == 1);
+    CHECK(a.is_allocated(indices_t<2>{2,1}));
+    CHECK(ca(9,6) == 3.0);
+    CHECK(ca(8,4) == -1.0);
+
+    a(0,0) = 1.0;
+    CHECK(a.allocated_chunks() == 2);
+
+    SECTION("edge chunk views are trimmed")
+    {
+        auto v = a.chunk(indices_t<2>{2,1});
+        REQUIRE(v.shape(0) == 2);
+        REQUIRE(v.shape(1) == 3);
+        CHECK(v(1,2) == 3.0);
+        v(0,0) = 5.0;
+        CHECK(ca(8,4) == 5.0);
+    }
+
+    SECTION("chunk-aware iteration")
+    {
+        std::vector<size_t> visited;
+        ca.for_each_chunk([&](const indices_t<2>& ci, const const_ndarray_view<double,2>&)
+        {
+            visited.push_back(ci[0]*10 + ci[1]);
+        });
+        std::vector<size_t> expected = {0,21};
+        CHECK(visited == expected);
+        CHECK_THROWS_AS(ca.chunk(indices_t<2>{1,0}), std::out_of_range);
+    }
+
+    SECTION("release")
+    {
+        a.release_chunk(indices_t<2>{0,0});
+        CHECK(a.allocated_chunks() == 1);
+        CHECK(ca(0,0) == -1.0);
+    }
+
+    SECTION("copy and convert")
+    {
+        chunked_ndarray<double,2> b(a);
+        CHECK(b.allocated_chunks() == 2);
+        b(0,0) = 2.0;
+        CHECK(ca(0,0) == 1.0);
+
+        ndarray<double,2> d = a.to_ndarray();
+        CHECK(d.shape(0) == 10);
+        CHECK(d(0,0) == 1.0);
+        CHECK(d(9,6) == 3.0);
+        CHECK(d(5,5) == -1.0);
+    }
+
+    SECTION("move leaves the source empty")
+    {
+        chunked_ndarray<double,2> b(std::move(a));
+        CHECK(b.allocated_chunks() == 2);
+        CHECK(b(9,6) == 3.0);
+        CHECK(a.shape()[0] == 0);
+        CHECK(a.num_chunks() == 0);
+        CHECK(a.allocated_chunks() == 0);
+        CHECK(a.to_ndarray().size() == 0);
+
+        chunked_ndarray<double,2> c(extents_t<2>{2,2}, extents_t<2>{1,1});
+        c = std::move(b);
+        CHECK(c.allocated_chunks() == 2);
+        CHECK(c.shape()[1] == 7);
+        CHECK(b.num_chunks() == 0);
+        CHECK(b.allocated_chunks() == 0);
+    }
+}
+
+TEST_CASE("one based column major chunked_ndarray tests")
+{
+    chunked_ndarray<int,3,column_major,one_based> a(extents_t<3>{5,5,5}, extents_t<3>{2,2,2});
+    a(5,5,5) = 125;
+    a(1,2,3) = 6;
+    CHECK(a.allocated_chunks() == 2);
+    CHECK(a.chunk(indices_t<3>{2,2,2})(1,1,1) == 125);
+    CHECK(a.chunk_origin(indices_t<3>{0,1,1})[1] == 3);
+
+    auto d = a.to_ndarray();
+    CHECK(d(5,5,5) == 125);
+    CHECK(d(1,2,3) == 6);
+    CHECK(d(2,2,2) == 0);
+}
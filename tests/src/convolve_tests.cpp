@@ -0,0 +1,308 @@
+#include <catch/catch.hpp>
+#include <iostream>
+#include "acons/ndarray.hpp"
+#include "acons/convolve.hpp"
+#include "test_patterns.hpp"
+
+using namespace acons;
+
+namespace {
+
+// Reference convolution straight from the definition, full output index n reads
+// input n - k, the other modes are windows of the full output
+template <size_t N, typename In, typename K>
+ndarray<long,N> naive_convolve(const In& input, const K& kernel, convolve_mode mode)
+{
+    extents_t<N> full_shape;
+    indices_t<N> start;
+    for (size_t i = 0; i < N; ++i)
+    {
+        size_t n = input.shape(i);
+        size_t k = kernel.shape(i);
+        full_shape[i] = n + k - 1;
+        start[i] = mode == convolve_mode::valid ? k - 1 : mode == convolve_mode::same ? (k - 1)/2 : 0;
+    }
+    ndarray<long,N> out(convolve_shape(input.shape(), kernel.shape(), mode), 0L);
+    ndarray<long,N> full(full_shape, 0L);
+
+    size_t full_size = full.size();
+    size_t kernel_size = kernel.size();
+    for (size_t f = 0; f < full_size; ++f)
+    {
+        indices_t<N> fi;
+        size_t rem = f;
+        for (size_t i = N; i-- > 0; )
+        {
+            fi[i] = rem % full_shape[i];
+            rem /= full_shape[i];
+        }
+        long sum = 0;
+        for (size_t q = 0; q < kernel_size; ++q)
+        {
+            indices_t<N> ki;
+            indices_t<N> ii;
+            size_t r = q;
+            bool inside = true;
+            for (size_t i = N; i-- > 0; )
+            {
+                ki[i] = r % kernel.shape(i);
+                r /= kernel.shape(i);
+                if (fi[i] < ki[i] || fi[i] - ki[i] >= input.shape(i))
+                {
+                    inside = false;
+                }
+                ii[i] = fi[i] - ki[i];
+            }
+            if (inside)
+            {
+                sum += input(ii)*kernel(ki);
+            }
+        }
+        full(fi) = sum;
+    }
+
+    for (size_t o = 0; o < out.size(); ++o)
+    {
+        indices_t<N> oi;
+        indices_t<N> fi;
+        size_t rem = o;
+        for (size_t i = N; i-- > 0; )
+        {
+            oi[i] = rem % out.shape(i);
+            rem /= out.shape(i);
+            fi[i] = oi[i] + start[i];
+        }
+        out(oi) = full(fi);
+    }
+    return out;
+}
+
+template <size_t N, typename C>
+bool same_values(const C& c, const ndarray<long,N>& expected)
+{
+    for (size_t o = 0; o < expected.size(); ++o)
+    {
+        indices_t<N> oi;
+        size_t rem = o;
+        for (size_t i = N; i-- > 0; )
+        {
+            oi[i] = rem % expected.shape(i);
+            rem /= expected.shape(i);
+        }
+        if (c(oi) != expected(oi))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+const convolve_mode modes[] = {convolve_mode::valid, convolve_mode::same, convolve_mode::full};
+
+}
+
+TEST_CASE("convolve_shape tests")
+{
+    extents_t<2> input{10,8};
+    extents_t<2> kernel{3,4};
+
+    extents_t<2> valid = convolve_shape(input, kernel, convolve_mode::valid);
+    CHECK(valid[0] == 8);
+    CHECK(valid[1] == 5);
+    extents_t<2> same = convolve_shape(input, kernel, convolve_mode::same);
+    CHECK(same[0] == 10);
+    CHECK(same[1] == 8);
+    extents_t<2> full = convolve_shape(input, kernel, convolve_mode::full);
+    CHECK(full[0] == 12);
+    CHECK(full[1] == 11);
+
+    CHECK_THROWS_AS(convolve_shape(extents_t<1>{2}, extents_t<1>{3}, convolve_mode::valid), std::invalid_argument);
+    CHECK_THROWS_AS(convolve_shape(extents_t<1>{2}, extents_t<1>{0}, convolve_mode::full), std::invalid_argument);
+}
+
+TEST_CASE("convolve 1-D tests")
+{
+    ndarray<double,1> a = {1,2,3};
+    ndarray<double,1> k = {0,1,0.5};
+
+    ndarray<double,1> full(5);
+    convolve(a, k, full, convolve_mode::full);
+    CHECK(full == ndarray<double,1>{0,1,2.5,4,1.5});
+
+    ndarray<double,1> same(3);
+    convolve(a, k, same, convolve_mode::same);
+    CHECK(same == ndarray<double,1>{1,2.5,4});
+
+    ndarray<double,1> valid(1);
+    convolve(a, k, valid);
+    CHECK(valid(0) == 2.5);
+
+    correlate(a, k, valid);
+    CHECK(valid(0) == 3.5);
+}
+
+TEST_CASE("convolve 1-D long signal tests")
+{
+    // Several row segments, computed on several threads
+    ndarray<long,1> a(10000);
+    ndarray<long,1> k(7);
+    fill_pattern(a, 1);
+    fill_pattern(k, 2);
+    for (auto mode : modes)
+    {
+        ndarray<long,1> out(convolve_shape(a.shape(), k.shape(), mode));
+        convolve(a, k, out, mode, 4);
+        CHECK(same_values<1>(out, naive_convolve<1>(a, k, mode)));
+    }
+}
+
+TEST_CASE("convolve 2-D tests")
+{
+    ndarray<long,2> a(23, 31);
+    fill_pattern(a, 3);
+
+    SECTION("odd kernel")
+    {
+        ndarray<long,2> k(3, 5);
+        fill_pattern(k, 4);
+        for (auto mode : modes)
+        {
+            ndarray<long,2> out(convolve_shape(a.shape(), k.shape(), mode));
+            convolve(a, k, out, mode);
+            CHECK(same_values<2>(out, naive_convolve<2>(a, k, mode)));
+        }
+    }
+
+    SECTION("even kernel")
+    {
+        ndarray<long,2> k(4, 2);
+        fill_pattern(k, 5);
+        for (auto mode : modes)
+        {
+            ndarray<long,2> out(convolve_shape(a.shape(), k.shape(), mode));
+            convolve(a, k, out, mode);
+            CHECK(same_values<2>(out, naive_convolve<2>(a, k, mode)));
+        }
+    }
+
+    SECTION("correlate is convolve with a reversed kernel")
+    {
+        ndarray<long,2> k = {{1,2},{3,4}};
+        ndarray<long,2> reversed = {{4,3},{2,1}};
+        ndarray<long,2> c(23, 31);
+        ndarray<long,2> expected(23, 31);
+        correlate(a, k, c, convolve_mode::same);
+        convolve(a, reversed, expected, convolve_mode::same);
+        CHECK(c == expected);
+    }
+}
+
+TEST_CASE("convolve column major and strided view tests")
+{
+    ndarray<long,2,column_major> a(40, 30);
+    fill_pattern(a, 6);
+    ndarray<long,2> k(3, 3);
+    fill_pattern(k, 7);
+
+    const_ndarray_view<long,2,column_major> av(a, {slice(0,40,2),slice(3,27)});
+    ndarray<long,2,column_major> out(22, 50, -1L);
+    ndarray_view<long,2,column_major> ov(out, {slice(1,21),slice(0,48,2)});
+
+    ndarray<long,2> input_copy(20, 24);
+    for (size_t i = 0; i < 20; ++i)
+    {
+        for (size_t j = 0; j < 24; ++j)
+        {
+            input_copy(i,j) = av(i,j);
+        }
+    }
+
+    convolve(av, ndarray_view<long,2>(k), ov, convolve_mode::same, 2);
+    CHECK(same_values<2>(ov, naive_convolve<2>(input_copy, k, convolve_mode::same)));
+    CHECK(out(0,0) == -1);
+    CHECK(out(1,1) == -1);
+}
+
+TEST_CASE("convolve 3-D tests")
+{
+    ndarray<long,3> a(9, 10, 11);
+    ndarray<long,3> k(3, 2, 3);
+    fill_pattern(a, 8);
+    fill_pattern(k, 9);
+    for (auto mode : modes)
+    {
+        ndarray<long,3> out(convolve_shape(a.shape(), k.shape(), mode));
+        convolve(a, k, out, mode);
+        CHECK(same_values<3>(out, naive_convolve<3>(a, k, mode)));
+    }
+}
+
+TEST_CASE("convolve filter bank tests")
+{
+    ndarray<long,2> a(20, 70);
+    fill_pattern(a, 10);
+
+    // Small banks take the direct path, larger ones im2col
+    for (size_t filters : {size_t(2), size_t(6)})
+    {
+        ndarray<long,3> kernels(filters, 3, 4);
+        fill_pattern(kernels, 11);
+        for (auto mode : modes)
+        {
+            extents_t<2> shape = convolve_shape(a.shape(), extents_t<2>{3,4}, mode);
+            ndarray<long,3> out(filters, shape[0], shape[1]);
+            convolve(a, kernels, out, mode, 3);
+            for (size_t f = 0; f < filters; ++f)
+            {
+                const_ndarray_view<long,2> kf(kernels, indices_t<1>{f});
+                const_ndarray_view<long,2> of(out, indices_t<1>{f});
+                CHECK(same_values<2>(of, naive_convolve<2>(a, kf, mode)));
+            }
+        }
+    }
+}
+
+TEST_CASE("convolve_separable tests")
+{
+    ndarray<long,2> a(17, 25);
+    fill_pattern(a, 12);
+    ndarray<long,1> ky = {1,2,1};
+    ndarray<long,1> kx = {1,0,-1,2};
+    ndarray<long,2> k(3, 4);
+    for (size_t i = 0; i < 3; ++i)
+    {
+        for (size_t j = 0; j < 4; ++j)
+        {
+            k(i,j) = ky(i)*kx(j);
+        }
+    }
+
+    for (auto mode : modes)
+    {
+        ndarray<long,2> out(convolve_shape(a.shape(), k.shape(), mode));
+        convolve_separable(a, std::array<ndarray<long,1>,2>{{ky, kx}}, out, mode);
+        CHECK(same_values<2>(out, naive_convolve<2>(a, k, mode)));
+    }
+
+    ndarray<long,3> v(6, 7, 8);
+    fill_pattern(v, 13);
+    ndarray<long,3> expected(6, 7, 8);
+    ndarray<long,3> k3(3, 3, 3);
+    for (size_t i = 0; i < 27; ++i)
+    {
+        k3.data()[i] = ky(i/9)*ky((i/3) % 3)*ky(i % 3);
+    }
+    convolve(v, k3, expected, convolve_mode::same);
+    ndarray<long,3> out(6, 7, 8);
+    convolve_separable(v, std::array<ndarray<long,1>,3>{{ky, ky, ky}}, out, convolve_mode::same);
+    CHECK(out == expected);
+}
+
+TEST_CASE("convolve shape mismatch tests")
+{
+    ndarray<double,2> a(5, 5);
+    ndarray<double,2> k(3, 3);
+    ndarray<double,2> out(5, 5);
+    CHECK_THROWS_AS(convolve(a, k, out, convolve_mode::valid), std::invalid_argument);
+    CHECK_THROWS_AS(convolve(k, a, out, convolve_mode::valid), std::invalid_argument);
+}
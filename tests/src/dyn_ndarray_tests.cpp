@@ -0,0 +1,121 @@
+#include <catch/catch.hpp>
+#include <iostream>
+#include "acons/dyn_ndarray.hpp"
+
+using namespace acons;
+
+namespace {
+
+struct sum_kernel
+{
+    template <typename View>
+    double operator()(const View& v) const
+    {
+        double sum = 0;
+        const double* p = v.data();
+        for (size_t i = 0; i < v.size(); ++i)
+        {
+            sum += p[i];
+        }
+        return sum;
+    }
+};
+
+struct rank_kernel
+{
+    template <typename T, size_t N, typename Order, typename Base>
+    size_t operator()(const ndarray_view<T,N,Order,Base>&) const
+    {
+        return N;
+    }
+};
+
+}
+
+TEST_CASE("dyn_ndarray construction tests")
+{
+    dyn_ndarray<double> a(dyn_extents_t{2,3,4}, 1.0);
+
+    REQUIRE(a.rank() == 3);
+    REQUIRE(a.size() == 24);
+    CHECK(a.shape(0) == 2);
+    CHECK(a.strides()[0] == 12);
+    CHECK(a.strides()[2] == 1);
+
+    a(1,2,3) = 5.0;
+    CHECK(a(dyn_indices_t{1,2,3}) == 5.0);
+    CHECK(a.data()[23] == 5.0);
+}
+
+TEST_CASE("dyn_ndarray high rank uses heap storage for shape")
+{
+    dyn_extents_t shape(10, 2);
+    dyn_ndarray<int> a(shape, 0);
+    REQUIRE(a.rank() == 10);
+    REQUIRE(a.size() == 1024);
+    a(1,1,1,1,1,1,1,1,1,1) = 7;
+    CHECK(a.data()[1023] == 7);
+
+    dyn_ndarray<int> b(a);
+    CHECK(b == a);
+}
+
+TEST_CASE("dyn_ndarray conversion tests")
+{
+    ndarray<double,2> a = {{0,1,2},{3,4,5}};
+
+    SECTION("from static")
+    {
+        dyn_ndarray<double> b(a);
+        REQUIRE(b.rank() == 2);
+        CHECK(b(1,2) == 5);
+
+        ndarray<double,2> c = b.to_ndarray<2>();
+        CHECK(c == a);
+    }
+
+    SECTION("as_static")
+    {
+        dyn_ndarray<double> b(a);
+        ndarray_view<double,2> v = b.as_static<2>();
+        v(0,1) = 10;
+        CHECK(b(0,1) == 10);
+        CHECK_THROWS_AS(b.as_static<3>(), std::invalid_argument);
+    }
+
+    SECTION("views over sliced static views")
+    {
+        ndarray_view<double,2> v(a, {slice(1,2),slice(1,3)});
+        dyn_ndarray_view<double> dv(v);
+        REQUIRE(dv.rank() == 2);
+        CHECK(dv(0,0) == 4);
+        CHECK(dv(0,1) == 5);
+        dv(0,0) = 40;
+        CHECK(a(1,1) == 40);
+
+        ndarray_view<double,2> sv = dv.as_static<2>();
+        CHECK(sv(0,1) == 5);
+
+        dyn_ndarray<double> copy(dv);
+        CHECK(copy.size() == 2);
+        CHECK(copy(0,1) == 5);
+    }
+
+    SECTION("column_major")
+    {
+        ndarray<double,2,column_major> b = {{0,1,2},{3,4,5}};
+        dyn_ndarray<double,column_major> c(b);
+        CHECK(c.strides()[0] == 1);
+        CHECK(c(1,0) == 3);
+        const_dyn_ndarray_view<double,column_major> v(c);
+        CHECK(v.as_static<2>()(1,2) == 5);
+    }
+}
+
+TEST_CASE("dispatch_rank tests")
+{
+    dyn_ndarray<double> a(dyn_extents_t{2,2,2}, 1.0);
+    CHECK(dispatch_rank(a, sum_kernel()) == 8.0);
+    CHECK(dispatch_rank<4>(a, rank_kernel()) == 3);
+    CHECK_THROWS_AS(dispatch_rank<2>(a, rank_kernel()), std::invalid_argument);
+}
@@ -0,0 +1,237 @@
+#include <catch/catch.hpp>
+#include <iostream>
+#include <sstream>
+#include "acons/ndarray.hpp"
+#include "acons/float16.hpp"
+#include "acons/linalg.hpp"
+#include "acons/scan.hpp"
+#include "acons/mask.hpp"
+
+using namespace acons;
+
+TEST_CASE("float16 conversion tests")
+{
+    CHECK(float16(1.0f).bits() == 0x3c00);
+    CHECK(float16(-2.0f).bits() == 0xc000);
+    CHECK(float16(65504.0f).bits() == 0x7bff);
+    CHECK(float16(0.0f).bits() == 0);
+    CHECK(float16(-0.0f).bits() == 0x8000);
+
+    // Ties round to even
+    CHECK(float16(1.0f + 1.0f/2048).bits() == 0x3c00);
+    CHECK(float16(1.0f + 3.0f/2048).bits() == 0x3c02);
+
+    // Overflow, infinity and NaN
+    CHECK(float16(65520.0f).bits() == 0x7c00);
+    CHECK(isinf(float16(1e10f)));
+    CHECK(isnan(float16(std::numeric_limits<float>::quiet_NaN())));
+    CHECK(float16(-std::numeric_limits<float>::infinity()).bits() == 0xfc00);
+
+    // Subnormals
+    CHECK(float16(std::ldexp(1.0f, -24)).bits() == 0x0001);
+    CHECK(float16(std::ldexp(1.0f, -14)).bits() == 0x0400);
+    CHECK(static_cast<float>(float16::from_bits(0x0001)) == std::ldexp(1.0f, -24));
+    CHECK(static_cast<float>(float16::from_bits(0x03ff)) == std::ldexp(1023.0f, -24));
+
+    // Every half survives a round trip through float
+    bool ok = true;
+    for (uint32_t b = 0; b < 0x10000; ++b)
+    {
+        float16 h = float16::from_bits(static_cast<uint16_t>(b));
+        float f = static_cast<float>(h);
+        ok = ok && (isnan(h) ? std::isnan(f) : float16(f).bits() == b);
+        ok = ok && (std::isnan(f) || detail::half_bits_to_float(static_cast<uint16_t>(b)) == f);
+    }
+    CHECK(ok);
+    // The bulk conversions agree with the scalar ones on every half
+    ndarray<float16,1> all(65536);
+    for (size_t b = 0; b < 65536; ++b)
+    {
+        all(b) = float16::from_bits(static_cast<uint16_t>(b));
+    }
+    auto widened = astype<float>(all);
+    auto narrowed = astype<float16>(widened);
+    ok = true;
+    for (size_t b = 0; b < 65536; ++b)
+    {
+        float f = static_cast<float>(all(b));
+        ok = ok && (std::isnan(f) ? std::isnan(widened(b)) && isnan(narrowed(b))
+                                  : widened(b) == f && narrowed(b).bits() == b);
+    }
+    CHECK(ok);
+}
+
+TEST_CASE("bfloat16 conversion tests")
+{
+    CHECK(bfloat16(1.0f).bits() == 0x3f80);
+    CHECK(bfloat16(-3.0f).bits() == 0xc040);
+    // 1 + 2^-8 is halfway between 1 and 1 + 2^-7, and rounds to even
+    CHECK(bfloat16(1.0f + 1.0f/256).bits() == 0x3f80);
+    CHECK(bfloat16(1.0f + 3.0f/256).bits() == 0x3f82);
+    CHECK(isnan(bfloat16(std::numeric_limits<float>::quiet_NaN())));
+    CHECK(isinf(bfloat16(std::numeric_limits<float>::infinity())));
+    CHECK(static_cast<float>(std::numeric_limits<bfloat16>::max()) == std::ldexp(255.0f, 120));
+    CHECK(static_cast<float>(std::numeric_limits<float16>::max()) == 65504.0f);
+    CHECK(static_cast<float>(std::numeric_limits<float16>::epsilon()) == std::ldexp(1.0f, -10));
+    CHECK(static_cast<float>(std::numeric_limits<bfloat16>::epsilon()) == std::ldexp(1.0f, -7));
+}
+
+TEST_CASE("float16 arithmetic tests")
+{
+    float16 a = 1.5f;
+    float16 b = 2;
+    CHECK(a + b == 3.5f);
+    CHECK(a*b == 3);
+    CHECK(b - a == 0.5);
+    CHECK(a/b == 0.75f);
+    CHECK(-a == -1.5f);
+    CHECK(abs(-a) == a);
+    CHECK(a < b);
+    CHECK(b >= a);
+    a += 1;
+    CHECK(a == 2.5f);
+    CHECK(float16(2048) + float16(1) == 2048);
+
+    bfloat16 c = 3;
+    c *= 2;
+    CHECK(c == 6);
+
+    std::ostringstream os;
+    os << a << " " << c;
+    CHECK(os.str() == "2.5 6");
+
+    std::istringstream is("0.25");
+    float16 d;
+    is >> d;
+    CHECK(d == 0.25f);
+}
+
+TEST_CASE("float16 ndarray tests")
+{
+    ndarray<float16,2> a = {{1,2,3},{4,5,6}};
+    ndarray<float16,2> zeros(2, 3, 0);
+    CHECK(zeros(1,2) == 0);
+    CHECK(a(1,2) == 6);
+    CHECK(a == ndarray<float16,2>{{1,2,3},{4,5,6}});
+
+    std::ostringstream os;
+    os << a;
+    CHECK(os.str() == "[[1,2,3],[4,5,6]]");
+
+    ndarray_view<float16,2> v(a, {slice(0,2),slice(1,3)});
+    v(0,0) += 0.5f;
+    CHECK(a(0,1) == 2.5f);
+
+    auto sums = cumsum(a, 1);
+    CHECK(sums == ndarray<float16,2>{{1,3.5,6.5},{4,9,15}});
+
+    ndarray<bool,2> mask = {{true,false,true},{false,false,true}};
+    CHECK(where(mask, a, float16(0)) == ndarray<float16,2>{{1,0,3},{0,0,6}});
+    CHECK(where(mask, a, 0) == ndarray<float16,2>{{1,0,3},{0,0,6}});
+    putmask(a, mask, bfloat16(-1));
+    CHECK(a(0,0) == -1);
+}
+
+TEST_CASE("float16 astype tests")
+{
+    ndarray<float,3> f(3, 5, 37);
+    for (size_t i = 0; i < f.size(); ++i)
+    {
+        f.data()[i] = static_cast<float>(i)*0.37f - 100.0f;
+    }
+
+    auto h = astype<float16>(f);
+    auto b = astype<bfloat16>(f, 2);
+    bool ok = true;
+    for (size_t i = 0; i < f.size(); ++i)
+    {
+        ok = ok && h.data()[i].bits() == float16(f.data()[i]).bits() &&
+             b.data()[i].bits() == bfloat16(f.data()[i]).bits();
+    }
+    CHECK(ok);
+
+    // Ties, subnormals, overflow and NaN through the bulk conversions
+    ndarray<float,1> edges = {1.0f + 1.0f/2048, 1.0f + 3.0f/2048, std::ldexp(1.0f, -25), std::ldexp(3.0f, -25),
+                              std::ldexp(1.0f, -20), -std::ldexp(5.0f, -17), 65519.0f, 65520.0f, -1e9f,
+                              std::numeric_limits<float>::quiet_NaN(), 0.0f, -0.0f};
+    auto edges16 = astype<float16>(edges);
+    auto edges_bf = astype<bfloat16>(edges);
+    for (size_t i = 0; i < edges.size(); ++i)
+    {
+        CHECK(edges16(i).bits() == detail::float_to_half_bits(edges(i)));
+        CHECK(edges_bf(i).bits() == detail::float_to_bfloat16_bits(edges(i)));
+    }
+
+    auto back = astype<float>(h);
+    CHECK(astype<float16>(back) == h);
+
+    // Strided and mixed order operands
+    ndarray<float16,3,column_major> cm(3, 5, 37);
+    astype(f, cm);
+    const_ndarray_view<float16,3,column_major> part(cm, {slice(0,3,2),slice(1,4),slice(0,37,3)});
+    auto widened = astype<double>(part);
+    ok = true;
+    for (size_t i = 0; i < 2; ++i)
+    {
+        for (size_t j = 0; j < 3; ++j)
+        {
+            for (size_t k = 0; k < 13; ++k)
+            {
+                ok = ok && widened(i,j,k) == static_cast<float>(h(2*i,j+1,3*k));
+            }
+        }
+    }
+    CHECK(ok);
+
+    // Large enough to be split across threads
+    ndarray<float,2> big(600, 300);
+    for (size_t i = 0; i < big.size(); ++i)
+    {
+        big.data()[i] = static_cast<float>(i % 1000)/8;
+    }
+    auto big16 = astype<float16>(big, 4);
+    ndarray<float,2> big32(600, 300);
+    astype(big16, big32, 4);
+    CHECK(big32 == big);
+
+    ndarray<float,3> wrong(3, 5, 36);
+    CHECK_THROWS_AS(astype(h, wrong), std::invalid_argument);
+}
+
+TEST_CASE("float16 matmul tests")
+{
+    const size_t m = 37, k = 300, n = 19;
+    ndarray<float16,2> a(m, k);
+    ndarray<float16,2> b(k, n);
+    ndarray<float,2> af(m, k);
+    ndarray<float,2> bf(k, n);
+    for (size_t i = 0; i < m; ++i)
+    {
+        for (size_t p = 0; p < k; ++p)
+        {
+            a(i,p) = static_cast<float>((i*7 + p*3) % 11)/4 - 1;
+            af(i,p) = static_cast<float>(a(i,p));
+        }
+    }
+    for (size_t p = 0; p < k; ++p)
+    {
+        for (size_t j = 0; j < n; ++j)
+        {
+            b(p,j) = static_cast<float>((p*5 + j) % 7)/2 - 1.5f;
+            bf(p,j) = static_cast<float>(b(p,j));
+        }
+    }
+    auto c = matmul(a, b);
+    auto cf = matmul(af, bf);
+    // Products are summed in float and rounded once per block of k
+    bool ok = true;
+    for (size_t i = 0; i < m; ++i)
+    {
+        for (size_t j = 0; j < n; ++j)
+        {
+            float expected = cf(i,j);
+            ok = ok && std::abs(static_cast<float>(c(i,j)) - expected) <= std::abs(expected)*2e-3f + 1e-3f;
+        }
+    }
+    CHECK(ok);
+}
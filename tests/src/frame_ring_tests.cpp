@@ -0,0 +1,176 @@
+#include <catch/catch.hpp>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "acons/ndarray.hpp"
+#include "acons/frame_ring.hpp"
+
+using namespace acons;
+
+TEST_CASE("spsc_frame_ring single thread tests")
+{
+    spsc_frame_ring<uint16_t,2> ring(2, extents_t<2>{3,4});
+    CHECK(ring.capacity() == 2);
+    CHECK(ring.storage().shape(0) == 2);
+    CHECK_FALSE(ring.read_available());
+
+    REQUIRE(ring.write_available());
+    ndarray_view<uint16_t,2> frame = ring.write_frame();
+    CHECK(frame.shape(0) == 3);
+    CHECK(frame.shape(1) == 4);
+    frame(2,3) = 7;
+    ring.publish();
+
+    CHECK(ring.try_push([](ndarray_view<uint16_t,2>& f) {f(0,0) = 8;}));
+    CHECK_FALSE(ring.write_available());
+    CHECK_FALSE(ring.try_push([](ndarray_view<uint16_t,2>&) {}));
+    CHECK(ring.size() == 2);
+
+    REQUIRE(ring.read_available());
+    const_ndarray_view<uint16_t,2> r = ring.read_frame();
+    CHECK(r(2,3) == 7);
+    ring.release();
+
+    uint16_t value = 0;
+    CHECK(ring.try_pop([&](const const_ndarray_view<uint16_t,2>& f) {value = f(0,0);}));
+    CHECK(value == 8);
+    CHECK_FALSE(ring.try_pop([](const const_ndarray_view<uint16_t,2>&) {}));
+
+    // Wraps around
+    CHECK(ring.try_push([](ndarray_view<uint16_t,2>& f) {f(1,1) = 9;}));
+    CHECK(ring.try_pop([&](const const_ndarray_view<uint16_t,2>& f) {value = f(1,1);}));
+    CHECK(value == 9);
+}
+
+TEST_CASE("spsc_frame_ring threaded tests")
+{
+    const size_t frames = 10000;
+    spsc_frame_ring<uint32_t,1> ring(8, extents_t<1>{16});
+
+    std::thread producer([&]()
+    {
+        for (size_t i = 0; i < frames; )
+        {
+            if (ring.try_push([&](ndarray_view<uint32_t,1>& f)
+                {
+                    for (size_t j = 0; j < f.shape(0); ++j)
+                    {
+                        f(j) = static_cast<uint32_t>(i + j);
+                    }
+                }))
+            {
+                ++i;
+            }
+        }
+    });
+
+    size_t received = 0;
+    bool in_order = true;
+    while (received < frames)
+    {
+        ring.try_pop([&](const const_ndarray_view<uint32_t,1>& f)
+        {
+            in_order = in_order && f(0) == received && f(15) == received + 15;
+            ++received;
+        });
+    }
+    producer.join();
+    CHECK(in_order);
+    CHECK(ring.size() == 0);
+}
+
+TEST_CASE("mpmc_frame_ring tests")
+{
+    SECTION("single thread")
+    {
+        mpmc_frame_ring<int,2> ring(2, extents_t<2>{2,2});
+        CHECK(ring.try_push([](ndarray_view<int,2>& f) {f(1,1) = 1;}));
+        CHECK(ring.try_push([](ndarray_view<int,2>& f) {f(1,1) = 2;}));
+        CHECK_FALSE(ring.try_push([](ndarray_view<int,2>&) {}));
+
+        int value = 0;
+        CHECK(ring.try_pop([&](const const_ndarray_view<int,2>& f) {value = f(1,1);}));
+        CHECK(value == 1);
+        CHECK(ring.try_pop([&](const const_ndarray_view<int,2>& f) {value = f(1,1);}));
+        CHECK(value == 2);
+        CHECK_FALSE(ring.try_pop([](const const_ndarray_view<int,2>&) {}));
+    }
+    SECTION("throwing callbacks")
+    {
+        mpmc_frame_ring<int,1> ring(2, extents_t<1>{1});
+        CHECK_THROWS_AS(ring.try_push([](ndarray_view<int,1>&) {throw std::runtime_error("fill");}), std::runtime_error);
+        CHECK(ring.try_push([](ndarray_view<int,1>& f) {f(0) = 1;}));
+        CHECK_FALSE(ring.try_push([](ndarray_view<int,1>&) {}));
+
+        // The empty frame is skipped
+        int value = 0;
+        CHECK(ring.try_pop([&](const const_ndarray_view<int,1>& f) {value = f(0);}));
+        CHECK(value == 1);
+        CHECK_FALSE(ring.try_pop([](const const_ndarray_view<int,1>&) {}));
+
+        CHECK(ring.try_push([](ndarray_view<int,1>& f) {f(0) = 2;}));
+        CHECK(ring.try_push([](ndarray_view<int,1>& f) {f(0) = 3;}));
+        CHECK_THROWS_AS(ring.try_pop([](const const_ndarray_view<int,1>&) {throw std::runtime_error("consume");}), std::runtime_error);
+        CHECK(ring.try_pop([&](const const_ndarray_view<int,1>& f) {value = f(0);}));
+        CHECK(value == 3);
+
+        // Both frames were released
+        CHECK(ring.try_push([](ndarray_view<int,1>&) {}));
+        CHECK(ring.try_push([](ndarray_view<int,1>&) {}));
+    }
+    SECTION("threads")
+    {
+        const size_t producers = 3;
+        const size_t consumers = 3;
+        const size_t per_producer = 3000;
+        mpmc_frame_ring<size_t,1> ring(16, extents_t<1>{4});
+
+        std::vector<std::atomic<int>> seen(producers*per_producer);
+        for (auto& s : seen)
+        {
+            s = 0;
+        }
+        std::atomic<size_t> consumed(0);
+
+        std::vector<std::thread> threads;
+        for (size_t p = 0; p < producers; ++p)
+        {
+            threads.emplace_back([&,p]()
+            {
+                for (size_t i = 0; i < per_producer; )
+                {
+                    size_t id = p*per_producer + i;
+                    if (ring.try_push([&](ndarray_view<size_t,1>& f) {f(0) = id; f(3) = id;}))
+                    {
+                        ++i;
+                    }
+                }
+            });
+        }
+        std::atomic<bool> inconsistent(false);
+        for (size_t c = 0; c < consumers; ++c)
+        {
+            threads.emplace_back([&]()
+            {
+                while (consumed.load() < producers*per_producer)
+                {
+                    ring.try_pop([&](const const_ndarray_view<size_t,1>& f)
+                    {
+                        if (f(0) != f(3))
+                        {
+                            inconsistent = true;
+                        }
+                        ++seen[f(0)];
+                        ++consumed;
+                    });
+                }
+            });
+        }
+        for (auto& t : threads)
+        {
+            t.join();
+        }
+        CHECK_FALSE(inconsistent.load());
+        CHECK(std::count_if(seen.begin(), seen.end(), [](const std::atomic<int>& s) {return s.load() == 1;}) == long(seen.size()));
+    }
+}
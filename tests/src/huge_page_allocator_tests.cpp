@@ -0,0 +1,152 @@
+#include <catch/catch.hpp>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <sched.h>
+#include "acons/ndarray.hpp"
+#include "acons/huge_page_allocator.hpp"
+
+using namespace acons;
+
+TEST_CASE("parallel_for tests")
+{
+    std::vector<int> hits(1000, 0);
+    detail::parallel_for(hits.size(), [&](size_t first, size_t last)
+    {
+        for (size_t i = first; i < last; ++i)
+        {
+            ++hits[i];
+        }
+    }, 4, 7);
+    CHECK(std::count(hits.begin(), hits.end(), 1) == 1000);
+
+    std::mutex m;
+    std::set<std::pair<size_t,size_t>> ranges;
+    detail::parallel_for(10, [&](size_t first, size_t last)
+    {
+        std::lock_guard<std::mutex> lock(m);
+        ranges.insert(std::make_pair(first, last));
+    }, 3, 4);
+    // 3 grains of 4, 4, 2 elements
+    CHECK(ranges.size() == 3);
+    CHECK(ranges.count(std::make_pair(size_t(8), size_t(10))) == 1);
+
+    CHECK_THROWS_AS(detail::parallel_for(100, [](size_t first, size_t)
+    {
+        if (first > 0)
+        {
+            throw std::runtime_error("failed");
+        }
+    }, 2), std::runtime_error);
+}
+
+TEST_CASE("parallel_for_pinned tests")
+{
+    std::vector<int> cpus = spread_cpus(3);
+    REQUIRE(!cpus.empty());
+    CHECK(cpus.size() <= 3);
+
+    std::mutex m;
+    std::vector<std::pair<size_t,int>> runs;
+    parallel_for_pinned(10, [&](size_t first, size_t)
+    {
+        std::lock_guard<std::mutex> lock(m);
+        runs.push_back(std::make_pair(first, sched_getcpu()));
+    }, cpus);
+    REQUIRE(runs.size() == cpus.size());
+    for (size_t t = 0; t < cpus.size(); ++t)
+    {
+        size_t first, last;
+        detail::partition_range(10, 1, cpus.size(), t, first, last);
+        auto it = std::find_if(runs.begin(), runs.end(), 
+                               [&](const std::pair<size_t,int>& r){return r.first == first;});
+        REQUIRE(it != runs.end());
+        CHECK(it->second == cpus[t]);
+    }
+
+    size_t count = 0;
+    parallel_for_pinned(5, [&](size_t first, size_t last){count += last - first;}, std::vector<int>());
+    CHECK(count == 5);
+}
+
+TEST_CASE("huge_page_allocator tests")
+{
+    const size_t n = 1024;
+
+    SECTION("standard pages, small")
+    {
+        huge_page_allocator<double> alloc(page_policy::standard);
+        ndarray<double,2,row_major,zero_based,huge_page_allocator<double>> a(std::allocator_arg, alloc, 4, 4, 1.0);
+        CHECK(a(3,3) == 1.0);
+    }
+    SECTION("transparent huge pages")
+    {
+        huge_page_allocator<double> alloc(page_policy::transparent);
+        ndarray<double,2,row_major,zero_based,huge_page_allocator<double>> a(std::allocator_arg, alloc, n, n, 2.0);
+        CHECK(reinterpret_cast<std::uintptr_t>(a.data()) % (size_t(2) << 20) == 0);
+        CHECK(a(n-1,n-1) == 2.0);
+    }
+    SECTION("explicit huge page size")
+    {
+        CHECK(detail::hugetlb_page_size() >= 4096);
+        CHECK((detail::hugetlb_page_size() & (detail::hugetlb_page_size() - 1)) == 0);
+    }
+    SECTION("explicit huge pages fall back")
+    {
+        huge_page_allocator<double> alloc(page_policy::explicit_huge, numa_policy::interleave);
+        ndarray<double,2,row_major,zero_based,huge_page_allocator<double>> a(std::allocator_arg, alloc, n, n+3, 3.0);
+        CHECK(a(n-1,n+2) == 3.0);
+        a.resize(extents_t<2>{n+1,n+3});
+        CHECK(a(n-1,n+2) == 3.0);
+        CHECK(a(n,0) == 0.0);
+    }
+}
+
+TEST_CASE("huge_page_allocator equality tests")
+{
+    typedef huge_page_allocator<float> allocator_type;
+    allocator_type a(page_policy::transparent, numa_policy::interleave);
+    CHECK(a == allocator_type(page_policy::transparent, numa_policy::interleave));
+    CHECK(a == huge_page_allocator<double>(a));
+    CHECK(a != allocator_type(page_policy::standard, numa_policy::interleave));
+    CHECK(a != allocator_type(page_policy::transparent, numa_policy::local));
+    CHECK(allocator_type(page_policy::transparent, numa_policy::first_touch, 2) != 
+          allocator_type(page_policy::transparent, numa_policy::first_touch, 3));
+
+    allocator_type p(page_policy::transparent, numa_policy::first_touch, std::vector<int>{0});
+    CHECK(p == allocator_type(page_policy::transparent, numa_policy::first_touch, std::vector<int>{0}));
+    CHECK(p != allocator_type(page_policy::transparent, numa_policy::first_touch, std::vector<int>{1}));
+    CHECK(p != allocator_type(page_policy::transparent, numa_policy::first_touch, 1));
+}
+
+TEST_CASE("huge_page_allocator first touch tests")
+{
+    typedef huge_page_allocator<float> allocator_type;
+    allocator_type alloc(page_policy::transparent, numa_policy::first_touch, 4);
+
+    SECTION("row major")
+    {
+        ndarray<float,3,row_major,zero_based,allocator_type> a(std::allocator_arg, alloc, 7, 256, 300, 5.0f);
+        CHECK(std::count(a.data(), a.data() + a.size(), 5.0f) == long(a.size()));
+    }
+    SECTION("column major")
+    {
+        ndarray<float,2,column_major,zero_based,allocator_type> a(std::allocator_arg, alloc, 1000, 301, 6.0f);
+        CHECK(std::count(a.data(), a.data() + a.size(), 6.0f) == long(a.size()));
+    }
+    SECTION("cpus")
+    {
+        std::vector<int> cpus = spread_cpus(2);
+        allocator_type pinned(page_policy::transparent, numa_policy::first_touch, cpus);
+        CHECK(pinned.cpus() == cpus);
+        CHECK(pinned.threads() == cpus.size());
+        ndarray<float,2,row_major,zero_based,allocator_type> a(std::allocator_arg, pinned, 1000, 513, 7.0f);
+        CHECK(std::count(a.data(), a.data() + a.size(), 7.0f) == long(a.size()));
+    }
+    SECTION("extents")
+    {
+        ndarray<float,2,row_major,zero_based,allocator_type> a(std::allocator_arg, alloc, extents_t<2>{513,1024});
+        CHECK(std::count(a.data(), a.data() + a.size(), 0.0f) == long(a.size()));
+    }
+}
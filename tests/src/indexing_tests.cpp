@@ -0,0 +1,191 @@
+#include <catch/catch.hpp>
+#include <iostream>
+#include <vector>
+#include "acons/ndarray.hpp"
+#include "acons/indexing.hpp"
+#include "test_patterns.hpp"
+
+using namespace acons;
+
+TEST_CASE("take rows tests")
+{
+    ndarray<float,2> table = {{0,1,2},{10,11,12},{20,21,22},{30,31,32}};
+
+    ndarray<size_t,1> idx = {3,0,3};
+    auto rows = take(table, idx);
+    CHECK(rows == ndarray<float,2>{{30,31,32},{0,1,2},{30,31,32}});
+
+    std::vector<int> columns = {2,0};
+    auto cols = take(table, columns, 1);
+    CHECK(cols == ndarray<float,2>{{2,0},{12,10},{22,20},{32,30}});
+
+    ndarray<float,2> out(3,3);
+    take(table, idx, out);
+    CHECK(out == rows);
+
+    SECTION("errors")
+    {
+        CHECK_THROWS_AS(take(table, std::vector<size_t>{4}), std::out_of_range);
+        CHECK_THROWS_AS(take(table, std::vector<int>{-1}), std::out_of_range);
+        CHECK_THROWS_AS(take(table, idx, 2), std::out_of_range);
+        ndarray<float,2> wrong(2,3);
+        CHECK_THROWS_AS(take(table, idx, wrong), std::invalid_argument);
+    }
+
+    SECTION("one based")
+    {
+        ndarray<float,1,row_major,one_based> v = {5,6,7};
+        auto t = take(v, std::vector<size_t>{3,1});
+        CHECK(t(1) == 7);
+        CHECK(t(2) == 5);
+    }
+}
+
+TEST_CASE("take 3-D all axes tests")
+{
+    ndarray<long,3> a(4, 5, 6);
+    fill_pattern(a, 1, 101, 0);
+    ndarray<long,3,column_major> c(4, 5, 6);
+    fill_pattern(c, 2, 101, 0);
+    std::vector<size_t> idx = {1,3,0,1};
+
+    for (size_t axis = 0; axis < 3; ++axis)
+    {
+        auto t = take(a, idx, axis);
+        auto tc = take(c, idx, axis);
+        bool ok = true;
+        for (size_t i = 0; i < t.shape(0); ++i)
+        {
+            for (size_t j = 0; j < t.shape(1); ++j)
+            {
+                for (size_t k = 0; k < t.shape(2); ++k)
+                {
+                    indices_t<3> index{i,j,k};
+                    index[axis] = idx[index[axis]];
+                    ok = ok && t(i,j,k) == a(index) && tc(i,j,k) == c(index);
+                }
+            }
+        }
+        CHECK(ok);
+    }
+}
+
+TEST_CASE("take view tests")
+{
+    ndarray<int,2> a(6, 8);
+    fill_pattern(a, 3, 101, 0);
+    const_ndarray_view<int,2> v(a, {slice(1,6),slice(0,8,2)});
+    auto t = take(v, std::vector<size_t>{4,0});
+    CHECK(t.shape(0) == 2);
+    CHECK(t.shape(1) == 4);
+    for (size_t j = 0; j < 4; ++j)
+    {
+        CHECK(t(0,j) == a(5,2*j));
+        CHECK(t(1,j) == a(1,2*j));
+    }
+
+    ndarray<int,2> big(4, 10, 0);
+    ndarray_view<int,2> out(big, {slice(0,2),slice(3,7)});
+    take(v, std::vector<size_t>{4,0}, out);
+    CHECK(big(0,3) == a(5,0));
+    CHECK(big(1,6) == a(1,6));
+    CHECK(big(0,2) == 0);
+}
+
+TEST_CASE("take many rows with threads tests")
+{
+    ndarray<float,2> table(1000, 64);
+    fill_pattern(table, 4, 101, 0);
+    std::vector<size_t> idx(2000);
+    for (size_t k = 0; k < idx.size(); ++k)
+    {
+        idx[k] = (k*389) % 1000;
+    }
+    auto rows = take(table, idx, 0, 4);
+    bool ok = true;
+    for (size_t k = 0; k < idx.size(); ++k)
+    {
+        for (size_t j = 0; j < 64; ++j)
+        {
+            ok = ok && rows(k,j) == table(idx[k],j);
+        }
+    }
+    CHECK(ok);
+}
+
+TEST_CASE("put tests")
+{
+    ndarray<int,2> a(4, 3, 0);
+    ndarray<int,2> values = {{1,1,1},{2,2,2},{3,3,3}};
+    put(a, std::vector<size_t>{2,0,2}, values);
+    CHECK(a == ndarray<int,2>{{2,2,2},{0,0,0},{3,3,3},{0,0,0}});
+
+    ndarray<int,2> b(2, 4, 0);
+    put(b, std::vector<size_t>{3,1}, ndarray<int,2>{{7,8},{9,10}}, 1);
+    CHECK(b == ndarray<int,2>{{0,8,0,7},{0,10,0,9}});
+
+    CHECK_THROWS_AS(put(a, std::vector<size_t>{0}, values), std::invalid_argument);
+    CHECK_THROWS_AS(put(a, std::vector<size_t>{0,1,4}, values), std::out_of_range);
+}
+
+TEST_CASE("scatter_add tests")
+{
+    ndarray<double,2> grad(3, 2, 0.0);
+    ndarray<double,2> updates = {{1,2},{3,4},{5,6},{7,8}};
+    scatter_add(grad, std::vector<size_t>{1,0,1,1}, updates);
+    CHECK(grad == ndarray<double,2>{{3,4},{13,16},{0,0}});
+
+    SECTION("along inner axis of a view")
+    {
+        ndarray<long,2> a(3, 6, 0L);
+        ndarray_view<long,2> v(a, {slice(0,3),slice(1,6,2)});
+        ndarray<long,2> u = {{1,1},{2,2},{3,3}};
+        scatter_add(v, std::vector<size_t>{2,2}, u, 1);
+        CHECK(a == ndarray<long,2>{{0,0,0,0,0,2},{0,0,0,0,0,4},{0,0,0,0,0,6}});
+    }
+}
+
+TEST_CASE("scatter_add conflicts with threads tests")
+{
+    // Many duplicate destinations, split across threads by destination range
+    const size_t rows = 50;
+    ndarray<long,2> a(rows, 256, 0L);
+    std::vector<size_t> idx(3000);
+    for (size_t k = 0; k < idx.size(); ++k)
+    {
+        idx[k] = (k*k) % rows;
+    }
+    ndarray<long,2> values(idx.size(), 256);
+    fill_pattern(values, 5, 101, 0);
+
+    ndarray<long,2> expected(rows, 256, 0L);
+    for (size_t k = 0; k < idx.size(); ++k)
+    {
+        for (size_t j = 0; j < 256; ++j)
+        {
+            expected(idx[k],j) += values(k,j);
+        }
+    }
+    scatter_add(a, idx, values, 0, 4);
+    CHECK(a == expected);
+
+    ndarray<long,2> b(rows, 256, 0L);
+    put(b, idx, values, 0, 3);
+    bool ok = true;
+    for (size_t r = 0; r < rows; ++r)
+    {
+        size_t last = idx.size();
+        for (size_t k = 0; k < idx.size(); ++k)
+        {
+            if (idx[k] == r)
+            {
+                last = k;
+            }
+        }
+        for (size_t j = 0; j < 256; ++j)
+        {
+            ok = ok && b(r,j) == (last == idx.size() ? 0 : values(last,j));
+        }
+    }
+    CHECK(ok);
+}
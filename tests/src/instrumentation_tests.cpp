@@ -0,0 +1,108 @@
+// Built as a separate program, acons_instrumentation_tests, with ACONS_INSTRUMENTATION defined
+#include <catch/catch.hpp>
+#include <iostream>
+#include "acons/ndarray.hpp"
+
+using namespace acons;
+
+namespace {
+
+struct sample
+{
+    double value;
+    sample(double v = 0) : value(v) {}
+};
+
+struct other_sample
+{
+    int value;
+    other_sample(int v = 0) : value(v) {}
+};
+
+}
+
+TEST_CASE("instrumentation allocation tests")
+{
+    REQUIRE(instrumentation_enabled());
+
+    scoped_stats_recorder<sample> recorder;
+    {
+        ndarray<sample,2> a(3,4,sample(0.0));
+    }
+    ndarray_stats s = recorder.stats();
+    CHECK(s.allocations == 1);
+    CHECK(s.deallocations == 1);
+    CHECK(s.bytes_allocated == 12*sizeof(sample));
+    CHECK(s.bytes_deallocated == 12*sizeof(sample));
+    CHECK(s.deep_copies == 0);
+}
+
+TEST_CASE("instrumentation copy and move tests")
+{
+    ndarray<other_sample,2> a(2,3,other_sample(1));
+
+    SECTION("copy")
+    {
+        scoped_stats_recorder<other_sample> recorder;
+        ndarray<other_sample,2> b(a);
+        ndarray_stats s = recorder.stats();
+        CHECK(s.allocations == 1);
+        CHECK(s.deep_copies == 1);
+        CHECK(s.bytes_copied == 6*sizeof(other_sample));
+        CHECK(s.moves == 0);
+    }
+    SECTION("move")
+    {
+        ndarray<other_sample,2> b(a);
+        scoped_stats_recorder<other_sample> recorder;
+        ndarray<other_sample,2> c(std::move(b));
+        ndarray<other_sample,2> d;
+        d = std::move(c);
+        ndarray_stats s = recorder.stats();
+        CHECK(s.allocations == 0);
+        CHECK(s.deep_copies == 0);
+        CHECK(s.moves == 2);
+    }
+    SECTION("resize")
+    {
+        ndarray<other_sample,2> b(a);
+        scoped_stats_recorder<other_sample> recorder;
+        b.resize(extents_t<2>{1,3});
+        ndarray_stats s = recorder.stats();
+        CHECK(s.allocations == 0);
+        CHECK(s.deep_copies == 0);
+
+        recorder.restart();
+        b.resize(extents_t<2>{4,3});
+        s = recorder.stats();
+        CHECK(s.allocations == 1);
+        CHECK(s.deallocations == 1);
+        CHECK(s.bytes_deallocated == 6*sizeof(other_sample));
+        CHECK(s.deep_copies == 1);
+        CHECK(s.bytes_copied == 3*sizeof(other_sample));
+    }
+}
+
+TEST_CASE("instrumentation view tests")
+{
+    ndarray<sample,2> a(4,4,sample());
+
+    scoped_stats_recorder<sample> recorder;
+    ndarray_view<sample,2> v(a, {slice(0,2),slice(0,2)});
+    const_ndarray_view<sample,1> w(v, indices_t<1>{1});
+    ndarray_stats s = recorder.stats();
+    CHECK(s.view_constructions == 2);
+    CHECK(s.allocations == 0);
+    CHECK(w.size() == 2);
+}
+
+TEST_CASE("instrumentation reset tests")
+{
+    {
+        ndarray<other_sample,1> a(8,other_sample(1));
+    }
+    reset_ndarray_stats<other_sample>();
+    ndarray_stats s = get_ndarray_stats<other_sample>();
+    CHECK(s.allocations == 0);
+    CHECK(s.bytes_deallocated == 0);
+}
@@ -0,0 +1,238 @@
+#include <catch/catch.hpp>
+#include <iostream>
+#include "acons/ndarray.hpp"
+#include "acons/linalg.hpp"
+
+using namespace acons;
+
+namespace {
+
+template <typename Array>
+void fill_pattern(Array& a, int seed)
+{
+    for (size_t i = 0; i < a.shape(0); ++i)
+    {
+        for (size_t j = 0; j < a.shape(1); ++j)
+        {
+            a(i,j) = static_cast<typename Array::element_type>((i*7 + j*3 + seed) % 11) - 5;
+        }
+    }
+}
+
+template <typename A, typename B>
+ndarray<long,2> naive_product(const A& a, const B& b)
+{
+    ndarray<long,2> c(a.shape(0), b.shape(1), 0L);
+    for (size_t i = 0; i < a.shape(0); ++i)
+    {
+        for (size_t j = 0; j < b.shape(1); ++j)
+        {
+            for (size_t k = 0; k < a.shape(1); ++k)
+            {
+                c(i,j) += a(i,k)*b(k,j);
+            }
+        }
+    }
+    return c;
+}
+
+template <typename C>
+bool same_values(const C& c, const ndarray<long,2>& expected)
+{
+    for (size_t i = 0; i < expected.shape(0); ++i)
+    {
+        for (size_t j = 0; j < expected.shape(1); ++j)
+        {
+            if (c(i,j) != expected(i,j))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// The scalar micro-kernel is the only one on compilers without GCC vector extensions,
+// such as MSVC, so it is checked against the vector kernel wherever both exist
+template <typename T>
+bool same_micro_kernels(size_t m, size_t n, bool accumulate)
+{
+    const size_t mr = detail::gemm_blocking<T>::mr;
+    const size_t nr = detail::gemm_blocking<T>::nr;
+    const size_t kb = 37;
+    std::vector<T> ap(mr*kb);
+    std::vector<T> bp(kb*nr);
+    for (size_t i = 0; i < ap.size(); ++i)
+    {
+        ap[i] = static_cast<T>(static_cast<int>((i*5 + 1) % 9) - 4);
+    }
+    for (size_t i = 0; i < bp.size(); ++i)
+    {
+        bp[i] = static_cast<T>(static_cast<int>((i*3 + 2) % 7) - 3);
+    }
+    const size_t row_stride = nr + 3;
+    std::vector<T> c1(mr*row_stride, T(1));
+    std::vector<T> c2(c1);
+    detail::gemm_micro_kernel<T,mr,nr,false>::apply(kb, ap.data(), bp.data(), c1.data(), row_stride, 1, m, n, accumulate);
+    detail::gemm_micro_kernel<T,mr,nr>::apply(kb, ap.data(), bp.data(), c2.data(), row_stride, 1, m, n, accumulate);
+    return c1 == c2;
+}
+
+}
+
+TEST_CASE("matmul small tests")
+{
+    ndarray<double,2> a = {{1,2,3},{4,5,6}};
+    ndarray<double,2> b = {{7,8},{9,10},{11,12}};
+    ndarray<double,2> c(2,2);
+
+    matmul(a, b, c);
+    ndarray<double,2> expected = {{58,64},{139,154}};
+    CHECK(c == expected);
+
+    CHECK(matmul(a, b) == expected);
+}
+
+TEST_CASE("matmul row and column major tests")
+{
+    ndarray<long,2> a(37, 29);
+    ndarray<long,2,column_major> b(29, 53);
+    ndarray<long,2,column_major> c(37, 53);
+    fill_pattern(a, 1);
+    fill_pattern(b, 2);
+
+    matmul(a, b, c, 1);
+    CHECK(same_values(c, naive_product(a, b)));
+}
+
+TEST_CASE("matmul strided view tests")
+{
+    ndarray<long,2> a(40, 30);
+    ndarray<long,2> b(30, 50);
+    fill_pattern(a, 3);
+    fill_pattern(b, 4);
+
+    // Every other row of a, the middle columns of b
+    const_ndarray_view<long,2> av(a, {slice(0,40,2),slice()});
+    const_ndarray_view<long,2> bv(b, {slice(),slice(10,35)});
+    ndarray<long,2> c(30, 60, -1L);
+    ndarray_view<long,2> cv(c, {slice(5,25),slice(0,50,2)});
+
+    matmul(av, bv, cv);
+    CHECK(same_values(cv, naive_product(av, bv)));
+    CHECK(c(0,0) == -1);
+    CHECK(c(5,1) == -1);
+}
+
+TEST_CASE("matmul blocked and threaded tests")
+{
+    // Larger than one cache block in every dimension
+    ndarray<long,2> a(300, 270);
+    ndarray<long,2> b(270, 530);
+    fill_pattern(a, 5);
+    fill_pattern(b, 6);
+    ndarray<long,2> expected = naive_product(a, b);
+
+    ndarray<long,2> c1(300, 530);
+    matmul(a, b, c1, 1);
+    CHECK(same_values(c1, expected));
+
+    ndarray<long,2> c4(300, 530);
+    matmul(a, b, c4, 4);
+    CHECK(same_values(c4, expected));
+}
+
+TEST_CASE("matmul floating point tests")
+{
+    ndarray<float,2> a(65, 130);
+    ndarray<float,2> b(130, 70);
+    fill_pattern(a, 7);
+    fill_pattern(b, 8);
+    ndarray<long,2> expected = naive_product(a, b);
+
+    ndarray<float,2> c = matmul(a, b, 3);
+    for (size_t i = 0; i < c.shape(0); ++i)
+    {
+        for (size_t j = 0; j < c.shape(1); ++j)
+        {
+            CHECK(c(i,j) == static_cast<float>(expected(i,j)));
+        }
+    }
+}
+
+TEST_CASE("matmul micro-kernel fallback tests")
+{
+    for (bool accumulate : {false, true})
+    {
+        CHECK(same_micro_kernels<float>(4, detail::gemm_blocking<float>::nr, accumulate));
+        CHECK(same_micro_kernels<float>(3, 5, accumulate));
+        CHECK(same_micro_kernels<double>(4, detail::gemm_blocking<double>::nr, accumulate));
+        CHECK(same_micro_kernels<double>(1, 2, accumulate));
+    }
+}
+
+TEST_CASE("matmul empty inner dimension tests")
+{
+    ndarray<double,2> a(3, 0);
+    ndarray<double,2> b(0, 4);
+    ndarray<double,2> c(3, 4, 1.0);
+    matmul(a, b, c);
+    CHECK(c == ndarray<double,2>(3, 4, 0.0));
+}
+
+TEST_CASE("matmul shape mismatch tests")
+{
+    ndarray<double,2> a(3, 4);
+    ndarray<double,2> b(5, 2);
+    ndarray<double,2> c(3, 2);
+    CHECK_THROWS_AS(matmul(a, b, c), std::invalid_argument);
+}
+
+TEST_CASE("batched matmul tests")
+{
+    const size_t batches = 5;
+    ndarray<long,3> a(batches, 9, 20);
+    ndarray<long,3> b(batches, 20, 11);
+    ndarray<long,2> w(20, 11);
+    for (size_t n = 0; n < batches; ++n)
+    {
+        ndarray_view<long,2> an(a, indices_t<1>{n});
+        ndarray_view<long,2> bn(b, indices_t<1>{n});
+        fill_pattern(an, static_cast<int>(n));
+        fill_pattern(bn, static_cast<int>(n) + 1);
+    }
+    fill_pattern(w, 9);
+
+    SECTION("per batch b")
+    {
+        for (size_t threads : {size_t(1), size_t(2), size_t(8)})
+        {
+            ndarray<long,3> c(batches, 9, 11);
+            matmul(a, b, c, threads);
+            for (size_t n = 0; n < batches; ++n)
+            {
+                const_ndarray_view<long,2> an(a, indices_t<1>{n});
+                const_ndarray_view<long,2> bn(b, indices_t<1>{n});
+                const_ndarray_view<long,2> cn(c, indices_t<1>{n});
+                CHECK(same_values(cn, naive_product(an, bn)));
+            }
+        }
+    }
+
+    SECTION("shared b")
+    {
+        ndarray<long,3> c = matmul(a, w);
+        for (size_t n = 0; n < batches; ++n)
+        {
+            const_ndarray_view<long,2> an(a, indices_t<1>{n});
+            const_ndarray_view<long,2> cn(c, indices_t<1>{n});
+            CHECK(same_values(cn, naive_product(an, w)));
+        }
+    }
+
+    SECTION("mismatch")
+    {
+        ndarray<long,3> c(batches + 1, 9, 11);
+        CHECK_THROWS_AS(matmul(a, b, c), std::invalid_argument);
+    }
+}
@@ -0,0 +1,173 @@
+#include <catch/catch.hpp>
+#include <iostream>
+#include "acons/ndarray.hpp"
+#include "acons/mask.hpp"
+#include "test_patterns.hpp"
+
+using namespace acons;
+
+namespace {
+
+template <typename Mask>
+void fill_mask(Mask& mask, size_t period)
+{
+    size_t i = 0;
+    for (auto p = mask.data(); p != mask.data() + mask.size(); ++p)
+    {
+        *p = (i*i + 1) % period == 0;
+        ++i;
+    }
+}
+
+}
+
+TEST_CASE("where tests")
+{
+    ndarray<bool,2> mask = {{true,false,true},{false,false,true}};
+    ndarray<double,2> a = {{1,2,3},{4,5,6}};
+    ndarray<double,2> b = {{-1,-2,-3},{-4,-5,-6}};
+
+    CHECK(where(mask, a, b) == ndarray<double,2>{{1,-2,3},{-4,-5,6}});
+    CHECK(where(mask, a, 0) == ndarray<double,2>{{1,0,3},{0,0,6}});
+
+    packed_mask<2> packed(mask);
+    CHECK(where(packed, a, b) == ndarray<double,2>{{1,-2,3},{-4,-5,6}});
+
+    ndarray<bool,2> wrong(3, 2, true);
+    CHECK_THROWS_AS(where(wrong, a, b), std::invalid_argument);
+}
+
+TEST_CASE("where mixed order and views tests")
+{
+    ndarray<bool,2,column_major> mask(6, 5);
+    fill_mask(mask, 3);
+    ndarray<int,2> a(6, 5);
+    fill_pattern(a, 1);
+    ndarray<int,2> big(12, 5);
+    fill_pattern(big, 2);
+    const_ndarray_view<int,2> b(big, {slice(0,12,2),slice(0,5)});
+
+    auto r = where(mask, a, b);
+    auto rp = where(packed_mask<2>(mask), a, b);
+    bool ok = true;
+    for (size_t i = 0; i < 6; ++i)
+    {
+        for (size_t j = 0; j < 5; ++j)
+        {
+            int expected = mask(i,j) ? a(i,j) : b(i,j);
+            ok = ok && r(i,j) == expected && rp(i,j) == expected;
+        }
+    }
+    CHECK(ok);
+}
+
+TEST_CASE("putmask tests")
+{
+    ndarray<bool,2> mask = {{true,false},{false,true}};
+
+    ndarray<float,2> a = {{1,2},{3,4}};
+    putmask(a, mask, 0);
+    CHECK(a == ndarray<float,2>{{0,2},{3,0}});
+
+    ndarray<float,2> b = {{1,2},{3,4}};
+    putmask(b, mask, ndarray<float,2>{{9,8},{7,6}});
+    CHECK(b == ndarray<float,2>{{9,2},{3,6}});
+
+    SECTION("view")
+    {
+        ndarray<int,2> c(3, 4, 1);
+        ndarray_view<int,2> v(c, {slice(1,3),slice(1,3)});
+        putmask(v, packed_mask<2>(mask), 5);
+        CHECK(c == ndarray<int,2>{{1,1,1,1},{1,5,1,1},{1,1,5,1}});
+    }
+}
+
+TEST_CASE("compress and count_nonzero tests")
+{
+    ndarray<bool,2> mask = {{true,false,true},{false,false,true}};
+    ndarray<int,2> a = {{1,2,3},{4,5,6}};
+    CHECK(count_nonzero(mask) == 3);
+    CHECK(compress(a, mask) == ndarray<int,1>{1,3,6});
+    CHECK(compress(a, packed_mask<2>(mask)) == ndarray<int,1>{1,3,6});
+
+    // Index order, whatever the storage order
+    ndarray<int,2,column_major> c = {{1,2,3},{4,5,6}};
+    CHECK(compress(c, mask) == ndarray<int,1>{1,3,6});
+
+    ndarray<bool,2> none(2, 3, false);
+    CHECK(compress(a, none).size() == 0);
+    CHECK(count_nonzero(packed_mask<2>(none)) == 0);
+}
+
+TEST_CASE("mask long rows with threads tests")
+{
+    // Rows longer than a segment, spread across threads
+    const size_t rows = 7;
+    const size_t cols = 10000;
+    ndarray<bool,2> mask(rows, cols);
+    fill_mask(mask, 5);
+    packed_mask<2> packed(mask);
+    ndarray<long,2> a(rows, cols);
+    fill_pattern(a, 3);
+
+    size_t expected_count = 0;
+    std::vector<long> expected;
+    for (size_t i = 0; i < rows; ++i)
+    {
+        for (size_t j = 0; j < cols; ++j)
+        {
+            if (mask(i,j))
+            {
+                ++expected_count;
+                expected.push_back(a(i,j));
+            }
+        }
+    }
+    CHECK(count_nonzero(mask, 3) == expected_count);
+    CHECK(count_nonzero(packed, 3) == expected_count);
+    CHECK(packed.count() == expected_count);
+
+    for (auto selected : {compress(a, mask, 3), compress(a, packed, 4)})
+    {
+        REQUIRE(selected.size() == expected.size());
+        CHECK(std::equal(expected.begin(), expected.end(), selected.data()));
+    }
+
+    ndarray<long,2> b(a);
+    putmask(b, packed, -100, 4);
+    auto w = where(mask, a, -100L, 3);
+    bool ok = true;
+    for (size_t i = 0; i < rows; ++i)
+    {
+        for (size_t j = 0; j < cols; ++j)
+        {
+            ok = ok && b(i,j) == (mask(i,j) ? -100 : a(i,j)) && w(i,j) == (mask(i,j) ? a(i,j) : -100);
+        }
+    }
+    CHECK(ok);
+}
+
+TEST_CASE("packed_mask tests")
+{
+    ndarray<bool,3> mask(2, 3, 70);
+    fill_mask(mask, 4);
+    packed_mask<3> packed(mask);
+    CHECK(packed.words_per_row() == 2);
+    CHECK(packed.rows() == 6);
+    CHECK(packed.size() == mask.size());
+    bool ok = true;
+    for (size_t i = 0; i < 2; ++i)
+    {
+        for (size_t j = 0; j < 3; ++j)
+        {
+            for (size_t k = 0; k < 70; ++k)
+            {
+                ok = ok && packed(indices_t<3>{i,j,k}) == mask(i,j,k);
+            }
+        }
+    }
+    CHECK(ok);
+
+    packed_mask<3> all(extents_t<3>{2,3,70}, true);
+    CHECK(all.count() == 420);
+}
@@ -25,9 +25,9 @@ std::ostream& operator<<(std::ostream& os, const state& s)
 }
 
 template <size_t N>
-void initialize(const std::array<size_t,N>& shape,
-               const std::array<size_t,N>& strides,
-               const std::array<size_t,N>& offsets,
+void initialize(const indices_t<N>& shape,
+               const indices_t<N>& strides,
+               const indices_t<N>& offsets,
                size_t n,
                std::array<state,N>& stack)
 {
@@ -52,9 +52,9 @@ void initialize(const std::array<size_t,N>& shape,
 }
 
 template <size_t N>
-void iterate_n(const std::array<size_t,N>& shape,
-               const std::array<size_t,N>& strides,
-               const std::array<size_t,N>& offsets,
+void iterate_n(const indices_t<N>& shape,
+               const indices_t<N>& strides,
+               const indices_t<N>& offsets,
                size_t n,
                std::array<state,N>& stack)
 {
@@ -102,9 +102,9 @@ TEST_CASE("4 x 5 new iterator tests")
         array_t::view<N> v(a, { slice(1,3),slice(2,4) });
 
         std::cout << "v: " << v << "\n";
-        std::array<size_t,2> shape = v.shape();
-        std::array<size_t,2> strides = v.strides();
-        std::array<size_t,2> offsets = v.offsets();
+        extents_t<2> shape = v.shape();
+        indices_t<2> strides = v.strides();
+        indices_t<2> offsets = v.offsets();
 
         std::cout << "shape: " << shape << "\n";
         std::cout << "strides: " << strides << "\n";
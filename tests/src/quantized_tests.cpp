@@ -0,0 +1,259 @@
+#include <catch/catch.hpp>
+#include <iostream>
+#include <cmath>
+#include "acons/ndarray.hpp"
+#include "acons/quantized.hpp"
+
+using namespace acons;
+
+namespace {
+
+template <typename Array>
+void fill_values(Array& a, float step)
+{
+    size_t i = 0;
+    for (auto p = a.data(); p != a.data() + a.size(); ++p)
+    {
+        *p = static_cast<float>((i*37) % 101)*step - 20.0f;
+        ++i;
+    }
+}
+
+// Every element of q is within half a step of a
+template <typename A, typename Q>
+bool within_half_step(const A& a, const Q& q)
+{
+    bool ok = true;
+    for (size_t i = 0; i < a.shape(0); ++i)
+    {
+        for (size_t j = 0; j < a.shape(1); ++j)
+        {
+            size_t g = q.axis() == 0 ? i : (q.axis() == 1 ? j : 0);
+            ok = ok && std::abs(q(i,j) - a(i,j)) <= q.scale(g)*0.501f;
+        }
+    }
+    return ok;
+}
+
+template <typename Q>
+void check_dequantize_sum(const Q& q)
+{
+    auto d = dequantize(q);
+    double expected = 0;
+    for (size_t i = 0; i < d.size(); ++i)
+    {
+        expected += d.data()[i];
+    }
+    CHECK(dequantize_sum(q) == Approx(expected).margin(1e-4));
+}
+
+template <typename C>
+void expect_close(const C& c, const ndarray<float,2>& expected)
+{
+    bool ok = c.shape(0) == expected.shape(0) && c.shape(1) == expected.shape(1);
+    for (size_t i = 0; ok && i < c.shape(0); ++i)
+    {
+        for (size_t j = 0; j < c.shape(1); ++j)
+        {
+            ok = ok && std::abs(c(i,j) - expected(i,j)) <= 1e-4f*(1 + std::abs(expected(i,j)));
+        }
+    }
+    CHECK(ok);
+}
+
+}
+
+TEST_CASE("quantized_ndarray construction tests")
+{
+    quantized_ndarray<uint8_t,2> a(extents_t<2>{2,3}, 0.5f, 10);
+    CHECK(a.size() == 6);
+    CHECK(a.axis() == a.no_axis);
+    CHECK(a.codes()(1,2) == 10);
+    CHECK(a(1,2) == 0.0f);
+    a.codes()(0,1) = 13;
+    CHECK(a(0,1) == 1.5f);
+
+    quantized_ndarray<int8_t,2> b(extents_t<2>{2,3}, 1, {0.5f,1.0f,2.0f}, {-1,0,1});
+    CHECK(b.codes()(1,0) == -1);
+    CHECK(b.codes()(1,2) == 1);
+    b.codes()(1,2) = 4;
+    CHECK(b(1,2) == 6.0f);
+    CHECK(b.scale(2) == 2.0f);
+
+    quantized_ndarray<int8_t,2,row_major,one_based> c(extents_t<2>{2,2}, 0, {1.0f,3.0f}, {0,0});
+    c.codes()(2,1) = 2;
+    CHECK(c(2,1) == 6.0f);
+
+    CHECK_THROWS_AS((quantized_ndarray<int8_t,2>(extents_t<2>{2,3}, 0.0f, 0)), std::invalid_argument);
+    CHECK_THROWS_AS((quantized_ndarray<uint8_t,2>(extents_t<2>{2,3}, 1.0f, -1)), std::invalid_argument);
+    CHECK_THROWS_AS((quantized_ndarray<int8_t,2>(extents_t<2>{2,3}, 1, {1.0f,1.0f}, {0,0})), std::invalid_argument);
+    CHECK_THROWS_AS((quantized_ndarray<int8_t,2>(extents_t<2>{2,3}, 2, {1.0f}, {0})), std::invalid_argument);
+}
+
+TEST_CASE("quantize tests")
+{
+    SECTION("per tensor")
+    {
+        ndarray<float,2> a(7, 45);
+        fill_values(a, 0.5f);
+        auto q = quantize<uint8_t>(a);
+        CHECK(q.axis() == q.no_axis);
+        CHECK(q.scale() == Approx(50.0f/255));
+        CHECK(within_half_step(a, q));
+        // Zero is represented exactly
+        a(0,0) = 0;
+        quantize(a, q);
+        CHECK(q(0,0) == 0.0f);
+
+        auto s = quantize<int8_t>(a);
+        CHECK(within_half_step(a, s));
+        CHECK(dequantize(s).shape(1) == 45);
+    }
+
+    SECTION("denormal range")
+    {
+        const float tiny = std::numeric_limits<float>::denorm_min();
+        // Ranges whose scale would underflow to zero, or be denormal with an infinite inverse
+        ndarray<float,1> a = {0.0f, 10*tiny, 100*tiny, -50*tiny};
+        ndarray<float,1> b = {0.0f, 1e-39f, -2e-39f};
+        for (const ndarray<float,1>* x : {&a, &b})
+        {
+            auto q = quantize<uint8_t>(*x);
+            CHECK(q.scale() >= (std::numeric_limits<float>::min)());
+            CHECK(std::isfinite(1.0f/q.scale()));
+            CHECK(int32_t(q.codes()(0)) == q.zero_point());
+            CHECK(q(0) == 0.0f);
+
+            auto s = quantize<int8_t>(*x);
+            CHECK(int32_t(s.codes()(0)) == s.zero_point());
+        }
+    }
+
+    SECTION("rounding and clamping")
+    {
+        ndarray<float,1> a = {0.5f, 1.5f, 2.5f, -0.5f, -1.5f, 1000.0f, -1000.0f, 0.49f,
+                              std::numeric_limits<float>::quiet_NaN()};
+        quantized_ndarray<int8_t,1> q(extents_t<1>{9}, 1.0f, 0);
+        quantize(a, q);
+        CHECK(q.codes() == ndarray<int8_t,1>{0, 2, 2, 0, -2, 127, -128, 0, -128});
+
+        quantized_ndarray<uint8_t,1> u(extents_t<1>{9}, 2.0f, 100);
+        quantize(a, u);
+        CHECK(u.codes() == ndarray<uint8_t,1>{100, 101, 101, 100, 99, 255, 0, 100, 0});
+
+        ndarray<float,1> wrong(8, 0.0f);
+        CHECK_THROWS_AS(quantize(wrong, q), std::invalid_argument);
+    }
+
+    SECTION("per axis")
+    {
+        ndarray<float,2> a(6, 40);
+        fill_values(a, 0.25f);
+        for (size_t j = 0; j < 40; ++j)
+        {
+            a(2,j) *= 10;
+        }
+        auto rows = quantize<int8_t>(a, 0);
+        CHECK(rows.scales().size() == 6);
+        CHECK(rows.scale(2) > rows.scale(1));
+        CHECK(within_half_step(a, rows));
+
+        auto cols = quantize<uint8_t>(a, 1);
+        CHECK(cols.scales().size() == 40);
+        CHECK(within_half_step(a, cols));
+
+        CHECK_THROWS_AS(quantize<int8_t>(a, 2), std::invalid_argument);
+    }
+
+    SECTION("strided and column major operands")
+    {
+        ndarray<float,2,column_major> a(9, 33);
+        fill_values(a, 0.3f);
+        auto q = quantize<int8_t>(a, 1);
+        CHECK(within_half_step(a, q));
+        auto p = quantize<int8_t>(a, 0);
+        CHECK(within_half_step(a, p));
+
+        ndarray<float,2> b(10, 40);
+        fill_values(b, 0.3f);
+        const_ndarray_view<float,2> v(b, {slice(1,10,2),slice(0,40,3)});
+        auto r = quantize<uint8_t>(v, 1);
+        CHECK(within_half_step(v, r));
+    }
+}
+
+TEST_CASE("dequantize tests")
+{
+    ndarray<float,3> a(3, 4, 21);
+    fill_values(a, 0.2f);
+    for (size_t axis = 0; axis < 3; ++axis)
+    {
+        auto q = quantize<int8_t>(a, axis);
+        auto d = dequantize(q);
+        ndarray<double,3,column_major> cm(3, 4, 21);
+        dequantize(q, cm);
+        bool ok = true;
+        for (size_t i = 0; i < 3; ++i)
+        {
+            for (size_t j = 0; j < 4; ++j)
+            {
+                for (size_t k = 0; k < 21; ++k)
+                {
+                    ok = ok && d(i,j,k) == q(i,j,k) && cm(i,j,k) == q(i,j,k) &&
+                         std::abs(d(i,j,k) - a(i,j,k)) <= q.scale(axis == 0 ? i : (axis == 1 ? j : k));
+                }
+            }
+        }
+        CHECK(ok);
+    }
+
+    auto q = quantize<uint8_t>(a);
+    ndarray<float,3> wrong(3, 4, 20);
+    CHECK_THROWS_AS(dequantize(q, wrong), std::invalid_argument);
+}
+
+TEST_CASE("dequantize_sum tests")
+{
+    ndarray<float,3> a(5, 6, 70);
+    fill_values(a, 0.4f);
+    ndarray<float,3,column_major> b(5, 6, 70);
+    fill_values(b, 0.4f);
+
+    check_dequantize_sum(quantize<uint8_t>(a));
+    check_dequantize_sum(quantize<int8_t>(b));
+    for (size_t axis = 0; axis < 3; ++axis)
+    {
+        check_dequantize_sum(quantize<int8_t>(a, axis));
+        check_dequantize_sum(quantize<uint8_t>(b, axis));
+    }
+    CHECK(dequantize_sum(quantized_ndarray<int8_t,2>(extents_t<2>{0,3}, 1.0f, 0)) == 0);
+}
+
+TEST_CASE("dequantize_matmul tests")
+{
+    const size_t m = 29, k = 300, n = 21;
+    ndarray<float,2> a(m, k);
+    fill_values(a, 0.1f);
+    ndarray<float,2> b(k, n);
+    fill_values(b, 0.05f);
+
+    auto qb = quantize<int8_t>(b, 1);
+    auto c = dequantize_matmul(a, qb);
+    expect_close(c, matmul(a, dequantize(qb)));
+
+    auto qa = quantize<uint8_t>(a, 0);
+    expect_close(dequantize_matmul(qa, qb), matmul(dequantize(qa), dequantize(qb)));
+    expect_close(dequantize_matmul(qa, b, 2), matmul(dequantize(qa), b));
+
+    // Column major codes, per tensor parameters, and a strided result
+    ndarray<float,2,column_major> bc(k, n);
+    fill_values(bc, 0.05f);
+    auto qc = quantize<int8_t>(bc);
+    ndarray<float,2> wide(m, 2*n, 0.0f);
+    ndarray_view<float,2> every_other(wide, {slice(),slice(0,2*n,2)});
+    dequantize_matmul(a, qc, every_other);
+    expect_close(every_other, matmul(a, dequantize(qc)));
+
+    ndarray<float,2> wrong(m, n + 1);
+    CHECK_THROWS_AS(dequantize_matmul(a, qb, wrong), std::invalid_argument);
+}
@@ -0,0 +1,105 @@
+#include <catch/catch.hpp>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "acons/ndarray.hpp"
+#include "acons/rcu_ndarray.hpp"
+
+using namespace acons;
+
+TEST_CASE("rcu_ndarray single thread tests")
+{
+    rcu_ndarray<float,3> table(extents_t<3>{2,3,4}, 1.0f);
+    CHECK(table.num_buffers() == 2);
+
+    {
+        auto guard = table.read();
+        CHECK(guard.version() == 0);
+        CHECK(guard.view()(1,2,3) == 1.0f);
+    }
+
+    table.update([](ndarray<float,3>& a)
+    {
+        std::fill(a.data(), a.data() + a.size(), 2.0f);
+    });
+    auto before = table.read();
+    CHECK(before.version() == 1);
+    CHECK(before.get()(0,0,0) == 2.0f);
+
+    // Published updates do not affect existing guards
+    table.modify([](ndarray<float,3>& a)
+    {
+        a(0,0,0) = 3.0f;
+    });
+    CHECK(before.get()(0,0,0) == 2.0f);
+
+    auto after = table.read();
+    CHECK(after.version() == 2);
+    CHECK(after.get()(0,0,0) == 3.0f);
+    CHECK(after.get()(1,2,3) == 2.0f);
+
+    CHECK_THROWS_AS((rcu_ndarray<float,3>(extents_t<3>{1,1,1}, 0.0f, 4)), std::invalid_argument);
+}
+
+TEST_CASE("rcu_ndarray resize tests")
+{
+    rcu_ndarray<int,1> a(extents_t<1>{2}, 0, 3);
+    a.update([](ndarray<int,1>& b)
+    {
+        b.resize(extents_t<1>{5}, 7);
+    });
+    auto guard = a.read();
+    CHECK(guard.view().shape(0) == 5);
+    CHECK(guard.view()(4) == 7);
+}
+
+TEST_CASE("rcu_ndarray concurrent tests")
+{
+    const size_t readers = 4;
+    const size_t updates = 200;
+
+    for (size_t buffers = 2; buffers <= 3; ++buffers)
+    {
+        rcu_ndarray<size_t,2> table(extents_t<2>{8,8}, 0, buffers);
+        std::atomic<bool> done(false);
+        std::atomic<bool> torn(false);
+
+        std::vector<std::thread> threads;
+        for (size_t r = 0; r < readers; ++r)
+        {
+            threads.emplace_back([&]()
+            {
+                while (!done.load())
+                {
+                    auto guard = table.read();
+                    const_ndarray_view<size_t,2> v = guard.view();
+                    size_t expected = guard.version();
+                    for (size_t i = 0; i < 8; ++i)
+                    {
+                        for (size_t j = 0; j < 8; ++j)
+                        {
+                            if (v(i,j) != expected)
+                            {
+                                torn = true;
+                            }
+                        }
+                    }
+                }
+            });
+        }
+        for (size_t u = 1; u <= updates; ++u)
+        {
+            table.update([&](ndarray<size_t,2>& a)
+            {
+                std::fill(a.data(), a.data() + a.size(), u);
+            });
+        }
+        done = true;
+        for (auto& t : threads)
+        {
+            t.join();
+        }
+        CHECK_FALSE(torn.load());
+        CHECK(table.read().version() == updates);
+    }
+}
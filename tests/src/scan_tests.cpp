@@ -0,0 +1,254 @@
+#include <catch/catch.hpp>
+#include <iostream>
+#include "acons/ndarray.hpp"
+#include "acons/scan.hpp"
+#include "test_patterns.hpp"
+
+using namespace acons;
+
+namespace {
+
+struct max_op
+{
+    long operator()(long a, long b) const {return a < b ? b : a;}
+};
+
+}
+
+TEST_CASE("scan 1-D tests")
+{
+    ndarray<long,1> a = {1,2,3,4};
+
+    ndarray<long,1> out(4);
+    scan(a, out, 0);
+    CHECK(out == ndarray<long,1>{1,3,6,10});
+
+    scan(a, out, 0, std::plus<long>(), false);
+    CHECK(out == ndarray<long,1>{0,1,3,6});
+
+    scan(a, out, 0, std::multiplies<long>());
+    CHECK(out == ndarray<long,1>{1,2,6,24});
+
+    scan(a, out, 0, std::multiplies<long>(), false);
+    CHECK(out == ndarray<long,1>{1,1,2,6});
+
+    CHECK(cumsum(a, 0) == ndarray<long,1>{1,3,6,10});
+    CHECK(cumprod(a, 0) == ndarray<long,1>{1,2,6,24});
+}
+
+TEST_CASE("scan custom op tests")
+{
+    ndarray<long,1> a = {3,1,4,1,5,9,2,6};
+    ndarray<long,1> out(8);
+    inclusive_scan(a, out, 0, max_op());
+    CHECK(out == ndarray<long,1>{3,3,4,4,5,9,9,9});
+
+    // No scan_identity for max_op, so the initial value is explicit
+    exclusive_scan(a, out, 0, 2L, max_op());
+    CHECK(out == ndarray<long,1>{2,3,3,4,4,5,9,9});
+
+    exclusive_scan(a, out, 0, 10L);
+    CHECK(out == ndarray<long,1>{10,13,14,18,19,24,33,35});
+
+    CHECK_FALSE(detail::has_scan_identity<max_op>::value);
+    CHECK(detail::has_scan_identity<std::plus<long>>::value);
+}
+
+TEST_CASE("scan 2-D axis tests")
+{
+    ndarray<long,2> a = {{1,2,3},{4,5,6}};
+
+    SECTION("axis 0, across lanes")
+    {
+        ndarray<long,2> out(2,3);
+        scan(a, out, 0);
+        CHECK(out == ndarray<long,2>{{1,2,3},{5,7,9}});
+        scan(a, out, 0, std::plus<long>(), false);
+        CHECK(out == ndarray<long,2>{{0,0,0},{1,2,3}});
+    }
+
+    SECTION("axis 1, along lanes")
+    {
+        ndarray<long,2> out(2,3);
+        scan(a, out, 1);
+        CHECK(out == ndarray<long,2>{{1,3,6},{4,9,15}});
+        scan(a, out, 1, std::plus<long>(), false);
+        CHECK(out == ndarray<long,2>{{0,1,3},{0,4,9}});
+    }
+
+    SECTION("column major")
+    {
+        ndarray<long,2,column_major> c = {{1,2,3},{4,5,6}};
+        ndarray<long,2,column_major> out(2,3);
+        scan(c, out, 1);
+        CHECK(out == ndarray<long,2,column_major>{{1,3,6},{4,9,15}});
+        scan(c, out, 0);
+        CHECK(out == ndarray<long,2,column_major>{{1,2,3},{5,7,9}});
+    }
+
+    SECTION("in place")
+    {
+        ndarray<long,2> b(a);
+        scan(b, b, 1);
+        CHECK(b == ndarray<long,2>{{1,3,6},{4,9,15}});
+    }
+
+    SECTION("errors")
+    {
+        ndarray<long,2> out(3,2);
+        CHECK_THROWS_AS(scan(a, out, 0), std::invalid_argument);
+        ndarray<long,2> ok(2,3);
+        CHECK_THROWS_AS(scan(a, ok, 2), std::out_of_range);
+    }
+}
+
+TEST_CASE("scan view tests")
+{
+    ndarray<long,2> a(6, 8);
+    fill_pattern(a, 1);
+    ndarray<long,2> out(6, 8, 0L);
+
+    const_ndarray_view<long,2> av(a, {slice(1,5),slice(0,8,2)});
+    ndarray_view<long,2> ov(out, {slice(2,6),slice(4,8)});
+    scan(av, ov, 0);
+    for (size_t j = 0; j < 4; ++j)
+    {
+        long sum = 0;
+        for (size_t i = 0; i < 4; ++i)
+        {
+            sum += av(i,j);
+            CHECK(ov(i,j) == sum);
+        }
+    }
+    CHECK(out(0,4) == 0);
+    CHECK(out(2,0) == 0);
+}
+
+TEST_CASE("scan 3-D all axes tests")
+{
+    ndarray<long,3> a(5, 6, 7);
+    fill_pattern(a, 2);
+    for (size_t axis = 0; axis < 3; ++axis)
+    {
+        for (bool inclusive : {true, false})
+        {
+            ndarray<long,3> out(5, 6, 7);
+            scan(a, out, axis, std::plus<long>(), inclusive);
+            bool ok = true;
+            for (size_t i = 0; i < 5; ++i)
+            {
+                for (size_t j = 0; j < 6; ++j)
+                {
+                    for (size_t k = 0; k < 7; ++k)
+                    {
+                        indices_t<3> index{i,j,k};
+                        size_t end = index[axis] + (inclusive ? 1 : 0);
+                        long sum = 0;
+                        for (size_t m = 0; m < end; ++m)
+                        {
+                            indices_t<3> other = index;
+                            other[axis] = m;
+                            sum += a(other);
+                        }
+                        ok = ok && out(i,j,k) == sum;
+                    }
+                }
+            }
+            CHECK(ok);
+        }
+    }
+}
+
+TEST_CASE("scan long lane block scan tests")
+{
+    // One lane, long enough for the two pass block scan
+    const size_t n = 100000;
+    ndarray<long,1> a(n);
+    fill_pattern(a, 3);
+
+    for (bool inclusive : {true, false})
+    {
+        ndarray<long,1> out(n);
+        scan(a, out, 0, std::plus<long>(), inclusive, 4);
+        long sum = 0;
+        bool ok = true;
+        for (size_t i = 0; i < n; ++i)
+        {
+            if (inclusive)
+            {
+                sum += a(i);
+            }
+            ok = ok && out(i) == sum;
+            if (!inclusive)
+            {
+                sum += a(i);
+            }
+        }
+        CHECK(ok);
+    }
+
+    ndarray<long,1> out(n);
+    exclusive_scan(a, out, 0, 100L, std::plus<long>(), 4);
+    long sum = 100;
+    bool ok = true;
+    for (size_t i = 0; i < n; ++i)
+    {
+        ok = ok && out(i) == sum;
+        sum += a(i);
+    }
+    CHECK(ok);
+}
+
+TEST_CASE("scan wide strip tests")
+{
+    // More lanes than one strip, on several threads
+    ndarray<long,2> a(40, 3000);
+    fill_pattern(a, 4);
+    ndarray<long,2> out(40, 3000);
+    scan(a, out, 0, std::plus<long>(), true, 3);
+    bool ok = true;
+    for (size_t j = 0; j < 3000; ++j)
+    {
+        long sum = 0;
+        for (size_t i = 0; i < 40; ++i)
+        {
+            sum += a(i,j);
+            ok = ok && out(i,j) == sum;
+        }
+    }
+    CHECK(ok);
+
+    exclusive_scan(a, out, 0, -5L, std::plus<long>(), 3);
+    ok = true;
+    for (size_t j = 0; j < 3000; ++j)
+    {
+        long sum = -5;
+        for (size_t i = 0; i < 40; ++i)
+        {
+            ok = ok && out(i,j) == sum;
+            sum += a(i,j);
+        }
+    }
+    CHECK(ok);
+}
+
+TEST_CASE("integral_image tests")
+{
+    ndarray<uint8_t,2> image = {{1,2,3},{4,5,6},{7,8,9}};
+    ndarray<uint32_t,2> sums(3,3);
+    integral_image(image, sums);
+    CHECK(sums == ndarray<uint32_t,2>{{1,3,6},{5,12,21},{12,27,45}});
+
+    // Wider output avoids overflow
+    ndarray<uint8_t,2> bright(300, 200, uint8_t(255));
+    ndarray<uint32_t,2> total(300, 200);
+    integral_image(bright, total, 2);
+    CHECK(total(299,199) == 300u*200u*255u);
+    CHECK(total(0,199) == 200u*255u);
+
+    ndarray<long,3> v(3, 4, 5, 1L);
+    ndarray<long,3> vs(3, 4, 5);
+    integral_image(v, vs);
+    CHECK(vs(2,3,4) == 60);
+    CHECK(vs(1,1,1) == 8);
+}
@@ -0,0 +1,199 @@
+#include <catch/catch.hpp>
+#include <iostream>
+#include <thread>
+#include "acons/ndarray.hpp"
+#include "acons/shared_ndarray.hpp"
+
+using namespace acons;
+
+TEST_CASE("shared_ndarray copy on write tests")
+{
+    shared_ndarray<double,2> a(2,3,1.0);
+    shared_ndarray<double,2> b(a);
+
+    CHECK(a.use_count() == 2);
+    CHECK(a.data() != nullptr);
+    // Mutable data() on a detaches it
+    CHECK(a.unique());
+    CHECK(b.unique());
+
+    shared_ndarray<double,2> c(b);
+    const shared_ndarray<double,2>& cc = c;
+    CHECK(cc(1,2) == 1.0);
+    const shared_ndarray<double,2>& cb = b;
+    CHECK(cc.data() == cb.get().data());
+    CHECK(c.use_count() == 2);
+
+    c(1,2) = 5.0;
+    CHECK(c.unique());
+    CHECK(c(1,2) == 5.0);
+    CHECK(b(1,2) == 1.0);
+    CHECK(b != c);
+}
+
+TEST_CASE("shared_ndarray unshareable tests")
+{
+    shared_ndarray<double,1> a(3, 1.0);
+    CHECK_FALSE(a.unshareable());
+
+    // A reference taken before a copy must not write through to the copy
+    double& r = a(0);
+    CHECK(a.unshareable());
+    shared_ndarray<double,1> b = a;
+    CHECK(a.unique());
+    r = 42.0;
+    const shared_ndarray<double,1>& cb = b;
+    CHECK(cb(0) == 1.0);
+    CHECK_FALSE(b.unshareable());
+
+    shared_ndarray<double,1> c;
+    c = a;
+    CHECK(a.unique());
+    const shared_ndarray<double,1>& cc = c;
+    CHECK(cc(0) == 42.0);
+
+    auto v = a.share();
+    r = 7.0;
+    CHECK(v(0) == 42.0);
+
+    // Copies of a shareable object still share
+    shared_ndarray<double,1> d = b;
+    CHECK(b.use_count() == 2);
+}
+
+TEST_CASE("shared_ndarray seal tests")
+{
+    shared_ndarray<double,2> a(2,3,0.0);
+    for (size_t i = 0; i < a.shape(0); ++i)
+    {
+        for (size_t j = 0; j < a.shape(1); ++j)
+        {
+            a(i,j) = double(i*3 + j);
+        }
+    }
+    CHECK(a.unshareable());
+    a.seal();
+    CHECK_FALSE(a.unshareable());
+
+    // Passing the filled array on shares its storage
+    shared_ndarray<double,2> b = a;
+    const shared_ndarray<double,2>& ca = a;
+    const shared_ndarray<double,2>& cb = b;
+    CHECK(a.use_count() == 2);
+    CHECK(cb.data() == ca.data());
+    CHECK(cb(1,2) == 5.0);
+
+    auto v = a.share();
+    CHECK(v.data() == ca.data());
+    CHECK(a.use_count() == 3);
+}
+
+TEST_CASE("shared_ndarray const access tests")
+{
+    shared_ndarray<int,1> a(4, 3);
+    shared_ndarray<int,1> b(a);
+
+    CHECK(b.cdata() == a.cdata());
+    CHECK(b.cget()(2) == 3);
+    int sum = 0;
+    for (auto it = b.cbegin(); it != b.cend(); ++it)
+    {
+        sum += *it;
+    }
+    CHECK(sum == 12);
+    CHECK_FALSE(b.unshareable());
+    CHECK(b.use_count() == 2);
+}
+
+TEST_CASE("shared_ndarray thread tests")
+{
+    shared_ndarray<long,1> a(1000, 1L);
+    shared_ndarray<long,1> b(a);
+    shared_ndarray<long,1> c(a);
+
+    // Each thread writes its own object, the storage is shared until each detaches
+    std::thread t1([&]() {for (size_t i = 0; i < b.size(); ++i) b(i) += 1;});
+    std::thread t2([&]() {for (size_t i = 0; i < c.size(); ++i) c(i) += 2;});
+    t1.join();
+    t2.join();
+
+    const shared_ndarray<long,1>& ca = a;
+    CHECK(ca(999) == 1);
+    CHECK(b(999) == 2);
+    CHECK(c(999) == 3);
+}
+
+TEST_CASE("shared_ndarray move tests")
+{
+    shared_ndarray<int,2> a(2,2,1);
+    const int* p = static_cast<const shared_ndarray<int,2>&>(a).data();
+
+    shared_ndarray<int,2> b(std::move(a));
+    CHECK(static_cast<const shared_ndarray<int,2>&>(b).data() == p);
+    CHECK(a.size() == 0);
+    CHECK(a.shape(0) == 0);
+    CHECK(a.cview().size() == 0);
+    shared_ndarray<int,2> c(a);
+    CHECK(c.size() == 0);
+
+    shared_ndarray<int,2> d(3,3,2);
+    d = std::move(b);
+    CHECK(d.size() == 4);
+    CHECK(b.size() == 0);
+    CHECK(b.unique());
+}
+
+TEST_CASE("shared_ndarray construction tests")
+{
+    ndarray<int,2> a = {{1,2},{3,4}};
+    const int* p = a.data();
+
+    shared_ndarray<int,2> s(std::move(a));
+    const shared_ndarray<int,2>& cs = s;
+    CHECK(cs.data() == p);
+    CHECK(s.shape(0) == 2);
+    CHECK(s.size() == 4);
+
+    shared_ndarray<int,2> t(extents_t<2>{2,2}, 7);
+    CHECK(t(indices_t<2>{1,1}) == 7);
+
+    shared_ndarray<int,2> u;
+    u = s;
+    CHECK(u == s);
+    CHECK(s.use_count() == 2);
+}
+
+TEST_CASE("shared_ndarray iterator tests")
+{
+    shared_ndarray<int,1> a(4,1);
+    shared_ndarray<int,1> b(a);
+
+    const shared_ndarray<int,1>& cb = b;
+    int sum = 0;
+    for (auto it = cb.begin(); it != cb.end(); ++it)
+    {
+        sum += *it;
+    }
+    CHECK(sum == 4);
+    CHECK(b.use_count() == 2);
+
+    for (auto it = b.begin(); it != b.end(); ++it)
+    {
+        *it = 2;
+    }
+    CHECK(a(0) == 1);
+    CHECK(b(3) == 2);
+}
+
+TEST_CASE("shared_ndarray view tests")
+{
+    shared_ndarray<double,2> a(2,2,3.0);
+    shared_ndarray<double,2> b(a);
+
+    const_ndarray_view<double,2> v = a.cview();
+    CHECK(v(1,1) == 3.0);
+    CHECK(a.use_count() == 2);
+
+    const_ndarray_view<double,1> row(b.cview(), indices_t<1>{1});
+    CHECK(row(0) == 3.0);
+}
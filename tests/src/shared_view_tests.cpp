@@ -0,0 +1,83 @@
+#include <catch/catch.hpp>
+#include <iostream>
+#include <functional>
+#include "acons/ndarray.hpp"
+#include "acons/shared_ndarray.hpp"
+
+using namespace acons;
+
+TEST_CASE("shared_view lifetime tests")
+{
+    std::function<double()> consumer;
+    {
+        ndarray<double,2> a = {{1,2,3},{4,5,6}};
+        shared_view<double,2> v = make_shared_view(std::move(a));
+        shared_view<double,1> row(v, indices_t<1>{1});
+        consumer = [row]() {return row(0) + row(2);};
+    }
+    CHECK(consumer() == 10.0);
+}
+
+TEST_CASE("shared_view slice and reduce tests")
+{
+    auto storage = std::make_shared<ndarray<int,3>>(2,3,4,0);
+    for (size_t i = 0; i < storage->size(); ++i)
+    {
+        storage->data()[i] = static_cast<int>(i);
+    }
+
+    SECTION("slices")
+    {
+        shared_view<int,3> v(storage, {slice(0,2),slice(1,3),slice(0,4,2)});
+        ndarray_view<int,3> expected(*storage, {slice(0,2),slice(1,3),slice(0,4,2)});
+        CHECK(v == expected);
+        CHECK(v.owner() == storage);
+        CHECK(storage.use_count() == 2);
+    }
+    SECTION("first dimension")
+    {
+        shared_view<int,2> v(storage, indices_t<1>{1});
+        CHECK(v(0,0) == 12);
+        shared_view<int,1> w(v, indices_t<1>{2});
+        CHECK(w(3) == 23);
+        CHECK(storage.use_count() == 3);
+    }
+    SECTION("first dimension and slices")
+    {
+        shared_view<int,2> v(storage, indices_t<1>{1}, std::array<slice,2>{slice(1,3),slice(2,4)});
+        CHECK(v(0,0) == 18);
+        CHECK(v.shape(0) == 2);
+    }
+    SECTION("writes")
+    {
+        shared_view<int,2> v(storage, indices_t<1>{0});
+        v(0,0) = 100;
+        CHECK((*storage)(0,0,0) == 100);
+    }
+}
+
+TEST_CASE("const_shared_view tests")
+{
+    shared_ndarray<double,2> a(2,2,1.0);
+    const_shared_view<double,2> v = a.share();
+    CHECK(a.use_count() == 2);
+
+    // Writing to a detaches it, the view keeps the old elements
+    a(0,0) = 2.0;
+    CHECK(v(0,0) == 1.0);
+    CHECK(a(0,0) == 2.0);
+
+    const_shared_view<double,1> col(v, std::array<slice,1>{slice(0,2)}, indices_t<1>{1});
+    CHECK(col(1) == 1.0);
+
+    const_shared_view<double,1> copy(col);
+    CHECK(copy.owner() == v.owner());
+
+    auto storage = std::make_shared<const ndarray<int,1>>(3,5);
+    const_shared_view<int,1> c(storage);
+    CHECK(c(2) == 5);
+
+    shared_view<double,2> m = make_shared_view(ndarray<double,2>(2,2,3.0));
+    const_shared_view<double,1> fromm(m, indices_t<1>{1});
+    CHECK(fromm(1) == 3.0);
+}
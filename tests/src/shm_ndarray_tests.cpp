@@ -0,0 +1,159 @@
+#include <catch/catch.hpp>
+#include <iostream>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "acons/ndarray.hpp"
+#include "acons/shm_ndarray.hpp"
+
+using namespace acons;
+
+namespace {
+
+std::string segment_name(const char* tag)
+{
+    return std::string("/acons_test_") + tag + "_" + std::to_string(getpid());
+}
+
+}
+
+TEST_CASE("shm_ndarray create and open tests")
+{
+    std::string name = segment_name("open");
+    shm_ndarray<double,2>::remove(name);
+
+    shm_ndarray<double,2> a = shm_ndarray<double,2>::create(name, extents_t<2>{3,4}, 1.0);
+    CHECK(reinterpret_cast<std::uintptr_t>(a.data()) % shm_data_alignment == 0);
+    a(2,3) = 5.0;
+
+    shm_ndarray<double,2> b = shm_ndarray<double,2>::open(name);
+    CHECK(std::equal(b.shape().begin(), b.shape().end(), a.shape().begin()));
+    CHECK(b.header().dtype == static_cast<uint32_t>(shm_dtype::float64));
+
+    const shm_ndarray<double,2>& cb = b;
+    const_ndarray_view<double,2> v = cb.get_view();
+    CHECK(v(2,3) == 5.0);
+    CHECK(v(0,0) == 1.0);
+
+    // Writes through one mapping are seen through the other
+    ndarray_view<double,2> w = a.get_view();
+    w(1,1) = 7.0;
+    CHECK(cb(1,1) == 7.0);
+    CHECK(cb.data() != a.data());
+
+    CHECK(shm_ndarray<double,2>::remove(name));
+    CHECK(v(1,1) == 7.0);
+}
+
+TEST_CASE("const_shm_ndarray tests")
+{
+    std::string name = segment_name("readonly");
+    shm_ndarray<int,2>::remove(name);
+    shm_ndarray<int,2> a = shm_ndarray<int,2>::create(name, extents_t<2>{2,3}, 4);
+
+    const_shm_ndarray<int,2> b = const_shm_ndarray<int,2>::open(name);
+    CHECK(b.size() == 6);
+    CHECK(b(1,2) == 4);
+    CHECK(b(indices_t<2>{0,1}) == 4);
+    CHECK(b.get_view()(1,0) == 4);
+    CHECK((std::is_same<decltype(b.data()), const int*>::value));
+    CHECK((std::is_same<decltype(b(1,2)), const int&>::value));
+
+    a(1,2) = 5;
+    CHECK(b(1,2) == 5);
+
+    CHECK_THROWS_AS((const_shm_ndarray<double,2>::open(name)), std::invalid_argument);
+    shm_ndarray<int,2>::remove(name);
+}
+
+TEST_CASE("shm_ndarray header mismatch tests")
+{
+    std::string name = segment_name("mismatch");
+    shm_ndarray<float,2>::remove(name);
+    shm_ndarray<float,2> a = shm_ndarray<float,2>::create(name, extents_t<2>{2,2});
+
+    CHECK_THROWS_AS((shm_ndarray<double,2>::open(name)), std::invalid_argument);
+    CHECK_THROWS_AS((shm_ndarray<int32_t,2>::open(name)), std::invalid_argument);
+    CHECK_THROWS_AS((shm_ndarray<float,3>::open(name)), std::invalid_argument);
+    CHECK_THROWS_AS((shm_ndarray<float,2,column_major>::open(name)), std::invalid_argument);
+    CHECK_THROWS_AS((shm_ndarray<float,2,row_major,one_based>::open(name)), std::invalid_argument);
+    CHECK_THROWS_AS((shm_ndarray<float,2>::create(name, extents_t<2>{2,2})), std::system_error);
+
+    shm_ndarray<float,2>::remove(name);
+    CHECK_THROWS_AS((shm_ndarray<float,2>::open(name)), std::system_error);
+}
+
+TEST_CASE("shm_ndarray corrupt header tests")
+{
+    std::string name = segment_name("corrupt");
+    shm_ndarray<double,2>::remove(name);
+    shm_ndarray<double,2> a = shm_ndarray<double,2>::create(name, extents_t<2>{3,4}, 0.0);
+    shm_header& h = const_cast<shm_header&>(a.header());
+
+    // Strides that reach past the elements
+    h.strides[0] = 1000;
+    CHECK_THROWS_AS((shm_ndarray<double,2>::open(name)), std::invalid_argument);
+    h.strides[0] = 4;
+    CHECK(shm_ndarray<double,2>::open(name).size() == 12);
+
+    // A shape whose product overflows to the recorded size
+    h.shape[0] = uint64_t(1) << 33;
+    h.shape[1] = uint64_t(1) << 31;
+    h.size = 0;
+    CHECK_THROWS_AS((shm_ndarray<double,2>::open(name)), std::invalid_argument);
+
+    h.shape[0] = 4;
+    h.shape[1] = 3;
+    h.size = 12;
+    CHECK_THROWS_AS((shm_ndarray<double,2>::open(name)), std::invalid_argument);
+
+    shm_ndarray<double,2>::remove(name);
+}
+
+TEST_CASE("shm_ndarray column major one based tests")
+{
+    typedef shm_ndarray<int,2,column_major,one_based> array_type;
+    std::string name = segment_name("colmajor");
+    array_type::remove(name);
+
+    array_type a = array_type::create(name, extents_t<2>{2,3}, 0);
+    a(2,3) = 9;
+    CHECK(a.data()[5] == 9);
+
+    array_type b = array_type::open(name);
+    CHECK(b(2,3) == 9);
+    CHECK(std::equal(b.strides().begin(), b.strides().end(), a.strides().begin()));
+    array_type::remove(name);
+}
+
+TEST_CASE("shm_ndarray cross process tests")
+{
+    std::string name = segment_name("fork");
+    shm_ndarray<int64_t,1>::remove(name);
+    shm_ndarray<int64_t,1> a = shm_ndarray<int64_t,1>::create(name, extents_t<1>{100}, 0);
+
+    pid_t pid = fork();
+    REQUIRE(pid != -1);
+    if (pid == 0)
+    {
+        int status = 1;
+        try
+        {
+            shm_ndarray<int64_t,1> b = shm_ndarray<int64_t,1>::open(name);
+            for (size_t i = 0; i < b.size(); ++i)
+            {
+                b(i) = static_cast<int64_t>(i*i);
+            }
+            status = 0;
+        }
+        catch (...)
+        {
+        }
+        _exit(status);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    CHECK(WIFEXITED(status));
+    CHECK(WEXITSTATUS(status) == 0);
+    CHECK(a(99) == 99*99);
+    shm_ndarray<int64_t,1>::remove(name);
+}
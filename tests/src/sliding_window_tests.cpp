@@ -0,0 +1,122 @@
+#include <catch/catch.hpp>
+#include <iostream>
+#include "acons/ndarray.hpp"
+
+using namespace acons;
+
+TEST_CASE("1-dim sliding_window_view tests")
+{
+    ndarray<double,1> a = {0,1,2,3,4,5};
+
+    SECTION("unit step")
+    {
+        auto w = sliding_window_view(a, extents_t<1>{3});
+        REQUIRE(w.shape(0) == 4);
+        REQUIRE(w.shape(1) == 3);
+        CHECK(w(0,0) == 0);
+        CHECK(w(1,0) == 1);
+        CHECK(w(1,2) == 3);
+        CHECK(w(3,2) == 5);
+    }
+
+    SECTION("step 2")
+    {
+        auto w = sliding_window_view(a, extents_t<1>{2}, indices_t<1>{2});
+        REQUIRE(w.shape(0) == 3);
+        REQUIRE(w.shape(1) == 2);
+        CHECK(w(0,1) == 1);
+        CHECK(w(1,0) == 2);
+        CHECK(w(2,1) == 5);
+    }
+
+    SECTION("window writes through to array")
+    {
+        auto w = sliding_window_view(a, extents_t<1>{3});
+        w(2,1) = 30;
+        CHECK(a(3) == 30);
+    }
+
+    SECTION("window larger than array")
+    {
+        CHECK_THROWS_AS(sliding_window_view(a, extents_t<1>{7}), std::invalid_argument);
+    }
+}
+
+TEST_CASE("2-dim sliding_window_view tests")
+{
+    ndarray<double,2> a = {{0,1,2,3},{4,5,6,7},{8,9,10,11}};
+
+    SECTION("row_major")
+    {
+        auto w = sliding_window_view(a, extents_t<2>{2,2});
+        REQUIRE(w.shape(0) == 2);
+        REQUIRE(w.shape(1) == 3);
+        REQUIRE(w.shape(2) == 2);
+        REQUIRE(w.shape(3) == 2);
+        CHECK(w(1,2,0,0) == 6);
+        CHECK(w(1,2,1,1) == 11);
+        CHECK(w(0,1,1,0) == 5);
+    }
+
+    SECTION("over a sliced view")
+    {
+        ndarray_view<double,2> v(a, {slice(1,3),slice(1,4)});
+        const_ndarray_view<double,4> w = sliding_window_view(v, extents_t<2>{2,2});
+        REQUIRE(w.shape(0) == 1);
+        REQUIRE(w.shape(1) == 2);
+        CHECK(w(0,0,0,0) == 5);
+        CHECK(w(0,1,1,1) == 11);
+    }
+
+    SECTION("column_major")
+    {
+        ndarray<double,2,column_major> b = {{0,1,2,3},{4,5,6,7},{8,9,10,11}};
+        auto w = sliding_window_view(b, extents_t<2>{2,3}, indices_t<2>{1,1});
+        REQUIRE(w.shape(0) == 2);
+        REQUIRE(w.shape(1) == 2);
+        CHECK(w(1,1,0,0) == 5);
+        CHECK(w(1,1,1,2) == 11);
+    }
+}
+
+TEST_CASE("sliding_windows iterator tests")
+{
+    ndarray<double,2> a = {{0,1,2,3},{4,5,6,7},{8,9,10,11}};
+
+    SECTION("window sums")
+    {
+        std::vector<double> sums;
+        for (const auto& w : sliding_windows(a, extents_t<2>{2,2}))
+        {
+            sums.push_back(w(0,0) + w(0,1) + w(1,0) + w(1,1));
+        }
+        std::vector<double> expected = {10,14,18,26,30,34};
+        CHECK(sums == expected);
+    }
+
+    SECTION("strided windows over a view")
+    {
+        ndarray_view<double,2> v(a, {slice(0,3),slice(0,4)});
+        auto range = sliding_windows(v, extents_t<2>{1,2}, indices_t<2>{2,2});
+        REQUIRE(range.size() == 4);
+        std::vector<double> firsts;
+        for (auto it = range.begin(); it != range.end(); ++it)
+        {
+            firsts.push_back((*it)(0,0));
+        }
+        std::vector<double> expected = {0,2,8,10};
+        CHECK(firsts == expected);
+    }
+
+    SECTION("column_major windows")
+    {
+        ndarray<double,2,column_major> b = {{0,1,2},{3,4,5}};
+        std::vector<double> firsts;
+        for (const auto& w : sliding_windows(b, extents_t<2>{2,2}))
+        {
+            firsts.push_back(w(1,1));
+        }
+        std::vector<double> expected = {4,5};
+        CHECK(firsts == expected);
+    }
+}
@@ -0,0 +1,141 @@
+#include <catch/catch.hpp>
+#include <iostream>
+#include "acons/ndarray.hpp"
+#include "acons/soa_ndarray.hpp"
+
+using namespace acons;
+
+namespace {
+
+struct particle
+{
+    double x, y, z;
+    float mass;
+    bool alive;
+};
+
+bool operator==(const particle& a, const particle& b)
+{
+    return a.x == b.x && a.y == b.y && a.z == b.z && a.mass == b.mass && a.alive == b.alive;
+}
+
+particle make_particle(size_t i)
+{
+    return particle{double(i), 2.0*i, -1.0*i, 0.5f*i, i % 2 == 0};
+}
+
+}
+
+namespace acons {
+
+template <>
+struct soa_traits<particle>
+{
+    typedef std::tuple<ACONS_SOA_FIELD(particle, x), ACONS_SOA_FIELD(particle, y), ACONS_SOA_FIELD(particle, z),
+                       ACONS_SOA_FIELD(particle, mass), ACONS_SOA_FIELD(particle, alive)> fields;
+};
+
+}
+
+TEST_CASE("soa_ndarray construction tests")
+{
+    soa_ndarray<particle,2> a(extents_t<2>{3,4}, particle{1,2,3,4.0f,true});
+    CHECK(a.field_count == 5);
+    CHECK(a.size() == 12);
+    CHECK(a.shape(1) == 4);
+    CHECK(static_cast<particle>(a(2,3)) == (particle{1,2,3,4.0f,true}));
+    CHECK(a.field<3>()(1,1) == 4.0f);
+
+    soa_ndarray<particle,2> empty;
+    CHECK(empty.empty());
+    CHECK(empty.shape(0) == 0);
+
+    // From an array of records, and back
+    ndarray<particle,2> records(3, 5);
+    for (size_t i = 0; i < records.size(); ++i)
+    {
+        records.data()[i] = make_particle(i);
+    }
+    soa_ndarray<particle,2> b(records);
+    CHECK(static_cast<particle>(b(1,2)) == make_particle(7));
+    CHECK(b.field(&particle::y)(2,4) == 28.0);
+    ndarray<particle,2> back = b.to_ndarray();
+    CHECK(std::equal(back.data(), back.data() + back.size(), records.data()));
+
+    // From a strided view, into a column major array
+    const_ndarray_view<particle,2> v(records, {slice(0,3,2),slice(1,5,2)});
+    soa_ndarray<particle,2,column_major> c(v);
+    CHECK(c.shape(0) == 2);
+    CHECK(static_cast<particle>(c(1,1)) == make_particle(13));
+    CHECK(c.field<0>().data()[1] == 11.0);
+
+    soa_ndarray<particle,2> d = b;
+    CHECK(d == b);
+    d(0,0).get<4>() = false;
+    CHECK(d != b);
+    swap(d, a);
+    CHECK(d.shape(1) == 4);
+    CHECK(a.shape(1) == 5);
+}
+
+TEST_CASE("soa_ndarray field tests")
+{
+    soa_ndarray<particle,2> a(extents_t<2>{4,6});
+    auto x = a.field(&particle::x);
+    auto vx = a.field<1>();
+    CHECK(x.strides()[0] == 6);
+    for (size_t i = 0; i < 4; ++i)
+    {
+        for (size_t j = 0; j < 6; ++j)
+        {
+            x(i,j) = double(i*6 + j);
+            vx(i,j) = 1.0;
+        }
+    }
+
+    // Each field is one contiguous buffer
+    double* px = a.field_data<0>();
+    const double* pvx = a.field_data(&particle::y);
+    for (size_t k = 0; k < a.size(); ++k)
+    {
+        px[k] += 0.5*pvx[k];
+    }
+    CHECK(a.field<0>()(3,5) == 23.5);
+    CHECK(a(3,5).get(&particle::x) == 23.5);
+
+    const soa_ndarray<particle,2>& ca = a;
+    const_ndarray_view<float,2> mass = ca.field(&particle::mass);
+    CHECK(mass.shape(1) == 6);
+    CHECK(ca(1,2).x == 8.5);
+
+    double particle::*not_a_field = nullptr;
+    CHECK_THROWS_AS(a.field(not_a_field), std::invalid_argument);
+
+    soa_ndarray<particle,2,row_major,one_based> b(extents_t<2>{2,2});
+    b.field<0>()(2,2) = 7.0;
+    CHECK(b(2,2).get<0>() == 7.0);
+}
+
+TEST_CASE("soa_reference tests")
+{
+    soa_ndarray<particle,1> a(extents_t<1>{5});
+    for (size_t i = 0; i < 5; ++i)
+    {
+        a(i) = make_particle(i);
+    }
+    CHECK(a.field<4>()(3) == false);
+    CHECK(a.field(&particle::mass)(3) == 1.5f);
+
+    // Assigning one proxy to another copies the record
+    a(0) = a(3);
+    CHECK(static_cast<particle>(a(0)) == make_particle(3));
+
+    particle p = a(4);
+    p.z = 100.0;
+    a(indices_t<1>{1}) = p;
+    CHECK(a.field(&particle::z)(1) == 100.0);
+    CHECK(a.field(&particle::x)(1) == 4.0);
+
+    a(2).get(&particle::alive) = false;
+    CHECK_FALSE(a(2).get<4>());
+}
@@ -0,0 +1,316 @@
+#include <catch/catch.hpp>
+#include <iostream>
+#include <limits>
+#include <cmath>
+#include "acons/ndarray.hpp"
+#include "acons/sort.hpp"
+
+using namespace acons;
+
+namespace {
+
+struct version
+{
+    int release;
+    int patch;
+
+    bool operator<(const version& other) const
+    {
+        return release < other.release || (release == other.release && patch < other.patch);
+    }
+};
+
+template <typename Array>
+void fill_pattern(Array& a, long seed)
+{
+    typedef typename Array::element_type T;
+    unsigned long x = 2463534242ul + seed;
+    for (auto p = a.data(); p != a.data() + a.size(); ++p)
+    {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        *p = static_cast<T>(static_cast<long>(x % 2001) - 1000);
+    }
+}
+
+template <typename Array>
+bool lanes_sorted_along_last(const Array& a)
+{
+    for (size_t i = 0; i < a.shape(0); ++i)
+    {
+        for (size_t j = 1; j < a.shape(1); ++j)
+        {
+            if (a(i,j) < a(i,j-1))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+}
+
+TEST_CASE("sort 1-D tests")
+{
+    ndarray<int,1> a = {3,-1,4,1,-5,9,2,6};
+    sort(a);
+    CHECK(a == ndarray<int,1>{-5,-1,1,2,3,4,6,9});
+
+    ndarray<double,1> b = {2.5,-0.5,1.0,-3.0};
+    sort(b, 0, std::greater<double>());
+    CHECK(b == ndarray<double,1>{2.5,1.0,-0.5,-3.0});
+
+    CHECK_THROWS_AS(sort(a, 1), std::out_of_range);
+}
+
+TEST_CASE("sort 2-D axis tests")
+{
+    ndarray<int,2> a = {{3,1,2},{0,5,4}};
+
+    SECTION("last axis")
+    {
+        sort(a);
+        CHECK(a == ndarray<int,2>{{1,2,3},{0,4,5}});
+    }
+
+    SECTION("first axis, strided lanes")
+    {
+        sort(a, 0);
+        CHECK(a == ndarray<int,2>{{0,1,2},{3,5,4}});
+    }
+
+    SECTION("column major")
+    {
+        ndarray<int,2,column_major> c = {{3,1,2},{0,5,4}};
+        sort(c, 1);
+        CHECK(c == ndarray<int,2,column_major>{{1,2,3},{0,4,5}});
+    }
+
+    SECTION("view")
+    {
+        ndarray<int,2> b = {{9,8,7,6},{5,4,3,2},{1,0,-1,-2}};
+        sort(ndarray_view<int,2>(b, {slice(0,3),slice(0,4,2)}), 0);
+        CHECK(b == ndarray<int,2>{{1,8,-1,6},{5,4,3,2},{9,0,7,-2}});
+    }
+}
+
+TEST_CASE("sort radix tests")
+{
+    // Lanes long enough for radix sort, on several threads
+    SECTION("int")
+    {
+        ndarray<int,2> a(20, 1000);
+        fill_pattern(a, 1);
+        ndarray<int,2> expected(a);
+        for (size_t i = 0; i < 20; ++i)
+        {
+            std::sort(expected.data() + i*1000, expected.data() + (i+1)*1000);
+        }
+        sort(a, 1, 3);
+        CHECK(a == expected);
+    }
+
+    SECTION("unsigned char, strided")
+    {
+        ndarray<uint8_t,2> a(600, 3);
+        fill_pattern(a, 2);
+        sort(a, 0);
+        bool ok = true;
+        for (size_t j = 0; j < 3; ++j)
+        {
+            for (size_t i = 1; i < 600; ++i)
+            {
+                ok = ok && a(i-1,j) <= a(i,j);
+            }
+        }
+        CHECK(ok);
+    }
+
+    SECTION("int64_t")
+    {
+        ndarray<int64_t,1> a(5000);
+        fill_pattern(a, 3);
+        a(7) = (std::numeric_limits<int64_t>::min)();
+        a(8) = (std::numeric_limits<int64_t>::max)();
+        sort(a);
+        CHECK(a(0) == (std::numeric_limits<int64_t>::min)());
+        CHECK(a(4999) == (std::numeric_limits<int64_t>::max)());
+        CHECK(std::is_sorted(a.data(), a.data() + a.size()));
+    }
+
+    SECTION("double")
+    {
+        ndarray<double,2> a(4, 700);
+        fill_pattern(a, 4);
+        for (auto p = a.data(); p != a.data() + a.size(); ++p)
+        {
+            *p *= 0.125;
+        }
+        a(0,5) = -std::numeric_limits<double>::infinity();
+        a(0,6) = std::numeric_limits<double>::infinity();
+        a(1,7) = -0.0;
+        sort(a);
+        CHECK(lanes_sorted_along_last(a));
+        CHECK(a(0,0) == -std::numeric_limits<double>::infinity());
+        CHECK(a(0,699) == std::numeric_limits<double>::infinity());
+    }
+
+    SECTION("float with NaN")
+    {
+        ndarray<float,1> a(300);
+        fill_pattern(a, 5);
+        a(10) = std::numeric_limits<float>::quiet_NaN();
+        sort(a);
+        CHECK(a(299) != a(299));
+        CHECK(std::is_sorted(a.data(), a.data() + 299));
+    }
+
+    SECTION("short float lanes with NaN and signed zero")
+    {
+        const float nan = std::numeric_limits<float>::quiet_NaN();
+        ndarray<float,2> a = {{0.0f,8.0f,nan,-1.0f,-0.0f,3.0f,nan,4.0f},
+                              {2.0f,nan,1.0f,-0.0f,0.0f,-5.0f,7.0f,6.0f}};
+        ndarray<float,2,column_major> b(2, 8);
+        for (size_t i = 0; i < 2; ++i)
+        {
+            for (size_t j = 0; j < 8; ++j)
+            {
+                b(i,j) = a(i,j);
+            }
+        }
+        sort(a);
+        sort(b);
+        for (size_t i = 0; i < 2; ++i)
+        {
+            CHECK(std::is_sorted(&a(i,0), &a(i,0) + 6));
+            CHECK(a(i,7) != a(i,7));
+            CHECK(std::signbit(a(i,1)));
+            CHECK_FALSE(std::signbit(a(i,2)));
+        }
+        CHECK(a(0,6) != a(0,6));
+        CHECK(a(1,6) == 7.0f);
+        CHECK(b(0,0) == -1.0f);
+        CHECK(std::signbit(b(1,1)));
+        CHECK(b(1,7) != b(1,7));
+
+        ndarray<double,1> c = {3.0, std::numeric_limits<double>::quiet_NaN(), 1.0, 2.0};
+        partition(c, 2);
+        CHECK(c(2) == 3.0);
+        CHECK(c(3) != c(3));
+    }
+}
+
+TEST_CASE("argsort tests")
+{
+    ndarray<int,2> a = {{30,10,20,10},{5,5,1,7}};
+    auto idx = argsort(a);
+    CHECK(idx == ndarray<size_t,2>{{1,3,2,0},{2,0,1,3}});
+
+    auto idx0 = argsort(a, 0);
+    CHECK(idx0 == ndarray<size_t,2>{{1,1,1,1},{0,0,0,0}});
+
+    ndarray<int,1,row_major,one_based> b = {3,1,2};
+    auto bi = argsort(b);
+    CHECK(bi(1) == 2);
+    CHECK(bi(2) == 3);
+    CHECK(bi(3) == 1);
+
+    SECTION("radix, stable")
+    {
+        ndarray<float,1> c(1000);
+        fill_pattern(c, 6);
+        for (auto p = c.data(); p != c.data() + c.size(); ++p)
+        {
+            *p = static_cast<float>(static_cast<int>(*p) % 10);
+        }
+        auto ci = argsort(c);
+        bool ok = true;
+        for (size_t i = 1; i < 1000; ++i)
+        {
+            ok = ok && (c(ci(i-1)) < c(ci(i)) || (c(ci(i-1)) == c(ci(i)) && ci(i-1) < ci(i)));
+        }
+        CHECK(ok);
+    }
+
+    SECTION("comparison only element type")
+    {
+        ndarray<version,1> s(3);
+        s(0) = version{2,1};
+        s(1) = version{1,9};
+        s(2) = version{2,0};
+        CHECK(argsort(s) == ndarray<size_t,1>{1,2,0});
+    }
+}
+
+TEST_CASE("partition tests")
+{
+    ndarray<int,2> a(6, 50);
+    fill_pattern(a, 7);
+    ndarray<int,2> sorted(a);
+    sort(sorted);
+
+    for (size_t kth : {size_t(0), size_t(17), size_t(49)})
+    {
+        ndarray<int,2> b(a);
+        partition(b, kth);
+        bool ok = true;
+        for (size_t i = 0; i < 6; ++i)
+        {
+            ok = ok && b(i,kth) == sorted(i,kth);
+            for (size_t j = 0; j < 50; ++j)
+            {
+                ok = ok && (j < kth ? b(i,j) <= b(i,kth) : b(i,j) >= b(i,kth));
+            }
+        }
+        CHECK(ok);
+    }
+
+    ndarray<int,2> c = {{4,9},{1,3},{7,2}};
+    partition(c, 1, 0);
+    CHECK(c(1,0) == 4);
+    CHECK(c(1,1) == 3);
+
+    CHECK_THROWS_AS(partition(c, 3, 0), std::out_of_range);
+}
+
+TEST_CASE("topk tests")
+{
+    ndarray<int,2> a = {{1,7,3,7,5},{9,0,9,2,4}};
+
+    auto largest = topk(a, 2);
+    CHECK(largest.values == ndarray<int,2>{{7,7},{9,9}});
+    CHECK(largest.indices == ndarray<size_t,2>{{1,3},{0,2}});
+
+    auto smallest = topk(a, 3, 1, false);
+    CHECK(smallest.values == ndarray<int,2>{{1,3,5},{0,2,4}});
+    CHECK(smallest.indices == ndarray<size_t,2>{{0,2,4},{1,3,4}});
+
+    auto columns = topk(a, 1, 0);
+    CHECK(columns.values == ndarray<int,2>{{9,7,9,7,5}});
+    CHECK(columns.indices == ndarray<size_t,2>{{1,0,1,0,0}});
+
+    auto none = topk(a, 0);
+    CHECK(none.values.shape(1) == 0);
+
+    CHECK_THROWS_AS(topk(a, 6), std::invalid_argument);
+
+    SECTION("many lanes")
+    {
+        ndarray<float,2> b(64, 500);
+        fill_pattern(b, 8);
+        auto r = topk(b, 10, 1, true, 4);
+        ndarray<float,2> sorted(b);
+        sort(sorted, 1, std::greater<float>());
+        bool ok = true;
+        for (size_t i = 0; i < 64; ++i)
+        {
+            for (size_t j = 0; j < 10; ++j)
+            {
+                ok = ok && r.values(i,j) == sorted(i,j) && b(i,r.indices(i,j)) == r.values(i,j);
+            }
+        }
+        CHECK(ok);
+    }
+}
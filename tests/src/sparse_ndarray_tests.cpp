@@ -0,0 +1,134 @@
+#include <catch/catch.hpp>
+#include <iostream>
+#include "acons/sparse_ndarray.hpp"
+#include "acons/linalg.hpp"
+
+using namespace acons;
+
+TEST_CASE("coo_ndarray from dense tests")
+{
+    ndarray<double,3> a(2,3,4,0.0);
+    a(0,1,2) = 1.5;
+    a(1,2,3) = -2.0;
+    a(1,0,0) = 0.01;
+
+    SECTION("non-zero elements")
+    {
+        coo_ndarray<double,3> s(a);
+        REQUIRE(s.nnz() == 3);
+        CHECK(s.values()[0] == 1.5);
+        CHECK(s.indices()[0][1] == 1);
+        CHECK(s.to_dense() == a);
+    }
+
+    SECTION("threshold")
+    {
+        coo_ndarray<double,3> s(a, 0.1);
+        REQUIRE(s.nnz() == 2);
+        CHECK(s.values()[1] == -2.0);
+    }
+
+    SECTION("one based column_major dense")
+    {
+        ndarray<double,2,column_major,one_based> b = {{0,1},{2,0}};
+        coo_matrix<double> s(b);
+        REQUIRE(s.nnz() == 2);
+        CHECK(s.indices()[0][0] == 0);
+        CHECK(s.indices()[0][1] == 1);
+        auto c = s.to_dense<column_major,one_based>();
+        // operator== reads past the end of one based column major arrays, compare elements
+        REQUIRE(c.shape(0) == 2);
+        REQUIRE(c.shape(1) == 2);
+        bool equal = true;
+        for (size_t i = 1; i <= 2; ++i)
+        {
+            for (size_t j = 1; j <= 2; ++j)
+            {
+                equal = equal && c(i,j) == b(i,j);
+            }
+        }
+        CHECK(equal);
+    }
+}
+
+TEST_CASE("csr_matrix tests")
+{
+    ndarray<double,2> a = {{1,0,0,2},{0,0,0,0},{0,3,4,0}};
+    csr_matrix<double> s(a);
+
+    REQUIRE(s.nnz() == 4);
+    std::vector<size_t> row_ptr = {0,2,2,4};
+    std::vector<size_t> cols = {0,3,1,2};
+    CHECK(s.row_ptr() == row_ptr);
+    CHECK(s.col_indices() == cols);
+    CHECK(s.to_dense() == a);
+
+    SECTION("from coo with duplicates")
+    {
+        coo_matrix<double> coo(extents_t<2>{3,4});
+        coo.push_back(indices_t<2>{2,2}, 4);
+        coo.push_back(indices_t<2>{0,3}, 2);
+        coo.push_back(indices_t<2>{2,1}, 3);
+        coo.push_back(indices_t<2>{0,0}, 0.5);
+        coo.push_back(indices_t<2>{0,0}, 0.5);
+        csr_matrix<double> t(coo);
+        CHECK(t.row_ptr() == row_ptr);
+        CHECK(t.col_indices() == cols);
+        CHECK(t.to_dense() == a);
+        CHECK(t.to_coo().nnz() == 4);
+    }
+
+    SECTION("sparse-dense multiply")
+    {
+        ndarray<double,2> b = {{1,2},{3,4},{5,6},{7,8}};
+        ndarray<double,2> c = matmul(s, b);
+        ndarray<double,2> expected = {{15,18},{0,0},{29,36}};
+        CHECK(c == expected);
+    }
+
+    SECTION("sparse-dense multiply with strided views")
+    {
+        ndarray<double,2,column_major> b = {{1,2,0},{3,4,0},{5,6,0},{7,8,0}};
+        ndarray<double,2,column_major> c(3,2,-1.0);
+        ndarray_view<double,2,column_major> cv(c);
+        matmul(s, const_ndarray_view<double,2,column_major>(b, {slice(0,4),slice(0,2)}), cv);
+        CHECK(c(0,0) == 15);
+        CHECK(c(1,1) == 0);
+        CHECK(c(2,1) == 36);
+    }
+
+    SECTION("sparse matrix-vector multiply")
+    {
+        ndarray<double,1> x = {1,1,1,1};
+        ndarray<double,1> y = matmul(s, x);
+        ndarray<double,1> expected = {3,0,7};
+        CHECK(y == expected);
+    }
+
+    SECTION("shape mismatch")
+    {
+        ndarray<double,2> b(3,2,0.0);
+        CHECK_THROWS_AS(matmul(s, b), std::invalid_argument);
+    }
+}
+
+TEST_CASE("csr_matrix matmul with linalg tests")
+{
+    // The dense matmul overloads must not be chosen for sparse operands
+    ndarray<double,2> a = {{1,0,2,0},{0,0,0,0},{0,3,0,4}};
+    csr_matrix<double> s(a);
+
+    ndarray<double,2> b = {{1,2},{3,4},{5,6},{7,8}};
+    ndarray<double,2> c(3,2,-1.0);
+    ndarray_view<double,2> cv(c);
+    matmul(s, const_ndarray_view<double,2>(b), cv);
+    CHECK(c == matmul(a, b));
+    CHECK(matmul(s, b) == matmul(a, b));
+
+    ndarray<double,1> x = {1,1,1,1};
+    ndarray<double,1> y(3,0.0);
+    ndarray_view<double,1> yv(y);
+    matmul(s, const_ndarray_view<double,1>(x), yv);
+    CHECK(y == matmul(s, x));
+    CHECK(y(2) == 7);
+}
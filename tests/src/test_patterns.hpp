@@ -0,0 +1,17 @@
+#ifndef ACONS_TESTS_TEST_PATTERNS_HPP
+#define ACONS_TESTS_TEST_PATTERNS_HPP
+
+// Fills the elements of a in storage order with (i*7 + 3) % period - shift, for i
+// counting up from seed. The defaults give small values of both signs.
+template <typename Array>
+void fill_pattern(Array& a, long seed, long period = 13, long shift = 6)
+{
+    long i = seed;
+    for (auto p = a.data(); p != a.data() + a.size(); ++p)
+    {
+        *p = static_cast<typename Array::element_type>((i*7 + 3) % period - shift);
+        ++i;
+    }
+}
+
+#endif
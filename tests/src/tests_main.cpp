@@ -1,3 +1,5 @@
 #define CATCH_CONFIG_MAIN
+// Since glibc 2.34 SIGSTKSZ is not a constant, which this version of Catch requires
+#define CATCH_CONFIG_NO_POSIX_SIGNALS
 #include <catch/catch.hpp>
 